@@ -156,6 +156,9 @@ void FiffRawViewModel::initFiffData(QIODevice& p_IODevice)
         m_ChannelInfoList.append(m_pFiffIO->m_qlistRaw[0]->info.chs[i]);
     }
 
+    // memory-map local files, raw buffers are then decoded from the mapping instead of being read through the device
+    m_pFiffIO->m_qlistRaw[0]->file->map();
+
     // load FiffInfo
     m_pFiffInfo = FiffInfo::SPtr(new FiffInfo(m_pFiffIO->m_qlistRaw[0]->info));
 
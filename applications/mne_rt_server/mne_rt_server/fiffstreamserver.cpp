@@ -44,6 +44,9 @@
 
 #include "mne_rt_server.h"
 
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_constants.h>
+
 #include <stdlib.h>
 
 //=============================================================================================================
@@ -352,10 +355,27 @@ void FiffStreamServer::forwardMeasInfo(qint32 ID, const FiffInfo& p_fiffInfo)
 }
 
 //=============================================================================================================
-//ToDo increase preformance --> try inline
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    //Only serialize if at least one client started its measurement
+    bool t_bIsSending = false;
+    QMap<qint32, FiffStreamThread*>::const_iterator i;
+    for (i = m_qClientList.constBegin(); i != m_qClientList.constEnd() && !t_bIsSending; ++i)
+    {
+        t_bIsSending = i.value()->isSendingRawBuffer();
+    }
+
+    if(!t_bIsSending)
+        return;
+
+    //Serialize the FIFF_DATA_BUFFER tag once. The clients only queue implicitly shared copies of the block.
+    QByteArray t_blockRawBuffer;
+    {
+        FiffStream t_FiffStreamOut(&t_blockRawBuffer, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
+    }
+
+    emit remitRawBuffer(t_blockRawBuffer);
 }
 
 //=============================================================================================================
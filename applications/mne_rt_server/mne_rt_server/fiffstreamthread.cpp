@@ -58,6 +58,14 @@
 //=============================================================================================================
 
 #include <QtNetwork>
+#include <QtEndian>
+
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define SEND_QUEUE_HIGH_WATER_MARK  (32*1024*1024)  /**< Queued bytes above which raw buffers are dropped for a client. */
+#define SOCKET_LOW_WATER_MARK       (1024*1024)     /**< Bytes in the socket buffer below which more blocks are written. */
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -76,8 +84,12 @@ FiffStreamThread::FiffStreamThread(qint32 id, int socketDescriptor, QObject *par
 , m_iDataClientId(id)
 , m_sDataClientAlias(QString(""))
 , m_iSocketDescriptor(socketDescriptor)
+, m_iQueuedBytes(0)
+, m_iNumDropped(0)
+, m_bFlushScheduled(false)
+, m_pSocket(Q_NULLPTR)
 , m_bIsSendingRawBuffer(false)
-, m_bIsRunning(false)
+, m_bIsRunning(true)
 {
 }
 
@@ -90,7 +102,15 @@ FiffStreamThread::~FiffStreamThread()
     if(t_pFiffStreamServer)
         t_pFiffStreamServer->m_qClientList.remove(m_iDataClientId);
 
+    //Quit from within the event loop, a quit() issued before exec() started would be lost
+    m_qMutex.lock();
     m_bIsRunning = false;
+    if(m_pSocket)
+        QMetaObject::invokeMethod(m_pSocket, [this]() { quit(); }, Qt::QueuedConnection);
+    else
+        QThread::quit();
+    m_qMutex.unlock();
+
     QThread::wait();
 }
 
@@ -102,10 +122,12 @@ void FiffStreamThread::startMeas(qint32 ID)
     {
         qDebug() << "Activate raw buffer sending.";
 
-        m_qMutex.lock();
-        // ToDo send start meas
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_blockStart;
+        FiffStream t_FiffStreamOut(&t_blockStart, QIODevice::WriteOnly);
         t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        enqueue(t_blockStart, false);
+
+        m_qMutex.lock();
         m_bIsSendingRawBuffer = true;
         m_qMutex.unlock();
     }
@@ -121,10 +143,13 @@ void FiffStreamThread::stopMeas(qint32 ID)
         qDebug() << "stop raw buffer sending.";
 
         m_qMutex.lock();
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
         m_bIsSendingRawBuffer = false;
         m_qMutex.unlock();
+
+        QByteArray t_blockEnd;
+        FiffStream t_FiffStreamOut(&t_blockEnd, QIODevice::WriteOnly);
+        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        enqueue(t_blockEnd, false);
     }
 }
 
@@ -167,19 +192,14 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
 
 //=============================================================================================================
 
-void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
+void FiffStreamThread::sendRawBuffer(const QByteArray& blockRawBuffer)
 {
     if(m_bIsSendingRawBuffer)
     {
 //        qDebug() << "Send RawBuffer to client";
 
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
-
-        m_qMutex.unlock();
-
+        //The block was serialized once by the server, queueing it only increases its reference count
+        enqueue(blockRawBuffer, true);
     }
 //    else
 //    {
@@ -189,6 +209,90 @@ void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawDa
 
 //=============================================================================================================
 
+void FiffStreamThread::enqueue(const QByteArray& block, bool bDroppable)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    m_qSendQueue.enqueue(qMakePair(block, bDroppable));
+    m_iQueuedBytes += block.size();
+
+    //The client does not keep up, drop the oldest raw buffers. Block markers and infos are always sent.
+    QQueue<QPair<QByteArray, bool> >::iterator it = m_qSendQueue.begin();
+    while(m_iQueuedBytes > SEND_QUEUE_HIGH_WATER_MARK && it != m_qSendQueue.end())
+    {
+        if(it->second)
+        {
+            m_iQueuedBytes -= it->first.size();
+            it = m_qSendQueue.erase(it);
+
+            if(m_iNumDropped++ % 100 == 0)
+                printf("FiffStreamClient (ID %d): too slow, %lld raw buffers dropped\r\n\n", m_iDataClientId, m_iNumDropped);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    //Posting the event under the lock ensures the socket is still alive
+    if(m_pSocket && !m_bFlushScheduled)
+    {
+        m_bFlushScheduled = true;
+        QMetaObject::invokeMethod(m_pSocket, [this]() { flushSendQueue(); }, Qt::QueuedConnection);
+    }
+}
+
+//=============================================================================================================
+
+void FiffStreamThread::flushSendQueue()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    m_bFlushScheduled = false;
+
+    if(!m_pSocket)
+        return;
+
+    //Writing is non-blocking, the rest is written once the socket emitted bytesWritten
+    while(!m_qSendQueue.isEmpty() && m_pSocket->bytesToWrite() < SOCKET_LOW_WATER_MARK)
+    {
+        QByteArray t_block = m_qSendQueue.dequeue().first;
+        m_iQueuedBytes -= t_block.size();
+        m_pSocket->write(t_block);
+    }
+}
+
+//=============================================================================================================
+
+void FiffStreamThread::readCommands(FiffStream& p_FiffStreamIn)
+{
+    const qint64 t_iHeaderSize = sizeof(qint32)*4;
+
+    //Only read tags which arrived completely, so a slow client never blocks the event loop
+    while(m_pSocket->bytesAvailable() >= t_iHeaderSize)
+    {
+        QByteArray t_header = m_pSocket->peek(t_iHeaderSize);
+        qint32 t_iTagSize = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(t_header.constData()) + 2*sizeof(qint32));
+
+        if(m_pSocket->bytesAvailable() < t_iHeaderSize + t_iTagSize)
+            break;
+
+        FiffTag::SPtr t_pTag;
+        p_FiffStreamIn.read_tag_info(t_pTag, false);
+        p_FiffStreamIn.read_tag_data(t_pTag);
+
+        //
+        // Parse the tag
+        //
+        if(t_pTag->kind == FIFF_MNE_RT_COMMAND)
+        {
+            parseCommand(t_pTag);
+        }
+    }
+}
+
+//=============================================================================================================
+
 //void FiffStreamThread::sendData(QTcpSocket& p_qTcpSocket)
 //{
 //    if(p_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
@@ -212,9 +316,8 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 {
     if(ID == m_iDataClientId)
     {
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_blockMeasInfo;
+        FiffStream t_FiffStreamOut(&t_blockMeasInfo, QIODevice::WriteOnly);
 
 //        qint32 init_info[2];
 //        init_info[0] = FIFF_MNE_RT_CLIENT_ID;
@@ -225,7 +328,7 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 //FiffStream::start_writing_raw
 
         p_fiffInfo.writeToStream(&t_FiffStreamOut);
-        m_qMutex.unlock();
+        enqueue(t_blockMeasInfo, false);
 
 //        qDebug() << "MeasInfo Blocksize: " << m_qSendBlock.size();
     }
@@ -235,9 +338,11 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 
 void FiffStreamThread::writeClientId()
 {
-    FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+    QByteArray t_blockClientId;
+    FiffStream t_FiffStreamOut(&t_blockClientId, QIODevice::WriteOnly);
 
     t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    enqueue(t_blockClientId, false);
 }
 
 //=============================================================================================================
@@ -280,8 +385,6 @@ void FiffStreamThread::writeClientId()
 
 void FiffStreamThread::run()
 {
-    m_bIsRunning = true;
-
     FiffStreamServer* t_pParentServer = qobject_cast<FiffStreamServer*>(this->parent());
 
     connect(t_pParentServer, &FiffStreamServer::remitMeasInfo,
@@ -308,62 +411,33 @@ void FiffStreamThread::run()
 
     FiffStream t_FiffStreamIn(&t_qTcpSocket);
 
-//    int i = 0;
-    while(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
-    {
-        //
-        // Write available data
-        //
-        m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-//        qDebug() << "data available" << t_iBlockSize;
-        if(t_iBlockSize > 0)
-        {
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-//            qDebug() << ++i<< "[wrote bytes] " << t_iBytesWritten;
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
-            {
-                m_qSendBlock.clear();
-            }
-            else
-            {
-                //we have to store bytes which were not written to the socket, due to writing limit
-                //m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-                m_qSendBlock.remove(0,t_iBytesWritten); //higher performance then mid
-            }
-        }
-        m_qMutex.unlock();
-
-        //
-        // Read: Wait 10ms for incomming tag header, read and continue
-        //
-        t_qTcpSocket.waitForReadyRead(10);
-
-        if (t_qTcpSocket.bytesAvailable() >= (int)sizeof(qint32)*4)
-        {
-//            qDebug() << "goes to read bytes " ;
-            FiffTag::SPtr t_pTag;
-            t_FiffStreamIn.read_tag_info(t_pTag, false);
-
-            //
-            // wait until tag size data are available and read the data
-            //
-            while (t_qTcpSocket.bytesAvailable() < t_pTag->size())
-            {
-                t_qTcpSocket.waitForReadyRead(10);
-            }
-            t_FiffStreamIn.read_tag_data(t_pTag);
-
-            //
-            // Parse the tag
-            //
-            if(t_pTag->kind == FIFF_MNE_RT_COMMAND)
-            {
-                parseCommand(t_pTag);
-            }
-        }
-    }
+    //
+    // Serve the client from the event loop of this thread: write when data was queued or the socket drained,
+    // read when commands arrived, quit when the client disconnected
+    //
+    connect(&t_qTcpSocket, &QTcpSocket::bytesWritten,
+            &t_qTcpSocket, [this]() { flushSendQueue(); });
+    connect(&t_qTcpSocket, &QTcpSocket::readyRead,
+            &t_qTcpSocket, [this, &t_FiffStreamIn]() { readCommands(t_FiffStreamIn); });
+    connect(&t_qTcpSocket, &QTcpSocket::disconnected,
+            &t_qTcpSocket, [this]() { quit(); });
+
+    //Once the socket is set, the destructor stops the thread through the event loop
+    m_qMutex.lock();
+    m_pSocket = &t_qTcpSocket;
+    bool t_bIsRunning = m_bIsRunning;
+    m_qMutex.unlock();
+
+    //Write what was queued before the thread started
+    flushSendQueue();
+    readCommands(t_FiffStreamIn);
+
+    if(t_bIsRunning && t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
+        exec();
+
+    m_qMutex.lock();
+    m_pSocket = Q_NULLPTR;
+    m_qMutex.unlock();
 
     t_qTcpSocket.disconnectFromHost();
     if(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
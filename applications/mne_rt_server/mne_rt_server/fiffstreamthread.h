@@ -53,6 +53,8 @@
 #include <QTcpSocket>
 #include <QMutex>
 #include <QSharedPointer>
+#include <QQueue>
+#include <QPair>
 
 //=============================================================================================================
 // DEFINE NAMESPACE RTSERVER
@@ -80,6 +82,8 @@ public:
 
     inline QString getAlias();
 
+    inline bool isSendingRawBuffer();
+
 //    void deactivateRawBufferSending();
 
     void parseCommand(QSharedPointer<FIFFLIB::FiffTag> p_pTag);
@@ -98,11 +102,15 @@ private:
     int m_iSocketDescriptor;
 
     QMutex m_qMutex;
-    QByteArray m_qSendBlock;
+    QQueue<QPair<QByteArray, bool> > m_qSendQueue;  /**< Serialized blocks waiting for the socket, flagged whether they may be dropped. The blocks are implicitly shared between all clients. */
+    qint64 m_iQueuedBytes;                          /**< Size of all blocks in m_qSendQueue. */
+    qint64 m_iNumDropped;                           /**< Number of raw buffers dropped because the client was too slow. */
+    bool m_bFlushScheduled;                         /**< Whether flushSendQueue is already queued in the event loop of this thread. */
+    QTcpSocket* m_pSocket;                          /**< The client socket, only valid while run() executes. */
 
     bool m_bIsSendingRawBuffer;
 
-    bool m_bIsRunning;
+    bool m_bIsRunning;                              /**< Cleared by the destructor to stop the thread. */
 
     void startMeas(qint32 ID);
 
@@ -110,7 +118,32 @@ private:
 
     void sendMeasurementInfo(qint32 ID, const FIFFLIB::FiffInfo& p_fiffInfo);
 
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
+    void sendRawBuffer(const QByteArray& blockRawBuffer);
+
+    //=========================================================================================================
+    /**
+     * Appends a serialized block to the send queue and schedules writing it in the event loop of this thread.
+     * If the queue exceeds the high water mark the oldest droppable blocks are discarded. Thread safe.
+     *
+     * @param[in] block         The serialized block.
+     * @param[in] bDroppable    Whether the block may be dropped for slow clients (raw buffers only).
+     */
+    void enqueue(const QByteArray& block, bool bDroppable);
+
+    //=========================================================================================================
+    /**
+     * Moves blocks from the send queue to the socket without blocking, as long as the socket buffer is below
+     * its low water mark. Called in the event loop whenever data was queued or written.
+     */
+    void flushSendQueue();
+
+    //=========================================================================================================
+    /**
+     * Reads and parses all completely received command tags without blocking.
+     *
+     * @param[in] p_FiffStreamIn    The stream on the client socket.
+     */
+    void readCommands(FIFFLIB::FiffStream& p_FiffStreamIn);
     //void readToBuffer1();
 //    void readProc(QTcpSocket& p_qTcpSocket);
 };
@@ -124,6 +157,11 @@ inline QString FiffStreamThread::getAlias()
 {
     return m_sDataClientAlias;
 }
+
+inline bool FiffStreamThread::isSendingRawBuffer()
+{
+    return m_bIsSendingRawBuffer;
+}
 } // NAMESPACE
 
 #endif //FIFFSTREAMTHREAD_H
@@ -126,6 +126,7 @@ void FiffProducer::run()
     fiff_int_t first, last;
     MatrixXd data;
     MatrixXd times;
+    MatrixXf matBlock;
 
     first = from;
 
@@ -158,7 +159,8 @@ void FiffProducer::run()
             printf("error during read_raw_segment\n");
         }
 
-        MatrixXf tmp = data.cast<float>();//(inv_calsMat*data).cast<float>();
+        // Converted straight into the block which is handed over to the buffer, there is no temporary
+        matBlock = data.cast<float>();//(inv_calsMat*data).cast<float>();
 
         if(t_bRestart)
         {
@@ -175,14 +177,8 @@ void FiffProducer::run()
                 printf("error during read_raw_segment\n");
             }
 
-            MatrixXf tmp2 = data.cast<float>();//(inv_calsMat*data).cast<float>();
-
-            MatrixXf tmp3(tmp.rows(), tmp.cols()+tmp2.cols());
-
-            tmp3.block(0,0,tmp.rows(),tmp.cols()) = tmp;
-            tmp3.block(0,tmp.cols(),tmp.rows(),tmp2.cols()) = tmp2;
-
-            tmp = tmp3;
+            matBlock.conservativeResize(Eigen::NoChange, matBlock.cols()+data.cols());
+            matBlock.rightCols(data.cols()) = data.cast<float>();//(inv_calsMat*data).cast<float>();
 
             t_bRestart = false;
             first += t_iDiff;
@@ -192,9 +188,9 @@ void FiffProducer::run()
             first += quantum;
         }
 
-        // call blocks until there is free space in the buffer
-        while(!m_pFiffSimulator->m_pRawMatrixBuffer->push(tmp) && m_bIsRunning) {
-            //Do nothing until the circular buffer is ready to accept new data again
+        // call blocks with backoff until there is free space in the buffer. The matrix is swapped, not copied.
+        while(!m_pFiffSimulator->m_pRawMatrixBuffer->pushSwap(matBlock) && m_bIsRunning) {
+            //Try again until the circular buffer is ready to accept new data again
         }
     }
 
@@ -320,7 +320,7 @@ void FiffSimulator::init()
     m_pRawMatrixBuffer = NULL;
 
     if(!m_RawInfo.isEmpty())
-        m_pRawMatrixBuffer = new CircularBuffer_Matrix_float(RAW_BUFFFER_SIZE);
+        m_pRawMatrixBuffer = new SpscCircularBuffer_Matrix_float(RAW_BUFFFER_SIZE);
 }
 
 //=============================================================================================================
@@ -466,7 +466,7 @@ bool FiffSimulator::readRawInfo()
         //
         if(m_pRawMatrixBuffer)
             delete m_pRawMatrixBuffer;
-        m_pRawMatrixBuffer = new CircularBuffer_Matrix_float(10);
+        m_pRawMatrixBuffer = new SpscCircularBuffer_Matrix_float(10);
 
         mutex.unlock();
     }
@@ -486,16 +486,17 @@ void FiffSimulator::run()
     quint32 uiSamplePeriod = (unsigned int) ((t_fBuffSampleSize/t_fSamplingFrequency)*1000000.0f);
 
 //    quint32 count = 0;
-    Eigen::MatrixXf matData;
+    QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf);
 
     while(m_bIsRunning)
     {
-        if(m_pRawMatrixBuffer->pop(matData) ) {
-            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(matData));
+        // The block is swapped into the emitted matrix, it is not copied
+        if(m_pRawMatrixBuffer->pop(*t_pRawBuffer) ) {
             //        ++count;
             //        printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
 
             emit remitRawBuffer(t_pRawBuffer);
+            t_pRawBuffer = QSharedPointer<Eigen::MatrixXf>(new Eigen::MatrixXf);
             usleep(uiSamplePeriod);
         }
     }
@@ -45,7 +45,7 @@
 #include "../../mne_rt_server/IConnector.h"
 
 #include <fiff/fiff_raw_data.h>
-#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -179,7 +179,7 @@ private:
     QMutex mutex;
 
     FiffProducer*                           m_pFiffProducer;        /**< Holds the DataProducer.*/
-    UTILSLIB::CircularBuffer_Matrix_float*  m_pRawMatrixBuffer;     /**< The Circular Raw Matrix Buffer. */
+    UTILSLIB::SpscCircularBuffer_Matrix_float*  m_pRawMatrixBuffer; /**< The Circular Raw Matrix Buffer. */
     FIFFLIB::FiffRawData                    m_RawInfo;              /**< Holds the fiff raw measurement information. */
     QString                                 m_sResourceDataPath;    /**< Holds the path to the Fiff resource simulation file directory.*/
     quint32                                 m_uiBufferSampleSize;   /**< Sample size of the buffer */
@@ -106,8 +106,9 @@ RealTimeMultiSampleArrayWidget::~RealTimeMultiSampleArrayWidget()
 
 void RealTimeMultiSampleArrayWidget::update(SCMEASLIB::Measurement::SPtr pMeasurement)
 {
-    if(!m_pRTMSA) {
-        m_pRTMSA = qSharedPointerDynamicCast<RealTimeMultiSampleArray>(pMeasurement);
+    // Take the latest measurement, since it can be a snapshot which holds the new data
+    if(QSharedPointer<RealTimeMultiSampleArray> pRTMSA = qSharedPointerDynamicCast<RealTimeMultiSampleArray>(pMeasurement)) {
+        m_pRTMSA = pRTMSA;
     }
 
     if(m_pRTMSA) {
@@ -39,6 +39,12 @@
 
 #include "measurement.h"
 
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
@@ -63,3 +69,31 @@ Measurement::Measurement(int type,
 Measurement::~Measurement()
 {
 }
+
+//=============================================================================================================
+
+QSharedPointer<Measurement> Measurement::snapshot() const
+{
+    return QSharedPointer<Measurement>();
+}
+
+//=============================================================================================================
+
+QSharedPointer<Measurement> Measurement::coalesce(const QSharedPointer<Measurement>& pNewer) const
+{
+    Q_UNUSED(pNewer)
+    return QSharedPointer<Measurement>();
+}
+
+//=============================================================================================================
+
+qint64 Measurement::currentTimestamp()
+{
+    static QElapsedTimer timer = []() {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+
+    return timer.nsecsElapsed();
+}
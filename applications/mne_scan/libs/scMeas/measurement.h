@@ -50,6 +50,7 @@
 #include <QSharedPointer>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QString>
 
 //=============================================================================================================
 // DEFINE NAMESPACE SCMEASLIB
@@ -58,6 +59,17 @@
 namespace SCMEASLIB
 {
 
+//=============================================================================================================
+/**
+ * Monotonic timestamps which travel with a Measurement through the plugin graph. All times are in nanoseconds
+ * as returned by Measurement::currentTimestamp(). A value of 0 means not set.
+ */
+struct MeasurementTrace {
+    qint64  iOrigin = 0;    /**< Time at which the data left the sensor plugin. */
+    qint64  iSent = 0;      /**< Time at which the measurement was sent by the last plugin. */
+    QString sSource;        /**< Name of the plugin which sent the measurement. */
+};
+
 class SCMEASSHARED_EXPORT Measurement : public QObject
 {
     Q_OBJECT
@@ -122,6 +134,52 @@ public:
      */
     inline int type() const;
 
+    //=========================================================================================================
+    /**
+     * Returns an immutable copy of the current payload which can be handed to consumers living in other
+     * threads without blocking the producer. The default implementation returns a null pointer, meaning the
+     * Measurement type does not support snapshots and has to be delivered synchronously.
+     *
+     * @return the snapshot or a null pointer if not supported.
+     */
+    virtual QSharedPointer<Measurement> snapshot() const;
+
+    //=========================================================================================================
+    /**
+     * Merges this snapshot with a newer snapshot of the same Measurement into one snapshot which holds the payload
+     * of both, this one first. Used to coalesce queued packets. The default implementation returns a null pointer,
+     * meaning the Measurement type can not be merged and only the newer snapshot should be kept.
+     *
+     * @param[in] pNewer      the newer snapshot.
+     *
+     * @return the merged snapshot or a null pointer if not supported.
+     */
+    virtual QSharedPointer<Measurement> coalesce(const QSharedPointer<Measurement>& pNewer) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the latency trace of the Measurement.
+     *
+     * @return the latency trace.
+     */
+    inline MeasurementTrace getTrace() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the latency trace of the Measurement. Is set by the output connector right before it notifies.
+     *
+     * @param[in] trace      the latency trace.
+     */
+    inline void setTrace(const MeasurementTrace& trace);
+
+    //=========================================================================================================
+    /**
+     * Returns the current time of the monotonic clock used for the latency traces.
+     *
+     * @return the current time in nanoseconds.
+     */
+    static qint64 currentTimestamp();
+
 signals:
     void notify();
 
@@ -139,6 +197,7 @@ private:
     int                                 m_iMetaTypeId;      /**< QMetaType id of the Measurement */
     QString                             m_qString_Name;     /**< Name of the Measurement */
     bool                                m_bVisibility;      /**< Visibility status */
+    MeasurementTrace                    m_trace;            /**< Latency trace */
 };
 
 //=============================================================================================================
@@ -191,6 +250,22 @@ inline int Measurement::type() const
     return m_iMetaTypeId;
 }
 
+//=============================================================================================================
+
+inline MeasurementTrace Measurement::getTrace() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_trace;
+}
+
+//=============================================================================================================
+
+inline void Measurement::setTrace(const MeasurementTrace& trace)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_trace = trace;
+}
+
 } //NAMESPACE
 
 Q_DECLARE_METATYPE(SCMEASLIB::Measurement::SPtr)
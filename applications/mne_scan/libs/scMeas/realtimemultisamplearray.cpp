@@ -63,6 +63,7 @@ RealTimeMultiSampleArray::RealTimeMultiSampleArray(QObject *parent)
 : Measurement(QMetaType::type("RealTimeMultiSampleArray::SPtr"), parent)
 , m_fSamplingRate(0)
 , m_iMultiArraySize(10)
+, m_pMultiSampleArray(QSharedPointer<const QList<MatrixXd> >::create())
 , m_bChInfoIsInit(false)
 {
 }
@@ -248,13 +249,60 @@ void RealTimeMultiSampleArray::setValue(const MatrixXd& mat)
     //Store
     m_matSamples.push_back(mat);
 
-    m_qMutex.unlock();
-    if(m_matSamples.size() >= m_iMultiArraySize)
-    {
-        emit notify();
-        m_qMutex.lock();
-        m_matSamples.clear();
+    if(m_matSamples.size() < m_iMultiArraySize) {
         m_qMutex.unlock();
+        return;
     }
+
+    //Publish the gathered block. Copying the QList only shares its nodes, the matrices are not copied.
+    m_pMultiSampleArray = QSharedPointer<const QList<MatrixXd> >::create(m_matSamples);
+    m_matSamples.clear();
+
+    m_qMutex.unlock();
+    emit notify();
+}
+
+//=============================================================================================================
+
+QSharedPointer<Measurement> RealTimeMultiSampleArray::snapshot() const
+{
+    QSharedPointer<RealTimeMultiSampleArray> pSnapshot = QSharedPointer<RealTimeMultiSampleArray>::create();
+    pSnapshot->setName(getName());
+    pSnapshot->setVisibility(isVisible());
+    pSnapshot->setTrace(getTrace());
+
+    QMutexLocker locker(&m_qMutex);
+    pSnapshot->m_pFiffInfo_orig = m_pFiffInfo_orig;
+    pSnapshot->m_sXMLLayoutFile = m_sXMLLayoutFile;
+    pSnapshot->m_fSamplingRate = m_fSamplingRate;
+    pSnapshot->m_iMultiArraySize = m_iMultiArraySize;
+    pSnapshot->m_pMultiSampleArray = m_pMultiSampleArray;
+    pSnapshot->m_bChInfoIsInit = m_bChInfoIsInit;
+    pSnapshot->m_qListChInfo = m_qListChInfo;
+
+    return pSnapshot;
+}
+
+//=============================================================================================================
+
+QSharedPointer<Measurement> RealTimeMultiSampleArray::coalesce(const QSharedPointer<Measurement>& pNewer) const
+{
+    QSharedPointer<RealTimeMultiSampleArray> pNewerRTMSA = pNewer.dynamicCast<RealTimeMultiSampleArray>();
+    if(!pNewerRTMSA) {
+        return QSharedPointer<Measurement>();
+    }
+
+    QSharedPointer<RealTimeMultiSampleArray> pMerged = pNewerRTMSA->snapshot().staticCast<RealTimeMultiSampleArray>();
+
+    QList<MatrixXd> lMerged;
+    m_qMutex.lock();
+    lMerged = *m_pMultiSampleArray;
+    m_qMutex.unlock();
+    lMerged.append(*pMerged->m_pMultiSampleArray);
+
+    pMerged->m_iMultiArraySize = lMerged.size();
+    pMerged->m_pMultiSampleArray = QSharedPointer<const QList<MatrixXd> >::create(lMerged);
+
+    return pMerged;
 }
 
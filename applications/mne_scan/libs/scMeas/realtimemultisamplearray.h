@@ -193,12 +193,34 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the gathered multi sample array.
+     * Returns the last gathered multi sample array, i.e. the block which was published with the last notify().
      *
      * @return the current multi sample array.
      */
     inline const QList<Eigen::MatrixXd>& getMultiSampleArray();
 
+    //=========================================================================================================
+    /**
+     * Returns a RealTimeMultiSampleArray which shares the channel information and the last published
+     * multi sample array with this one. The samples are not copied and are never modified afterwards, so the
+     * snapshot can be handed to several consumers in other threads while new samples are gathered.
+     *
+     * @return the snapshot.
+     */
+    virtual QSharedPointer<Measurement> snapshot() const;
+
+    //=========================================================================================================
+    /**
+     * Returns a snapshot with the channel information of the newer snapshot and the multi sample arrays of both,
+     * this one first. The multi array size of the result is the number of merged blocks. The blocks are copied
+     * once into the merged list.
+     *
+     * @param[in] pNewer      the newer snapshot, has to be a RealTimeMultiSampleArray.
+     *
+     * @return the merged snapshot or a null pointer if pNewer is not a RealTimeMultiSampleArray.
+     */
+    virtual QSharedPointer<Measurement> coalesce(const QSharedPointer<Measurement>& pNewer) const;
+
     //=========================================================================================================
     /**
      * Attaches a value to the sample array list.
@@ -215,7 +237,8 @@ private:
     QString                     m_sXMLLayoutFile;   /**< Layout file name. */
     float                       m_fSamplingRate;    /**< Sampling rate of the RealTimeSampleArray.*/
     qint32                      m_iMultiArraySize;  /**< Sample size of the multi sample array.*/
-    QList<Eigen::MatrixXd>      m_matSamples;       /**< The multi sample array.*/
+    QList<Eigen::MatrixXd>      m_matSamples;       /**< The multi sample array which is currently gathered.*/
+    QSharedPointer<const QList<Eigen::MatrixXd> > m_pMultiSampleArray; /**< The last published multi sample array, shared with all snapshots.*/
     bool                        m_bChInfoIsInit;    /**< If channel info is initialized.*/
 
     QList<RealTimeSampleArrayChInfo> m_qListChInfo; /**< Channel info list.*/
@@ -229,6 +252,7 @@ inline void RealTimeMultiSampleArray::clear()
 {
     QMutexLocker locker(&m_qMutex);
     m_matSamples.clear();
+    m_pMultiSampleArray = QSharedPointer<const QList<Eigen::MatrixXd> >::create();
 }
 
 //=============================================================================================================
@@ -319,7 +343,8 @@ qint32 RealTimeMultiSampleArray::getMultiArraySize() const
 
 inline const QList<Eigen::MatrixXd>& RealTimeMultiSampleArray::getMultiSampleArray()
 {
-    return m_matSamples;
+    QMutexLocker locker(&m_qMutex);
+    return *m_pMultiSampleArray;
 }
 } // NAMESPACE
 
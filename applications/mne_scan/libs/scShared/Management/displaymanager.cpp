@@ -38,6 +38,8 @@
 //=============================================================================================================
 
 #include "displaymanager.h"
+#include "latencytracer.h"
+#include "pluginconnectoredge.h"
 
 #include <scDisp/realtimemultisamplearraywidget.h>
 #include <scDisp/realtime3dwidget.h>
@@ -100,10 +102,21 @@ QWidget* DisplayManager::show(AbstractPlugin::OutputConnectorList &outputConnect
 
             qListActions.append(rtmsaWidget->getDisplayActions());
 
-            // We need to use queued connection here because, e.g., the FiffSimulator is dispatching its data from the main thread
-            // and a blocking one because the data is deleted immediatley after the signal was emmited
+            // The data is delivered through an edge, so a slow display does not stall the sender. Blocks which queue up
+            // while the display is busy are merged and drawn at once. The lambda holds the edge, which is released
+            // when the widget is destroyed and the connection is removed with it.
+            PluginConnectorEdge::SPtr pEdge = PluginConnectorEdge::create(rtmsaWidget,
+                                                                          [rtmsaWidget](SCMEASLIB::Measurement::SPtr pMeasurement) {
+                                                                              rtmsaWidget->update(pMeasurement);
+                                                                              if(LatencyTracer::instance().isEnabled()) {
+                                                                                  LatencyTracer::instance().recordDisplay(pMeasurement->getTrace());
+                                                                              }
+                                                                          },
+                                                                          PluginConnectorEdge::Coalesce);
             connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtmsaWidget, &RealTimeMultiSampleArrayWidget::update, Qt::BlockingQueuedConnection);
+                    rtmsaWidget, [pEdge](SCMEASLIB::Measurement::SPtr pMeasurement) {
+                        pEdge->push(pMeasurement);
+                    }, Qt::DirectConnection);
 
             vboxLayout->addWidget(rtmsaWidget);
             rtmsaWidget->init();
@@ -183,6 +196,20 @@ QWidget* DisplayManager::show(AbstractPlugin::OutputConnectorList &outputConnect
             vboxLayout->addWidget(fsWidget);
             fsWidget->init();
         }
+
+        // Connected after the display and direct, so the blocking update of the display already returned when
+        // this is called. The latency therefore includes the time the display needed to take the data.
+        // The RealTimeMultiSampleArray display records its latency when the edge delivered the data.
+        if(pPluginOutputConnector.dynamicCast< PluginOutputData<RealTimeMultiSampleArray> >()) {
+            continue;
+        }
+
+        connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
+                newDisp, [](SCMEASLIB::Measurement::SPtr pMeasurement) {
+                    if(LatencyTracer::instance().isEnabled()) {
+                        LatencyTracer::instance().recordDisplay(pMeasurement->getTrace());
+                    }
+                }, Qt::DirectConnection);
     }
 
     newDisp->setLayout(vboxLayout);
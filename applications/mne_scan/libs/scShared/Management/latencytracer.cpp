@@ -0,0 +1,456 @@
+//=============================================================================================================
+/**
+ * @file     latencytracer.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Definition of the LatencyHistogram and LatencyTracer classes.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencytracer.h"
+
+#include "../Plugins/abstractplugin.h"
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace SCSHAREDLIB;
+using namespace SCMEASLIB;
+
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define SUB_BUCKET_BITS 3
+#define NUM_SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+LatencyHistogram::LatencyHistogram()
+: m_vecBuckets(64 * NUM_SUB_BUCKETS, 0)
+, m_iCount(0)
+, m_iMin(0)
+, m_iMax(0)
+, m_dSum(0.0)
+{
+}
+
+//=============================================================================================================
+
+void LatencyHistogram::record(qint64 iNsecs)
+{
+    iNsecs = qMax(iNsecs, qint64(0));
+
+    ++m_vecBuckets[bucketIndex(iNsecs)];
+
+    if(m_iCount == 0 || iNsecs < m_iMin) {
+        m_iMin = iNsecs;
+    }
+    m_iMax = qMax(m_iMax, iNsecs);
+    m_dSum += double(iNsecs);
+    ++m_iCount;
+}
+
+//=============================================================================================================
+
+double LatencyHistogram::mean() const
+{
+    return m_iCount > 0 ? m_dSum / double(m_iCount) : 0.0;
+}
+
+//=============================================================================================================
+
+qint64 LatencyHistogram::percentile(double dPercentile) const
+{
+    if(m_iCount == 0) {
+        return 0;
+    }
+
+    qint64 iRank = qMax(qint64(1), qint64(std::ceil(qBound(0.0, dPercentile, 100.0) / 100.0 * double(m_iCount))));
+    qint64 iSum = 0;
+
+    for(int i = 0; i < m_vecBuckets.size(); ++i) {
+        iSum += m_vecBuckets[i];
+        if(iSum >= iRank) {
+            return qBound(m_iMin, bucketUpperBound(i), m_iMax);
+        }
+    }
+
+    return m_iMax;
+}
+
+//=============================================================================================================
+
+int LatencyHistogram::bucketIndex(qint64 iNsecs)
+{
+    // Values below NUM_SUB_BUCKETS get a bucket each, above that every power of two is split into NUM_SUB_BUCKETS
+    if(iNsecs < NUM_SUB_BUCKETS) {
+        return int(iNsecs);
+    }
+
+    int iExponent = 63 - qCountLeadingZeroBits(quint64(iNsecs));
+    int iSub = int((iNsecs >> (iExponent - SUB_BUCKET_BITS)) & (NUM_SUB_BUCKETS - 1));
+
+    return (iExponent - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS + iSub;
+}
+
+//=============================================================================================================
+
+qint64 LatencyHistogram::bucketUpperBound(int iIndex)
+{
+    if(iIndex < NUM_SUB_BUCKETS) {
+        return iIndex;
+    }
+
+    int iExponent = iIndex / NUM_SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int iSub = iIndex % NUM_SUB_BUCKETS;
+
+    return ((qint64(NUM_SUB_BUCKETS + iSub + 1)) << (iExponent - SUB_BUCKET_BITS)) - 1;
+}
+
+//=============================================================================================================
+
+LatencyTracer::LatencyTracer()
+: m_iEnabled(0)
+{
+}
+
+//=============================================================================================================
+
+LatencyTracer& LatencyTracer::instance()
+{
+    static LatencyTracer tracer;
+    return tracer;
+}
+
+//=============================================================================================================
+
+void LatencyTracer::setEnabled(bool bEnabled)
+{
+    m_iEnabled.storeRelease(bEnabled ? 1 : 0);
+}
+
+//=============================================================================================================
+
+bool LatencyTracer::isEnabled() const
+{
+    return m_iEnabled.loadAcquire() != 0;
+}
+
+//=============================================================================================================
+
+void LatencyTracer::reset()
+{
+    QMutexLocker locker(&m_qMutex);
+    m_qMapHistograms.clear();
+    m_qHashLastInput.clear();
+}
+
+//=============================================================================================================
+
+void LatencyTracer::record(const QString& sEdge,
+                           Stage stage,
+                           qint64 iNsecs)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    QVector<LatencyHistogram>& vecHistograms = m_qMapHistograms[sEdge];
+    if(vecHistograms.isEmpty()) {
+        vecHistograms.resize(NumStages);
+    }
+
+    vecHistograms[stage].record(iNsecs);
+}
+
+//=============================================================================================================
+
+void LatencyTracer::stampOutput(AbstractPlugin* pPlugin,
+                                Measurement* pMeasurement)
+{
+    if(!pPlugin || !pMeasurement) {
+        return;
+    }
+
+    qint64 iNow = Measurement::currentTimestamp();
+
+    MeasurementTrace trace;
+    trace.iOrigin = iNow;
+    trace.iSent = iNow;
+    trace.sSource = pPlugin->getName();
+
+    if(pPlugin->getType() != AbstractPlugin::_ISensor) {
+        bool bHasInput = false;
+        InputStamp lastInput;
+
+        {
+            QMutexLocker locker(&m_qMutex);
+            if(m_qHashLastInput.contains(pPlugin)) {
+                lastInput = m_qHashLastInput.value(pPlugin);
+                bHasInput = true;
+            }
+        }
+
+        if(bHasInput) {
+            trace.iOrigin = lastInput.iOrigin;
+            record(trace.sSource, Compute, iNow - lastInput.iArrival);
+        }
+    }
+
+    pMeasurement->setTrace(trace);
+}
+
+//=============================================================================================================
+
+void LatencyTracer::recordInput(AbstractPlugin* pPlugin,
+                                const Measurement* pMeasurement)
+{
+    if(!pPlugin || !pMeasurement) {
+        return;
+    }
+
+    qint64 iNow = Measurement::currentTimestamp();
+    MeasurementTrace trace = pMeasurement->getTrace();
+
+    if(trace.iSent > 0) {
+        QString sEdge = trace.sSource + " -> " + pPlugin->getName();
+        record(sEdge, QueueWait, iNow - trace.iSent);
+        record(sEdge, EndToEnd, iNow - trace.iOrigin);
+    }
+
+    InputStamp stamp;
+    stamp.iOrigin = trace.iOrigin > 0 ? trace.iOrigin : iNow;
+    stamp.iArrival = iNow;
+
+    QMutexLocker locker(&m_qMutex);
+    m_qHashLastInput.insert(pPlugin, stamp);
+}
+
+//=============================================================================================================
+
+void LatencyTracer::recordDisplay(const MeasurementTrace& trace)
+{
+    if(trace.iSent <= 0) {
+        return;
+    }
+
+    qint64 iNow = Measurement::currentTimestamp();
+    QString sEdge = trace.sSource + " -> Display";
+
+    record(sEdge, QueueWait, iNow - trace.iSent);
+    record(sEdge, EndToEnd, iNow - trace.iOrigin);
+}
+
+//=============================================================================================================
+
+QStringList LatencyTracer::getEdges() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_qMapHistograms.keys();
+}
+
+//=============================================================================================================
+
+LatencyHistogram LatencyTracer::getHistogram(const QString& sEdge,
+                                             Stage stage) const
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(!m_qMapHistograms.contains(sEdge)) {
+        return LatencyHistogram();
+    }
+
+    return m_qMapHistograms[sEdge][stage];
+}
+
+//=============================================================================================================
+
+QString LatencyTracer::summary() const
+{
+    QMutexLocker locker(&m_qMutex);
+
+    QString sSummary;
+    QMap<QString, QVector<LatencyHistogram> >::const_iterator it;
+    for(it = m_qMapHistograms.constBegin(); it != m_qMapHistograms.constEnd(); ++it) {
+        for(int i = 0; i < NumStages; ++i) {
+            const LatencyHistogram& histogram = it.value()[i];
+            if(histogram.count() == 0) {
+                continue;
+            }
+
+            sSummary += QString("%1 [%2]: p50 %3 ms, p99 %4 ms (n=%5)\n")
+                        .arg(it.key())
+                        .arg(stageName(Stage(i)))
+                        .arg(double(histogram.percentile(50)) * 1e-6, 0, 'f', 2)
+                        .arg(double(histogram.percentile(99)) * 1e-6, 0, 'f', 2)
+                        .arg(histogram.count());
+        }
+    }
+
+    return sSummary.trimmed();
+}
+
+//=============================================================================================================
+
+bool LatencyTracer::exportToFile(const QString& sFileName) const
+{
+    if(sFileName.endsWith(".json", Qt::CaseInsensitive)) {
+        return exportToJson(sFileName);
+    }
+
+    return exportToCsv(sFileName);
+}
+
+//=============================================================================================================
+
+QString LatencyTracer::stageName(Stage stage)
+{
+    switch(stage) {
+        case QueueWait:
+            return "queue_wait";
+        case Compute:
+            return "compute";
+        case EndToEnd:
+            return "end_to_end";
+        default:
+            return "unknown";
+    }
+}
+
+//=============================================================================================================
+
+bool LatencyTracer::exportToCsv(const QString& sFileName) const
+{
+    QFile file(sFileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "[LatencyTracer::exportToCsv] Could not open" << sFileName;
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "edge,stage,count,min_us,p50_us,p90_us,p99_us,max_us,mean_us\n";
+
+    QMutexLocker locker(&m_qMutex);
+
+    QMap<QString, QVector<LatencyHistogram> >::const_iterator it;
+    for(it = m_qMapHistograms.constBegin(); it != m_qMapHistograms.constEnd(); ++it) {
+        for(int i = 0; i < NumStages; ++i) {
+            const LatencyHistogram& histogram = it.value()[i];
+            if(histogram.count() == 0) {
+                continue;
+            }
+
+            stream << "\"" << it.key() << "\","
+                   << stageName(Stage(i)) << ","
+                   << histogram.count() << ","
+                   << double(histogram.min()) * 1e-3 << ","
+                   << double(histogram.percentile(50)) * 1e-3 << ","
+                   << double(histogram.percentile(90)) * 1e-3 << ","
+                   << double(histogram.percentile(99)) * 1e-3 << ","
+                   << double(histogram.max()) * 1e-3 << ","
+                   << histogram.mean() * 1e-3 << "\n";
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+bool LatencyTracer::exportToJson(const QString& sFileName) const
+{
+    QFile file(sFileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "[LatencyTracer::exportToJson] Could not open" << sFileName;
+        return false;
+    }
+
+    QJsonArray jsonEdges;
+
+    {
+        QMutexLocker locker(&m_qMutex);
+
+        QMap<QString, QVector<LatencyHistogram> >::const_iterator it;
+        for(it = m_qMapHistograms.constBegin(); it != m_qMapHistograms.constEnd(); ++it) {
+            QJsonObject jsonStages;
+
+            for(int i = 0; i < NumStages; ++i) {
+                const LatencyHistogram& histogram = it.value()[i];
+                if(histogram.count() == 0) {
+                    continue;
+                }
+
+                QJsonObject jsonStage;
+                jsonStage["count"] = double(histogram.count());
+                jsonStage["min_us"] = double(histogram.min()) * 1e-3;
+                jsonStage["p50_us"] = double(histogram.percentile(50)) * 1e-3;
+                jsonStage["p90_us"] = double(histogram.percentile(90)) * 1e-3;
+                jsonStage["p99_us"] = double(histogram.percentile(99)) * 1e-3;
+                jsonStage["max_us"] = double(histogram.max()) * 1e-3;
+                jsonStage["mean_us"] = histogram.mean() * 1e-3;
+                jsonStages[stageName(Stage(i))] = jsonStage;
+            }
+
+            QJsonObject jsonEdge;
+            jsonEdge["edge"] = it.key();
+            jsonEdge["stages"] = jsonStages;
+            jsonEdges.append(jsonEdge);
+        }
+    }
+
+    QJsonObject jsonRoot;
+    jsonRoot["edges"] = jsonEdges;
+
+    file.write(QJsonDocument(jsonRoot).toJson());
+
+    return true;
+}
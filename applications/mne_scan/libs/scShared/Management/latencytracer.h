@@ -0,0 +1,336 @@
+//=============================================================================================================
+/**
+ * @file     latencytracer.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Contains the declaration of the LatencyHistogram and LatencyTracer classes.
+ *
+ */
+
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../scshared_global.h"
+
+#include <scMeas/measurement.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+
+//=============================================================================================================
+// DEFINE NAMESPACE SCSHAREDLIB
+//=============================================================================================================
+
+namespace SCSHAREDLIB
+{
+
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class AbstractPlugin;
+
+//=============================================================================================================
+/**
+ * Histogram of latencies in nanoseconds. The buckets are logarithmic with eight linear sub-buckets per power of
+ * two, so percentiles are resolved to about 12 %.
+ *
+ * @brief The LatencyHistogram class collects latencies.
+ */
+class SCSHAREDSHARED_EXPORT LatencyHistogram
+{
+public:
+    //=========================================================================================================
+    /**
+     * Constructs an empty LatencyHistogram.
+     */
+    LatencyHistogram();
+
+    //=========================================================================================================
+    /**
+     * Adds a latency.
+     *
+     * @param[in] iNsecs     the latency in nanoseconds.
+     */
+    void record(qint64 iNsecs);
+
+    //=========================================================================================================
+    /**
+     * Returns the number of recorded latencies.
+     *
+     * @return the number of recorded latencies.
+     */
+    inline qint64 count() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the smallest recorded latency.
+     *
+     * @return the smallest latency in nanoseconds, 0 if empty.
+     */
+    inline qint64 min() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the largest recorded latency.
+     *
+     * @return the largest latency in nanoseconds, 0 if empty.
+     */
+    inline qint64 max() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the mean of the recorded latencies.
+     *
+     * @return the mean latency in nanoseconds, 0 if empty.
+     */
+    double mean() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the given percentile of the recorded latencies, i.e. the upper bound of the bucket it falls into.
+     *
+     * @param[in] dPercentile    the percentile between 0 and 100.
+     *
+     * @return the percentile in nanoseconds, 0 if empty.
+     */
+    qint64 percentile(double dPercentile) const;
+
+private:
+    static int bucketIndex(qint64 iNsecs);
+    static qint64 bucketUpperBound(int iIndex);
+
+    QVector<qint64>     m_vecBuckets;   /**< Number of latencies per bucket. */
+    qint64              m_iCount;       /**< Number of recorded latencies. */
+    qint64              m_iMin;         /**< Smallest recorded latency. */
+    qint64              m_iMax;         /**< Largest recorded latency. */
+    double              m_dSum;         /**< Sum of the recorded latencies. */
+};
+
+//=============================================================================================================
+/**
+ * Collects the latencies of the plugin graph. The output connectors stamp every measurement with the time the
+ * data left the sensor and the time it was sent (see SCMEASLIB::MeasurementTrace). From these the tracer
+ * records per edge the time a measurement waited before the receiver got it and the latency since the sensor,
+ * and per algorithm plugin the time between receiving an input and sending an output. Tracing is disabled by
+ * default.
+ *
+ * @brief The LatencyTracer class records latency histograms of the plugin graph.
+ */
+class SCSHAREDSHARED_EXPORT LatencyTracer
+{
+public:
+    //=========================================================================================================
+    /**
+     * The recorded stages.
+     */
+    enum Stage {
+        QueueWait,      /**< From sending the measurement to the receiver getting it. */
+        Compute,        /**< From a plugin receiving an input to sending an output. */
+        EndToEnd,       /**< From the data leaving the sensor to the receiver getting it. */
+        NumStages
+    };
+
+    //=========================================================================================================
+    /**
+     * Returns the process wide tracer.
+     *
+     * @return the tracer.
+     */
+    static LatencyTracer& instance();
+
+    //=========================================================================================================
+    /**
+     * Enables or disables tracing.
+     *
+     * @param[in] bEnabled   whether to trace.
+     */
+    void setEnabled(bool bEnabled);
+
+    //=========================================================================================================
+    /**
+     * Returns whether tracing is enabled.
+     *
+     * @return true if tracing is enabled.
+     */
+    bool isEnabled() const;
+
+    //=========================================================================================================
+    /**
+     * Removes all recorded latencies.
+     */
+    void reset();
+
+    //=========================================================================================================
+    /**
+     * Adds a latency to the histogram of an edge and stage.
+     *
+     * @param[in] sEdge      name of the edge or plugin.
+     * @param[in] stage      the stage.
+     * @param[in] iNsecs     the latency in nanoseconds.
+     */
+    void record(const QString& sEdge,
+                Stage stage,
+                qint64 iNsecs);
+
+    //=========================================================================================================
+    /**
+     * Stamps a measurement which is about to be sent by a plugin. Sensors start a new trace, algorithms
+     * forward the origin of their last input and record their compute time.
+     *
+     * @param[in] pPlugin        the sending plugin.
+     * @param[in] pMeasurement   the measurement to stamp.
+     */
+    void stampOutput(AbstractPlugin* pPlugin,
+                     SCMEASLIB::Measurement* pMeasurement);
+
+    //=========================================================================================================
+    /**
+     * Records the queue wait and end-to-end latency of a measurement which arrived at a plugin.
+     *
+     * @param[in] pPlugin        the receiving plugin.
+     * @param[in] pMeasurement   the received measurement.
+     */
+    void recordInput(AbstractPlugin* pPlugin,
+                     const SCMEASLIB::Measurement* pMeasurement);
+
+    //=========================================================================================================
+    /**
+     * Records the end-to-end latency of a measurement which was shown by a display.
+     *
+     * @param[in] trace      the trace of the shown measurement.
+     */
+    void recordDisplay(const SCMEASLIB::MeasurementTrace& trace);
+
+    //=========================================================================================================
+    /**
+     * Returns the names of all edges and plugins with recorded latencies.
+     *
+     * @return the names.
+     */
+    QStringList getEdges() const;
+
+    //=========================================================================================================
+    /**
+     * Returns a copy of the histogram of an edge and stage.
+     *
+     * @param[in] sEdge      name of the edge or plugin.
+     * @param[in] stage      the stage.
+     *
+     * @return the histogram.
+     */
+    LatencyHistogram getHistogram(const QString& sEdge,
+                                  Stage stage) const;
+
+    //=========================================================================================================
+    /**
+     * Returns a short text with the median and 99th percentile per edge and stage.
+     *
+     * @return the summary.
+     */
+    QString summary() const;
+
+    //=========================================================================================================
+    /**
+     * Writes all histograms to a CSV or, if the file name ends with .json, a JSON file.
+     *
+     * @param[in] sFileName  the file to write.
+     *
+     * @return true if the file was written.
+     */
+    bool exportToFile(const QString& sFileName) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the name of a stage as used in the exported files.
+     *
+     * @param[in] stage      the stage.
+     *
+     * @return the name.
+     */
+    static QString stageName(Stage stage);
+
+private:
+    //=========================================================================================================
+    /**
+     * Constructs the LatencyTracer. Use instance().
+     */
+    LatencyTracer();
+
+    bool exportToCsv(const QString& sFileName) const;
+    bool exportToJson(const QString& sFileName) const;
+
+    struct InputStamp {
+        qint64 iOrigin;     /**< Origin of the last received input. */
+        qint64 iArrival;    /**< Time the last input was received. */
+    };
+
+    mutable QMutex                                  m_qMutex;               /**< Guards the histograms and stamps. */
+    QAtomicInt                                      m_iEnabled;             /**< Whether tracing is enabled. */
+    QMap<QString, QVector<LatencyHistogram> >       m_qMapHistograms;       /**< Histograms per edge, one per stage. */
+    QHash<const AbstractPlugin*, InputStamp>        m_qHashLastInput;       /**< The last input received per plugin. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint64 LatencyHistogram::count() const
+{
+    return m_iCount;
+}
+
+//=============================================================================================================
+
+inline qint64 LatencyHistogram::min() const
+{
+    return m_iCount > 0 ? m_iMin : 0;
+}
+
+//=============================================================================================================
+
+inline qint64 LatencyHistogram::max() const
+{
+    return m_iMax;
+}
+} // NAMESPACE
+
+#endif // LATENCYTRACER_H
@@ -117,6 +117,14 @@ public:
      */
     inline QString getName() const;
 
+    //=========================================================================================================
+    /**
+     * Returns the plugin the PluginConnector belongs to.
+     *
+     * @return the plugin.
+     */
+    inline AbstractPlugin* getPlugin() const;
+
 signals:
 
 protected:
@@ -139,6 +147,13 @@ QString PluginConnector::getName() const
 {
     return m_sName;
 }
+
+//=============================================================================================================
+
+AbstractPlugin* PluginConnector::getPlugin() const
+{
+    return m_pPlugin;
+}
 } // NAMESPACE
 
 #endif // PLUGINCONNECTOR_H
@@ -63,6 +63,9 @@ PluginConnectorConnection::PluginConnectorConnection(AbstractPlugin::SPtr sender
 : QObject(parent)
 , m_pSender(sender)
 , m_pReceiver(receiver)
+, m_bDataFlowMode(false)
+, m_overflowPolicy(PluginConnectorEdge::DropOldest)
+, m_iQueueCapacity(8)
 {
     createConnection();
 }
@@ -83,6 +86,85 @@ void PluginConnectorConnection::clearConnection()
         disconnect(it.value());
 
     m_qHashConnections.clear();
+
+    for(PluginConnectorEdge::SPtr& pEdge : m_qHashEdges) {
+        pEdge->close();
+    }
+
+    m_qHashEdges.clear();
+}
+
+//=============================================================================================================
+
+void PluginConnectorConnection::setDataFlowMode(bool bDataFlowMode,
+                                                PluginConnectorEdge::OverflowPolicy policy,
+                                                int iQueueCapacity)
+{
+    m_bDataFlowMode = bDataFlowMode;
+    m_overflowPolicy = policy;
+    m_iQueueCapacity = iQueueCapacity;
+
+    // Recreate the existing connections with the new settings
+    QList<QPair<QString, QString> > lConnected = m_qHashConnections.keys();
+
+    for(const QPair<QString, QString>& pair : lConnected) {
+        disconnectConnectors(pair);
+
+        qint32 i, j;
+        for(i = 0; i < m_pSender->getOutputConnectors().size(); ++i)
+            if(m_pSender->getOutputConnectors()[i]->getName() == pair.first)
+                break;
+
+        for(j = 0; j < m_pReceiver->getInputConnectors().size(); ++j)
+            if(m_pReceiver->getInputConnectors()[j]->getName() == pair.second)
+                break;
+
+        if(i < m_pSender->getOutputConnectors().size() && j < m_pReceiver->getInputConnectors().size()) {
+            connectConnectors(i, j);
+        }
+    }
+}
+
+//=============================================================================================================
+
+void PluginConnectorConnection::connectConnectors(qint32 iOutput, qint32 iInput)
+{
+    QSharedPointer<PluginOutputConnector> pOutput = m_pSender->getOutputConnectors()[iOutput];
+    QSharedPointer<PluginInputConnector> pInput = m_pReceiver->getInputConnectors()[iInput];
+
+    QPair<QString,QString> pair(pOutput->getName(), pInput->getName());
+
+    if(m_bDataFlowMode && getDataType(pOutput) == ConnectorDataType::_RTMSA) {
+        PluginConnectorEdge::SPtr pEdge = PluginConnectorEdge::create(pInput.data(), m_overflowPolicy, m_iQueueCapacity);
+        m_qHashEdges.insert(pair, pEdge);
+
+        // The lambda holds a reference to the edge, so the edge lives as long as the connection is being emitted
+        m_qHashConnections.insert(pair,
+                                  connect(pOutput.data(), &PluginOutputConnector::notify,
+                                          [pEdge](SCMEASLIB::Measurement::SPtr pMeasurement) {
+                                              pEdge->push(pMeasurement);
+                                          }));
+    } else {
+        // We need to use BlockingQueuedConnection here because the FiffSimulator is still dispatching its data from a different thread via the direct connect signal method
+        m_qHashConnections.insert(pair,
+                                  connect(pOutput.data(), &PluginOutputConnector::notify,
+                                          pInput.data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+    }
+}
+
+//=============================================================================================================
+
+void PluginConnectorConnection::disconnectConnectors(const QPair<QString, QString>& pairConnectors)
+{
+    if(m_qHashConnections.contains(pairConnectors)) {
+        disconnect(m_qHashConnections[pairConnectors]);
+        m_qHashConnections.remove(pairConnectors);
+    }
+
+    if(m_qHashEdges.contains(pairConnectors)) {
+        m_qHashEdges[pairConnectors]->close();
+        m_qHashEdges.remove(pairConnectors);
+    }
 }
 
 //=============================================================================================================
@@ -108,11 +190,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeMultiSampleArray> > receiverRTMSA = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeMultiSampleArray> >();
             if(senderRTMSA && receiverRTMSA)
             {
-                // We need to use BlockingQueuedConnection here because the FiffSimulator is still dispatching its data from a different thread via the direct connect signal method
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                 m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
@@ -122,11 +200,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeEvokedSet> > receiverRTESet = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeEvokedSet> >();
             if(senderRTESet && receiverRTESet)
             {
-                // We cannot use BlockingQueuedConnection here because Averaging is dispatching its data from the main thread via the onNewEvokedSet method
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                 m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
@@ -136,10 +210,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeCov> > receiverRTC = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeCov> >();
             if(senderRTC && receiverRTC)
             {
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                 m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
@@ -149,10 +220,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeSourceEstimate> > receiverRTSE = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeSourceEstimate> >();
             if(senderRTSE && receiverRTSE)
             {
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                 m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
@@ -162,10 +230,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeHpiResult> > receiverRTHR = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeHpiResult> >();
             if(senderRTHR && receiverRTHR)
             {
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                  m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
@@ -175,10 +240,7 @@ bool PluginConnectorConnection::createConnection()
             QSharedPointer< PluginInputData<RealTimeFwdSolution> > receiverRTFS = m_pReceiver->getInputConnectors()[j].dynamicCast< PluginInputData<RealTimeFwdSolution> >();
             if(senderRTFS && receiverRTFS)
             {
-                m_qHashConnections.insert(QPair<QString,QString>(m_pSender->getOutputConnectors()[i]->getName(),
-                                                                  m_pReceiver->getInputConnectors()[j]->getName()),
-                                          connect(m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                  m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+                connectConnectors(i, j);
                 bConnected = true;
                 break;
             }
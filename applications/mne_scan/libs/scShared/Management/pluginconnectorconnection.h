@@ -44,6 +44,7 @@
 
 #include "plugininputconnector.h"
 #include "pluginoutputconnector.h"
+#include "pluginconnectoredge.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -120,6 +121,37 @@ public:
 
     inline bool isConnected();
 
+    //=========================================================================================================
+    /**
+     * Switches between the blocking connection, where the sender waits until the receiver processed each
+     * measurement, and the data-flow mode, where immutable snapshots are delivered through a bounded queue per
+     * connected input (see PluginConnectorEdge). The data-flow mode is only used for measurement types which
+     * support snapshots, all other types stay blocking. Existing connections are recreated.
+     *
+     * @param[in] bDataFlowMode     whether to use the data-flow mode.
+     * @param[in] policy            the overflow policy of the queues.
+     * @param[in] iQueueCapacity    the maximum number of queued measurements per connected input.
+     */
+    void setDataFlowMode(bool bDataFlowMode,
+                         PluginConnectorEdge::OverflowPolicy policy = PluginConnectorEdge::DropOldest,
+                         int iQueueCapacity = 8);
+
+    //=========================================================================================================
+    /**
+     * Returns whether the data-flow mode is active.
+     *
+     * @return true if the data-flow mode is active.
+     */
+    inline bool isDataFlowMode() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the overflow policy used in data-flow mode.
+     *
+     * @return the overflow policy.
+     */
+    inline PluginConnectorEdge::OverflowPolicy getOverflowPolicy() const;
+
     //=========================================================================================================
     /**
      * The connector connection setup widget
@@ -137,10 +169,33 @@ private:
      */
     bool createConnection();
 
+    //=========================================================================================================
+    /**
+     * Connects an output connector of the sender to an input connector of the receiver, either blocking or
+     * through a PluginConnectorEdge depending on the data-flow mode and the measurement type.
+     *
+     * @param[in] iOutput   index of the output connector of the sender.
+     * @param[in] iInput    index of the input connector of the receiver.
+     */
+    void connectConnectors(qint32 iOutput, qint32 iInput);
+
+    //=========================================================================================================
+    /**
+     * Removes a connection created by connectConnectors.
+     *
+     * @param[in] pairConnectors    the names of the output and the input connector.
+     */
+    void disconnectConnectors(const QPair<QString, QString>& pairConnectors);
+
     AbstractPlugin::SPtr m_pSender;
     AbstractPlugin::SPtr m_pReceiver;
 
     QHash<QPair<QString, QString>, QMetaObject::Connection> m_qHashConnections; /**< QHash which holds the connections between sender and receiver QHash<QPair<Sender,Receiver>, Connection>. */
+    QHash<QPair<QString, QString>, PluginConnectorEdge::SPtr> m_qHashEdges;     /**< The queues of the connections which are in data-flow mode. */
+
+    bool                                    m_bDataFlowMode;    /**< Whether the data-flow mode is active. */
+    PluginConnectorEdge::OverflowPolicy     m_overflowPolicy;   /**< The overflow policy in data-flow mode. */
+    int                                     m_iQueueCapacity;   /**< The queue capacity in data-flow mode. */
 };
 
 //=============================================================================================================
@@ -173,6 +228,20 @@ inline bool PluginConnectorConnection::isConnected()
 {
     return m_qHashConnections.size() > 0 ? true : false;
 }
+
+//=============================================================================================================
+
+inline bool PluginConnectorConnection::isDataFlowMode() const
+{
+    return m_bDataFlowMode;
+}
+
+//=============================================================================================================
+
+inline PluginConnectorEdge::OverflowPolicy PluginConnectorConnection::getOverflowPolicy() const
+{
+    return m_overflowPolicy;
+}
 } // NAMESPACE
 
 #endif // PLUGINCONNECTORCONNECTION_H
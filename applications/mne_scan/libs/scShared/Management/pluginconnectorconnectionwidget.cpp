@@ -122,6 +122,25 @@ PluginConnectorConnectionWidget::PluginConnectorConnectionWidget(PluginConnector
                 this,
                 &PluginConnectorConnectionWidget::updateReceiver);
 
+    //Transport mode
+    m_pComboBoxTransport = new QComboBox(this);
+    m_pComboBoxTransport->addItem(tr("Blocking"));
+    m_pComboBoxTransport->addItem(tr("Data flow - block when full"));
+    m_pComboBoxTransport->addItem(tr("Data flow - drop oldest"));
+    m_pComboBoxTransport->addItem(tr("Data flow - coalesce"));
+    m_pComboBoxTransport->setToolTip(tr("In data-flow mode the sender does not wait for the receiver. Measurements are queued per input instead."));
+
+    if(m_pPluginConnectorConnection->isDataFlowMode()) {
+        m_pComboBoxTransport->setCurrentIndex(1 + m_pPluginConnectorConnection->getOverflowPolicy());
+    }
+
+    connect(m_pComboBoxTransport, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &PluginConnectorConnectionWidget::updateTransport);
+
+    layout->addWidget(new QLabel(tr("Transport"), this),curRow,0);
+    layout->addWidget(m_pComboBoxTransport,curRow,1);
+    ++curRow;
+
     layout->addWidget(bottomFiller,curRow,0);
     ++curRow;
 
@@ -162,14 +181,11 @@ void PluginConnectorConnectionWidget::updateReceiver(const QString &p_sCurrentRe
                     break;
 
             qint32 j = 0;
-            for(j = 0; j < m_pPluginConnectorConnection->m_pSender->getOutputConnectors().size(); ++j)
+            for(j = 0; j < m_pPluginConnectorConnection->m_pReceiver->getInputConnectors().size(); ++j)
                 if(m_pPluginConnectorConnection->m_pReceiver->getInputConnectors()[j]->getName() == p_sCurrentReceiver)
                     break;
 
-            m_pPluginConnectorConnection->m_qHashConnections.insert(QPair<QString,QString>(m_pPluginConnectorConnection->m_pSender->getOutputConnectors()[i]->getName(),
-                                                                                           m_pPluginConnectorConnection->m_pReceiver->getInputConnectors()[j]->getName()),
-                                                                    connect(m_pPluginConnectorConnection->m_pSender->getOutputConnectors()[i].data(), &PluginOutputConnector::notify,
-                                                                            m_pPluginConnectorConnection->m_pReceiver->getInputConnectors()[j].data(), &PluginInputConnector::update, Qt::BlockingQueuedConnection));
+            m_pPluginConnectorConnection->connectConnectors(i, j);
         }
     }
 
@@ -179,9 +195,28 @@ void PluginConnectorConnectionWidget::updateReceiver(const QString &p_sCurrentRe
         if(it.value() != t_qComboBox && it.value()->currentText() == p_sCurrentReceiver)
         {
             QPair<QString, QString> t_qPair(it.key(),it.value()->currentText());
-            disconnect(m_pPluginConnectorConnection->m_qHashConnections[t_qPair]);
-            m_pPluginConnectorConnection->m_qHashConnections.remove(t_qPair);
+            m_pPluginConnectorConnection->disconnectConnectors(t_qPair);
             it.value()->setCurrentIndex(0);
         }
     }
 }
+
+//=============================================================================================================
+
+void PluginConnectorConnectionWidget::updateTransport(int iIndex)
+{
+    switch(iIndex) {
+        case 1:
+            m_pPluginConnectorConnection->setDataFlowMode(true, PluginConnectorEdge::Block);
+            break;
+        case 2:
+            m_pPluginConnectorConnection->setDataFlowMode(true, PluginConnectorEdge::DropOldest);
+            break;
+        case 3:
+            m_pPluginConnectorConnection->setDataFlowMode(true, PluginConnectorEdge::Coalesce);
+            break;
+        default:
+            m_pPluginConnectorConnection->setDataFlowMode(false);
+            break;
+    }
+}
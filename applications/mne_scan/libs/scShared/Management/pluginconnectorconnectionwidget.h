@@ -97,12 +97,21 @@ public:
      */
     void updateReceiver(const QString &p_sCurrentReceiver);
 
+    //=========================================================================================================
+    /**
+     * New selection in the transport combo box
+     *
+     * @param [in] iIndex   the index of the selected transport mode
+     */
+    void updateTransport(int iIndex);
+
 signals:
 
 public slots:
 
 private:
     QLabel* m_pLabel;                                           /**< Holds the start up widget label. */
+    QComboBox* m_pComboBoxTransport;                            /**< Selects blocking or data-flow transport. */
 
     PluginConnectorConnection*  m_pPluginConnectorConnection;   /**< a pointer to corresponding PluginConnectorConnection.*/
 
@@ -0,0 +1,208 @@
+//=============================================================================================================
+/**
+ * @file     pluginconnectoredge.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Definition of the PluginConnectorEdge class.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "pluginconnectoredge.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace SCSHAREDLIB;
+using namespace SCMEASLIB;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+PluginConnectorEdge::PluginConnectorEdge(PluginInputConnector* pReceiver,
+                                         OverflowPolicy policy,
+                                         int iCapacity)
+: PluginConnectorEdge(pReceiver,
+                      [pReceiver](Measurement::SPtr pMeasurement) { pReceiver->update(pMeasurement); },
+                      policy,
+                      iCapacity)
+{
+}
+
+//=============================================================================================================
+
+PluginConnectorEdge::PluginConnectorEdge(QObject* pReceiver,
+                                         const std::function<void(Measurement::SPtr)>& funcDeliver,
+                                         OverflowPolicy policy,
+                                         int iCapacity)
+: QObject()
+, m_pReceiver(pReceiver)
+, m_funcDeliver(funcDeliver)
+, m_overflowPolicy(policy)
+, m_iCapacity(qMax(1, iCapacity))
+, m_iNumDropped(0)
+, m_iNumMerged(0)
+, m_bDrainPending(false)
+, m_bClosed(false)
+{
+    if(pReceiver) {
+        moveToThread(pReceiver->thread());
+    }
+}
+
+//=============================================================================================================
+
+void PluginConnectorEdge::push(Measurement::SPtr pMeasurement)
+{
+    // Measurement types without snapshot support are passed on as they are
+    Measurement::SPtr pPacket = pMeasurement->snapshot();
+    if(!pPacket) {
+        pPacket = pMeasurement;
+    }
+
+    QMutexLocker locker(&m_qMutex);
+
+    if(m_bClosed) {
+        return;
+    }
+
+    switch(m_overflowPolicy) {
+        case Block:
+            while(m_qQueuePackets.size() >= m_iCapacity && !m_bClosed) {
+                // Waiting in the receiver thread would dead lock, since the queue is drained there
+                if(QThread::currentThread() == thread()) {
+                    m_qQueuePackets.dequeue();
+                    ++m_iNumDropped;
+                    break;
+                }
+                m_qNotFull.wait(&m_qMutex);
+            }
+            if(m_bClosed) {
+                return;
+            }
+            break;
+
+        case DropOldest:
+            while(m_qQueuePackets.size() >= m_iCapacity) {
+                m_qQueuePackets.dequeue();
+                ++m_iNumDropped;
+            }
+            break;
+
+        case Coalesce:
+            // The queue holds at most the one merged packet
+            if(!m_qQueuePackets.isEmpty()) {
+                Measurement::SPtr pMerged;
+                if(m_iNumMerged < m_iCapacity) {
+                    pMerged = m_qQueuePackets.last()->coalesce(pPacket);
+                }
+                if(pMerged) {
+                    pPacket = pMerged;
+                    ++m_iNumMerged;
+                } else {
+                    m_iNumDropped += m_iNumMerged;
+                    m_iNumMerged = 1;
+                }
+                m_qQueuePackets.clear();
+            } else {
+                m_iNumMerged = 1;
+            }
+            break;
+    }
+
+    m_qQueuePackets.enqueue(pPacket);
+
+    if(m_bDrainPending) {
+        return;
+    }
+
+    m_bDrainPending = true;
+    locker.unlock();
+
+    QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+}
+
+//=============================================================================================================
+
+void PluginConnectorEdge::close()
+{
+    QMutexLocker locker(&m_qMutex);
+    m_bClosed = true;
+    m_qQueuePackets.clear();
+    m_qNotFull.wakeAll();
+}
+
+//=============================================================================================================
+
+int PluginConnectorEdge::getNumQueued() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_qQueuePackets.size();
+}
+
+//=============================================================================================================
+
+qint64 PluginConnectorEdge::getNumDropped() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iNumDropped;
+}
+
+//=============================================================================================================
+
+void PluginConnectorEdge::drain()
+{
+    forever {
+        Measurement::SPtr pPacket;
+
+        {
+            QMutexLocker locker(&m_qMutex);
+            if(m_qQueuePackets.isEmpty() || m_bClosed) {
+                m_bDrainPending = false;
+                return;
+            }
+            pPacket = m_qQueuePackets.dequeue();
+            m_qNotFull.wakeAll();
+        }
+
+        if(m_pReceiver) {
+            m_funcDeliver(pPacket);
+        }
+    }
+}
@@ -0,0 +1,244 @@
+//=============================================================================================================
+/**
+ * @file     pluginconnectoredge.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Contains the declaration of the PluginConnectorEdge class.
+ *
+ */
+
+#ifndef PLUGINCONNECTOREDGE_H
+#define PLUGINCONNECTOREDGE_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../scshared_global.h"
+
+#include "plugininputconnector.h"
+
+#include <scMeas/measurement.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QPointer>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <functional>
+
+//=============================================================================================================
+// DEFINE NAMESPACE SCSHAREDLIB
+//=============================================================================================================
+
+namespace SCSHAREDLIB
+{
+
+//=============================================================================================================
+/**
+ * A PluginConnectorEdge delivers the measurements of one output connector to one input connector in data-flow
+ * mode. Every notification of the sender is turned into an immutable snapshot (see Measurement::snapshot) which
+ * is put into a bounded queue. The queue is drained in the thread of the receiver, so the sender only waits if
+ * the overflow policy is Block and the queue is full. Since snapshots share their samples, fanning out one
+ * output to several edges does not copy any data. Besides input connectors, any QObject can be the receiver,
+ * e.g. a display widget.
+ *
+ * @brief The PluginConnectorEdge class implements a bounded, non-blocking connection between two connectors.
+ */
+class SCSHAREDSHARED_EXPORT PluginConnectorEdge : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<PluginConnectorEdge> SPtr;               /**< Shared pointer type for PluginConnectorEdge. */
+    typedef QSharedPointer<const PluginConnectorEdge> ConstSPtr;    /**< Const shared pointer type for PluginConnectorEdge. */
+
+    //=========================================================================================================
+    /**
+     * What happens if a new measurement arrives while the queue is full.
+     */
+    enum OverflowPolicy {
+        Block,          /**< The sender waits until the receiver took a packet from the queue. */
+        DropOldest,     /**< The oldest queued packet is discarded. */
+        Coalesce        /**< The queued packets are merged into one (see Measurement::coalesce), at most capacity packets. A full merged packet, or one which can not be merged, is discarded. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Constructs a PluginConnectorEdge. The edge is moved to the thread of the receiver.
+     *
+     * @param[in] pReceiver         the input connector the measurements are delivered to.
+     * @param[in] policy            the overflow policy.
+     * @param[in] iCapacity         the maximum number of queued packets.
+     */
+    PluginConnectorEdge(PluginInputConnector* pReceiver,
+                        OverflowPolicy policy = DropOldest,
+                        int iCapacity = 8);
+
+    //=========================================================================================================
+    /**
+     * Constructs a PluginConnectorEdge which delivers to an arbitrary receiver. The edge is moved to the thread
+     * of the receiver. Nothing is delivered anymore once the receiver was destroyed.
+     *
+     * @param[in] pReceiver         the object in whose thread the measurements are delivered.
+     * @param[in] funcDeliver       called with each measurement in the thread of the receiver.
+     * @param[in] policy            the overflow policy.
+     * @param[in] iCapacity         the maximum number of queued packets.
+     */
+    PluginConnectorEdge(QObject* pReceiver,
+                        const std::function<void(SCMEASLIB::Measurement::SPtr)>& funcDeliver,
+                        OverflowPolicy policy = DropOldest,
+                        int iCapacity = 8);
+
+    //=========================================================================================================
+    /**
+     * Creates a PluginConnectorEdge. The edge is released with deleteLater, since the last reference might be
+     * dropped in the thread of the sender.
+     *
+     * @param[in] pReceiver         the input connector the measurements are delivered to.
+     * @param[in] policy            the overflow policy.
+     * @param[in] iCapacity         the maximum number of queued packets.
+     *
+     * @return the created PluginConnectorEdge.
+     */
+    static inline QSharedPointer<PluginConnectorEdge> create(PluginInputConnector* pReceiver,
+                                                             OverflowPolicy policy = DropOldest,
+                                                             int iCapacity = 8);
+
+    //=========================================================================================================
+    /**
+     * Creates a PluginConnectorEdge which delivers to an arbitrary receiver. The edge is released with deleteLater.
+     *
+     * @param[in] pReceiver         the object in whose thread the measurements are delivered.
+     * @param[in] funcDeliver       called with each measurement in the thread of the receiver.
+     * @param[in] policy            the overflow policy.
+     * @param[in] iCapacity         the maximum number of queued packets.
+     *
+     * @return the created PluginConnectorEdge.
+     */
+    static inline QSharedPointer<PluginConnectorEdge> create(QObject* pReceiver,
+                                                             const std::function<void(SCMEASLIB::Measurement::SPtr)>& funcDeliver,
+                                                             OverflowPolicy policy = DropOldest,
+                                                             int iCapacity = 8);
+
+    //=========================================================================================================
+    /**
+     * Queues a snapshot of the measurement and schedules its delivery. Called in the thread of the sender.
+     *
+     * @param[in] pMeasurement      the measurement which notified.
+     */
+    void push(SCMEASLIB::Measurement::SPtr pMeasurement);
+
+    //=========================================================================================================
+    /**
+     * Closes the edge. Queued packets are discarded and a sender waiting on a full queue is released.
+     */
+    void close();
+
+    //=========================================================================================================
+    /**
+     * Returns the number of packets which are currently queued.
+     *
+     * @return the number of queued packets.
+     */
+    int getNumQueued() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of packets which were discarded due to the overflow policy.
+     *
+     * @return the number of dropped packets.
+     */
+    qint64 getNumDropped() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the overflow policy.
+     *
+     * @return the overflow policy.
+     */
+    inline OverflowPolicy getOverflowPolicy() const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Delivers all queued packets to the receiver. Called in the thread of the receiver.
+     */
+    void drain();
+
+    mutable QMutex                              m_qMutex;           /**< Guards the queue and the flags. */
+    QWaitCondition                              m_qNotFull;         /**< Signaled whenever a packet is taken from the queue. */
+    QQueue<SCMEASLIB::Measurement::SPtr>        m_qQueuePackets;    /**< The queued snapshots. */
+    QPointer<QObject>                           m_pReceiver;        /**< The receiver. */
+    std::function<void(SCMEASLIB::Measurement::SPtr)> m_funcDeliver; /**< Delivers a packet to the receiver. */
+    OverflowPolicy                              m_overflowPolicy;   /**< The overflow policy. */
+    int                                         m_iCapacity;        /**< The maximum number of queued packets. */
+    qint64                                      m_iNumDropped;      /**< The number of dropped packets. */
+    int                                         m_iNumMerged;       /**< The number of packets merged into the queued packet in Coalesce mode. */
+    bool                                        m_bDrainPending;    /**< Whether a drain is already scheduled in the receiver thread. */
+    bool                                        m_bClosed;          /**< Whether the edge was closed. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline QSharedPointer<PluginConnectorEdge> PluginConnectorEdge::create(PluginInputConnector* pReceiver,
+                                                                       OverflowPolicy policy,
+                                                                       int iCapacity)
+{
+    return QSharedPointer<PluginConnectorEdge>(new PluginConnectorEdge(pReceiver, policy, iCapacity),
+                                               &QObject::deleteLater);
+}
+
+//=============================================================================================================
+
+inline QSharedPointer<PluginConnectorEdge> PluginConnectorEdge::create(QObject* pReceiver,
+                                                                       const std::function<void(SCMEASLIB::Measurement::SPtr)>& funcDeliver,
+                                                                       OverflowPolicy policy,
+                                                                       int iCapacity)
+{
+    return QSharedPointer<PluginConnectorEdge>(new PluginConnectorEdge(pReceiver, funcDeliver, policy, iCapacity),
+                                               &QObject::deleteLater);
+}
+
+//=============================================================================================================
+
+inline PluginConnectorEdge::OverflowPolicy PluginConnectorEdge::getOverflowPolicy() const
+{
+    return m_overflowPolicy;
+}
+} // NAMESPACE
+
+#endif // PLUGINCONNECTOREDGE_H
@@ -38,6 +38,7 @@
 //=============================================================================================================
 
 #include "plugininputconnector.h"
+#include "latencytracer.h"
 #include "../Plugins/abstractplugin.h"
 
 //=============================================================================================================
@@ -75,5 +76,9 @@ bool PluginInputConnector::isOutputConnector() const
 
 void PluginInputConnector::update(SCMEASLIB::Measurement::SPtr pMeasurement)
 {
+    if(LatencyTracer::instance().isEnabled()) {
+        LatencyTracer::instance().recordInput(m_pPlugin, pMeasurement.data());
+    }
+
     emit notify(pMeasurement);
 }
@@ -41,6 +41,7 @@
 //=============================================================================================================
 
 #include "pluginoutputdata.h"
+#include "latencytracer.h"
 
 #include <scMeas/measurement.h>
 
@@ -84,6 +85,10 @@ PluginOutputData<T>::PluginOutputData(AbstractPlugin *parent,
 template <class T>
 void PluginOutputData<T>::update()
 {
+    if(LatencyTracer::instance().isEnabled()) {
+        LatencyTracer::instance().stampOutput(m_pPlugin, m_pMeasurement.data());
+    }
+
     emit notify(qSharedPointerDynamicCast<SCMEASLIB::Measurement>(m_pMeasurement));
 }
 }//Namespace
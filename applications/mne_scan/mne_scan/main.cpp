@@ -64,6 +64,7 @@
 #include <QtGui>
 #include <QApplication>
 #include <QSharedPointer>
+#include <QCommandLineParser>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -167,8 +168,36 @@ int main(int argc, char *argv[])
 
     SCMEASLIB::MeasurementTypes::registerTypes();
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MNE Scan");
+    parser.addHelpOption();
+
+    QCommandLineOption benchmarkOpt(QStringList() << "b" << "benchmark",
+                                    QCoreApplication::translate("main","Run the plugin configuration without user interaction and report the end-to-end latencies."),
+                                    QCoreApplication::translate("main","configFile"));
+    QCommandLineOption durationOpt(QStringList() << "d" << "duration",
+                                   QCoreApplication::translate("main","Duration of the benchmark in seconds. Default is 30."),
+                                   QCoreApplication::translate("main","seconds"),
+                                   "30");
+    QCommandLineOption latencyOutOpt(QStringList() << "latency-out",
+                                     QCoreApplication::translate("main","Export the latency histograms of the benchmark to this file (.csv or .json)."),
+                                     QCoreApplication::translate("main","filePath"));
+
+    parser.addOption(benchmarkOpt);
+    parser.addOption(durationOpt);
+    parser.addOption(latencyOutOpt);
+
+    parser.process(app);
+
     MainWindow mainWin;
-    mainWin.show();
+
+    if(parser.isSet(benchmarkOpt)) {
+        mainWin.runBenchmark(parser.value(benchmarkOpt),
+                             parser.value(durationOpt).toInt(),
+                             parser.value(latencyOutOpt));
+    } else {
+        mainWin.show();
+    }
 
     QSurfaceFormat fmt;
     fmt.setSamples(10);
@@ -40,6 +40,7 @@
 #include <scShared/Management/pluginmanager.h>
 #include <scShared/Management/pluginscenemanager.h>
 #include <scShared/Management/displaymanager.h>
+#include <scShared/Management/latencytracer.h>
 
 #include <scShared/Plugins/abstractplugin.h>
 
@@ -94,6 +95,7 @@ const QString pluginDir = "/mne_scan_plugins";        /**< holds path to plugins
 MainWindow::MainWindow(QWidget *parent)
 : QMainWindow(parent)
 , m_bIsRunning(false)
+, m_bHeadless(false)
 , m_iTimeoutMSec(1000)
 , m_pStartUpWidget(new StartUpWidget(this))
 , m_eLogLevelCurrent(_LogLvMax)
@@ -451,6 +453,11 @@ void MainWindow::createActions()
     connect(m_pActionExit.data(), &QAction::triggered,
             this, &MainWindow::close);
 
+    m_pActionExportLatency = new QAction(tr("Export &latency statistics..."), this);
+    m_pActionExportLatency->setStatusTip(tr("Export the recorded latency histograms to a CSV or JSON file"));
+    connect(m_pActionExportLatency.data(), &QAction::triggered,
+            this, &MainWindow::exportLatencyStatistics);
+
     //View QMenu
     m_pActionMinLgLv = new QAction(tr("&Minimal"), this);
     m_pActionMinLgLv->setCheckable(true);
@@ -473,6 +480,12 @@ void MainWindow::createActions()
     connect(m_pActionMaxLgLv.data(), &QAction::triggered,
             this, &MainWindow::setMaxLogLevel);
 
+    m_pActionLatencyOverlay = new QAction(tr("Latency overlay"), this);
+    m_pActionLatencyOverlay->setCheckable(true);
+    m_pActionLatencyOverlay->setStatusTip(tr("Trace the latencies of the plugin pipeline and show them in an overlay"));
+    connect(m_pActionLatencyOverlay.data(), &QAction::toggled,
+            this, &MainWindow::showLatencyOverlay);
+
     m_pActionGroupLgLv = new QActionGroup(this);
     m_pActionGroupLgLv->addAction(m_pActionMinLgLv);
     m_pActionGroupLgLv->addAction(m_pActionNormLgLv);
@@ -572,6 +585,8 @@ void MainWindow::createMenus()
         m_pMenuFile->addAction(m_pActionOpenConfig);
         m_pMenuFile->addAction(m_pActionSaveConfig);
         m_pMenuFile->addSeparator();
+        m_pMenuFile->addAction(m_pActionExportLatency);
+        m_pMenuFile->addSeparator();
         m_pMenuFile->addAction(m_pActionExit);
     }
 
@@ -589,6 +604,7 @@ void MainWindow::createMenus()
     m_pMenuLgLv->addAction(m_pActionMinLgLv);
     m_pMenuLgLv->addAction(m_pActionNormLgLv);
     m_pMenuLgLv->addAction(m_pActionMaxLgLv);
+    m_pMenuView->addAction(m_pActionLatencyOverlay);
     m_pMenuView->addSeparator();
 
     if(m_pPluginGuiDockWidget) {
@@ -894,7 +910,11 @@ void MainWindow::startMeasurement()
     writeToLog(tr("Starting real-time measurement..."), _LogKndMessage, _LogLvMin);
 
     if(!m_pPluginSceneManager->startPlugins()) {
-        QMessageBox::information(0, tr("MNE Scan - Start"), QString(QObject::tr("Not able to start all plugins!")), QMessageBox::Ok);
+        if(m_bHeadless) {
+            qCritical() << "MainWindow::startMeasurement - Not able to start all plugins!";
+        } else {
+            QMessageBox::information(0, tr("MNE Scan - Start"), QString(QObject::tr("Not able to start all plugins!")), QMessageBox::Ok);
+        }
         m_pPluginSceneManager->stopPlugins();
         return;
     }
@@ -977,4 +997,123 @@ void MainWindow::updateTime()
      *m_pTime = m_pTime->addMSecs(m_iTimeoutMSec);
     QString strTime = m_pTime->toString();
     m_pLabelTime->setText(strTime);
+
+    updateLatencyOverlay();
+}
+
+//=============================================================================================================
+
+void MainWindow::showLatencyOverlay(bool bShow)
+{
+    LatencyTracer::instance().setEnabled(bShow || m_bHeadless);
+
+    if(!m_pLabelLatencyOverlay) {
+        m_pLabelLatencyOverlay = new QLabel(this);
+        m_pLabelLatencyOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+        m_pLabelLatencyOverlay->setStyleSheet("background-color: rgba(0, 0, 0, 160); color: white; padding: 6px; font-family: monospace;");
+    }
+
+    m_pLabelLatencyOverlay->setVisible(bShow);
+    updateLatencyOverlay();
+}
+
+//=============================================================================================================
+
+void MainWindow::updateLatencyOverlay()
+{
+    if(!m_pLabelLatencyOverlay || !m_pLabelLatencyOverlay->isVisible()) {
+        return;
+    }
+
+    QString sSummary = LatencyTracer::instance().summary();
+    m_pLabelLatencyOverlay->setText(sSummary.isEmpty() ? tr("No latencies recorded yet") : sSummary);
+    m_pLabelLatencyOverlay->adjustSize();
+
+    // Keep the overlay in the top right corner of the central widget
+    if(QWidget* pCentralWidget = centralWidget()) {
+        QRect rectCentral = pCentralWidget->geometry();
+        m_pLabelLatencyOverlay->move(rectCentral.right() - m_pLabelLatencyOverlay->width() - 10,
+                                     rectCentral.top() + 10);
+    }
+
+    m_pLabelLatencyOverlay->raise();
+}
+
+//=============================================================================================================
+
+void MainWindow::exportLatencyStatistics()
+{
+    QString sFileName = QFileDialog::getSaveFileName(this,
+                                                     tr("Export latency statistics"),
+                                                     QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/latency.csv",
+                                                     tr("CSV file (*.csv);;JSON file (*.json)"));
+
+    if(sFileName.isEmpty()) {
+        return;
+    }
+
+    if(!LatencyTracer::instance().exportToFile(sFileName)) {
+        QMessageBox::warning(this, tr("MNE Scan - Latency"), tr("Could not write %1").arg(sFileName));
+    }
+}
+
+//=============================================================================================================
+
+void MainWindow::runBenchmark(const QString& sConfigFile,
+                              int iDurationSec,
+                              const QString& sOutputFile)
+{
+    m_bHeadless = true;
+
+    // The splash screen is only closed when the main window is shown
+    if(m_pSplashScreen) {
+        m_pSplashScreen->close();
+    }
+
+    QFileInfo qFileInfo(sConfigFile);
+    if(!qFileInfo.exists()) {
+        qCritical() << "MainWindow::runBenchmark - Configuration" << sConfigFile << "does not exist.";
+        QTimer::singleShot(0, qApp, []() { qApp->exit(1); });
+        return;
+    }
+
+    m_pPluginGui->loadConfig(qFileInfo.absolutePath(), qFileInfo.fileName());
+
+    LatencyTracer::instance().reset();
+    LatencyTracer::instance().setEnabled(true);
+
+    startMeasurement();
+
+    if(!m_bIsRunning) {
+        QTimer::singleShot(0, qApp, []() { qApp->exit(1); });
+        return;
+    }
+
+    QTimer::singleShot(iDurationSec * 1000, this, [this, sOutputFile]() {
+        stopMeasurement();
+
+        LatencyTracer& tracer = LatencyTracer::instance();
+        tracer.setEnabled(false);
+
+        printf("%-60s %10s %10s %10s\n", "edge", "count", "p50 [ms]", "p99 [ms]");
+        for(const QString& sEdge : tracer.getEdges()) {
+            LatencyHistogram histogram = tracer.getHistogram(sEdge, LatencyTracer::EndToEnd);
+            if(histogram.count() == 0) {
+                continue;
+            }
+
+            printf("%-60s %10lld %10.2f %10.2f\n",
+                   sEdge.toUtf8().constData(),
+                   histogram.count(),
+                   double(histogram.percentile(50)) * 1e-6,
+                   double(histogram.percentile(99)) * 1e-6);
+        }
+        fflush(stdout);
+
+        if(!sOutputFile.isEmpty()) {
+            tracer.exportToFile(sOutputFile);
+        }
+
+        qApp->quit();
+    });
 }
@@ -201,6 +201,20 @@ public:
      */
     void loadSettings();
 
+    //=========================================================================================================
+    /**
+     * Runs a plugin pipeline without user interaction and reports the end-to-end latencies. Loads the
+     * configuration, starts the measurement with latency tracing enabled, stops it after the given duration,
+     * prints the median and 99th percentile of every edge and quits the application.
+     *
+     * @param [in] sConfigFile      the plugin configuration (.xml) to run, e.g. a FiffSimulator pipeline.
+     * @param [in] iDurationSec     the duration of the measurement in seconds.
+     * @param [in] sOutputFile      file to export the latency histograms to (.csv or .json). Not exported if empty.
+     */
+    void runBenchmark(const QString& sConfigFile,
+                      int iDurationSec,
+                      const QString& sOutputFile = QString());
+
 private:
     //=========================================================================================================
     /**
@@ -362,8 +376,30 @@ private:
      */
     void updateTime();
 
+    //=========================================================================================================
+    /**
+     * Shows or hides the latency overlay. Latency tracing is enabled while the overlay is shown.
+     *
+     * @param [in] bShow     whether to show the overlay.
+     */
+    void showLatencyOverlay(bool bShow);
+
+    //=========================================================================================================
+    /**
+     * Updates the text and position of the latency overlay.
+     */
+    void updateLatencyOverlay();
+
+    //=========================================================================================================
+    /**
+     * Exports the recorded latency histograms to a CSV or JSON file chosen by the user.
+     */
+    void exportLatencyStatistics();
+
     bool m_bIsRunning;                  /**< whether program/plugins is/are started.*/
 
+    bool                                m_bHeadless;                    /**< Whether running without user interaction, i.e. in benchmark mode.*/
+
     int                                 m_iTimeoutMSec;                 /**< Holds milliseconds after which timer timeouts.*/
 
     QPointer<QActionGroup>              m_pActionGroupLgLv;             /**< group log level */
@@ -386,6 +422,8 @@ private:
     QPointer<QAction>                   m_pActionDefaultMode;           /**< stop application */
     QPointer<QAction>                   m_pActionResearchMode;        /**< activate research gui mode */
     QPointer<QAction>                   m_pActionClinicalMode;          /**< activate clinical gui mode */
+    QPointer<QAction>                   m_pActionLatencyOverlay;        /**< show the latency overlay */
+    QPointer<QAction>                   m_pActionExportLatency;         /**< export the latency statistics */
 
     QList<QAction*>                     m_qListDynamicPluginActions;    /**< dynamic plugin actions */
     QList<QAction*>                     m_qListDynamicDisplayActions;   /**< dynamic display actions */
@@ -404,6 +442,7 @@ private:
     QPointer<QToolBar>                  m_pDynamicPluginToolBar;        /**< Holds the plugin tool bar.*/
 
     QPointer<QLabel>                    m_pLabelTime;                   /**< Holds the display label for the running time.*/
+    QPointer<QLabel>                    m_pLabelLatencyOverlay;         /**< Holds the latency overlay.*/
 
     QPointer<QTextBrowser>              m_pTextBrowser_Log;             /**< Holds the text browser for the log.*/
 
@@ -76,7 +76,7 @@ using namespace Eigen;
 //=============================================================================================================
 
 Averaging::Averaging()
-: m_pCircularBuffer(CircularBuffer<FIFFLIB::FiffEvokedSet>::SPtr::create(40))
+: m_pCircularBuffer(SpscCircularBuffer<FIFFLIB::FiffEvokedSet>::SPtr::create(40))
 {
 }
 
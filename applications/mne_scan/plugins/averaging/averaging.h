@@ -43,7 +43,7 @@
 #include "averaging_global.h"
 
 #include <scShared/Plugins/abstractalgorithm.h>
-#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
 
 #include <fiff/fiff_evoked_set.h>
 
@@ -224,7 +224,7 @@ private:
     SCSHAREDLIB::PluginInputData<SCMEASLIB::RealTimeMultiSampleArray>::SPtr     m_pAveragingInput;      /**< The RealTimeSampleArray of the Averaging input.*/
     SCSHAREDLIB::PluginOutputData<SCMEASLIB::RealTimeEvokedSet>::SPtr           m_pAveragingOutput;     /**< The RealTimeEvoked of the Averaging output.*/
 
-    UTILSLIB::CircularBuffer<FIFFLIB::FiffEvokedSet>::SPtr                      m_pCircularBuffer;      /**< Holds incoming fiff evoked sets. */
+    UTILSLIB::SpscCircularBuffer<FIFFLIB::FiffEvokedSet>::SPtr                  m_pCircularBuffer;      /**< Holds incoming fiff evoked sets. */
 
     QMutex                                          m_qMutex;                           /**< Provides access serialization between threads. */
 
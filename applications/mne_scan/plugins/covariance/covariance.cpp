@@ -81,7 +81,9 @@ using namespace Eigen;
 
 Covariance::Covariance()
 : m_iEstimationSamples(2000)
-, m_pCircularBuffer(CircularBuffer_Matrix_double::SPtr::create(40))
+, m_iEstimationMode(RtCov::Block)
+, m_iUpdateInterval(500)
+, m_pCircularBuffer(SpscCircularBuffer_Matrix_double::SPtr::create(40))
 {
 }
 
@@ -108,6 +110,8 @@ void Covariance::init()
     // Load Settings
     QSettings settings("MNECPP");
     m_iEstimationSamples = settings.value(QString("MNESCAN/%1/estimationSamples").arg(this->getName()), 5000).toInt();
+    m_iEstimationMode = settings.value(QString("MNESCAN/%1/estimationMode").arg(this->getName()), RtCov::Block).toInt();
+    m_iUpdateInterval = settings.value(QString("MNESCAN/%1/updateInterval").arg(this->getName()), 500).toInt();
 
     // Input
     m_pCovarianceInput = PluginInputData<RealTimeMultiSampleArray>::create(this, "CovarianceIn", "Covariance input data");
@@ -133,8 +137,14 @@ void Covariance::initPluginControlWidgets()
                 pCovarianceWidget, &CovarianceSettingsView::setGuiMode);
         connect(pCovarianceWidget, &CovarianceSettingsView::samplesChanged,
                 this, &Covariance::changeSamples);
+        connect(pCovarianceWidget, &CovarianceSettingsView::estimationModeChanged,
+                this, &Covariance::changeEstimationMode);
+        connect(pCovarianceWidget, &CovarianceSettingsView::updateIntervalChanged,
+                this, &Covariance::changeUpdateInterval);
         pCovarianceWidget->setMinSamples(m_pFiffInfo->sfreq);
         pCovarianceWidget->setCurrentSamples(m_iEstimationSamples);
+        pCovarianceWidget->setCurrentEstimationMode(m_iEstimationMode);
+        pCovarianceWidget->setCurrentUpdateInterval(m_iUpdateInterval);
         pCovarianceWidget->setObjectName("group_Settings");
         plControlWidgets.append(pCovarianceWidget);
 
@@ -151,6 +161,8 @@ void Covariance::unload()
     // Save Settings
     QSettings settings("MNECPP");
     settings.setValue(QString("MNESCAN/%1/estimationSamples").arg(this->getName()), m_iEstimationSamples);
+    settings.setValue(QString("MNESCAN/%1/estimationMode").arg(this->getName()), m_iEstimationMode);
+    settings.setValue(QString("MNESCAN/%1/updateInterval").arg(this->getName()), m_iUpdateInterval);
 }
 
 //=============================================================================================================
@@ -234,11 +246,28 @@ void Covariance::update(SCMEASLIB::Measurement::SPtr pMeasurement)
 
 void Covariance::changeSamples(qint32 samples)
 {
+    QMutexLocker locker(&m_mutex);
     m_iEstimationSamples = samples;
 }
 
 //=============================================================================================================
 
+void Covariance::changeEstimationMode(int iMode)
+{
+    QMutexLocker locker(&m_mutex);
+    m_iEstimationMode = iMode;
+}
+
+//=============================================================================================================
+
+void Covariance::changeUpdateInterval(int iSamples)
+{
+    QMutexLocker locker(&m_mutex);
+    m_iUpdateInterval = iSamples;
+}
+
+//=============================================================================================================
+
 void Covariance::run()
 {
     // Wait for fiff info
@@ -256,6 +285,8 @@ void Covariance::run()
     FiffCov fiffCov;
     m_mutex.lock();
     int iEstimationSamples = m_iEstimationSamples;
+    int iEstimationMode = m_iEstimationMode;
+    int iUpdateInterval = m_iUpdateInterval;
     m_mutex.unlock();
     RTPROCESSINGLIB::RtCov rtCov(m_pFiffInfo);
 
@@ -265,8 +296,14 @@ void Covariance::run()
         if(m_pCircularBuffer->pop(matData)) {
             m_mutex.lock();
             iEstimationSamples = m_iEstimationSamples;
+            iEstimationMode = m_iEstimationMode;
+            iUpdateInterval = m_iUpdateInterval;
             m_mutex.unlock();
 
+            // The continuous modes are opt-in and emit a new estimate every update interval
+            rtCov.setEstimationMode(static_cast<RtCov::EstimationMode>(iEstimationMode));
+            rtCov.setUpdateInterval(iUpdateInterval);
+
             fiffCov = rtCov.estimateCovariance(matData, iEstimationSamples);
             if(!fiffCov.names.isEmpty()) {
                 m_pCovarianceOutput->measurementData()->setValue(fiffCov);
@@ -43,7 +43,7 @@
 #include "covariance_global.h"
 
 #include <scShared/Plugins/abstractalgorithm.h>
-#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -148,14 +148,20 @@ public:
 
     void changeSamples(qint32 samples);
 
+    void changeEstimationMode(int iMode);
+
+    void changeUpdateInterval(int iSamples);
+
 protected:
     virtual void run();
 
 private:
     QMutex      m_mutex;
     qint32      m_iEstimationSamples;
+    qint32      m_iEstimationMode;
+    qint32      m_iUpdateInterval;
 
-    UTILSLIB::CircularBuffer_Matrix_double::SPtr        m_pCircularBuffer;              /**< Matrix data circular buffer */
+    UTILSLIB::SpscCircularBuffer_Matrix_double::SPtr    m_pCircularBuffer;              /**< Matrix data circular buffer */
 
     QSharedPointer<FIFFLIB::FiffInfo>                   m_pFiffInfo;                    /**< Fiff measurement info.*/
 
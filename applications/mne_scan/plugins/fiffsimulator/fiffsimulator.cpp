@@ -81,7 +81,7 @@ FiffSimulator::FiffSimulator()
 , m_sFiffSimulatorClientAlias("mne_scan")
 , m_iActiveConnectorId(0)
 , m_iBufferSize(-1)
-, m_pCircularBuffer(QSharedPointer<CircularBuffer_Matrix_float>(new CircularBuffer_Matrix_float(40)))
+, m_pCircularBuffer(QSharedPointer<SpscCircularBuffer_Matrix_float>(new SpscCircularBuffer_Matrix_float(40)))
 , m_pRtCmdClient(QSharedPointer<RtCmdClient>::create())
 , m_iDefaultPortCmdClient(4217)
 {
@@ -44,7 +44,7 @@
 
 #include <scShared/Plugins/abstractsensor.h>
 #include <communication/rtClient/rtcmdclient.h>
-#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -193,7 +193,7 @@ protected:
     QSharedPointer<FiffSimulatorProducer>                       m_pFiffSimulatorProducer;   /**< Holds the FiffSimulatorProducer.*/
     QSharedPointer<FIFFLIB::FiffInfo>                           m_pFiffInfo;                /**< Fiff measurement info.*/
     QSharedPointer<COMMUNICATIONLIB::RtCmdClient>               m_pRtCmdClient;             /**< The command client.*/
-    QSharedPointer<UTILSLIB::CircularBuffer_Matrix_float>       m_pCircularBuffer;          /**< Holds incoming raw data. */
+    QSharedPointer<UTILSLIB::SpscCircularBuffer_Matrix_float>   m_pCircularBuffer;          /**< Holds incoming raw data. */
 
     bool                    m_bCmdClientIsConnected;        /**< If the command client is connected.*/
     QString                 m_sFiffSimulatorIP;             /**< The IP Adress of mne_rt_server.*/
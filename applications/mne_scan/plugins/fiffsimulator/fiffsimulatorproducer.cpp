@@ -182,7 +182,7 @@ void FiffSimulatorProducer::run()
             if(kind == FIFF_DATA_BUFFER) {
                 to += matData.cols();
                 from += matData.cols();
-                while(!m_pFiffSimulator->m_pCircularBuffer->push(matData) && !isInterruptionRequested()) {
+                while(!m_pFiffSimulator->m_pCircularBuffer->pushSwap(matData) && !isInterruptionRequested()) {
                     //Do nothing until the circular buffer is ready to accept new data again
                 }
             } else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END) {
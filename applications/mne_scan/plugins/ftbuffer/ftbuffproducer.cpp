@@ -90,7 +90,12 @@ void FtBuffProducer::runMainLoop()
     qInfo() << "[FtBuffProducer::runMainLoop] Connected to buffer and ready to receive data.";
 
     while(!this->thread()->isInterruptionRequested()) {
-        m_pFtConnector->getData();
+        //Sleep in the socket until the buffer has new samples instead of polling it
+        if(m_pFtConnector->isEventDriven()) {
+            m_pFtConnector->waitForData();
+        } else {
+            m_pFtConnector->getData();
+        }
 
         //Sends up new data when FtConnector flags new data
         if (m_pFtConnector->newData()) {
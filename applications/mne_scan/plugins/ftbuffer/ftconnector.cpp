@@ -38,6 +38,8 @@
 
 #include "ftconnector.h"
 
+#include <limits>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
@@ -63,8 +65,11 @@ FtConnector::FtConnector()
 :m_iNumSamples(0)
 ,m_iNumNewSamples(0)
 ,m_iNumChannels(0)
+,m_iWaitSamples(1)
+,m_iWaitTimeout(200)
 ,m_iPort(1972)
 ,m_bNewData(false)
+,m_bEventDriven(true)
 ,m_fSampleFreq(0)
 ,m_sAddress("127.0.0.1")
 ,m_pSocket(Q_NULLPTR)
@@ -103,6 +108,8 @@ bool FtConnector::connect()
     }
 
     if(m_pSocket->state() == QAbstractSocket::ConnectedState) {
+        //Requests are small, do not let them wait for more data to be sent
+        m_pSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
         qInfo() << "[FtConnector::connect] Connected!";
         return true;
     } else {
@@ -208,7 +215,7 @@ bool FtConnector::parseHeaderDef(QBuffer &readBuffer)
 
     qInfo() << "[FtConnector::parseHeaderDef] Got header parameters.";
 
-    if (m_iDataType != 9) {
+    if (dataTypeSize(m_iDataType) == 0) {
         qCritical() << "Data type not supported. Plugin will not behave correctly.";
     }
 
@@ -310,6 +317,268 @@ bool FtConnector::getData()
 
 //=============================================================================================================
 
+bool FtConnector::waitForData()
+{
+    // A failed reconnect leaves no socket behind
+    if(!m_pSocket && !connect()) {
+        return false;
+    }
+
+    // Wait until the buffer holds more than threshold samples. Events are ignored.
+    messagedef_t messagedef;
+    messagedef.bufsize = sizeof(samples_events_t) + sizeof (qint32);
+    messagedef.command = WAIT_DAT;
+
+    samples_events_t threshold;
+    threshold.nsamples = m_iNumSamples + m_iWaitSamples - 1;
+    threshold.nevents = std::numeric_limits<qint32>::max();
+
+    qint32 timeout = m_iWaitTimeout;
+
+    sendRequest(messagedef);
+    sendSampleEvents(threshold);
+    m_pSocket->write(reinterpret_cast<char*>(&timeout), sizeof (qint32));
+
+    messagedef_t response;
+    if(!readExactly(reinterpret_cast<char*>(&response), sizeof (messagedef_t))) {
+        return false;
+    }
+
+    if(response.command != WAIT_OK || response.bufsize < static_cast<qint32>(sizeof (samples_events_t))) {
+        QByteArray discard(qMax(0, response.bufsize), 0);
+        readExactly(discard.data(), discard.size());
+        qWarning() << "[FtConnector::waitForData] WAIT_DAT request failed.";
+        return false;
+    }
+
+    samples_events_t samplesEvents;
+    if(!readExactly(reinterpret_cast<char*>(&samplesEvents), sizeof (samples_events_t))) {
+        return false;
+    }
+
+    m_iNumNewSamples = samplesEvents.nsamples;
+
+    if (m_iNumNewSamples < m_iNumSamples) {
+        // buffer was restarted, continue with its new samples
+        m_iNumSamples = m_iNumNewSamples;
+        return false;
+    }
+
+    if (m_iNumNewSamples == m_iNumSamples) {
+        // timed out without new data
+        return false;
+    }
+
+    // Get data message + data selection params
+    messagedef.bufsize = sizeof (datasel_t);
+    messagedef.command = GET_DAT;
+
+    datasel_t datasel;
+    datasel.begsample = m_iNumSamples;
+    datasel.endsample = m_iNumNewSamples - 1;
+
+    sendRequest(messagedef);
+    sendDataSel(datasel);
+
+    if(!readExactly(reinterpret_cast<char*>(&response), sizeof (messagedef_t))) {
+        return false;
+    }
+
+    if(response.command != GET_OK || response.bufsize < static_cast<qint32>(sizeof (datadef_t))) {
+        QByteArray discard(qMax(0, response.bufsize), 0);
+        readExactly(discard.data(), discard.size());
+        qWarning() << "[FtConnector::waitForData] GET_DAT request failed.";
+        return false;
+    }
+
+    datadef_t datadef;
+    if(!readExactly(reinterpret_cast<char*>(&datadef), sizeof (datadef_t))) {
+        return false;
+    }
+
+    if(!receiveData(datadef)) {
+        return false;
+    }
+
+    //update sample tracking
+    m_iMsgSamples = datadef.nsamples;
+    m_iNumSamples += datadef.nsamples;
+    m_bNewData = true;
+
+    return true;
+}
+
+//=============================================================================================================
+
+void FtConnector::setWaitThreshold(int iNumSamples,
+                                   int iTimeout)
+{
+    m_iWaitSamples = qMax(1, iNumSamples);
+    m_iWaitTimeout = qMax(0, iTimeout);
+}
+
+//=============================================================================================================
+
+void FtConnector::setEventDriven(bool bEventDriven)
+{
+    m_bEventDriven = bEventDriven;
+}
+
+//=============================================================================================================
+
+bool FtConnector::isEventDriven() const
+{
+    return m_bEventDriven;
+}
+
+//=============================================================================================================
+
+bool FtConnector::readExactly(char* pData,
+                              qint64 iNumBytes)
+{
+    qint64 iRead = 0;
+
+    while(iRead < iNumBytes) {
+        if(m_pSocket->bytesAvailable() == 0 && !m_pSocket->waitForReadyRead(m_iWaitTimeout + 1000)) {
+            qWarning() << "[FtConnector::readExactly] Timed out waiting for buffer response.";
+            resetConnection();
+            return false;
+        }
+
+        qint64 iBytes = m_pSocket->read(pData + iRead, iNumBytes - iRead);
+        if(iBytes < 0) {
+            resetConnection();
+            return false;
+        }
+        iRead += iBytes;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+void FtConnector::resetConnection()
+{
+    // The rest of the response may still arrive at any time and would be taken as the answer to the next request
+    qWarning() << "[FtConnector::resetConnection] Reconnecting to get back in sync with the buffer.";
+    m_pSocket->abort();
+    connect();
+}
+
+//=============================================================================================================
+
+bool FtConnector::receiveData(const datadef_t& datadef)
+{
+    int iSampleSize = dataTypeSize(datadef.data_type);
+    qint64 iNumValues = static_cast<qint64>(datadef.nchans) * datadef.nsamples;
+
+    if(iSampleSize == 0 || iNumValues * iSampleSize != datadef.bufsize) {
+        qWarning() << "[FtConnector::receiveData] Data type" << datadef.data_type << "not supported or inconsistent data size.";
+        QByteArray discard(qMax(0, datadef.bufsize), 0);
+        readExactly(discard.data(), discard.size());
+        return false;
+    }
+
+    // Does not reallocate as long as the block size stays the same
+    m_matEmit.resize(datadef.nchans, datadef.nsamples);
+
+    // The buffer sends the data sample by sample, each with the values of all channels (channel-interleaved).
+    // This is the column major layout of m_matEmit, one column per sample. The raw values are placed at the end
+    // of the matrix memory. A converted value never reaches raw bytes which are
+    // not converted yet, since no raw value is wider than a double.
+    double* pData = m_matEmit.data();
+    char* pRaw = reinterpret_cast<char*>(pData) + iNumValues * static_cast<qint64>(sizeof(double)) - datadef.bufsize;
+
+    qint64 iReceived = 0;
+    qint64 iConverted = 0;
+
+    while(iReceived < datadef.bufsize) {
+        if(m_pSocket->bytesAvailable() == 0 && !m_pSocket->waitForReadyRead(m_iWaitTimeout + 1000)) {
+            qWarning() << "[FtConnector::receiveData] Timed out waiting for sample data.";
+            resetConnection();
+            return false;
+        }
+
+        qint64 iBytes = m_pSocket->read(pRaw + iReceived, datadef.bufsize - iReceived);
+        if(iBytes < 0) {
+            resetConnection();
+            return false;
+        }
+        iReceived += iBytes;
+
+        // Decode what arrived while the rest is still on its way
+        qint64 iComplete = iReceived / iSampleSize;
+        convertSamples(pRaw, pData, iConverted, iComplete, datadef.data_type);
+        iConverted = iComplete;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+int FtConnector::dataTypeSize(qint32 iDataType)
+{
+    switch(iDataType) {
+        case DATATYPE_INT16:
+            return sizeof(qint16);
+        case DATATYPE_INT32:
+            return sizeof(qint32);
+        case DATATYPE_FLOAT32:
+            return sizeof(float);
+        case DATATYPE_FLOAT64:
+            return sizeof(double);
+        default:
+            return 0;
+    }
+}
+
+//=============================================================================================================
+
+namespace {
+
+template<typename T>
+void widenSamples(const char* pRaw,
+                  double* pData,
+                  qint64 iFrom,
+                  qint64 iTo)
+{
+    T value;
+    for(qint64 i = iFrom; i < iTo; ++i) {
+        std::memcpy(&value, pRaw + i * static_cast<qint64>(sizeof(T)), sizeof(T));
+        pData[i] = static_cast<double>(value);
+    }
+}
+
+}
+
+//=============================================================================================================
+
+void FtConnector::convertSamples(const char* pRaw,
+                                 double* pData,
+                                 qint64 iFrom,
+                                 qint64 iTo,
+                                 qint32 iDataType)
+{
+    switch(iDataType) {
+        case DATATYPE_INT16:
+            widenSamples<qint16>(pRaw, pData, iFrom, iTo);
+            break;
+        case DATATYPE_INT32:
+            widenSamples<qint32>(pRaw, pData, iFrom, iTo);
+            break;
+        case DATATYPE_FLOAT32:
+            widenSamples<float>(pRaw, pData, iFrom, iTo);
+            break;
+        case DATATYPE_FLOAT64:
+            widenSamples<double>(pRaw, pData, iFrom, iTo);
+            break;
+    }
+}
+
+//=============================================================================================================
+
 bool FtConnector::setAddr(const QString &sNewAddress)
 {
     m_sAddress.clear();
@@ -458,38 +727,19 @@ void FtConnector::sendSampleEvents(samples_events_t &threshold)
 bool FtConnector::parseData(QBuffer &datasampBuffer,
                             int bufsize)
 {
-    Q_UNUSED(bufsize)
-    //start interpreting data as float instead of char
     QByteArray dataArray = datasampBuffer.readAll();
-    float* fdata = reinterpret_cast<float*> (dataArray.data());
-
-//TODO: Implement receiving other types of data
-//    switch (m_iDataType) {
-//        case DATATYPE_FLOAT32:
-//            auto data = reinterpret_cast<float*>(dataArray.data(), bufsize);
-//            qDebug() << "*** Would you look at that, we're all the way here ***";
-//            qDebug() << "Data sample:";
-
-//            for (int i = 0; i < 10 ; i++) {
-//                qDebug() << data[i];
-//            }
-//            break;
-//    }
 
-    //format data into eigen matrix to pass up
-    Eigen::MatrixXf matData;
-    matData.resize(m_iNumChannels, m_iMsgSamples);
-
-    int count = 0;
-    for (int i = 0; i < int (m_iMsgSamples); i++) {
-        for (int j = 0; j < int (m_iNumChannels); j++) {
-            matData(j,i) = fdata[count];
-            count++;
-        }
+    qint64 iNumValues = static_cast<qint64>(m_iNumChannels) * m_iMsgSamples;
+    if(dataTypeSize(m_iDataType) == 0 || iNumValues * dataTypeSize(m_iDataType) > qMin<qint64>(bufsize, dataArray.size())) {
+        qWarning() << "[FtConnector::parseData] Data type" << m_iDataType << "not supported or inconsistent data size.";
+        return false;
     }
 
+    //format data into eigen matrix to pass up, the channels of each sample are stored next to each other
+    m_matEmit.resize(m_iNumChannels, m_iMsgSamples);
+    convertSamples(dataArray.constData(), m_matEmit.data(), 0, iNumValues, m_iDataType);
+
     //store and flag new data
-    m_pMatEmit = new Eigen::MatrixXd(matData.cast<double>());
     m_bNewData = true;
 
     return m_bNewData;
@@ -500,8 +750,6 @@ bool FtConnector::parseData(QBuffer &datasampBuffer,
 void FtConnector::resetEmitData()
 {
     m_bNewData = false;
-    delete m_pMatEmit;
-    m_pMatEmit = Q_NULLPTR;
 }
 
 //=============================================================================================================
@@ -516,9 +764,9 @@ bool FtConnector::disconnect()
 
 //=============================================================================================================
 
-Eigen::MatrixXd FtConnector::getMatrix()
+const Eigen::MatrixXd& FtConnector::getMatrix() const
 {
-    return *m_pMatEmit;
+    return m_matEmit;
 }
 
 //=============================================================================================================
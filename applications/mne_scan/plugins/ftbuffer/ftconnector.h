@@ -98,6 +98,11 @@ namespace FTBUFFERPLUGIN
 #define PUT_DAT_NORESPONSE static_cast<qint16>(0x0502) /* decimal 1282 */
 #define PUT_EVT_NORESPONSE static_cast<qint16>(0x0503) /* decimal 1283 */
 
+#define DATATYPE_INT16   static_cast<qint32>(6)
+#define DATATYPE_INT32   static_cast<qint32>(7)
+#define DATATYPE_FLOAT32 static_cast<qint32>(9)
+#define DATATYPE_FLOAT64 static_cast<qint32>(10)
+
 //=============================================================================================================
 // STRUCT DEFINITIONS
 //=============================================================================================================
@@ -188,12 +193,48 @@ public:
 
     //=========================================================================================================
     /**
-     * equests and receives data from buffer, parses it, and stores it in m_pMatEmit
+     * equests and receives data from buffer, parses it, and stores it in m_matEmit
      *
      * @return true if successful, false if unsuccessful
      */
     bool getData();
 
+    //=========================================================================================================
+    /**
+     * Blocks in a WAIT_DAT request until the buffer holds at least m_iWaitSamples unread samples or
+     * m_iWaitTimeout ms passed, then requests the unread samples and decodes them directly from the socket into
+     * m_matEmit. Does not poll, the thread sleeps in the socket while the buffer is idle.
+     *
+     * @return true if new data was received, false on timeout or error
+     */
+    bool waitForData();
+
+    //=========================================================================================================
+    /**
+     * Sets the thresholds of the WAIT_DAT requests sent by waitForData.
+     *
+     * @param[in] iNumSamples   Minimum number of new samples to wait for.
+     * @param[in] iTimeout      Maximum time to wait in ms. New samples below the threshold are read after the timeout.
+     */
+    void setWaitThreshold(int iNumSamples,
+                          int iTimeout);
+
+    //=========================================================================================================
+    /**
+     * Sets whether the producer uses waitForData instead of polling with getData. Default is true.
+     *
+     * @param[in] bEventDriven  Whether to wait for data instead of polling.
+     */
+    void setEventDriven(bool bEventDriven);
+
+    //=========================================================================================================
+    /**
+     * Returns whether the producer uses waitForData instead of polling with getData.
+     *
+     * @return Whether to wait for data instead of polling.
+     */
+    bool isEventDriven() const;
+
     //=========================================================================================================
     /**
      * Gets address currently stored in private member m_sAddress
@@ -238,11 +279,11 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns member m_pMatEmit, newest buffer data formatted as an Eigen MatrixXd
+     * Returns member m_matEmit, newest buffer data formatted as an Eigen MatrixXd
      *
-     * @return returns m_pMatEmit
+     * @return returns m_matEmit
      */
-    Eigen::MatrixXd getMatrix();
+    const Eigen::MatrixXd& getMatrix() const;
 
     //=========================================================================================================
     /**
@@ -254,7 +295,7 @@ public:
 
     //=========================================================================================================
     /**
-     * Sets m_bNewData to false, deletes m_pMatEmit
+     * Sets m_bNewData to false. m_matEmit keeps its memory for the next block.
      */
     void resetEmitData();
 
@@ -329,7 +370,7 @@ private:
 
     //=========================================================================================================
     /**
-     * Parses sample data received from buffer, formates it and saves it to m_pMatEmit;
+     * Parses sample data received from buffer, formates it and saves it to m_matEmit;
      *
      * @param[in] datasampBuffer    QBuffer with return data from buffer
      * @param[in] bufsize           Buffer size of sample data
@@ -349,6 +390,64 @@ private:
     void prepBuffer(QBuffer &buffer,
                     int numBytes);
 
+    //=========================================================================================================
+    /**
+     * Reads exactly iNumBytes from the socket, waiting for them to arrive if necessary.
+     *
+     * @param[out] pData        Where to write the bytes to.
+     * @param[in] iNumBytes     How many bytes to read from socket.
+     *
+     * @return true if successful, false if the bytes did not arrive in time. The connection is reset in that case.
+     */
+    bool readExactly(char* pData,
+                     qint64 iNumBytes);
+
+    //=========================================================================================================
+    /**
+     * Drops the connection and connects again. Used after a response did not arrive completely, since its
+     * remaining bytes would be mistaken for the response to the next request.
+     */
+    void resetConnection();
+
+    //=========================================================================================================
+    /**
+     * Reads sample data from the socket and decodes it into m_matEmit while it arrives. The raw samples are
+     * received into the tail of the matrix memory and widened to double front to back, so no intermediate
+     * buffer is needed.
+     *
+     * @param[in] datadef       The data definition received from the buffer.
+     *
+     * @return true if successful, false if unsuccessful. The connection is reset if the data did not arrive in time.
+     */
+    bool receiveData(const datadef_t& datadef);
+
+    //=========================================================================================================
+    /**
+     * Returns the size of a single sample of a buffer data type in bytes.
+     *
+     * @param[in] iDataType     The buffer data type.
+     *
+     * @return The size in bytes, 0 if the data type is not supported.
+     */
+    static int dataTypeSize(qint32 iDataType);
+
+    //=========================================================================================================
+    /**
+     * Converts raw samples to double. Values are converted in ascending order, hence pRaw may point into
+     * pData as long as it is not in front of the position the raw values would have as doubles.
+     *
+     * @param[in] pRaw          The raw samples.
+     * @param[out] pData        The converted samples.
+     * @param[in] iFrom         Index of the first sample to convert.
+     * @param[in] iTo           Index after the last sample to convert.
+     * @param[in] iDataType     The buffer data type of the raw samples.
+     */
+    static void convertSamples(const char* pRaw,
+                               double* pData,
+                               qint64 iFrom,
+                               qint64 iTo,
+                               qint32 iDataType);
+
     //=========================================================================================================
     /**
      * Returns total amount of samples written to buffer
@@ -363,9 +462,12 @@ private:
     int                                     m_iNumChannels;                         /**< Number of channels in the buffer data */
     int                                     m_iDataType;                            /**< Type of data in the buffer */
     int                                     m_iNeuromagHeader;                      /**< Size of neuromag header chunk */
+    int                                     m_iWaitSamples;                         /**< Minimum number of new samples a WAIT_DAT request waits for */
+    int                                     m_iWaitTimeout;                         /**< Timeout of a WAIT_DAT request in ms */
     quint16                                 m_iPort;                                /**< Port where the ft bufferis found */
 
     bool                                    m_bNewData;                             /**< Indicate whether we've received new data */
+    bool                                    m_bEventDriven;                         /**< Whether to wait for data instead of polling */
 
     float                                   m_fSampleFreq;                          /**< Sampling frequency of data in the buffer */
 
@@ -373,7 +475,7 @@ private:
 
     QTcpSocket*                             m_pSocket;                              /**< Socket that manages the connection to the ft buffer */
 
-    Eigen::MatrixXd*                        m_pMatEmit;                             /**< Container to format data to tansmit to FtBuffProducer */
+    Eigen::MatrixXd                         m_matEmit;                              /**< Container to format data to tansmit to FtBuffProducer. Reused across blocks. */
 };
 
 }//namespace end bracket
@@ -52,6 +52,8 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QDebug>
+
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
@@ -478,6 +480,10 @@ void Hpi::run()
 
     HPIFit HPI = HPIFit(m_pFiffInfo);
 
+    // continuous fits start from the last coil positions
+    HPI.setWarmStart(true);
+    const int iNumFitsPerTimingLog = 100;
+
     double dErrorMax = 0.0;
     double dMeanErrorDist = 0.0;
     double dAllowedMovement = 0.0;
@@ -546,6 +552,19 @@ void Hpi::run()
                            m_pFiffInfo);
                 m_mutex.unlock();
 
+                // log the mean run time of the fit stages to check the real-time budget
+                const HpiFitTiming& timing = HPI.getTiming();
+                if(timing.iNumFits >= iNumFitsPerTimingLog) {
+                    const double dScale = 1e-6 / timing.iNumFits;
+                    qInfo() << "[Hpi::run] Mean fit time" << timing.iTotal * dScale << "ms -"
+                            << "setup" << timing.iSetup * dScale << "ms,"
+                            << "amplitudes" << timing.iAmplitudes * dScale << "ms,"
+                            << "seed" << timing.iSeed * dScale << "ms,"
+                            << "dipfit" << timing.iDipfit * dScale << "ms,"
+                            << "transformation" << timing.iTransformation * dScale << "ms";
+                    HPI.resetTiming();
+                }
+
                 //Check if the error meets distance requirement
                 if(fitResult.errorDistances.size() > 0) {
                     dMeanErrorDist = std::accumulate(fitResult.errorDistances.begin(), fitResult.errorDistances.end(), .0) / fitResult.errorDistances.size();
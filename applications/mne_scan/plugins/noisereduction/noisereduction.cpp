@@ -204,14 +204,13 @@ void NoiseReduction::update(SCMEASLIB::Measurement::SPtr pMeasurement)
             m_matSparseProjMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
             m_matSparseCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
             m_matSparseSpharaMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseProjCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseFull = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
 
             m_matSparseProjMult.setIdentity();
             m_matSparseCompMult.setIdentity();
             m_matSparseSpharaMult.setIdentity();
-            m_matSparseProjCompMult.setIdentity();
-            m_matSparseFull.setIdentity();
+
+            m_spatialOperators.setNumChannels(m_pFiffInfo->chs.size());
+            m_spatialOperators.setTemporalFilter(m_lFilterChannelList, m_bFilterActivated);
 
             //Init output
             m_pNoiseReductionOutput->measurementData()->initFromFiffInfo(m_pFiffInfo);
@@ -315,6 +314,7 @@ void NoiseReduction::setSpharaActive(bool state)
 {
     m_mutex.lock();
     m_bSpharaActive = state;
+    m_spatialOperators.setSphara(m_matSparseSpharaMult, m_bSpharaActive);
     m_mutex.unlock();
 }
 
@@ -349,23 +349,13 @@ void NoiseReduction::run()
         // Get the current data
         if(m_pCircularBuffer->pop(matData)) {
             m_mutex.lock();
-            //Do SSP's and compensators here
-            if(m_bCompActivated) {
-                if(m_bProjActivated) {
-                    //Comp + Proj
-                    matData = m_matSparseProjCompMult * matData;
-                } else {
-                    //Comp
-                    matData = m_matSparseCompMult * matData;
-                }
-            } else {
-                if(m_bProjActivated) {
-                    //Proj
-                    matData = m_matSparseProjMult * matData;
-                } else {
-                    //None - Raw
-                }
-            }
+            //Set bad channels to zero before SPHARA so they do not get smeared into. Only rebuilds the operators if the bads changed.
+            m_spatialOperators.setBadChannels(m_pFiffInfo->bads,
+                                              m_pFiffInfo->ch_names,
+                                              m_bSpharaActive);
+
+            //Do SSP's and compensators here. Also includes bad channel masking and SPHARA if they commute with the filter.
+            m_spatialOperators.applyBeforeFilter(matData);
 
             //Do temporal filtering here
             if(m_bFilterActivated) {
@@ -374,15 +364,8 @@ void NoiseReduction::run()
                                                m_lFilterChannelList);
             }
 
-            //Do SPHARA here
-            if(m_bSpharaActive) {
-                //Set bad channels to zero so they do not get smeared into
-                for(int i = 0; i < m_pFiffInfo->bads.size(); ++i) {
-                    matData.row(m_pFiffInfo->ch_names.indexOf(m_pFiffInfo->bads.at(i))).setZero();
-                }
-
-                matData = m_matSparseSpharaMult * matData;
-            }
+            //Do bad channel masking and SPHARA here, if they could not be folded in front of the filter
+            m_spatialOperators.applyAfterFilter(matData);
 
     //        //Common average
     //        MatrixXd commonAvr = MatrixXd(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
@@ -465,10 +448,7 @@ void NoiseReduction::updateProjection(const QList<FIFFLIB::FiffProj>& projs)
         if(tripletList.size() > 0)
             m_matSparseProjMult.setFromTriplets(tripletList.begin(), tripletList.end());
 
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
-
-        m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
+        m_spatialOperators.setProjector(m_matSparseProjMult, m_bProjActivated);
         m_mutex.unlock();
     }
 }
@@ -515,15 +495,14 @@ void NoiseReduction::updateCompensator(int to)
             }
         }
 
+        m_mutex.lock();
         m_matSparseCompMult = SparseMatrix<double>(matComp.rows(),matComp.cols());
         if(tripletList.size() > 0) {
             m_matSparseCompMult.setFromTriplets(tripletList.begin(), tripletList.end());
         }
 
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
-
-        m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
+        m_spatialOperators.setCompensator(m_matSparseCompMult, m_bCompActivated);
+        m_mutex.unlock();
     }
 }
 
@@ -552,6 +531,8 @@ void NoiseReduction::setFilterChannelType(QString sType)
             }
         }
     }
+
+    m_spatialOperators.setTemporalFilter(m_lFilterChannelList, m_bFilterActivated);
     m_mutex.unlock();
 }
 
@@ -573,7 +554,10 @@ void NoiseReduction::setFilter(const FilterKernel& filterData)
 
 void NoiseReduction::setFilterActive(bool state)
 {
+    m_mutex.lock();
     m_bFilterActivated = state;
+    m_spatialOperators.setTemporalFilter(m_lFilterChannelList, m_bFilterActivated);
+    m_mutex.unlock();
 }
 
 //=============================================================================================================
@@ -709,7 +693,7 @@ void NoiseReduction::createSpharaOperator()
     //Create full multiplication matrix
     m_matSparseSpharaMult = matSparseSpharaMultFirst * matSparseSpharaMultSecond;
 
-    m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
+    m_spatialOperators.setSphara(m_matSparseSpharaMult, m_bSpharaActive);
 
     m_mutex.unlock();
 }
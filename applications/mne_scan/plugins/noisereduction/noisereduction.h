@@ -47,6 +47,7 @@
 #include <fiff/fiff_proj.h>
 
 #include <rtprocessing/helpers/filterkernel.h>
+#include <rtprocessing/helpers/spatialoperatorcompositor.h>
 
 #include <scShared/Plugins/abstractalgorithm.h>
 
@@ -242,10 +243,10 @@ private:
     Eigen::VectorXi                 m_vecIndicesFirstEEG;                       /**< The indices of the channels to pick for the second SPHARA operator in case of an EEG system.*/
 
     Eigen::SparseMatrix<double>     m_matSparseSpharaMult;                      /**< The final sparse SPHARA operator .*/
-    Eigen::SparseMatrix<double>     m_matSparseProjCompMult;                    /**< The final sparse projection + compensator operator.*/
     Eigen::SparseMatrix<double>     m_matSparseProjMult;                        /**< The final sparse SSP projector */
     Eigen::SparseMatrix<double>     m_matSparseCompMult;                        /**< The final sparse compensator matrix */
-    Eigen::SparseMatrix<double>     m_matSparseFull;                            /**< The final sparse full multiplication matrix  */
+
+    RTPROCESSINGLIB::SpatialOperatorCompositor m_spatialOperators;              /**< Folds compensator, projector, bad channel mask and SPHARA into cached operators. */
 
     Eigen::MatrixXd                 m_matSpharaVVGradLoaded;                    /**< The loaded VectorView gradiometer basis functions.*/
     Eigen::MatrixXd                 m_matSpharaVVMagLoaded;                     /**< The loaded VectorView magnetometer basis functions.*/
@@ -93,7 +93,7 @@ using namespace Eigen;
 //=============================================================================================================
 
 RtcMne::RtcMne()
-: m_pCircularMatrixBuffer(CircularBuffer_Matrix_double::SPtr(new CircularBuffer_Matrix_double(40)))
+: m_pCircularMatrixBuffer(SpscCircularBuffer_Matrix_double::SPtr(new SpscCircularBuffer_Matrix_double(40)))
 , m_pCircularEvokedBuffer(CircularBuffer<FIFFLIB::FiffEvoked>::SPtr::create(40))
 , m_bEvokedInput(false)
 , m_bRawInput(false)
@@ -604,6 +604,7 @@ void RtcMne::run()
         if(bUpdateMinimumNorm) {
             m_qMutex.lock();
             pMinimumNorm = MinimumNorm::SPtr(new MinimumNorm(m_invOp, lambda2, m_sMethod));
+            pMinimumNorm->setFactoredKernel(true);
             m_bUpdateMinimumNorm = false;
             m_qMutex.unlock();
 
@@ -625,18 +626,23 @@ void RtcMne::run()
                     }
 
                     //TODO: Add picking here. See evoked part as input.
-                    sourceEstimate = pMinimumNorm->calculateInverse(matDataResized,
-                                                                    0.0f,
-                                                                    tstep,
-                                                                    true);
+                    //Only compute the sample which is sent on, if one is selected
+                    if(iTimePointSps < matDataResized.cols() && iTimePointSps >= 0) {
+                        sourceEstimate = pMinimumNorm->calculateInverse(matDataResized,
+                                                                        0.0f,
+                                                                        tstep,
+                                                                        FSLIB::Label(),
+                                                                        iTimePointSps,
+                                                                        true);
+                    } else {
+                        sourceEstimate = pMinimumNorm->calculateInverse(matDataResized,
+                                                                        0.0f,
+                                                                        tstep,
+                                                                        true);
+                    }
 
                     if(!sourceEstimate.isEmpty()) {
-                        if(iTimePointSps < sourceEstimate.data.cols() && iTimePointSps >= 0) {
-                            sourceEstimate = sourceEstimate.reduce(iTimePointSps,1);
-                            m_pRTSEOutput->measurementData()->setValue(sourceEstimate);
-                        } else {
-                            m_pRTSEOutput->measurementData()->setValue(sourceEstimate);
-                        }
+                        m_pRTSEOutput->measurementData()->setValue(sourceEstimate);
                     }
                 }
             } else {
@@ -41,7 +41,7 @@
 
 #include "writetofile_global.h"
 
-#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
 #include <scShared/Plugins/abstractalgorithm.h>
 
 //=============================================================================================================
@@ -209,7 +209,7 @@ private:
 
     QPointer<QAction>                       m_pActionRecordFile;            /**< start recording action */
 
-    QSharedPointer<UTILSLIB::CircularBuffer_Matrix_double>                      m_pCircularBuffer;      /**< Holds incoming raw data. */
+    QSharedPointer<UTILSLIB::SpscCircularBuffer_Matrix_double>                  m_pCircularBuffer;      /**< Holds incoming raw data. */
 
     SCSHAREDLIB::PluginInputData<SCMEASLIB::RealTimeMultiSampleArray>::SPtr      m_pWriteToFileInput;   /**< The RealTimeMultiSampleArray of the WriteToFile input.*/
 };
@@ -0,0 +1,208 @@
+//=============================================================================================================
+/**
+ * @file     main.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Example comparing latency and throughput of CircularBuffer and SpscCircularBuffer.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/circularbuffer.h>
+#include <utils/generics/spsccircularbuffer.h>
+#include <utils/generics/applicationlogger.h>
+
+#include <algorithm>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+
+/**
+ * Pushes iNumElements matrices of size iRows x iCols from a producer thread to the consumer (this thread) and prints
+ * the throughput and the push-to-pop latency. The first coefficient of every matrix carries its sequence number,
+ * which is used to verify the order and to look up the push time stamp.
+ */
+template<typename PushFunction, typename PopFunction>
+void runBenchmark(const QString& sName,
+                  int iRows,
+                  int iCols,
+                  int iNumElements,
+                  PushFunction push,
+                  PopFunction pop)
+{
+    QVector<qint64> vecPushTime(iNumElements);
+    QVector<qint64> vecLatency(iNumElements);
+    QElapsedTimer timer;
+    timer.start();
+
+    QFuture<void> future = QtConcurrent::run([&]() {
+        MatrixXd matData;
+        for(int i = 0; i < iNumElements; ++i) {
+            matData.resize(iRows, iCols);
+            matData(0,0) = i;
+            vecPushTime[i] = timer.nsecsElapsed();
+            while(!push(matData)) {
+            }
+        }
+    });
+
+    MatrixXd matData;
+    int iErrors = 0;
+    for(int i = 0; i < iNumElements; ++i) {
+        while(!pop(matData)) {
+        }
+
+        int iSequence = int(matData(0,0));
+        vecLatency[i] = timer.nsecsElapsed() - vecPushTime[iSequence];
+        if(iSequence != i) {
+            ++iErrors;
+        }
+    }
+
+    qint64 iElapsedNs = qMax(timer.nsecsElapsed(), qint64(1));
+    future.waitForFinished();
+
+    std::sort(vecLatency.begin(), vecLatency.end());
+    double dMeanLatency = 0.0;
+    for(int i = 0; i < vecLatency.size(); ++i) {
+        dMeanLatency += vecLatency[i];
+    }
+    dMeanLatency /= vecLatency.size();
+
+    double dSeconds = iElapsedNs / 1.0e9;
+
+    printf("%-28s | %4d x %5d | %10.0f blocks/s | %9.2f MB/s | latency mean %9.2f us | p50 %9.2f us | p99 %9.2f us | order errors %d\n",
+           sName.toUtf8().constData(),
+           iRows,
+           iCols,
+           iNumElements / dSeconds,
+           double(iNumElements) * iRows * iCols * sizeof(double) / 1.0e6 / dSeconds,
+           dMeanLatency / 1000.0,
+           vecLatency[vecLatency.size() / 2] / 1000.0,
+           vecLatency[int(vecLatency.size() * 0.99)] / 1000.0,
+           iErrors);
+}
+
+//=============================================================================================================
+
+/**
+ * Runs the benchmark for the semaphore based CircularBuffer and for SpscCircularBuffer with copying and swapping push.
+ */
+void runBenchmarks(int iRows,
+                   int iCols,
+                   int iNumElements,
+                   unsigned int uiBufferSize)
+{
+    CircularBuffer_Matrix_double circularBuffer(uiBufferSize);
+    runBenchmark("CircularBuffer",
+                 iRows, iCols, iNumElements,
+                 [&](MatrixXd& matData) { return circularBuffer.push(matData); },
+                 [&](MatrixXd& matData) { return circularBuffer.pop(matData); });
+
+    SpscCircularBuffer_Matrix_double spscBufferCopy(uiBufferSize, MatrixXd::Zero(iRows, iCols));
+    runBenchmark("SpscCircularBuffer (copy)",
+                 iRows, iCols, iNumElements,
+                 [&](MatrixXd& matData) { return spscBufferCopy.push(matData); },
+                 [&](MatrixXd& matData) { return spscBufferCopy.pop(matData); });
+
+    SpscCircularBuffer_Matrix_double spscBufferSwap(uiBufferSize, MatrixXd::Zero(iRows, iCols));
+    runBenchmark("SpscCircularBuffer (swap)",
+                 iRows, iCols, iNumElements,
+                 [&](MatrixXd& matData) { return spscBufferSwap.pushSwap(matData); },
+                 [&](MatrixXd& matData) { return spscBufferSwap.pop(matData); });
+}
+
+//=============================================================================================================
+
+/**
+ * The function main marks the entry point of the program.
+ * By default, main has the storage class extern.
+ *
+ * @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+ * @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+ * @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+ */
+int main(int argc, char *argv[])
+{
+    qInstallMessageHandler(ApplicationLogger::customLogWriter);
+    QCoreApplication app(argc, argv);
+
+    // Command Line Parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Circular Buffer Performance Example");
+    parser.addHelpOption();
+
+    QCommandLineOption elementsOption("elements", "The number of blocks to transfer per run <elements>.", "elements", "20000");
+    QCommandLineOption bufferOption("buffer", "The number of buffer elements <buffer>.", "buffer", "16");
+
+    parser.addOption(elementsOption);
+    parser.addOption(bufferOption);
+
+    parser.process(app);
+
+    int iNumElements = parser.value(elementsOption).toInt();
+    unsigned int uiBufferSize = parser.value(bufferOption).toUInt();
+
+    // Small blocks show the synchronization overhead, large blocks the copy overhead
+    runBenchmarks(1, 1, iNumElements * 10, uiBufferSize);
+    runBenchmarks(306, 10, iNumElements, uiBufferSize);
+    runBenchmarks(306, 100, iNumElements, uiBufferSize);
+    runBenchmarks(306, 1000, iNumElements / 10, uiBufferSize);
+
+    return 0;
+}
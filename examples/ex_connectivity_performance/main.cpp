@@ -144,6 +144,7 @@ int main(int argc, char *argv[])
 
     //Parameters for performance test
     QStringList sConnectivityMethodList = QStringList() << "COR" << "XCOR" << "COH" << "IMAGCOH" << "PLI" << "WPLI" << "USPLI" << "DSWPLI" << "PLV";
+    QStringList sSpectralMethodList = QStringList() << "COH" << "IMAGCOH" << "PLI" << "WPLI" << "USPLI" << "DSWPLI" << "PLV";
     QList<int> lNumberTrials = QList<int>() << 1 << 5 << 10 << 20 << 50 << 100 << 200;
     QList<int> lNumberChannels = QList<int>() << 32 << 64 << 128 << 256;
     QList<int> lNumberSamples = QList<int>() << 100 << 200 << 300 << 400 << 500 << 600 << 700 << 800 << 900 << 1000 << 2000 << 3000 << 4000 << 5000 << 6000 << 7000 << 8000 << 9000 << 10000 << 20000 << 30000 << 40000 << 50000 << 60000 << 70000 << 80000 << 90000 << 100000;
@@ -269,6 +270,40 @@ int main(int argc, char *argv[])
                         m_iCurrentIteration++;
                     }
                 }
+
+                // Compare all frequency domain metrics computed one after another against computing them
+                // together, where the tapered spectra and CSD are only computed once per trial
+                m_sCurrentDir = QString("/cluster/fusion/lesch/connectivity_performance_%1_%2_%3/%4/%5_%6_%7").arg(QHostInfo::localHostName()).arg(AbstractMetric::m_iNumberBinAmount).arg(iStorageModeActive).arg("MULTI").arg(QString::number(lNumberChannels.at(k))).arg(QString::number(lNumberSamples.at(j))).arg(QString::number(lNumberTrials.at(l)));
+                QDir().mkpath(m_sCurrentDir);
+
+                qWarning() << "sConnectivityMethods" << sSpectralMethodList;
+                qWarning() << "iNumberSamples" << lNumberSamples.at(j);
+                qWarning() << "iNumberChannels" << lNumberChannels.at(k);
+                qWarning() << "iNumberTrials" << lNumberTrials.at(l);
+
+                for(int u = 0; u < iNumberRepeats; ++u) {
+                    connectivitySettings.clearIntermediateData();
+                    timer.restart();
+
+                    for(int i = 0; i < sSpectralMethodList.size(); ++i) {
+                        connectivitySettings.setConnectivityMethods(QStringList() << sSpectralMethodList.at(i));
+                        connectivityObj.calculate(connectivitySettings);
+                    }
+
+                    qint64 iTimeSeparate = timer.elapsed();
+
+                    connectivitySettings.clearIntermediateData();
+                    timer.restart();
+
+                    connectivitySettings.setConnectivityMethods(sSpectralMethodList);
+                    connectivityObj.calculate(connectivitySettings);
+
+                    qint64 iTimeShared = timer.elapsed();
+
+                    qWarning() << "iteration" << u << "separate" << iTimeSeparate << "shared" << iTimeShared;
+
+                    printf("Iteration %d: %d frequency domain metrics for %d trials, %d channels, %d samples - separate %lld ms, shared %lld ms, speedup %.2f\n", u, sSpectralMethodList.size(), connectivitySettings.size(), lNumberChannels.at(k), lNumberSamples.at(j), iTimeSeparate, iTimeShared, iTimeShared > 0 ? double(iTimeSeparate)/double(iTimeShared) : 0.0);
+                }
             }
         }
     }
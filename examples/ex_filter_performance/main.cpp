@@ -0,0 +1,188 @@
+//=============================================================================================================
+/**
+ * @file     main.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Example of the filterFile throughput for different block sizes and queue depths.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+#include <rtprocessing/filter.h>
+#include <utils/generics/applicationlogger.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QBuffer>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+
+/**
+ * Forwards all but the info messages to the application logger. filterFile logs every block as info message.
+ */
+void customLogWriter(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    if(type != QtInfoMsg) {
+        ApplicationLogger::customLogWriter(type, context, msg);
+    }
+}
+
+//=============================================================================================================
+
+/**
+ * Filters the whole raw file into a memory buffer and prints the throughput in MB/s with respect to the written bytes.
+ */
+QByteArray runBenchmark(const QString& sName,
+                        FiffRawData::SPtr pRaw,
+                        const FilterKernel& filterKernel,
+                        const RowVectorXi& picks,
+                        bool bUseThreads,
+                        int iBlockSize,
+                        int iQueueDepth)
+{
+    QBuffer buffer;
+    QElapsedTimer timer;
+
+    timer.start();
+    bool bSuccess = RTPROCESSINGLIB::filterFile(buffer,
+                                                pRaw,
+                                                filterKernel,
+                                                picks,
+                                                bUseThreads,
+                                                iBlockSize,
+                                                iQueueDepth);
+    qint64 iElapsedMs = qMax(timer.elapsed(), qint64(1));
+
+    printf("%-24s | block %6d | queue %3d | %8lld ms | %8.2f MB/s%s\n",
+           sName.toUtf8().constData(),
+           iBlockSize,
+           iQueueDepth,
+           iElapsedMs,
+           buffer.data().size() / 1.0e6 / (iElapsedMs / 1000.0),
+           bSuccess ? "" : " | failed");
+
+    return buffer.data();
+}
+
+//=============================================================================================================
+
+/**
+ * The function main marks the entry point of the program.
+ * By default, main has the storage class extern.
+ *
+ * @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+ * @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+ * @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+ */
+int main(int argc, char *argv[])
+{
+    qInstallMessageHandler(customLogWriter);
+    QCoreApplication app(argc, argv);
+
+    // Command Line Parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Filter Performance Example");
+    parser.addHelpOption();
+
+    QCommandLineOption inputOption("fileIn", "The input file <in>.", "in", QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+    QCommandLineOption orderOption("order", "The filter order <order>.", "order", "1024");
+
+    parser.addOption(inputOption);
+    parser.addOption(orderOption);
+
+    parser.process(app);
+
+    QFile t_fileRaw(parser.value(inputOption));
+    int iOrder = parser.value(orderOption).toInt();
+
+    FiffRawData::SPtr pRaw = FiffRawData::SPtr::create(t_fileRaw);
+
+    if(pRaw->isEmpty()) {
+        qWarning("Could not read raw file.\n");
+        return -1;
+    }
+
+    // Only filter MEG channels
+    RowVectorXi picks = pRaw->info.pick_types(true, false, false);
+
+    double dSFreq = pRaw->info.sfreq;
+    FilterKernel filterKernel("filter_kernel",
+                              FilterKernel::BPF,
+                              iOrder,
+                              10.0/(dSFreq/2.0),
+                              10.0/(dSFreq/2.0),
+                              1.0/(dSFreq/2.0),
+                              dSFreq,
+                              FilterKernel::Cosine);
+
+    // Default block size, sequential and pipelined. The output has to be byte-identical.
+    QByteArray baReference = runBenchmark("single worker", pRaw, filterKernel, picks, false, -1, 1);
+    QByteArray baPipelined = runBenchmark("pipelined", pRaw, filterKernel, picks, true, -1, 4);
+    printf("Byte-identical output: %s\n", baReference == baPipelined ? "yes" : "no");
+
+    // Fixed block sizes and queue depths
+    QList<int> lBlockSizes = QList<int>() << 2 * iOrder << 8 * iOrder << 32 * iOrder;
+    QList<int> lQueueDepths = QList<int>() << 1 << 4 << 16;
+
+    for(int iBlockSize : lBlockSizes) {
+        baReference = runBenchmark("single worker", pRaw, filterKernel, picks, false, iBlockSize, 1);
+
+        for(int iQueueDepth : lQueueDepths) {
+            baPipelined = runBenchmark("pipelined", pRaw, filterKernel, picks, true, iBlockSize, iQueueDepth);
+
+            if(baReference != baPipelined) {
+                printf("Output differs for block size %d and queue depth %d\n", iBlockSize, iQueueDepth);
+            }
+        }
+    }
+
+    return 0;
+}
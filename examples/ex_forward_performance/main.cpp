@@ -0,0 +1,179 @@
+//=============================================================================================================
+/**
+ * @file     main.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Example of the forward solution computation time for an increasing number of threads.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/applicationlogger.h>
+
+#include <fiff/fiff.h>
+#include <fiff/c/fiff_coord_trans_old.h>
+#include <fiff/fiff_info.h>
+
+#include <fwd/computeFwd/compute_fwd_settings.h>
+#include <fwd/computeFwd/compute_fwd.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FWDLIB;
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+ * The function main marks the entry point of the program.
+ * By default, main has the storage class extern.
+ *
+ * @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+ * @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+ * @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+ */
+int main(int argc, char *argv[])
+{
+    qInstallMessageHandler(ApplicationLogger::customLogWriter);
+    QCoreApplication a(argc, argv);
+
+    // Command Line Parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Forward Solution Performance Example");
+    parser.addHelpOption();
+
+    QCommandLineOption maxThreadsOption("maxThreads", "The maximum number of threads to test <value>.", "value", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption repetitionsOption("repetitions", "The number of repetitions per thread count <value>.", "value", "1");
+    QCommandLineOption srcOption("src", "The source space <file>.", "file", QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif");
+
+    parser.addOption(maxThreadsOption);
+    parser.addOption(repetitionsOption);
+    parser.addOption(srcOption);
+
+    parser.process(a);
+
+    int iMaxThreads = qMax(1, parser.value(maxThreadsOption).toInt());
+    int iRepetitions = qMax(1, parser.value(repetitionsOption).toInt());
+
+    // Setup the forward computation on the sample BEM
+    ComputeFwdSettings::SPtr pSettings = ComputeFwdSettings::SPtr(new ComputeFwdSettings);
+
+    pSettings->include_meg = true;
+    pSettings->include_eeg = true;
+    pSettings->accurate = true;
+    pSettings->srcname = parser.value(srcOption);
+    pSettings->measname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif";
+    pSettings->mriname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/all-trans.fif";
+    pSettings->transname.clear();
+    pSettings->bemname = QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
+    pSettings->mindist = 5.0f/1000.0f;
+    pSettings->solname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/Result/sample_audvis-meg-eeg-oct-6-fwd.fif";
+
+    QFile t_fileIn(pSettings->measname);
+    FiffRawData raw(t_fileIn);
+    QSharedPointer<FiffInfo> pFiffInfo = QSharedPointer<FiffInfo>(new FiffInfo(raw.info));
+
+    FiffCoordTransOld meg_head_t = pFiffInfo->dev_head_t.toOld();
+
+    pSettings->meg_head_t = &meg_head_t;
+    pSettings->pFiffInfo = pFiffInfo;
+
+    pSettings->checkIntegrity();
+
+    // Compute the forward solution for an increasing number of threads
+    int iOriginalMaxThreads = QThreadPool::globalInstance()->maxThreadCount();
+    QElapsedTimer timer;
+    MatrixXd matRefSol;
+    double dSingleThreadTime = 0.0;
+
+    QList<int> lThreadCounts;
+    for(int iThreads = 1; iThreads < iMaxThreads; iThreads *= 2) {
+        lThreadCounts << iThreads;
+    }
+    lThreadCounts << iMaxThreads;
+
+    printf("Threads | Time [ms] | Speedup | Max. deviation\n");
+
+    for(int i = 0; i < lThreadCounts.size(); ++i) {
+        QThreadPool::globalInstance()->setMaxThreadCount(lThreadCounts.at(i));
+
+        double dTime = 0.0;
+        MatrixXd matSol;
+
+        for(int j = 0; j < iRepetitions; ++j) {
+            ComputeFwd computeFwd(pSettings);
+
+            timer.start();
+            computeFwd.calculateFwd();
+            dTime += timer.elapsed();
+
+            matSol = computeFwd.sol->data;
+        }
+
+        dTime /= iRepetitions;
+
+        if(i == 0) {
+            matRefSol = matSol;
+            dSingleThreadTime = dTime;
+        }
+
+        // The chunks write disjoint parts of the solution, so the result should not depend on the number of threads
+        double dMaxDeviation = (matSol.rows() == matRefSol.rows() && matSol.cols() == matRefSol.cols()) ? (matSol - matRefSol).cwiseAbs().maxCoeff() : -1.0;
+
+        printf("%7d | %9.0f | %7.2f | %g\n",
+               lThreadCounts.at(i),
+               dTime,
+               dTime > 0.0 ? dSingleThreadTime / dTime : 0.0,
+               dMaxDeviation);
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(iOriginalMaxThreads);
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+//=============================================================================================================
+/**
+ * @file     main.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Benchmark comparing FiffRawData::read_raw_segment with FiffRawSegmentReader
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+#include <utils/generics/applicationlogger.h>
+
+#include <random>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+
+/**
+ * Runs iNumReads random segment reads with the legacy and the indexed reader and prints timing and the maximum
+ * difference between both results.
+ */
+void runBenchmark(const QString& sName,
+                  const FiffRawData& raw,
+                  const RowVectorXi& picks,
+                  int iNumReads,
+                  int iSegmentLength)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(raw.first_samp, raw.last_samp - iSegmentLength + 1);
+
+    QVector<fiff_int_t> vecFrom;
+    for(int i = 0; i < iNumReads; ++i) {
+        vecFrom.append(distribution(generator));
+    }
+
+    MatrixXd matDataLegacy, matDataIndexed, matTimes;
+    QElapsedTimer timer;
+
+    //Legacy path
+    timer.start();
+    for(int i = 0; i < iNumReads; ++i) {
+        raw.read_raw_segment(matDataLegacy, matTimes, vecFrom[i], vecFrom[i] + iSegmentLength - 1, picks);
+    }
+    qint64 iLegacyNs = timer.nsecsElapsed();
+
+    //Indexed path
+    FiffRawSegmentReader reader(raw);
+    timer.restart();
+    for(int i = 0; i < iNumReads; ++i) {
+        reader.read_raw_segment(matDataIndexed, matTimes, vecFrom[i], vecFrom[i] + iSegmentLength - 1, picks);
+    }
+    qint64 iIndexedNs = timer.nsecsElapsed();
+
+    //Compare results
+    double dMaxDiff = 0.0;
+    for(int i = 0; i < qMin(iNumReads, 50); ++i) {
+        raw.read_raw_segment(matDataLegacy, matTimes, vecFrom[i], vecFrom[i] + iSegmentLength - 1, picks);
+        reader.read_raw_segment(matDataIndexed, matTimes, vecFrom[i], vecFrom[i] + iSegmentLength - 1, picks);
+        dMaxDiff = qMax(dMaxDiff, (matDataLegacy - matDataIndexed).cwiseAbs().maxCoeff());
+    }
+
+    printf("%-28s | %6d reads x %6d samples | legacy %9.3f ms/read | indexed %9.3f ms/read | speedup %6.2fx | max diff %g\n",
+           sName.toUtf8().constData(),
+           iNumReads,
+           iSegmentLength,
+           iLegacyNs / 1.0e6 / iNumReads,
+           iIndexedNs / 1.0e6 / iNumReads,
+           double(iLegacyNs) / double(qMax(iIndexedNs, qint64(1))),
+           dMaxDiff);
+}
+
+//=============================================================================================================
+
+/**
+ * The function main marks the entry point of the program.
+ * By default, main has the storage class extern.
+ *
+ * @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+ * @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+ * @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+ */
+int main(int argc, char *argv[])
+{
+    qInstallMessageHandler(ApplicationLogger::customLogWriter);
+    QCoreApplication app(argc, argv);
+
+    // Command Line Parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Read Raw Performance Example");
+    parser.addHelpOption();
+
+    QCommandLineOption inputOption("fileIn", "The input file <in>.", "in", QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+    QCommandLineOption readsOption("reads", "The number of random segment reads <reads>.", "reads", "500");
+
+    parser.addOption(inputOption);
+    parser.addOption(readsOption);
+
+    parser.process(app);
+
+    QFile t_fileRaw(parser.value(inputOption));
+    int iNumReads = parser.value(readsOption).toInt();
+
+    FiffRawData raw(t_fileRaw);
+
+    if(raw.isEmpty()) {
+        qWarning("Could not read raw file.\n");
+        return -1;
+    }
+
+    QStringList include;
+    include << "STI 014";
+    RowVectorXi picks = raw.info.pick_types(true, false, false, include, raw.info.bads);
+
+    printf("Calibration only\n");
+    runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 100);
+    runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 1000);
+    runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads / 10, 10000);
+    runBenchmark("MEG + STI 014", raw, picks, iNumReads, 100);
+    runBenchmark("MEG + STI 014", raw, picks, iNumReads, 1000);
+
+    //
+    //   Memory-map the file and benchmark again
+    //
+    if(raw.file->map()) {
+        printf("Calibration only, memory-mapped\n");
+        runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 100);
+        runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 1000);
+        runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads / 10, 10000);
+        runBenchmark("MEG + STI 014", raw, picks, iNumReads, 100);
+        runBenchmark("MEG + STI 014", raw, picks, iNumReads, 1000);
+    }
+
+    //
+    //   Activate the projection items and benchmark again
+    //
+    if(raw.info.projs.size() > 0) {
+        for(int k = 0; k < raw.info.projs.size(); ++k) {
+            raw.info.projs[k].active = true;
+        }
+
+        if(raw.info.make_projector(raw.proj) > 0) {
+            printf("SSP projector\n");
+            runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 100);
+            runBenchmark("all channels", raw, defaultRowVectorXi, iNumReads, 1000);
+            runBenchmark("MEG + STI 014", raw, picks, iNumReads, 100);
+            runBenchmark("MEG + STI 014", raw, picks, iNumReads, 1000);
+        }
+    }
+
+    return 0;
+}
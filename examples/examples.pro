@@ -49,11 +49,14 @@ TEMPLATE = subdirs
 SUBDIRS += \
     ex_averaging \
     ex_cancel_noise \
+    ex_circular_buffer_performance \
     ex_compute_forward \
     ex_coreg \
     ex_evoked_grad_amp \
     ex_fiff_io \
+    ex_filter_performance \
     ex_find_evoked \
+    ex_forward_performance \
     ex_inverse_mne \
     ex_make_inverse_operator \
     ex_make_layout \
@@ -62,6 +65,7 @@ SUBDIRS += \
     ex_read_evoked \
     ex_read_fwd \
     ex_read_raw \
+    ex_read_raw_performance \
     ex_read_write_raw \
 
     qtHaveModule(charts) {
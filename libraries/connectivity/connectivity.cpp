@@ -51,6 +51,7 @@
 #include "metrics/weightedphaselagindex.h"
 #include "metrics/unbiasedsquaredphaselagindex.h"
 #include "metrics/debiasedsquaredweightedphaselagindex.h"
+#include "metrics/abstractmetric.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -91,6 +92,16 @@ QList<Network> Connectivity::calculate(ConnectivitySettings& connectivitySetting
     QElapsedTimer timer;
     timer.start();
 
+    // Compute the tapered spectra and the spectral sums of all requested frequency domain metrics in a single pass.
+    // The metrics below only reduce these sums to their final networks.
+    int iSpectralSums = AbstractMetric::getSpectralSums(lMethods);
+
+    if(iSpectralSums != 0) {
+        AbstractMetric::computeSpectralSums(connectivitySettings,
+                                            iSpectralSums);
+        connectivitySettings.getIntermediateSumData().iPreparedSpectralSums = iSpectralSums;
+    }
+
     if(lMethods.contains("WPLI")) {
         results.append(WeightedPhaseLagIndex::calculate(connectivitySettings));
     }
@@ -127,6 +138,9 @@ QList<Network> Connectivity::calculate(ConnectivitySettings& connectivitySetting
         results.append(DebiasedSquaredWeightedPhaseLagIndex::calculate(connectivitySettings));
     }
 
+    // The sums are only guaranteed to match the current parameters during this call
+    connectivitySettings.getIntermediateSumData().iPreparedSpectralSums = 0;
+
     qWarning() << "Total" << timer.elapsed();
     qDebug() << "Connectivity::calculateMultiMethods - Calculated"<< lMethods <<"for" << connectivitySettings.size() << "trials in"<< timer.elapsed() << "msecs.";
 
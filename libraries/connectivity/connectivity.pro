@@ -74,6 +74,7 @@ CONFIG(debug, debug|release) {
 
 SOURCES += \
     metrics/abstractmetric.cpp \
+    metrics/crossspectraldensity.cpp \
     metrics/correlation.cpp \
     metrics/crosscorrelation.cpp \
     metrics/coherency.cpp \
@@ -85,6 +86,7 @@ SOURCES += \
     metrics/debiasedsquaredweightedphaselagindex.cpp \
     metrics/phaselagindex.cpp \
     network/network.cpp \
+    network/networkadjacency.cpp \
     network/networknode.cpp \
     network/networkedge.cpp \
     connectivitysettings.cpp \
@@ -93,6 +95,7 @@ SOURCES += \
 HEADERS += \
     connectivity_global.h \
     metrics/abstractmetric.h \
+    metrics/crossspectraldensity.h \
     metrics/correlation.h \
     metrics/crosscorrelation.h \
     metrics/coherency.h \
@@ -104,6 +107,7 @@ HEADERS += \
     metrics/debiasedsquaredweightedphaselagindex.h \
     metrics/phaselagindex.h \
     network/network.h \
+    network/networkadjacency.h \
     network/networknode.h \
     network/networkedge.h \
     connectivitysettings.h \
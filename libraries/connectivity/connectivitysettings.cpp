@@ -68,6 +68,20 @@ using namespace FSLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+namespace {
+
+template<typename T>
+void subtractFromSum(T& matSum,
+                     const T& matTrial)
+{
+    // Only trials which were stored in the same layout as the sum contribute to it
+    if(matTrial.size() != 0 && matSum.rows() == matTrial.rows() && matSum.cols() == matTrial.cols()) {
+        matSum -= matTrial;
+    }
+}
+
+} // anonymous namespace
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -96,20 +110,21 @@ void ConnectivitySettings::clearIntermediateData()
 {
     for (int i = 0; i < m_trialData.size(); ++i) {
         m_trialData[i].matPsd.resize(0,0);
-        m_trialData[i].vecPairCsd.clear();
+        m_trialData[i].matCsd.resize(0,0);
         m_trialData[i].vecTapSpectra.clear();
-        m_trialData[i].vecPairCsdNormalized.clear();
-        m_trialData[i].vecPairCsdImagSign.clear();
-        m_trialData[i].vecPairCsdImagAbs.clear();
-        m_trialData[i].vecPairCsdImagSqrd.clear();
+        m_trialData[i].matCsdNormalized.resize(0,0);
+        m_trialData[i].matCsdImagSign.resize(0,0);
+        m_trialData[i].matCsdImagAbs.resize(0,0);
+        m_trialData[i].matCsdImagSqrd.resize(0,0);
     }
 
     m_intermediateSumData.matPsdSum.resize(0,0);
-    m_intermediateSumData.vecPairCsdSum.clear();
-    m_intermediateSumData.vecPairCsdNormalizedSum.clear();
-    m_intermediateSumData.vecPairCsdImagSignSum.clear();
-    m_intermediateSumData.vecPairCsdImagAbsSum.clear();
-    m_intermediateSumData.vecPairCsdImagSqrdSum.clear();
+    m_intermediateSumData.matCsdSum.resize(0,0);
+    m_intermediateSumData.matCsdNormalizedSum.resize(0,0);
+    m_intermediateSumData.matCsdImagSignSum.resize(0,0);
+    m_intermediateSumData.matCsdImagAbsSum.resize(0,0);
+    m_intermediateSumData.matCsdImagSqrdSum.resize(0,0);
+    m_intermediateSumData.iPreparedSpectralSums = 0;
 }
 
 //*******************************************************************************************************
@@ -129,6 +144,7 @@ void ConnectivitySettings::append(const MatrixXd& matInputData)
     tempData.matData = matInputData;
 
     m_trialData.append(tempData);
+    m_intermediateSumData.iPreparedSpectralSums = 0;
 }
 
 //*******************************************************************************************************
@@ -136,6 +152,7 @@ void ConnectivitySettings::append(const MatrixXd& matInputData)
 void ConnectivitySettings::append(const ConnectivitySettings::IntermediateTrialData& inputData)
 {
     m_trialData.append(inputData);
+    m_intermediateSumData.iPreparedSpectralSums = 0;
 }
 
 //*******************************************************************************************************
@@ -179,32 +196,18 @@ void ConnectivitySettings::removeFirst(int iAmount)
 
     // Substract influence of trials from overall summed up intermediate data and remove from data list
     for (int j = 0; j < iAmount; ++j) {
-        for (int i = 0; i < m_trialData.first().matData.rows(); ++i) {
-            if(i < m_intermediateSumData.vecPairCsdSum.size() && (m_intermediateSumData.vecPairCsdSum.size() == m_trialData.first().vecPairCsd.size())) {
-                m_intermediateSumData.vecPairCsdSum[i].second -= m_trialData.first().vecPairCsd.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdNormalizedSum.size() && (m_intermediateSumData.vecPairCsdNormalizedSum.size() == m_trialData.first().vecPairCsdNormalized.size())) {
-                m_intermediateSumData.vecPairCsdNormalizedSum[i].second -= m_trialData.first().vecPairCsdNormalized.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagSignSum.size() && (m_intermediateSumData.vecPairCsdImagSignSum.size() == m_trialData.first().vecPairCsdImagSign.size())) {
-                m_intermediateSumData.vecPairCsdImagSignSum[i].second -= m_trialData.first().vecPairCsdImagSign.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagAbsSum.size() && (m_intermediateSumData.vecPairCsdImagAbsSum.size() == m_trialData.first().vecPairCsdImagAbs.size())) {
-                m_intermediateSumData.vecPairCsdImagAbsSum[i].second -= m_trialData.first().vecPairCsdImagAbs.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagSqrdSum.size() && (m_intermediateSumData.vecPairCsdImagSqrdSum.size() == m_trialData.first().vecPairCsdImagSqrd.size())) {
-                m_intermediateSumData.vecPairCsdImagSqrdSum[i].second -= m_trialData.first().vecPairCsdImagSqrd.at(i).second;
-            }
-        }
-
-        if(m_intermediateSumData.matPsdSum.rows() == m_trialData.first().matPsd.rows() &&
-           m_intermediateSumData.matPsdSum.cols() == m_trialData.first().matPsd.cols() ) {
-            m_intermediateSumData.matPsdSum -= m_trialData.first().matPsd;
-        }
+        subtractFromSum(m_intermediateSumData.matPsdSum, m_trialData.first().matPsd);
+        subtractFromSum(m_intermediateSumData.matCsdSum, m_trialData.first().matCsd);
+        subtractFromSum(m_intermediateSumData.matCsdNormalizedSum, m_trialData.first().matCsdNormalized);
+        subtractFromSum(m_intermediateSumData.matCsdImagSignSum, m_trialData.first().matCsdImagSign);
+        subtractFromSum(m_intermediateSumData.matCsdImagAbsSum, m_trialData.first().matCsdImagAbs);
+        subtractFromSum(m_intermediateSumData.matCsdImagSqrdSum, m_trialData.first().matCsdImagSqrd);
 
         m_trialData.removeFirst();
     }
 
+    m_intermediateSumData.iPreparedSpectralSums = 0;
+
 //    iTime = timer.elapsed();
 //    qDebug() << "ConnectivitySettings::removeFirst" << iTime;
 //    timer.restart();
@@ -230,32 +233,18 @@ void ConnectivitySettings::removeLast(int iAmount)
 
     // Substract influence of trials from overall summed up intermediate data and remove from data list
     for (int j = 0; j < iAmount; ++j) {
-        for (int i = 0; i < m_trialData.last().matData.rows(); ++i) {
-            if(i < m_intermediateSumData.vecPairCsdSum.size() && (m_intermediateSumData.vecPairCsdSum.size() == m_trialData.last().vecPairCsd.size())) {
-                m_intermediateSumData.vecPairCsdSum[i].second -= m_trialData.last().vecPairCsd.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdNormalizedSum.size() && (m_intermediateSumData.vecPairCsdNormalizedSum.size() == m_trialData.last().vecPairCsdNormalized.size())) {
-                m_intermediateSumData.vecPairCsdNormalizedSum[i].second -= m_trialData.last().vecPairCsdNormalized.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagSignSum.size() && (m_intermediateSumData.vecPairCsdImagSignSum.size() == m_trialData.last().vecPairCsdImagSign.size())) {
-                m_intermediateSumData.vecPairCsdImagSignSum[i].second -= m_trialData.last().vecPairCsdImagSign.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagAbsSum.size() && (m_intermediateSumData.vecPairCsdImagAbsSum.size() == m_trialData.last().vecPairCsdImagAbs.size())) {
-                m_intermediateSumData.vecPairCsdImagAbsSum[i].second -= m_trialData.last().vecPairCsdImagAbs.at(i).second;
-            }
-            if(i < m_intermediateSumData.vecPairCsdImagSqrdSum.size() && (m_intermediateSumData.vecPairCsdImagSqrdSum.size() == m_trialData.last().vecPairCsdImagSqrd.size())) {
-                m_intermediateSumData.vecPairCsdImagSqrdSum[i].second -= m_trialData.last().vecPairCsdImagSqrd.at(i).second;
-            }
-        }
-
-        if(m_intermediateSumData.matPsdSum.rows() == m_trialData.last().matPsd.rows() &&
-           m_intermediateSumData.matPsdSum.cols() == m_trialData.last().matPsd.cols() ) {
-            m_intermediateSumData.matPsdSum -= m_trialData.last().matPsd;
-        }
+        subtractFromSum(m_intermediateSumData.matPsdSum, m_trialData.last().matPsd);
+        subtractFromSum(m_intermediateSumData.matCsdSum, m_trialData.last().matCsd);
+        subtractFromSum(m_intermediateSumData.matCsdNormalizedSum, m_trialData.last().matCsdNormalized);
+        subtractFromSum(m_intermediateSumData.matCsdImagSignSum, m_trialData.last().matCsdImagSign);
+        subtractFromSum(m_intermediateSumData.matCsdImagAbsSum, m_trialData.last().matCsdImagAbs);
+        subtractFromSum(m_intermediateSumData.matCsdImagSqrdSum, m_trialData.last().matCsdImagSqrd);
 
         m_trialData.removeLast();
     }
 
+    m_intermediateSumData.iPreparedSpectralSums = 0;
+
 //    iTime = timer.elapsed();
 //    qDebug() << "ConnectivitySettings::removeLast" << iTime;
 //    timer.restart();
@@ -99,20 +99,21 @@ public:
         Eigen::MatrixXd     matData;
         Eigen::MatrixXd     matPsd;
         QVector<Eigen::MatrixXcd>               vecTapSpectra;
-        QVector<QPair<int,Eigen::MatrixXcd> >   vecPairCsd;
-        QVector<QPair<int,Eigen::MatrixXcd> >   vecPairCsdNormalized;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSign;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagAbs;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSqrd;
+        Eigen::MatrixXcd    matCsd;                 /**< The CSDs in the packed upper-triangular layout of CrossSpectralDensity (bins x pairs). */
+        Eigen::MatrixXcd    matCsdNormalized;       /**< The packed normalized CSDs (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagSign;         /**< The packed signs of the imaginary CSD parts (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagAbs;          /**< The packed absolute imaginary CSD parts (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagSqrd;         /**< The packed squared imaginary CSD parts (bins x pairs). */
     };
 
     struct IntermediateSumData {
         Eigen::MatrixXd     matPsdSum;
-        QVector<QPair<int,Eigen::MatrixXcd> >   vecPairCsdSum;
-        QVector<QPair<int,Eigen::MatrixXcd> >   vecPairCsdNormalizedSum;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSignSum;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagAbsSum;
-        QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSqrdSum;
+        Eigen::MatrixXcd    matCsdSum;              /**< Sum of the packed CSDs (bins x pairs). */
+        Eigen::MatrixXcd    matCsdNormalizedSum;    /**< Sum of the packed normalized CSDs (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagSignSum;      /**< Sum of the packed signs of the imaginary CSD parts (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagAbsSum;       /**< Sum of the packed absolute imaginary CSD parts (bins x pairs). */
+        Eigen::MatrixXd     matCsdImagSqrdSum;      /**< Sum of the packed squared imaginary CSD parts (bins x pairs). */
+        int                                     iPreparedSpectralSums = 0;  /**< The spectral sums (AbstractMetric::SpectralSum flags) which are up to date for all current trials. */
     };
 
     //=========================================================================================================
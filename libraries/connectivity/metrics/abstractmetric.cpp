@@ -37,20 +37,31 @@
 //=============================================================================================================
 
 #include "abstractmetric.h"
+#include "crossspectraldensity.h"
+
+#include <utils/spectral.h>
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QDebug>
+#include <QtConcurrent>
+#include <QThread>
+
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
 
+#include <unsupported/Eigen/FFT>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+using namespace UTILSLIB;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
@@ -60,6 +71,61 @@ bool AbstractMetric::m_bStorageModeIsActive = false;
 int AbstractMetric::m_iNumberBinStart = -1;
 int AbstractMetric::m_iNumberBinAmount = -1;
 
+namespace {
+
+template<typename T>
+void addToSum(T& matSum,
+              const T& matTrial)
+{
+    if(matTrial.size() == 0) {
+        return;
+    }
+
+    if(matSum.size() == 0) {
+        matSum = matTrial;
+    } else {
+        matSum += matTrial;
+    }
+}
+
+//=============================================================================================================
+
+template<typename T>
+void initSum(T& matSum,
+             int iNBins,
+             int iNPairs)
+{
+    if(matSum.rows() != iNBins || matSum.cols() != iNPairs) {
+        matSum.setZero(iNBins, iNPairs);
+    }
+}
+
+//=============================================================================================================
+
+QVector<QPair<int,int> > splitRows(int iNRows,
+                                   int iNChunks)
+{
+    // Row i holds iNRows - i pairs. Cut the rows so each chunk holds roughly the same number of pairs.
+    QVector<QPair<int,int> > vecRowRanges;
+    int iNPairsPerChunk = std::max(1, CrossSpectralDensity::getNumberOfPairs(iNRows) / std::max(1, iNChunks));
+    int iRowStart = 0;
+    int iNPairs = 0;
+
+    for(int i = 0; i < iNRows; ++i) {
+        iNPairs += iNRows - i;
+
+        if(iNPairs >= iNPairsPerChunk || i == iNRows - 1) {
+            vecRowRanges.append(QPair<int,int>(iRowStart, i + 1));
+            iRowStart = i + 1;
+            iNPairs = 0;
+        }
+    }
+
+    return vecRowRanges;
+}
+
+} // anonymous namespace
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -68,3 +134,386 @@ AbstractMetric::AbstractMetric()
 {
 }
 
+//=============================================================================================================
+
+int AbstractMetric::getSpectralSums(const QStringList& lMethods)
+{
+    int iSpectralSums = 0;
+
+    if(lMethods.contains("COH") || lMethods.contains("IMAGCOH")) {
+        iSpectralSums |= PsdSum | CsdSum;
+    }
+
+    if(lMethods.contains("PLV")) {
+        iSpectralSums |= CsdSum | CsdNormalizedSum;
+    }
+
+    if(lMethods.contains("PLI") || lMethods.contains("USPLI")) {
+        iSpectralSums |= CsdSum | CsdImagSignSum;
+    }
+
+    if(lMethods.contains("WPLI")) {
+        iSpectralSums |= CsdSum | CsdImagAbsSum;
+    }
+
+    if(lMethods.contains("DSWPLI")) {
+        iSpectralSums |= CsdSum | CsdImagAbsSum | CsdImagSqrdSum;
+    }
+
+    return iSpectralSums;
+}
+
+//=============================================================================================================
+
+void AbstractMetric::computeSpectralSums(ConnectivitySettings &connectivitySettings,
+                                         int iSpectralSums)
+{
+    if(connectivitySettings.isEmpty()) {
+        qWarning() << "AbstractMetric::computeSpectralSums - Input data is empty";
+        return;
+    }
+
+    ConnectivitySettings::IntermediateSumData& sumData = connectivitySettings.getIntermediateSumData();
+
+    // Nothing to do if the sums were already prepared for the current trials
+    if((sumData.iPreparedSpectralSums & iSpectralSums) == iSpectralSums) {
+        return;
+    }
+
+    if(AbstractMetric::m_bStorageModeIsActive == false) {
+        connectivitySettings.clearIntermediateData();
+    }
+
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    int iNRows = connectivitySettings.at(0).matData.rows();
+    int iSignalLength = connectivitySettings.at(0).matData.cols();
+    int iNfft = connectivitySettings.getFFTSize();
+
+    // Generate tapers
+    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, connectivitySettings.getWindowType());
+
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    // Check if start and bin amount need to be reset to full spectrum
+    if(m_iNumberBinStart == -1 ||
+       m_iNumberBinAmount == -1 ||
+       m_iNumberBinStart > iNFreqs ||
+       m_iNumberBinAmount > iNFreqs ||
+       m_iNumberBinAmount + m_iNumberBinStart > iNFreqs) {
+        qDebug() << "AbstractMetric::computeSpectralSums - Resetting to full spectrum";
+        AbstractMetric::m_iNumberBinStart = 0;
+        AbstractMetric::m_iNumberBinAmount = iNFreqs;
+    }
+
+    bool bHalveFirstBin = m_iNumberBinStart == 0;
+    bool bHalveLastBin = iNfft % 2 == 0 && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs;
+    double dDenomCsd = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
+
+    int iNPairs = CrossSpectralDensity::getNumberOfPairs(iNRows);
+    int iNThreads = std::max(1, QThread::idealThreadCount());
+
+    // More pair ranges than threads, so the ranges balance well and only a fraction of a full CSD matrix is
+    // held as temporary data at any time
+    QVector<QPair<int,int> > vecRowRanges = splitRows(iNRows, 4 * iNThreads);
+
+    QList<ConnectivitySettings::IntermediateTrialData>& lTrialData = connectivitySettings.getTrialData();
+    QVector<TrialSpectra> vecBatch;
+    TrialSpectra* pTrialSpectra = Q_NULLPTR;
+
+    std::function<void(TrialSpectra&)> prepareLambda = [&](TrialSpectra& trialSpectra) {
+        prepareTrial(trialSpectra,
+                     iSpectralSums,
+                     iNRows,
+                     iNFreqs,
+                     iNfft,
+                     tapers);
+    };
+
+    std::function<void(QPair<int,int>&)> accumulateLambda = [&](QPair<int,int>& rowRange) {
+        accumulatePairs(*pTrialSpectra,
+                        sumData,
+                        rowRange.first,
+                        rowRange.second,
+                        iNRows,
+                        dDenomCsd,
+                        bHalveFirstBin,
+                        bHalveLastBin);
+    };
+
+    // Process the trials in batches of one trial per thread. Only the spectra of a batch are held at once.
+    for(int iBatchStart = 0; iBatchStart < lTrialData.size(); iBatchStart += iNThreads) {
+        int iBatchSize = std::min(iNThreads, lTrialData.size() - iBatchStart);
+
+        vecBatch.resize(iBatchSize);
+
+        for(int i = 0; i < iBatchSize; ++i) {
+            vecBatch[i] = TrialSpectra();
+            vecBatch[i].pTrial = &lTrialData[iBatchStart + i];
+        }
+
+        QFuture<void> resultPrepare = QtConcurrent::map(vecBatch,
+                                                        prepareLambda);
+        resultPrepare.waitForFinished();
+
+        // Reduce in the order of the trials, so the result does not depend on the thread scheduling
+        for(int i = 0; i < vecBatch.size(); ++i) {
+            pTrialSpectra = &vecBatch[i];
+
+            if(pTrialSpectra->bPsd) {
+                addToSum(sumData.matPsdSum, pTrialSpectra->pTrial->matPsd);
+            }
+
+            if(pTrialSpectra->bCsd) {
+                initSum(sumData.matCsdSum, m_iNumberBinAmount, iNPairs);
+            }
+            if(pTrialSpectra->bNormalized) {
+                initSum(sumData.matCsdNormalizedSum, m_iNumberBinAmount, iNPairs);
+            }
+            if(pTrialSpectra->bImagSign) {
+                initSum(sumData.matCsdImagSignSum, m_iNumberBinAmount, iNPairs);
+            }
+            if(pTrialSpectra->bImagAbs) {
+                initSum(sumData.matCsdImagAbsSum, m_iNumberBinAmount, iNPairs);
+            }
+            if(pTrialSpectra->bImagSqrd) {
+                initSum(sumData.matCsdImagSqrdSum, m_iNumberBinAmount, iNPairs);
+            }
+
+            if(pTrialSpectra->bCsd || pTrialSpectra->bNormalized || pTrialSpectra->bImagSign ||
+               pTrialSpectra->bImagAbs || pTrialSpectra->bImagSqrd) {
+                QFuture<void> resultAccumulate = QtConcurrent::map(vecRowRanges,
+                                                                   accumulateLambda);
+                resultAccumulate.waitForFinished();
+            }
+
+            pTrialSpectra->matSpectra.resize(0,0);
+
+            if(!m_bStorageModeIsActive) {
+                //Do not store data to save memory
+                pTrialSpectra->pTrial->matPsd.resize(0,0);
+            }
+        }
+    }
+}
+
+//=============================================================================================================
+
+void AbstractMetric::computeTaperedSpectra(ConnectivitySettings::IntermediateTrialData& inputData,
+                                           int iNRows,
+                                           int iNFreqs,
+                                           int iNfft,
+                                           const QPair<MatrixXd, VectorXd>& tapers)
+{
+    if(inputData.vecTapSpectra.size() == iNRows) {
+        return;
+    }
+
+    inputData.vecTapSpectra.clear();
+    inputData.vecTapSpectra.reserve(iNRows);
+
+    // One FFT object per thread, so the plans are set up once and reused for all rows, tapers and trials
+    static thread_local FFT<double> fft;
+    fft.SetFlag(fft.HalfSpectrum);
+
+    RowVectorXd vecInputFFT, rowData;
+    RowVectorXcd vecTmpFreq;
+
+    MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
+
+    int i,j;
+
+    for (i = 0; i < iNRows; ++i) {
+        // Substract mean
+        rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
+
+        // The zero padding in Eigen's FFT is only working for column vectors. Pad once per row.
+        if (rowData.cols() < iNfft) {
+            vecInputFFT.setZero(iNfft);
+        }
+
+        for(j = 0; j < tapers.first.rows(); j++) {
+            if (rowData.cols() < iNfft) {
+                vecInputFFT.head(rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));
+            } else {
+                vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
+            }
+
+            // FFT for freq domain returning the half spectrum and multiply taper weights
+            fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
+            matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
+        }
+
+        inputData.vecTapSpectra.append(matTapSpectrum);
+    }
+}
+
+//=============================================================================================================
+
+void AbstractMetric::prepareTrial(TrialSpectra& trialSpectra,
+                                  int iSpectralSums,
+                                  int iNRows,
+                                  int iNFreqs,
+                                  int iNfft,
+                                  const QPair<MatrixXd, VectorXd>& tapers)
+{
+    ConnectivitySettings::IntermediateTrialData& inputData = *trialSpectra.pTrial;
+    int iNPairs = CrossSpectralDensity::getNumberOfPairs(iNRows);
+
+    // Only compute what is not available for this trial already
+    trialSpectra.bPsd = (iSpectralSums & PsdSum) && inputData.matPsd.rows() != iNRows;
+    trialSpectra.bNormalized = (iSpectralSums & CsdNormalizedSum) && inputData.matCsdNormalized.cols() != iNPairs;
+    trialSpectra.bImagSign = (iSpectralSums & CsdImagSignSum) && inputData.matCsdImagSign.cols() != iNPairs;
+    trialSpectra.bImagAbs = (iSpectralSums & CsdImagAbsSum) && inputData.matCsdImagAbs.cols() != iNPairs;
+    trialSpectra.bImagSqrd = (iSpectralSums & CsdImagSqrdSum) && inputData.matCsdImagSqrd.cols() != iNPairs;
+    bool bDerived = trialSpectra.bNormalized || trialSpectra.bImagSign || trialSpectra.bImagAbs || trialSpectra.bImagSqrd;
+    trialSpectra.bCsd = inputData.matCsd.cols() != iNPairs && ((iSpectralSums & CsdSum) || bDerived);
+
+    if(trialSpectra.bPsd || trialSpectra.bCsd) {
+        computeTaperedSpectra(inputData,
+                              iNRows,
+                              iNFreqs,
+                              iNfft,
+                              tapers);
+    }
+
+    // Compute PSD (average over tapers if necessary)
+    if(trialSpectra.bPsd) {
+        double denomPSD = tapers.second.cwiseAbs2().sum() / 2.0;
+
+        inputData.matPsd = MatrixXd(iNRows, m_iNumberBinAmount);
+
+        for (int i = 0; i < iNRows; ++i) {
+            inputData.matPsd.row(i) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseAbs2().colwise().sum() / denomPSD;
+        }
+
+        // Divide first and last element by 2 due to half spectrum
+        if(m_iNumberBinStart == 0) {
+            inputData.matPsd.col(0) /= 2.0;
+        }
+
+        if(iNfft % 2 == 0 && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
+            inputData.matPsd.rightCols(1) /= 2.0;
+        }
+    }
+
+    if(trialSpectra.bCsd) {
+        CrossSpectralDensity::packSpectra(inputData.vecTapSpectra,
+                                          m_iNumberBinStart,
+                                          m_iNumberBinAmount,
+                                          trialSpectra.matSpectra);
+    }
+
+    if(m_bStorageModeIsActive) {
+        // Keep the trial's contribution, so it can be subtracted again when the trial is removed. The pair ranges
+        // are written in parallel, so the memory is allocated here.
+        if(trialSpectra.bCsd) {
+            inputData.matCsd.resize(m_iNumberBinAmount, iNPairs);
+        }
+        if(trialSpectra.bNormalized) {
+            inputData.matCsdNormalized.resize(m_iNumberBinAmount, iNPairs);
+        }
+        if(trialSpectra.bImagSign) {
+            inputData.matCsdImagSign.resize(m_iNumberBinAmount, iNPairs);
+        }
+        if(trialSpectra.bImagAbs) {
+            inputData.matCsdImagAbs.resize(m_iNumberBinAmount, iNPairs);
+        }
+        if(trialSpectra.bImagSqrd) {
+            inputData.matCsdImagSqrd.resize(m_iNumberBinAmount, iNPairs);
+        }
+    } else {
+        //Do not store data to save memory
+        inputData.vecTapSpectra.clear();
+        inputData.matCsd.resize(0,0);
+        inputData.matCsdNormalized.resize(0,0);
+        inputData.matCsdImagSign.resize(0,0);
+        inputData.matCsdImagAbs.resize(0,0);
+        inputData.matCsdImagSqrd.resize(0,0);
+    }
+}
+
+//=============================================================================================================
+
+void AbstractMetric::accumulatePairs(TrialSpectra& trialSpectra,
+                                     ConnectivitySettings::IntermediateSumData& sumData,
+                                     int iRowStart,
+                                     int iRowEnd,
+                                     int iNRows,
+                                     double dDenomCsd,
+                                     bool bHalveFirstBin,
+                                     bool bHalveLastBin)
+{
+    ConnectivitySettings::IntermediateTrialData& inputData = *trialSpectra.pTrial;
+
+    int iPairStart = CrossSpectralDensity::getPairIndex(iRowStart, iRowStart, iNRows);
+    int iNPairs = CrossSpectralDensity::getPairIndex(iRowEnd - 1, iNRows - 1, iNRows) + 1 - iPairStart;
+
+    // Compute the CSDs of the pairs, or take the ones stored for this trial
+    MatrixXcd matCsd;
+
+    if(trialSpectra.bCsd) {
+        CrossSpectralDensity::computeRows(trialSpectra.matSpectra,
+                                          iNRows,
+                                          iRowStart,
+                                          iRowEnd,
+                                          dDenomCsd,
+                                          matCsd);
+
+        // Divide first and last element by 2 due to half spectrum
+        if(bHalveFirstBin) {
+            matCsd.row(0) /= 2.0;
+        }
+
+        if(bHalveLastBin) {
+            matCsd.bottomRows(1) /= 2.0;
+        }
+
+        sumData.matCsdSum.middleCols(iPairStart, iNPairs) += matCsd;
+
+        if(m_bStorageModeIsActive) {
+            inputData.matCsd.middleCols(iPairStart, iNPairs) = matCsd;
+        }
+    } else {
+        matCsd = inputData.matCsd.middleCols(iPairStart, iNPairs);
+    }
+
+    // Compute the derived values for all pairs and bins at once
+    if(trialSpectra.bNormalized) {
+        MatrixXcd matCsdNormalized = matCsd.cwiseQuotient(matCsd.cwiseAbs());
+        sumData.matCsdNormalizedSum.middleCols(iPairStart, iNPairs) += matCsdNormalized;
+
+        if(m_bStorageModeIsActive) {
+            inputData.matCsdNormalized.middleCols(iPairStart, iNPairs) = matCsdNormalized;
+        }
+    }
+
+    if(trialSpectra.bImagSign) {
+        MatrixXd matCsdImagSign = matCsd.imag().cwiseSign();
+        sumData.matCsdImagSignSum.middleCols(iPairStart, iNPairs) += matCsdImagSign;
+
+        if(m_bStorageModeIsActive) {
+            inputData.matCsdImagSign.middleCols(iPairStart, iNPairs) = matCsdImagSign;
+        }
+    }
+
+    if(trialSpectra.bImagAbs) {
+        MatrixXd matCsdImagAbs = matCsd.imag().cwiseAbs();
+        sumData.matCsdImagAbsSum.middleCols(iPairStart, iNPairs) += matCsdImagAbs;
+
+        if(m_bStorageModeIsActive) {
+            inputData.matCsdImagAbs.middleCols(iPairStart, iNPairs) = matCsdImagAbs;
+        }
+    }
+
+    if(trialSpectra.bImagSqrd) {
+        MatrixXd matCsdImagSqrd = matCsd.imag().array().square();
+        sumData.matCsdImagSqrdSum.middleCols(iPairStart, iNPairs) += matCsdImagSqrd;
+
+        if(m_bStorageModeIsActive) {
+            inputData.matCsdImagSqrd.middleCols(iPairStart, iNPairs) = matCsdImagSqrd;
+        }
+    }
+}
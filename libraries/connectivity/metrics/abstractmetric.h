@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include "../connectivity_global.h"
+#include "../connectivitysettings.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -47,6 +48,8 @@
 
 #include <QSharedPointer>
 #include <QVector>
+#include <QPair>
+#include <QMutex>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -87,11 +90,119 @@ public:
      */
     explicit AbstractMetric();
 
+    /**
+     * The spectral sums which are accumulated over all trials. The metrics are computed from these sums.
+     */
+    enum SpectralSum {
+        PsdSum              = 0x01,     /**< Sum of the PSDs (matPsdSum). */
+        CsdSum              = 0x02,     /**< Sum of the CSDs (matCsdSum). */
+        CsdNormalizedSum    = 0x04,     /**< Sum of the normalized CSDs (matCsdNormalizedSum). */
+        CsdImagSignSum      = 0x08,     /**< Sum of the signs of the imaginary CSD parts (matCsdImagSignSum). */
+        CsdImagAbsSum       = 0x10,     /**< Sum of the absolute imaginary CSD parts (matCsdImagAbsSum). */
+        CsdImagSqrdSum      = 0x20      /**< Sum of the squared imaginary CSD parts (matCsdImagSqrdSum). */
+    };
+
+    //=========================================================================================================
+    /**
+     * Returns the spectral sums needed to compute the given connectivity methods.
+     *
+     * @param[in] lMethods   The connectivity methods, e.g. "COH" or "WPLI".
+     *
+     * @return The needed sums as a combination of SpectralSum flags.
+     */
+    static int getSpectralSums(const QStringList& lMethods);
+
+    //=========================================================================================================
+    /**
+     * Spectral front-end shared by all frequency domain metrics. Computes the tapered spectra once per trial and
+     * accumulates all requested sums in the packed layout of CrossSpectralDensity. The spectra of one trial per
+     * thread are computed in parallel. The CSDs of each trial are then computed in parallel over disjoint channel
+     * pair ranges, which are added directly to the matching columns of the single packed sums. Sums which were
+     * already prepared for the current trials (see IntermediateSumData::iPreparedSpectralSums) are not recomputed.
+     *
+     * @param[in, out] connectivitySettings  The input data and parameters. The sums are stored in its intermediate sum data.
+     * @param[in] iSpectralSums              The sums to compute as a combination of SpectralSum flags.
+     */
+    static void computeSpectralSums(ConnectivitySettings &connectivitySettings,
+                                    int iSpectralSums);
+
     static bool     m_bStorageModeIsActive;
     static int      m_iNumberBinStart;
     static int      m_iNumberBinAmount;
 
 protected:
+    //=========================================================================================================
+    /**
+     * Computes the tapered spectra for all rows of a trial if not available already. The FFT object is kept per
+     * thread, so its plans are reused across rows, tapers and trials.
+     *
+     * @param[in, out] inputData     The trial data. The spectra are stored in vecTapSpectra.
+     * @param[in] iNRows             The number of rows.
+     * @param[in] iNFreqs            The number of frequenciy bins.
+     * @param[in] iNfft              The FFT length.
+     * @param[in] tapers             The taper information.
+     */
+    static void computeTaperedSpectra(ConnectivitySettings::IntermediateTrialData& inputData,
+                                      int iNRows,
+                                      int iNFreqs,
+                                      int iNfft,
+                                      const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
+    /**
+     * The packed spectra of one trial and the sums which still have to be computed for it.
+     */
+    struct TrialSpectra {
+        ConnectivitySettings::IntermediateTrialData* pTrial = Q_NULLPTR;    /**< The trial. */
+        Eigen::MatrixXcd matSpectra;        /**< The packed spectra (bins x channels*tapers). Only set if bCsd is true. */
+        bool bPsd = false;                  /**< Whether the PSD was computed for this trial. */
+        bool bCsd = false;                  /**< Whether the CSDs need to be computed for this trial. */
+        bool bNormalized = false;           /**< Whether the normalized CSDs need to be computed for this trial. */
+        bool bImagSign = false;             /**< Whether the signs of the imaginary CSD parts need to be computed for this trial. */
+        bool bImagAbs = false;              /**< Whether the absolute imaginary CSD parts need to be computed for this trial. */
+        bool bImagSqrd = false;             /**< Whether the squared imaginary CSD parts need to be computed for this trial. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Decides which sums still need to be computed for a trial, computes its PSD and packs its spectra. The trials
+     * of a batch are prepared in parallel.
+     *
+     * @param[in, out] trialSpectra  The trial and its packed spectra.
+     * @param[in] iSpectralSums      The sums to compute as a combination of SpectralSum flags.
+     * @param[in] iNRows             The number of rows.
+     * @param[in] iNFreqs            The number of frequenciy bins.
+     * @param[in] iNfft              The FFT length.
+     * @param[in] tapers             The taper information.
+     */
+    static void prepareTrial(TrialSpectra& trialSpectra,
+                             int iSpectralSums,
+                             int iNRows,
+                             int iNFreqs,
+                             int iNfft,
+                             const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
+    //=========================================================================================================
+    /**
+     * Computes the CSD related values of one trial for the pairs of the rows iRowStart <= i < iRowEnd and adds them
+     * to the matching columns of the packed sums. Disjoint row ranges are processed in parallel.
+     *
+     * @param[in, out] trialSpectra  The trial and its packed spectra.
+     * @param[in, out] sumData       The sums. Must be allocated for all pairs.
+     * @param[in] iRowStart          The first row.
+     * @param[in] iRowEnd            The row after the last row.
+     * @param[in] iNRows             The number of rows.
+     * @param[in] dDenomCsd          The normalization of the taper weights.
+     * @param[in] bHalveFirstBin     Whether the first bin is halved due to the half spectrum.
+     * @param[in] bHalveLastBin      Whether the last bin is halved due to the half spectrum.
+     */
+    static void accumulatePairs(TrialSpectra& trialSpectra,
+                                ConnectivitySettings::IntermediateSumData& sumData,
+                                int iRowStart,
+                                int iRowEnd,
+                                int iNRows,
+                                double dDenomCsd,
+                                bool bHalveFirstBin,
+                                bool bHalveLastBin);
 };
 
 //=============================================================================================================
@@ -76,6 +76,7 @@ namespace CONNECTIVITYLIB {
 //=============================================================================================================
 
 class Network;
+class NetworkAdjacency;
 
 //=============================================================================================================
 /**
@@ -119,37 +120,18 @@ public:
 private:
     //=========================================================================================================
     /**
-     * Computes the coherency values. This function gets called in parallel.
+     * Computes the coherency of all pairs from the packed CSD sums and the PSD sums and appends its absolute value
+     * or imaginary part as edges.
      *
-     * @param[in]    inputData           The input data.
-     * @param[out]   matPsdSum           The sum of all PSD matrices for each trial.
-     * @param[out]   vecPairCsdSum       The sum of all CSD matrices for each trial.
-     * @param[in]    mutex               The mutex used to safely access matPsdSum and vecPairCsdSum.
-     * @param[in]    iNRows              The number of rows.
-     * @param[in]    iNFreqs             The number of frequenciy bins.
-     * @param[in]    iNfft               The FFT length.
-     * @param[in]    tapers              The taper information.
+     * @param[in, out] adjacency     The adjacency the edges are appended to.
+     * @param[in] matCsdSum          The packed CSD sums (bins x pairs).
+     * @param[in] matPsdSum          The PSD sums (rows x bins).
      */
-    static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
-                        Eigen::MatrixXd& matPsdSum,
-                        QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
-                        QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
-                        int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
-
-    //=========================================================================================================
-    /**
-     * Computes the PSD and CSD. This function gets called in parallel.
-     */
-    static void computePSDCSDAbs(QMutex& mutex,
-                                 Network& finalNetwork,
-                                 const QPair<int,Eigen::MatrixXcd>& pairInput,
+    static void computePSDCSDAbs(NetworkAdjacency& adjacency,
+                                 const Eigen::MatrixXcd& matCsdSum,
                                  const Eigen::MatrixXd& matPsdSum);
-    static void computePSDCSDImag(QMutex& mutex,
-                                  Network& finalNetwork,
-                                  const QPair<int,Eigen::MatrixXcd>& pairInput,
+    static void computePSDCSDImag(NetworkAdjacency& adjacency,
+                                  const Eigen::MatrixXcd& matCsdSum,
                                   const Eigen::MatrixXd& matPsdSum);
 };
 
@@ -40,6 +40,7 @@
 #include "network/networknode.h"
 #include "network/networkedge.h"
 #include "network/network.h"
+#include "network/networkadjacency.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -135,22 +136,22 @@ Network Correlation::calculate(ConnectivitySettings& connectivitySettings)
 //    timer.restart();
 
     //Add edges to network
-    MatrixXd matWeight(1,1);
-    QSharedPointer<NetworkEdge> pEdge;
+    NetworkAdjacency adjacency(finalNetwork.getNumberNodes(), 1);
+    adjacency.reserve(matDist.rows() * (matDist.rows() - 1) / 2);
+
+    VectorXd vecWeight(1);
     int j;
 
     for(int i = 0; i < matDist.rows(); ++i) {
-        for(j = i; j < matDist.cols(); ++j) {
-            matWeight << matDist(i,j);
-
-            pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
+        for(j = i + 1; j < matDist.cols(); ++j) {
+            vecWeight(0) = matDist(i,j);
+            adjacency.appendEdge(i, j, vecWeight);
         }
     }
 
+    adjacency.finalize();
+    finalNetwork.setAdjacency(adjacency);
+
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
 //    timer.restart();
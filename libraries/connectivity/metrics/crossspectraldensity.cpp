@@ -0,0 +1,143 @@
+//=============================================================================================================
+/**
+ * @file     crossspectraldensity.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    CrossSpectralDensity class definition.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "crossspectraldensity.h"
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+namespace {
+    const int CSD_TILE_SIZE = 32;     /**< The number of channels per tile. */
+}
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void CrossSpectralDensity::packSpectra(const QVector<MatrixXcd>& vecTapSpectra,
+                                       int iBinStart,
+                                       int iBinAmount,
+                                       MatrixXcd& matSpectra)
+{
+    if(vecTapSpectra.isEmpty()) {
+        matSpectra.resize(0,0);
+        return;
+    }
+
+    int iNTapers = vecTapSpectra.first().rows();
+
+    matSpectra.resize(iBinAmount, vecTapSpectra.size() * iNTapers);
+
+    for(int i = 0; i < vecTapSpectra.size(); ++i) {
+        matSpectra.middleCols(i * iNTapers, iNTapers) = vecTapSpectra.at(i).middleCols(iBinStart, iBinAmount).transpose();
+    }
+}
+
+//=============================================================================================================
+
+void CrossSpectralDensity::compute(const MatrixXcd& matSpectra,
+                                   int iNRows,
+                                   double dDenom,
+                                   MatrixXcd& matCsd)
+{
+    computeRows(matSpectra,
+                iNRows,
+                0,
+                iNRows,
+                dDenom,
+                matCsd);
+}
+
+//=============================================================================================================
+
+void CrossSpectralDensity::computeRows(const MatrixXcd& matSpectra,
+                                       int iNRows,
+                                       int iRowStart,
+                                       int iRowEnd,
+                                       double dDenom,
+                                       MatrixXcd& matCsd)
+{
+    iRowStart = std::max(iRowStart, 0);
+    iRowEnd = std::min(iRowEnd, iNRows);
+
+    if(iRowStart >= iRowEnd) {
+        matCsd.resize(0,0);
+        return;
+    }
+
+    int iNTapers = matSpectra.cols() / iNRows;
+    int iNBins = matSpectra.rows();
+    int iPairOffset = getPairIndex(iRowStart, iRowStart, iNRows);
+
+    matCsd.resize(iNBins, getPairIndex(iRowEnd - 1, iNRows - 1, iNRows) + 1 - iPairOffset);
+
+    int i, j, k, iPair;
+
+    // Walk over tiles of channels, so the spectra of both tiles stay in cache while all their pairs are computed
+    for(int iTileStart = iRowStart; iTileStart < iRowEnd; iTileStart += CSD_TILE_SIZE) {
+        int iTileEnd = std::min(iTileStart + CSD_TILE_SIZE, iRowEnd);
+
+        for(int jTileStart = iTileStart; jTileStart < iNRows; jTileStart += CSD_TILE_SIZE) {
+            int jTileEnd = std::min(jTileStart + CSD_TILE_SIZE, iNRows);
+
+            for(i = iTileStart; i < iTileEnd; ++i) {
+                for(j = std::max(i, jTileStart); j < jTileEnd; ++j) {
+                    iPair = getPairIndex(i, j, iNRows) - iPairOffset;
+
+                    // Complex multiply-accumulate over the tapers, vectorized over the bins
+                    matCsd.col(iPair) = matSpectra.col(i * iNTapers).cwiseProduct(matSpectra.col(j * iNTapers).conjugate());
+
+                    for(k = 1; k < iNTapers; ++k) {
+                        matCsd.col(iPair) += matSpectra.col(i * iNTapers + k).cwiseProduct(matSpectra.col(j * iNTapers + k).conjugate());
+                    }
+                }
+            }
+        }
+    }
+
+    matCsd /= dDenom;
+}
@@ -0,0 +1,172 @@
+//=============================================================================================================
+/**
+ * @file     crossspectraldensity.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    CrossSpectralDensity class declaration.
+ *
+ */
+
+
+#ifndef CROSSSPECTRALDENSITY_H
+#define CROSSSPECTRALDENSITY_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../connectivity_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QVector>
+#include <QPair>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE CONNECTIVITYLIB
+//=============================================================================================================
+
+namespace CONNECTIVITYLIB {
+
+//=============================================================================================================
+/**
+ * Tiled kernel for the cross-spectral densities between all channel pairs of one trial.
+ *
+ * The tapered spectra are packed contiguously in [channel x taper x bin] order, i.e. as a (bins x channels*tapers)
+ * column major matrix. The CSDs are written in packed upper-triangular order: a (bins x pairs) matrix whose column
+ * getPairIndex(i,j) holds the CSD between channel i and j >= i. Keeping the bins innermost lets Eigen vectorize the
+ * complex multiply-accumulate, and the channel tiles keep both operands in cache.
+ *
+ * @brief Tiled kernel for packed cross-spectral densities.
+ */
+class CONNECTIVITYSHARED_EXPORT CrossSpectralDensity
+{
+
+public:
+    //=========================================================================================================
+    /**
+     * Returns the number of channel pairs (i,j) with i <= j.
+     *
+     * @param[in] iNRows     The number of channels.
+     *
+     * @return The number of pairs.
+     */
+    static inline int getNumberOfPairs(int iNRows);
+
+    //=========================================================================================================
+    /**
+     * Returns the packed column index of the channel pair (i,j) with i <= j.
+     *
+     * @param[in] i          The first channel.
+     * @param[in] j          The second channel. Must be >= i.
+     * @param[in] iNRows     The number of channels.
+     *
+     * @return The packed index.
+     */
+    static inline int getPairIndex(int i,
+                                   int j,
+                                   int iNRows);
+
+    //=========================================================================================================
+    /**
+     * Packs the tapered spectra of one trial into the contiguous layout used by compute.
+     *
+     * @param[in] vecTapSpectra      The tapered spectra (tapers x freqs) for each channel.
+     * @param[in] iBinStart          The first frequency bin to use.
+     * @param[in] iBinAmount         The number of frequency bins to use.
+     * @param[out] matSpectra        The packed spectra (bins x channels*tapers).
+     */
+    static void packSpectra(const QVector<Eigen::MatrixXcd>& vecTapSpectra,
+                            int iBinStart,
+                            int iBinAmount,
+                            Eigen::MatrixXcd& matSpectra);
+
+    //=========================================================================================================
+    /**
+     * Computes the CSDs of all channel pairs i <= j (sum over tapers divided by dDenom).
+     *
+     * @param[in] matSpectra     The packed spectra (bins x channels*tapers).
+     * @param[in] iNRows         The number of channels.
+     * @param[in] dDenom         The normalization of the taper weights.
+     * @param[out] matCsd        The packed CSDs (bins x pairs).
+     */
+    static void compute(const Eigen::MatrixXcd& matSpectra,
+                        int iNRows,
+                        double dDenom,
+                        Eigen::MatrixXcd& matCsd);
+
+    //=========================================================================================================
+    /**
+     * Computes the CSDs of the pairs (i,j) with iRowStart <= i < iRowEnd and j >= i. These pairs are contiguous in
+     * the packed layout, starting at getPairIndex(iRowStart,iRowStart,iNRows). Disjoint row ranges can therefore be
+     * computed in parallel and written to the matching columns of one packed matrix.
+     *
+     * @param[in] matSpectra     The packed spectra (bins x channels*tapers).
+     * @param[in] iNRows         The number of channels.
+     * @param[in] iRowStart      The first row.
+     * @param[in] iRowEnd        The row after the last row.
+     * @param[in] dDenom         The normalization of the taper weights.
+     * @param[out] matCsd        The packed CSDs of the pairs of the given rows (bins x pairs).
+     */
+    static void computeRows(const Eigen::MatrixXcd& matSpectra,
+                            int iNRows,
+                            int iRowStart,
+                            int iRowEnd,
+                            double dDenom,
+                            Eigen::MatrixXcd& matCsd);
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline int CrossSpectralDensity::getNumberOfPairs(int iNRows)
+{
+    return iNRows * (iNRows + 1) / 2;
+}
+
+//=============================================================================================================
+
+inline int CrossSpectralDensity::getPairIndex(int i,
+                                              int j,
+                                              int iNRows)
+{
+    return i * iNRows - i * (i - 1) / 2 + (j - i);
+}
+
+} // namespace CONNECTIVITYLIB
+
+#endif // CROSSSPECTRALDENSITY_H
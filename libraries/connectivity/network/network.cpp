@@ -68,6 +68,19 @@ using namespace UTILSLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+namespace {
+
+QPair<int,int> getMinMaxDegrees(const VectorXi& vecDegrees)
+{
+    if(vecDegrees.size() == 0) {
+        return QPair<int,int>(1000000,0);
+    }
+
+    return QPair<int,int>(vecDegrees.minCoeff(),vecDegrees.maxCoeff());
+}
+
+} // anonymous namespace
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -92,6 +105,10 @@ Network::Network(const QString& sConnectivityMethod,
 
 MatrixXd Network::getFullConnectivityMatrix(bool bGetMirroredVersion) const
 {
+    if(isCompact()) {
+        return m_pAdjacency->getConnectivityMatrix(false, bGetMirroredVersion);
+    }
+
     MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
     matDist.setZero();
 
@@ -116,6 +133,10 @@ MatrixXd Network::getFullConnectivityMatrix(bool bGetMirroredVersion) const
 
 MatrixXd Network::getThresholdedConnectivityMatrix(bool bGetMirroredVersion) const
 {
+    if(isCompact()) {
+        return m_pAdjacency->getConnectivityMatrix(true, bGetMirroredVersion);
+    }
+
     MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
     matDist.setZero();
 
@@ -140,6 +161,10 @@ MatrixXd Network::getThresholdedConnectivityMatrix(bool bGetMirroredVersion) con
 
 const QList<NetworkEdge::SPtr>& Network::getFullEdges() const
 {
+    if(isCompact() && m_lFullEdges.size() != m_pAdjacency->getNumberEdges()) {
+        createEdges();
+    }
+
     return m_lFullEdges;
 }
 
@@ -147,6 +172,10 @@ const QList<NetworkEdge::SPtr>& Network::getFullEdges() const
 
 const QList<NetworkEdge::SPtr>& Network::getThresholdedEdges() const
 {
+    if(isCompact() && m_lFullEdges.size() != m_pAdjacency->getNumberEdges()) {
+        createEdges();
+    }
+
     return m_lThresholdedEdges;
 }
 
@@ -154,6 +183,11 @@ const QList<NetworkEdge::SPtr>& Network::getThresholdedEdges() const
 
 const QList<NetworkNode::SPtr>& Network::getNodes() const
 {
+    // The nodes of a compact network only hold their edges once these were created
+    if(isCompact() && m_lFullEdges.size() != m_pAdjacency->getNumberEdges()) {
+        createEdges();
+    }
+
     return m_lNodes;
 }
 
@@ -161,14 +195,80 @@ const QList<NetworkNode::SPtr>& Network::getNodes() const
 
 NetworkNode::SPtr Network::getNodeAt(int i)
 {
+    if(isCompact() && m_lFullEdges.size() != m_pAdjacency->getNumberEdges()) {
+        createEdges();
+    }
+
     return m_lNodes.at(i);
 }
 
 //=============================================================================================================
 
-qint16 Network::getFullDistribution() const
+int Network::getNumberNodes() const
 {
-    qint16 distribution = 0;
+    return m_lNodes.size();
+}
+
+//=============================================================================================================
+
+MatrixX3f Network::getNodeVertices() const
+{
+    MatrixX3f matVert(m_lNodes.size(), 3);
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        matVert.row(i) = m_lNodes.at(i)->getVert().head<3>();
+    }
+
+    return matVert;
+}
+
+//=============================================================================================================
+
+VectorXi Network::getFullDegrees() const
+{
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(false, vecIndegrees, vecOutdegrees);
+        return vecIndegrees + vecOutdegrees;
+    }
+
+    VectorXi vecDegrees(m_lNodes.size());
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        vecDegrees(i) = m_lNodes.at(i)->getFullDegree();
+    }
+
+    return vecDegrees;
+}
+
+//=============================================================================================================
+
+VectorXi Network::getThresholdedDegrees() const
+{
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(true, vecIndegrees, vecOutdegrees);
+        return vecIndegrees + vecOutdegrees;
+    }
+
+    VectorXi vecDegrees(m_lNodes.size());
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        vecDegrees(i) = m_lNodes.at(i)->getThresholdedDegree();
+    }
+
+    return vecDegrees;
+}
+
+//=============================================================================================================
+
+int Network::getFullDistribution() const
+{
+    if(isCompact()) {
+        return 2 * m_pAdjacency->getNumberEdges();
+    }
+
+    int distribution = 0;
 
     for(int i = 0; i < m_lNodes.size(); ++i) {
         distribution += m_lNodes.at(i)->getFullDegree();
@@ -179,9 +279,13 @@ qint16 Network::getFullDistribution() const
 
 //=============================================================================================================
 
-qint16 Network::getThresholdedDistribution() const
+int Network::getThresholdedDistribution() const
 {
-    qint16 distribution = 0;
+    if(isCompact()) {
+        return 2 * m_pAdjacency->getNumberActiveEdges();
+    }
+
+    int distribution = 0;
 
     for(int i = 0; i < m_lNodes.size(); ++i) {
         distribution += m_lNodes.at(i)->getThresholdedDegree();
@@ -222,6 +326,10 @@ QPair<double, double> Network::getMinMaxThresholdedWeights() const
 
 QPair<int,int> Network::getMinMaxFullDegrees() const
 {
+    if(isCompact()) {
+        return getMinMaxDegrees(getFullDegrees());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -240,6 +348,10 @@ QPair<int,int> Network::getMinMaxFullDegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedDegrees() const
 {
+    if(isCompact()) {
+        return getMinMaxDegrees(getThresholdedDegrees());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -258,6 +370,12 @@ QPair<int,int> Network::getMinMaxThresholdedDegrees() const
 
 QPair<int,int> Network::getMinMaxFullIndegrees() const
 {
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(false, vecIndegrees, vecOutdegrees);
+        return getMinMaxDegrees(vecIndegrees);
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -276,6 +394,12 @@ QPair<int,int> Network::getMinMaxFullIndegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedIndegrees() const
 {
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(true, vecIndegrees, vecOutdegrees);
+        return getMinMaxDegrees(vecIndegrees);
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -294,6 +418,12 @@ QPair<int,int> Network::getMinMaxThresholdedIndegrees() const
 
 QPair<int,int> Network::getMinMaxFullOutdegrees() const
 {
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(false, vecIndegrees, vecOutdegrees);
+        return getMinMaxDegrees(vecOutdegrees);
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -312,6 +442,12 @@ QPair<int,int> Network::getMinMaxFullOutdegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedOutdegrees() const
 {
+    if(isCompact()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        m_pAdjacency->computeDegrees(true, vecIndegrees, vecOutdegrees);
+        return getMinMaxDegrees(vecOutdegrees);
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -333,6 +469,15 @@ void Network::setThreshold(double dThreshold)
     m_dThreshold = dThreshold;
     m_lThresholdedEdges.clear();
 
+    if(isCompact()) {
+        m_lFullEdges.clear();
+        m_pAdjacency->setThreshold(m_dThreshold);
+
+        m_minMaxThresholdedWeights.first = m_dThreshold;
+        m_minMaxThresholdedWeights.second = m_minMaxFullWeights.second;
+        return;
+    }
+
     for(int i = 0; i < m_lFullEdges.size(); ++i) {
         if(fabs(m_lFullEdges.at(i)->getWeight()) >= m_dThreshold) {
             m_lFullEdges.at(i)->setActive(true);
@@ -388,6 +533,18 @@ void Network::setFrequencyRange(float fLowerFreq, float fUpperFreq)
     // Update the min max values
     m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
 
+    if(isCompact()) {
+        m_lFullEdges.clear();
+        m_lThresholdedEdges.clear();
+        m_pAdjacency->setFrequencyBins(iLowerBin, iUpperBin);
+
+        if(m_pAdjacency->getNumberEdges() > 0) {
+            m_minMaxFullWeights.first = m_pAdjacency->getAveragedWeights().cwiseAbs().minCoeff();
+            m_minMaxFullWeights.second = m_pAdjacency->getAveragedWeights().cwiseAbs().maxCoeff();
+        }
+        return;
+    }
+
     for(int i = 0; i < m_lFullEdges.size(); ++i) {
         m_lFullEdges.at(i)->setFrequencyBins(QPair<int,int>(iLowerBin,iUpperBin));
 
@@ -410,6 +567,11 @@ const QPair<float,float>& Network::getFrequencyRange() const
 
 void Network::append(NetworkEdge::SPtr newEdge)
 {
+    if(isCompact()) {
+        qWarning() << "Network::append - Edges can not be appended to a compact network. Use setAdjacency instead.";
+        return;
+    }
+
     if(newEdge->getEndNodeID() != newEdge->getStartNodeID()) {
         double dEdgeWeight = newEdge->getWeight();
         if(dEdgeWeight < m_minMaxFullWeights.first) {
@@ -437,6 +599,10 @@ void Network::append(NetworkNode::SPtr newNode)
 
 bool Network::isEmpty() const
 {
+    if(isCompact()) {
+        return m_pAdjacency->getNumberEdges() == 0 || m_lNodes.isEmpty();
+    }
+
     if(m_lFullEdges.isEmpty() || m_lNodes.isEmpty()) {
         return true;
     }
@@ -454,8 +620,14 @@ void Network::normalize()
         return;
     }
 
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        m_lFullEdges.at(i)->setWeight(m_lFullEdges.at(i)->getWeight()/m_minMaxFullWeights.second);
+    if(isCompact()) {
+        m_lFullEdges.clear();
+        m_lThresholdedEdges.clear();
+        m_pAdjacency->scaleAveragedWeights(1.0/m_minMaxFullWeights.second);
+    } else {
+        for(int i = 0; i < m_lFullEdges.size(); ++i) {
+            m_lFullEdges.at(i)->setWeight(m_lFullEdges.at(i)->getWeight()/m_minMaxFullWeights.second);
+        }
     }
 
     m_minMaxFullWeights.first = m_minMaxFullWeights.first/m_minMaxFullWeights.second;
@@ -467,6 +639,121 @@ void Network::normalize()
 
 //=============================================================================================================
 
+void Network::compact()
+{
+    if(isCompact()) {
+        return;
+    }
+
+    NetworkAdjacency adjacency = NetworkAdjacency::fromEdges(m_lNodes.size(), m_lFullEdges);
+
+    if(!m_lFullEdges.isEmpty()) {
+        QPair<int,int> minMaxFreqBins = m_lFullEdges.first()->getFrequencyBins();
+        adjacency.setFrequencyBins(minMaxFreqBins.first, minMaxFreqBins.second);
+    }
+
+    adjacency.setThreshold(m_dThreshold);
+
+    releaseEdges();
+
+    m_pAdjacency = new NetworkAdjacency(adjacency);
+}
+
+//=============================================================================================================
+
+bool Network::isCompact() const
+{
+    return m_pAdjacency.constData() != Q_NULLPTR;
+}
+
+//=============================================================================================================
+
+void Network::setAdjacency(const NetworkAdjacency& adjacency)
+{
+    if(adjacency.getNumberNodes() != m_lNodes.size()) {
+        qWarning() << "Network::setAdjacency - Number of nodes" << adjacency.getNumberNodes() << "does not match the network's" << m_lNodes.size() << "nodes. Returning.";
+        return;
+    }
+
+    releaseEdges();
+
+    m_pAdjacency = new NetworkAdjacency(adjacency);
+    m_pAdjacency->setThreshold(m_dThreshold);
+
+    m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
+
+    if(m_pAdjacency->getNumberEdges() > 0) {
+        m_minMaxFullWeights.first = m_pAdjacency->getAveragedWeights().cwiseAbs().minCoeff();
+        m_minMaxFullWeights.second = m_pAdjacency->getAveragedWeights().cwiseAbs().maxCoeff();
+    }
+
+    m_minMaxThresholdedWeights.first = m_dThreshold;
+    m_minMaxThresholdedWeights.second = m_minMaxFullWeights.second;
+}
+
+//=============================================================================================================
+
+const NetworkAdjacency& Network::getAdjacency() const
+{
+    if(isCompact()) {
+        return *m_pAdjacency.constData();
+    }
+
+    static const NetworkAdjacency emptyAdjacency;
+    return emptyAdjacency;
+}
+
+//=============================================================================================================
+
+void Network::createEdges() const
+{
+    m_lFullEdges.clear();
+    m_lThresholdedEdges.clear();
+
+    // Fresh nodes, so the degrees of nodes handed out before are not changed
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        NetworkNode::SPtr pNode = NetworkNode::SPtr(new NetworkNode(m_lNodes.at(i)->getId(), m_lNodes.at(i)->getVert()));
+        pNode->setHubStatus(m_lNodes.at(i)->getHubStatus());
+        m_lNodes[i] = pNode;
+    }
+
+    const NetworkAdjacency& adjacency = *m_pAdjacency.constData();
+
+    m_lFullEdges.reserve(adjacency.getNumberEdges());
+
+    for(int i = 0; i < adjacency.getNumberEdges(); ++i) {
+        NetworkEdge::SPtr pEdge = NetworkEdge::SPtr(new NetworkEdge(adjacency.getStartNodeIDs()(i),
+                                                                    adjacency.getEndNodeIDs()(i),
+                                                                    adjacency.getWeights().col(i),
+                                                                    adjacency.getActiveEdges()(i)));
+        pEdge->setWeight(adjacency.getAveragedWeights()(i));
+
+        m_lNodes.at(pEdge->getStartNodeID())->append(pEdge);
+        m_lNodes.at(pEdge->getEndNodeID())->append(pEdge);
+        m_lFullEdges << pEdge;
+
+        if(adjacency.getActiveEdges()(i)) {
+            m_lThresholdedEdges << pEdge;
+        }
+    }
+}
+
+//=============================================================================================================
+
+void Network::releaseEdges()
+{
+    m_lFullEdges.clear();
+    m_lThresholdedEdges.clear();
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        NetworkNode::SPtr pNode = NetworkNode::SPtr(new NetworkNode(m_lNodes.at(i)->getId(), m_lNodes.at(i)->getVert()));
+        pNode->setHubStatus(m_lNodes.at(i)->getHubStatus());
+        m_lNodes[i] = pNode;
+    }
+}
+
+//=============================================================================================================
+
 VisualizationInfo Network::getVisualizationInfo() const
 {
     return m_visualizationInfo;
@@ -40,12 +40,14 @@
 //=============================================================================================================
 
 #include "../connectivity_global.h"
+#include "networkadjacency.h"
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QSharedDataPointer>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -127,7 +129,7 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the full and non thresholded edges.
+     * Returns the full and non thresholded edges. For compact networks the edge objects are created on demand.
      *
      * @return Returns the network edges.
      */
@@ -135,7 +137,7 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the thresholded edges.
+     * Returns the thresholded edges. For compact networks the edge objects are created on demand.
      *
      * @return Returns the network edges.
      */
@@ -143,7 +145,8 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the nodes.
+     * Returns the nodes. The nodes of a compact network are recreated together with their edges on the first
+     * call after the edges changed.
      *
      * @return Returns the network nodes.
      */
@@ -169,13 +172,45 @@ public:
      */
     QSharedPointer<NetworkNode> getNodeAt(int i);
 
+    //=========================================================================================================
+    /**
+     * Returns the number of nodes.
+     *
+     * @return The number of nodes.
+     */
+    int getNumberNodes() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the 3D positions of all nodes without creating the edges of a compact network.
+     *
+     * @return The node positions (nodes x 3).
+     */
+    Eigen::MatrixX3f getNodeVertices() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the degree (in and out) of each node corresponding to the full network.
+     *
+     * @return The degree of each node.
+     */
+    Eigen::VectorXi getFullDegrees() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the degree (in and out) of each node corresponding to the thresholded network.
+     *
+     * @return The degree of each node.
+     */
+    Eigen::VectorXi getThresholdedDegrees() const;
+
     //=========================================================================================================
     /**
      * Returns network distribution, also known as network degree, corresponding to the full network.
      *
      * @return   The network distribution calculated as degrees of all nodes together.
      */
-    qint16 getFullDistribution() const;
+    int getFullDistribution() const;
 
     //=========================================================================================================
     /**
@@ -183,7 +218,7 @@ public:
      *
      * @return   The network distribution calculated as degrees of all nodes together.
      */
-    qint16 getThresholdedDistribution() const;
+    int getThresholdedDistribution() const;
 
     //=========================================================================================================
     /**
@@ -314,6 +349,42 @@ public:
      */
     void append(QSharedPointer<NetworkNode> newNode);
 
+    //=========================================================================================================
+    /**
+     * Moves the edges into the compact NetworkAdjacency storage and releases the edge objects, including the
+     * edge lists of the nodes. Afterwards thresholding and degree queries run in O(E). Use getFullDegrees() and
+     * getThresholdedDegrees() instead of the per node degrees for compact networks. The averaged weights are
+     * recomputed from the edge weights, so compact a network before normalizing it. Edges can not be appended to
+     * compact networks.
+     */
+    void compact();
+
+    //=========================================================================================================
+    /**
+     * Returns whether the edges are held in the compact NetworkAdjacency storage.
+     *
+     * @return Whether this network is compact.
+     */
+    bool isCompact() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the compact edge storage directly, e.g. when building large networks. The nodes must have been
+     * appended already. Any edge objects are released.
+     *
+     * @param[in] adjacency      The compact edge storage. Must be finalized.
+     */
+    void setAdjacency(const NetworkAdjacency& adjacency);
+
+    //=========================================================================================================
+    /**
+     * Returns the compact edge storage. The returned arrays can be used directly, e.g. for plotting. Empty if
+     * this network is not compact.
+     *
+     * @return The compact edge storage.
+     */
+    const NetworkAdjacency& getAdjacency() const;
+
     //=========================================================================================================
     /**
      * Returns whether the Network is empty by checking the number of nodes and edges.
@@ -393,10 +464,26 @@ public:
     int getFFTSize();
 
 protected:
-    QList<QSharedPointer<NetworkEdge> >     m_lFullEdges;               /**< List with all edges of the network.*/
-    QList<QSharedPointer<NetworkEdge> >     m_lThresholdedEdges;        /**< List with all the active (thresholded) edges of the network.*/
+    //=========================================================================================================
+    /**
+     * Creates the edge objects of a compact network for callers of the edge list API. The nodes are replaced
+     * by nodes holding these edges.
+     */
+    void createEdges() const;
+
+    //=========================================================================================================
+    /**
+     * Releases all edge objects. The nodes are replaced by nodes without edges, so copies of this network
+     * sharing the old nodes are not affected.
+     */
+    void releaseEdges();
+
+    mutable QList<QSharedPointer<NetworkEdge> >     m_lFullEdges;           /**< List with all edges of the network. Created on demand for compact networks.*/
+    mutable QList<QSharedPointer<NetworkEdge> >     m_lThresholdedEdges;    /**< List with all the active (thresholded) edges of the network. Created on demand for compact networks.*/
+
+    QSharedDataPointer<NetworkAdjacency>    m_pAdjacency;               /**< The compact edge storage. Null if the edges are held as edge objects.*/
 
-    QList<QSharedPointer<NetworkNode> >     m_lNodes;                   /**< List with all nodes of the network.*/
+    mutable QList<QSharedPointer<NetworkNode> >     m_lNodes;           /**< List with all nodes of the network. Recreated with the edges for compact networks.*/
 
     Eigen::MatrixXd                         m_matDistMatrix;            /**< The distance matrix.*/
 
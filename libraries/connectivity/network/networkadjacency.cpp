@@ -0,0 +1,282 @@
+//=============================================================================================================
+/**
+ * @file     networkadjacency.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    NetworkAdjacency class definition.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "networkadjacency.h"
+
+#include "networkedge.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+NetworkAdjacency::NetworkAdjacency(int iNumberNodes,
+                                   int iNumberBins)
+: m_iNumberNodes(std::max(iNumberNodes, 0))
+, m_iNumberEdges(0)
+, m_iLowerBin(-1)
+, m_iUpperBin(-1)
+, m_dThreshold(0.0)
+, m_vecRowPointers(VectorXi::Zero(m_iNumberNodes + 1))
+, m_matWeights(std::max(iNumberBins, 1), 0)
+{
+}
+
+//=============================================================================================================
+
+NetworkAdjacency NetworkAdjacency::fromEdges(int iNumberNodes,
+                                             const QList<QSharedPointer<NetworkEdge> >& lEdges)
+{
+    int iNumberBins = lEdges.isEmpty() ? 1 : lEdges.first()->getMatrixWeight().rows();
+
+    NetworkAdjacency adjacency(iNumberNodes, iNumberBins);
+    adjacency.reserve(lEdges.size());
+
+    MatrixXd matWeight;
+
+    for(int i = 0; i < lEdges.size(); ++i) {
+        matWeight = lEdges.at(i)->getMatrixWeight();
+
+        if(matWeight.rows() != iNumberBins) {
+            qWarning() << "NetworkAdjacency::fromEdges - Edge" << i << "has" << matWeight.rows() << "instead of" << iNumberBins << "weights. Skipping.";
+            continue;
+        }
+
+        adjacency.appendEdge(lEdges.at(i)->getStartNodeID(),
+                             lEdges.at(i)->getEndNodeID(),
+                             matWeight.col(0));
+    }
+
+    adjacency.finalize();
+
+    return adjacency;
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::reserve(int iNumberEdges)
+{
+    if(iNumberEdges <= m_vecStartNodeIDs.size()) {
+        return;
+    }
+
+    m_vecStartNodeIDs.conservativeResize(iNumberEdges);
+    m_vecEndNodeIDs.conservativeResize(iNumberEdges);
+    m_matWeights.conservativeResize(NoChange, iNumberEdges);
+}
+
+//=============================================================================================================
+
+bool NetworkAdjacency::appendEdge(int iStartNodeID,
+                                  int iEndNodeID,
+                                  const VectorXd& vecWeights)
+{
+    if(iStartNodeID == iEndNodeID ||
+       iStartNodeID < 0 || iStartNodeID >= m_iNumberNodes ||
+       iEndNodeID < 0 || iEndNodeID >= m_iNumberNodes) {
+        return false;
+    }
+
+    if(vecWeights.rows() != m_matWeights.rows()) {
+        qWarning() << "NetworkAdjacency::appendEdge - Number of weights" << vecWeights.rows() << "does not match the number of bins" << m_matWeights.rows();
+        return false;
+    }
+
+    // Grow geometrically, so appending stays amortized constant
+    if(m_iNumberEdges == m_vecStartNodeIDs.size()) {
+        reserve(std::max(16, 2 * m_iNumberEdges));
+    }
+
+    m_vecStartNodeIDs(m_iNumberEdges) = iStartNodeID;
+    m_vecEndNodeIDs(m_iNumberEdges) = iEndNodeID;
+    m_matWeights.col(m_iNumberEdges) = vecWeights;
+
+    ++m_iNumberEdges;
+
+    return true;
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::finalize()
+{
+    // Sort the edges by start and end node
+    std::vector<int> vecOrder(m_iNumberEdges);
+    std::iota(vecOrder.begin(), vecOrder.end(), 0);
+
+    std::sort(vecOrder.begin(), vecOrder.end(), [this](int a, int b) {
+        return m_vecStartNodeIDs(a) < m_vecStartNodeIDs(b) ||
+               (m_vecStartNodeIDs(a) == m_vecStartNodeIDs(b) && m_vecEndNodeIDs(a) < m_vecEndNodeIDs(b));
+    });
+
+    VectorXi vecStartNodeIDs(m_iNumberEdges);
+    VectorXi vecEndNodeIDs(m_iNumberEdges);
+    MatrixXd matWeights(m_matWeights.rows(), m_iNumberEdges);
+
+    for(int i = 0; i < m_iNumberEdges; ++i) {
+        vecStartNodeIDs(i) = m_vecStartNodeIDs(vecOrder[i]);
+        vecEndNodeIDs(i) = m_vecEndNodeIDs(vecOrder[i]);
+        matWeights.col(i) = m_matWeights.col(vecOrder[i]);
+    }
+
+    m_vecStartNodeIDs.swap(vecStartNodeIDs);
+    m_vecEndNodeIDs.swap(vecEndNodeIDs);
+    m_matWeights.swap(matWeights);
+
+    // Build the row index
+    m_vecRowPointers.setZero(m_iNumberNodes + 1);
+
+    for(int i = 0; i < m_iNumberEdges; ++i) {
+        ++m_vecRowPointers(m_vecStartNodeIDs(i) + 1);
+    }
+
+    for(int i = 0; i < m_iNumberNodes; ++i) {
+        m_vecRowPointers(i + 1) += m_vecRowPointers(i);
+    }
+
+    m_vecAveragedWeights.setZero(m_iNumberEdges);
+    setFrequencyBins(m_iLowerBin, m_iUpperBin);
+    setThreshold(m_dThreshold);
+}
+
+//=============================================================================================================
+
+int NetworkAdjacency::getNumberActiveEdges() const
+{
+    return m_vecActiveEdges.count();
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::setFrequencyBins(int iLowerBin,
+                                        int iUpperBin)
+{
+    if(iUpperBin < iLowerBin || iLowerBin < -1 || iUpperBin < -1 ) {
+        return;
+    }
+
+    m_iLowerBin = iLowerBin;
+    m_iUpperBin = iUpperBin;
+
+    int iNumberBins = m_matWeights.rows();
+
+    if(m_iNumberEdges == 0) {
+        return;
+    }
+
+    // Same averaging as NetworkEdge::calculateAveragedWeight, but for all edges at once
+    if(iLowerBin == -1 && iUpperBin == -1) {
+        m_vecAveragedWeights = m_matWeights.colwise().mean().transpose();
+    } else if(iLowerBin < iNumberBins) {
+        int iRows = std::min(iUpperBin, iNumberBins - 1) - iLowerBin + 1;
+        m_vecAveragedWeights = m_matWeights.middleRows(iLowerBin, iRows).colwise().mean().transpose();
+    }
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::setThreshold(double dThreshold)
+{
+    m_dThreshold = dThreshold;
+    m_vecActiveEdges = m_vecAveragedWeights.array().abs() >= m_dThreshold;
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::scaleAveragedWeights(double dScale)
+{
+    m_vecAveragedWeights *= dScale;
+}
+
+//=============================================================================================================
+
+void NetworkAdjacency::computeDegrees(bool bThresholded,
+                                      VectorXi& vecIndegrees,
+                                      VectorXi& vecOutdegrees) const
+{
+    vecIndegrees.setZero(m_iNumberNodes);
+    vecOutdegrees.setZero(m_iNumberNodes);
+
+    for(int i = 0; i < m_iNumberEdges; ++i) {
+        if(!bThresholded || m_vecActiveEdges(i)) {
+            ++vecOutdegrees(m_vecStartNodeIDs(i));
+            ++vecIndegrees(m_vecEndNodeIDs(i));
+        }
+    }
+}
+
+//=============================================================================================================
+
+MatrixXd NetworkAdjacency::getConnectivityMatrix(bool bThresholded,
+                                                 bool bGetMirroredVersion) const
+{
+    MatrixXd matDist = MatrixXd::Zero(m_iNumberNodes, m_iNumberNodes);
+
+    for(int i = 0; i < m_iNumberEdges; ++i) {
+        if(!bThresholded || m_vecActiveEdges(i)) {
+            matDist(m_vecStartNodeIDs(i), m_vecEndNodeIDs(i)) = m_vecAveragedWeights(i);
+
+            if(bGetMirroredVersion) {
+                matDist(m_vecEndNodeIDs(i), m_vecStartNodeIDs(i)) = m_vecAveragedWeights(i);
+            }
+        }
+    }
+
+    return matDist;
+}
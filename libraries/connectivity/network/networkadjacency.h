@@ -0,0 +1,352 @@
+//=============================================================================================================
+/**
+ * @file     networkadjacency.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    NetworkAdjacency class declaration.
+ *
+ */
+
+
+#ifndef NETWORKADJACENCY_H
+#define NETWORKADJACENCY_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../connectivity_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedData>
+#include <QSharedPointer>
+#include <QList>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE CONNECTIVITYLIB
+//=============================================================================================================
+
+namespace CONNECTIVITYLIB {
+
+//=============================================================================================================
+// CONNECTIVITYLIB FORWARD DECLARATIONS
+//=============================================================================================================
+
+class NetworkEdge;
+
+//=============================================================================================================
+/**
+ * Compact edge storage for large networks. The edges are stored as coordinate lists (start and end node IDs) with
+ * a compressed row index over the start nodes (CSR). The per frequency bin weights of all edges are kept in one
+ * contiguous (bins x edges) matrix. Thresholding, degree and connectivity matrix queries run in O(E) without
+ * allocating per edge objects.
+ *
+ * @brief Compact CSR/COO edge storage for a Network.
+ */
+class CONNECTIVITYSHARED_EXPORT NetworkAdjacency : public QSharedData
+{
+
+public:
+    typedef QSharedPointer<NetworkAdjacency> SPtr;            /**< Shared pointer type for NetworkAdjacency. */
+    typedef QSharedPointer<const NetworkAdjacency> ConstSPtr; /**< Const shared pointer type for NetworkAdjacency. */
+
+    //=========================================================================================================
+    /**
+     * Constructs a NetworkAdjacency object.
+     *
+     * @param[in] iNumberNodes   The number of nodes.
+     * @param[in] iNumberBins    The number of weights (frequency bins) per edge.
+     */
+    explicit NetworkAdjacency(int iNumberNodes = 0,
+                              int iNumberBins = 1);
+
+    //=========================================================================================================
+    /**
+     * Creates the compact storage from a list of network edges. Only the first column of the edge weight
+     * matrices is kept.
+     *
+     * @param[in] iNumberNodes   The number of nodes.
+     * @param[in] lEdges         The edges.
+     *
+     * @return The compact storage.
+     */
+    static NetworkAdjacency fromEdges(int iNumberNodes,
+                                      const QList<QSharedPointer<NetworkEdge> >& lEdges);
+
+    //=========================================================================================================
+    /**
+     * Reserves memory for the given number of edges.
+     *
+     * @param[in] iNumberEdges   The number of edges.
+     */
+    void reserve(int iNumberEdges);
+
+    //=========================================================================================================
+    /**
+     * Appends an edge. Self connections and edges with invalid node IDs are ignored. Call finalize() once all
+     * edges were appended.
+     *
+     * @param[in] iStartNodeID   The start node of the edge.
+     * @param[in] iEndNodeID     The end node of the edge.
+     * @param[in] vecWeights     The weights of the edge, one per frequency bin.
+     *
+     * @return Whether the edge was appended.
+     */
+    bool appendEdge(int iStartNodeID,
+                    int iEndNodeID,
+                    const Eigen::VectorXd& vecWeights);
+
+    //=========================================================================================================
+    /**
+     * Sorts the edges by start and end node, builds the row index and updates the averaged weights and the
+     * active edges.
+     */
+    void finalize();
+
+    //=========================================================================================================
+    /**
+     * Returns the number of nodes.
+     *
+     * @return The number of nodes.
+     */
+    int getNumberNodes() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of edges.
+     *
+     * @return The number of edges.
+     */
+    int getNumberEdges() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of active (thresholded) edges.
+     *
+     * @return The number of active edges.
+     */
+    int getNumberActiveEdges() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of weights (frequency bins) per edge.
+     *
+     * @return The number of bins.
+     */
+    int getNumberBins() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the row index. The outgoing edges of node i are stored at [rowPointers(i), rowPointers(i+1)).
+     *
+     * @return The row index with getNumberNodes()+1 entries.
+     */
+    const Eigen::VectorXi& getRowPointers() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the start node IDs of all edges.
+     *
+     * @return The start node IDs.
+     */
+    const Eigen::VectorXi& getStartNodeIDs() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the end node IDs of all edges.
+     *
+     * @return The end node IDs.
+     */
+    const Eigen::VectorXi& getEndNodeIDs() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the weights of all edges.
+     *
+     * @return The weights (bins x edges).
+     */
+    const Eigen::MatrixXd& getWeights() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the weights of all edges averaged over the current frequency bins.
+     *
+     * @return The averaged weights.
+     */
+    const Eigen::VectorXd& getAveragedWeights() const;
+
+    //=========================================================================================================
+    /**
+     * Returns which edges are part of the thresholded network.
+     *
+     * @return The activity flags.
+     */
+    const Eigen::Array<bool, Eigen::Dynamic, 1>& getActiveEdges() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the frequency bins to average the weights from/to and updates the averaged weights. -1 for both
+     * bins averages over all weights. The active edges are not updated.
+     *
+     * @param[in] iLowerBin      The lower bin.
+     * @param[in] iUpperBin      The upper bin.
+     */
+    void setFrequencyBins(int iLowerBin,
+                          int iUpperBin);
+
+    //=========================================================================================================
+    /**
+     * Marks all edges with an absolute averaged weight of at least dThreshold as active.
+     *
+     * @param[in] dThreshold     The threshold.
+     */
+    void setThreshold(double dThreshold);
+
+    //=========================================================================================================
+    /**
+     * Scales the averaged weights, e.g. to normalize them.
+     *
+     * @param[in] dScale         The scaling factor.
+     */
+    void scaleAveragedWeights(double dScale);
+
+    //=========================================================================================================
+    /**
+     * Computes the in and out degrees of all nodes.
+     *
+     * @param[in] bThresholded       Whether to only count the active edges.
+     * @param[out] vecIndegrees      The indegrees.
+     * @param[out] vecOutdegrees     The outdegrees.
+     */
+    void computeDegrees(bool bThresholded,
+                        Eigen::VectorXi& vecIndegrees,
+                        Eigen::VectorXi& vecOutdegrees) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the connectivity matrix of the averaged weights.
+     *
+     * @param[in] bThresholded           Whether to only include the active edges.
+     * @param[in] bGetMirroredVersion    Whether to mirror the weights to the lower part of the matrix.
+     *
+     * @return The connectivity matrix.
+     */
+    Eigen::MatrixXd getConnectivityMatrix(bool bThresholded,
+                                          bool bGetMirroredVersion = true) const;
+
+protected:
+    int                                 m_iNumberNodes;         /**< The number of nodes.*/
+    int                                 m_iNumberEdges;         /**< The number of edges.*/
+    int                                 m_iLowerBin;            /**< The lower bin to average the weights from.*/
+    int                                 m_iUpperBin;            /**< The upper bin to average the weights to.*/
+    double                              m_dThreshold;           /**< The current threshold.*/
+
+    Eigen::VectorXi                     m_vecRowPointers;       /**< The row index over the start nodes (CSR).*/
+    Eigen::VectorXi                     m_vecStartNodeIDs;      /**< The start node of each edge.*/
+    Eigen::VectorXi                     m_vecEndNodeIDs;        /**< The end node of each edge.*/
+    Eigen::MatrixXd                     m_matWeights;           /**< The weights of all edges (bins x edges).*/
+    Eigen::VectorXd                     m_vecAveragedWeights;   /**< The weights averaged over the current bins.*/
+    Eigen::Array<bool, Eigen::Dynamic, 1>   m_vecActiveEdges;   /**< The activity flags of the thresholded network.*/
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline int NetworkAdjacency::getNumberNodes() const
+{
+    return m_iNumberNodes;
+}
+
+//=============================================================================================================
+
+inline int NetworkAdjacency::getNumberEdges() const
+{
+    return m_iNumberEdges;
+}
+
+//=============================================================================================================
+
+inline int NetworkAdjacency::getNumberBins() const
+{
+    return m_matWeights.rows();
+}
+
+//=============================================================================================================
+
+inline const Eigen::VectorXi& NetworkAdjacency::getRowPointers() const
+{
+    return m_vecRowPointers;
+}
+
+//=============================================================================================================
+
+inline const Eigen::VectorXi& NetworkAdjacency::getStartNodeIDs() const
+{
+    return m_vecStartNodeIDs;
+}
+
+//=============================================================================================================
+
+inline const Eigen::VectorXi& NetworkAdjacency::getEndNodeIDs() const
+{
+    return m_vecEndNodeIDs;
+}
+
+//=============================================================================================================
+
+inline const Eigen::MatrixXd& NetworkAdjacency::getWeights() const
+{
+    return m_matWeights;
+}
+
+//=============================================================================================================
+
+inline const Eigen::VectorXd& NetworkAdjacency::getAveragedWeights() const
+{
+    return m_vecAveragedWeights;
+}
+
+//=============================================================================================================
+
+inline const Eigen::Array<bool, Eigen::Dynamic, 1>& NetworkAdjacency::getActiveEdges() const
+{
+    return m_vecActiveEdges;
+}
+} // namespace CONNECTIVITYLIB
+
+#endif // NETWORKADJACENCY_H
@@ -45,6 +45,7 @@
 
 #include <QGridLayout>
 #include <QSpinBox>
+#include <QComboBox>
 #include <QLabel>
 #include <QSettings>
 
@@ -82,6 +83,32 @@ CovarianceSettingsView::CovarianceSettingsView(const QString& sSettingsPath,
     connect(m_pSpinBoxNumSamples, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
             this, &CovarianceSettingsView::samplesChanged);
     t_pGridLayout->addWidget(m_pSpinBoxNumSamples,0,1,1,1);
+
+    QLabel* t_pLabelEstimationMode = new QLabel;
+    t_pLabelEstimationMode->setText("Estimation Mode");
+    t_pGridLayout->addWidget(t_pLabelEstimationMode,1,0,1,1);
+
+    m_pComboBoxEstimationMode = new QComboBox;
+    m_pComboBoxEstimationMode->addItem("Block");
+    m_pComboBoxEstimationMode->addItem("Exponentially weighted");
+    m_pComboBoxEstimationMode->addItem("Sliding window");
+    connect(m_pComboBoxEstimationMode, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &CovarianceSettingsView::estimationModeChanged);
+    t_pGridLayout->addWidget(m_pComboBoxEstimationMode,1,1,1,1);
+
+    QLabel* t_pLabelUpdateInterval = new QLabel;
+    t_pLabelUpdateInterval->setText("Update Interval (Samples)");
+    t_pGridLayout->addWidget(t_pLabelUpdateInterval,2,0,1,1);
+
+    m_pSpinBoxUpdateInterval = new QSpinBox;
+    m_pSpinBoxUpdateInterval->setMinimum(1);
+    m_pSpinBoxUpdateInterval->setMaximum(minSamples*60);
+    m_pSpinBoxUpdateInterval->setSingleStep(minSamples/10);
+    m_pSpinBoxUpdateInterval->setToolTip("Number of samples between two estimates. Not used by the block mode.");
+    connect(m_pSpinBoxUpdateInterval, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &CovarianceSettingsView::updateIntervalChanged);
+    t_pGridLayout->addWidget(m_pSpinBoxUpdateInterval,2,1,1,1);
+
     this->setLayout(t_pGridLayout);
 
     loadSettings();
@@ -111,6 +138,20 @@ void CovarianceSettingsView::setMinSamples(int iSamples)
 
 //=============================================================================================================
 
+void CovarianceSettingsView::setCurrentEstimationMode(int iMode)
+{
+    m_pComboBoxEstimationMode->setCurrentIndex(iMode);
+}
+
+//=============================================================================================================
+
+void CovarianceSettingsView::setCurrentUpdateInterval(int iSamples)
+{
+    m_pSpinBoxUpdateInterval->setValue(iSamples);
+}
+
+//=============================================================================================================
+
 void CovarianceSettingsView::saveSettings()
 {
     if(m_sSettingsPath.isEmpty()) {
@@ -104,6 +104,22 @@ public:
      */
     void setMinSamples(int iSamples);
 
+    //=========================================================================================================
+    /**
+     * Set the current estimation mode (Block=0, ExponentiallyWeighted=1, SlidingWindow=2).
+     *
+     * @param[in] iMode     new estimation mode
+     */
+    void setCurrentEstimationMode(int iMode);
+
+    //=========================================================================================================
+    /**
+     * Set the number of samples between two covariance estimates. Only used by the continuous estimation modes.
+     *
+     * @param[in] iSamples     new number of samples between two estimates
+     */
+    void setCurrentUpdateInterval(int iSamples);
+
     //=========================================================================================================
     /**
      * Saves all important settings of this view via QSettings.
@@ -135,9 +151,13 @@ protected:
 
 signals:
     void samplesChanged(int iSamples);
+    void estimationModeChanged(int iMode);
+    void updateIntervalChanged(int iSamples);
 
 private:
     QSpinBox*       m_pSpinBoxNumSamples;
+    QComboBox*      m_pComboBoxEstimationMode;
+    QSpinBox*       m_pSpinBoxUpdateInterval;
     QString         m_sSettingsPath;            /**< The settings path to store the GUI settings to. */
 
 };
@@ -320,12 +320,15 @@ void RtFiffRawViewModel::setFiffInfo(QSharedPointer<FIFFLIB::FiffInfo> &p_pFiffI
         m_matSparseProjMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
         m_matSparseCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
         m_matSparseSpharaMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-        m_matSparseProjCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
 
         m_matSparseProjMult.setIdentity();
         m_matSparseCompMult.setIdentity();
         m_matSparseSpharaMult.setIdentity();
-        m_matSparseProjCompMult.setIdentity();
+
+        m_spatialOperators.setNumChannels(m_pFiffInfo->chs.size());
+        m_spatialOperators.setFoldAcrossFilter(false);
+        m_spatialOperators.setTemporalFilter(RowVectorXi(), !m_filterKernel.isEmpty() && m_bPerformFiltering);
+        m_spatialOperators.setSphara(m_matSparseSpharaMult, m_bSpharaActivated);
 
         //Create the initial Compensator projector
         updateCompensator(0);
@@ -406,14 +409,8 @@ MatrixXd RtFiffRawViewModel::getLastBlock()
 
 void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
 {
-    //SSP
-    bool doProj = m_bProjActivated && m_matDataRaw.cols() > 0 && m_matDataRaw.rows() == m_matProj.cols() ? true : false;
-
-    //Compensator
-    bool doComp = m_bCompActivated && m_matDataRaw.cols() > 0 && m_matDataRaw.rows() == m_matComp.cols() ? true : false;
-
-    //SPHARA
-    bool doSphara = m_bSpharaActivated && m_matSparseSpharaMult.cols() > 0 && m_matDataRaw.rows() == m_matSparseSpharaMult.cols() ? true : false;
+    //SPHARA on the filtered data. Without filtering it is already folded into the operator applied to the raw data.
+    bool doSphara = m_matDataRaw.cols() > 0 && m_spatialOperators.hasOperatorAfterFilter();
 
     //Copy new data into the global data matrix
     for(qint32 b = 0; b < data.size(); ++b) {
@@ -438,24 +435,9 @@ void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
 //            std::cout<<"m_matDataRaw.cols(): "<<m_matDataRaw.cols()<<std::endl;
 //            std::cout<<"nCol-m_iResidual: "<<nCol-m_iResidual<<std::endl<<std::endl;
 
-            if(doComp) {
-                if(doProj) {
-                    //Comp + Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjCompMult * data.at(b).block(0,0,nRow,m_iResidual);
-                } else {
-                    //Comp
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseCompMult * data.at(b).block(0,0,nRow,m_iResidual);
-                }
-            } else {
-                if(doProj)
-                {
-                    //Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjMult * data.at(b).block(0,0,nRow,m_iResidual);
-                } else {
-                    //None - Raw
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = data.at(b).block(0,0,nRow,m_iResidual);
-                }
-            }
+            //Comp + Proj (+ SPHARA if not filtering)
+            m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = data.at(b).block(0,0,nRow,m_iResidual);
+            m_spatialOperators.applyBeforeFilter(m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual));
 
             m_iCurrentSample = 0;
 
@@ -481,23 +463,9 @@ void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
 
         //std::cout<<"incoming data is ok"<<std::endl;
 
-        if(doComp) {
-            if(doProj) {
-                //Comp + Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjCompMult * data.at(b);
-            } else {
-                //Comp
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseCompMult * data.at(b);
-            }
-        } else {
-            if(doProj) {
-                //Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjMult * data.at(b);
-            } else {
-                //None - Raw
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = data.at(b);
-            }
-        }
+        //Comp + Proj (+ SPHARA if not filtering)
+        m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = data.at(b);
+        m_spatialOperators.applyBeforeFilter(m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol));
 
         //Filter if neccessary else set filtered data matrix to zero
         if(!m_filterKernel.isEmpty() && m_bPerformFiltering) {
@@ -506,23 +474,18 @@ void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
             //Perform SPHARA on filtered data after actual filtering - SPHARA should be applied on the best possible data
             if(doSphara) {
                 if(m_iCurrentSample-m_iMaxFilterLength/2 >= 0) {
-                    m_matDataFiltered.block(0, m_iCurrentSample-m_iMaxFilterLength/2, nRow, nCol) = m_matSparseSpharaMult * m_matDataFiltered.block(0, m_iCurrentSample-m_iMaxFilterLength/2, nRow, nCol);
+                    m_spatialOperators.applyAfterFilter(m_matDataFiltered.block(0, m_iCurrentSample-m_iMaxFilterLength/2, nRow, nCol));
                 }
                 else {
                     if(m_iCurrentSample-m_iMaxFilterLength/2 < 0) {
-                        m_matDataFiltered.block(0, 0, nRow, nCol) = m_matSparseSpharaMult * m_matDataFiltered.block(0, 0, nRow, nCol);
+                        m_spatialOperators.applyAfterFilter(m_matDataFiltered.block(0, 0, nRow, nCol));
                         int iResidual = m_iResidual+m_iMaxFilterLength/2;
-                        m_matDataFiltered.block(0, m_matDataFiltered.cols()-iResidual, nRow, iResidual) = m_matSparseSpharaMult * m_matDataFiltered.block(0, m_matDataFiltered.cols()-iResidual, nRow, iResidual);
+                        m_spatialOperators.applyAfterFilter(m_matDataFiltered.block(0, m_matDataFiltered.cols()-iResidual, nRow, iResidual));
                     }
                 }
             }
         } else {
             m_matDataFiltered.block(0, m_iCurrentSample, nRow, nCol).setZero();// = m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol);
-
-            //Perform SPHARA on raw data data
-            if(doSphara) {
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseSpharaMult * m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol);
-            }
         }
 
         m_iCurrentSample += nCol;
@@ -732,8 +695,7 @@ void RtFiffRawViewModel::updateProjection(const QList<FIFFLIB::FiffProj>& projs)
             m_matSparseProjMult.setFromTriplets(tripletList.begin(), tripletList.end());
         }
 
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
+        m_spatialOperators.setProjector(m_matSparseProjMult, m_bProjActivated);
     }
 }
 
@@ -786,8 +748,7 @@ void RtFiffRawViewModel::updateCompensator(int to)
             m_matSparseCompMult.setFromTriplets(tripletList.begin(), tripletList.end());
         }
 
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
+        m_spatialOperators.setCompensator(m_matSparseCompMult, m_bCompActivated);
     }
 }
 
@@ -796,6 +757,7 @@ void RtFiffRawViewModel::updateCompensator(int to)
 void RtFiffRawViewModel::updateSpharaActivation(bool state)
 {
     m_bSpharaActivated = state;
+    m_spatialOperators.setSphara(m_matSparseSpharaMult, m_bSpharaActivated);
 }
 
 //=============================================================================================================
@@ -874,6 +836,7 @@ void RtFiffRawViewModel::updateSpharaOptions(const QString& sSytemType, int nBas
 
         //Create full multiplication matrix
         m_matSparseSpharaMult = matSparseSpharaMultFirst * matSparseSpharaMultSecond;
+        m_spatialOperators.setSphara(m_matSparseSpharaMult, m_bSpharaActivated);
     }
 }
 
@@ -895,6 +858,8 @@ void RtFiffRawViewModel::setFilter(QList<FilterKernel> filterData)
 
     m_bDrawFilterFront = false;
 
+    m_spatialOperators.setTemporalFilter(RowVectorXi(), !m_filterKernel.isEmpty() && m_bPerformFiltering);
+
     //Filter all visible data channels at once
     //filterDataBlock();
 }
@@ -904,6 +869,7 @@ void RtFiffRawViewModel::setFilter(QList<FilterKernel> filterData)
 void RtFiffRawViewModel::setFilterActive(bool state)
 {
     m_bPerformFiltering = state;
+    m_spatialOperators.setTemporalFilter(RowVectorXi(), !m_filterKernel.isEmpty() && m_bPerformFiltering);
 }
 
 //=============================================================================================================
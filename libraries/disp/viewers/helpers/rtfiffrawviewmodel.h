@@ -46,6 +46,7 @@
 #include <fiff/fiff_proj.h>
 
 #include <rtprocessing/helpers/filterkernel.h>
+#include <rtprocessing/helpers/spatialoperatorcompositor.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -575,10 +576,11 @@ private:
     Eigen::VectorXi                     m_vecIndicesFirstEEG;                       /**< The indices of the channels to pick for the second SPHARA operator in case of an EEG system.*/
 
     Eigen::SparseMatrix<double>         m_matSparseSpharaMult;                      /**< The final sparse SPHARA operator .*/
-    Eigen::SparseMatrix<double>         m_matSparseProjCompMult;                    /**< The final sparse projection + compensator operator.*/
     Eigen::SparseMatrix<double>         m_matSparseProjMult;                        /**< The final sparse SSP projector */
     Eigen::SparseMatrix<double>         m_matSparseCompMult;                        /**< The final sparse compensator matrix */
 
+    RTPROCESSINGLIB::SpatialOperatorCompositor m_spatialOperators;                  /**< Folds compensator, projector and SPHARA into cached operators. SPHARA stays behind the filter so the raw data does not include it. */
+
     Eigen::MatrixXd                     m_matProj;                                  /**< SSP projector */
     Eigen::MatrixXd                     m_matComp;                                  /**< Compensator */
 
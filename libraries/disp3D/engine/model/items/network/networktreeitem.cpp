@@ -150,7 +150,13 @@ void NetworkTreeItem::addData(const Network& tNetworkData)
     data.setValue(tNetwork);
     this->setData(data, Data3DTreeModelItemRoles::NetworkData);
 
-    MatrixXd matDist = tNetwork.getFullConnectivityMatrix();
+    // The weights are only used for the threshold histogram. Avoid the dense matrix for compact (large) networks.
+    MatrixXd matDist;
+    if(tNetwork.isCompact()) {
+        matDist = tNetwork.getAdjacency().getAveragedWeights();
+    } else {
+        matDist = tNetwork.getFullConnectivityMatrix();
+    }
 //  MatrixXd matDist = tNetwork.getThresholdedConnectivityMatrix();
     data.setValue(matDist);
     this->setData(data, Data3DTreeModelItemRoles::Data);
@@ -253,8 +259,12 @@ void NetworkTreeItem::plotNodes(const Network& tNetworkData)
         return;
     }
 
-    QList<NetworkNode::SPtr> lNetworkNodes = tNetworkData.getNodes();
-    qint16 iMaxDegree = tNetworkData.getMinMaxThresholdedDegrees().second;
+    // The positions only, so no edge objects are created for compact networks
+    MatrixX3f matNodeVert = tNetworkData.getNodeVertices();
+
+    // Computed in one pass over the edges, which also works for compact networks
+    VectorXi vecDegrees = tNetworkData.getThresholdedDegrees();
+    qint16 iMaxDegree = vecDegrees.size() > 0 ? vecDegrees.maxCoeff() : 0;
 
     VisualizationInfo visualizationInfo = tNetworkData.getVisualizationInfo();
 
@@ -285,13 +295,13 @@ void NetworkTreeItem::plotNodes(const Network& tNetworkData)
     QVector3D tempPos;
     qint16 iDegree = 0;
 
-    for(int i = 0; i < lNetworkNodes.size(); ++i) {
-        iDegree = lNetworkNodes.at(i)->getThresholdedDegree();
+    for(int i = 0; i < matNodeVert.rows(); ++i) {
+        iDegree = vecDegrees(i);
 
         if(iDegree != 0) {
-            tempPos = QVector3D(lNetworkNodes.at(i)->getVert()(0),
-                                lNetworkNodes.at(i)->getVert()(1),
-                                lNetworkNodes.at(i)->getVert()(2));
+            tempPos = QVector3D(matNodeVert(i,0),
+                                matNodeVert(i,1),
+                                matNodeVert(i,2));
 
             //Set position and scale
             QMatrix4x4 tempTransform;
@@ -336,8 +346,17 @@ void NetworkTreeItem::plotEdges(const Network &tNetworkData)
     double dMaxWeight = tNetworkData.getMinMaxThresholdedWeights().second;
     double dMinWeight = tNetworkData.getMinMaxThresholdedWeights().first;
 
-    QList<NetworkEdge::SPtr> lNetworkEdges = tNetworkData.getThresholdedEdges();
-    QList<NetworkNode::SPtr> lNetworkNodes = tNetworkData.getNodes();
+    // Compact networks are plotted directly from their edge arrays without creating edge objects
+    bool bIsCompact = tNetworkData.isCompact();
+    const NetworkAdjacency& adjacency = tNetworkData.getAdjacency();
+
+    QList<NetworkEdge::SPtr> lNetworkEdges;
+    if(!bIsCompact) {
+        lNetworkEdges = tNetworkData.getThresholdedEdges();
+    }
+    MatrixX3f matNodeVert = tNetworkData.getNodeVertices();
+
+    int iNumberEdges = bIsCompact ? adjacency.getNumberEdges() : lNetworkEdges.size();
 
     VisualizationInfo visualizationInfo = tNetworkData.getVisualizationInfo();
 
@@ -370,58 +389,68 @@ void NetworkTreeItem::plotEdges(const Network &tNetworkData)
     double dWeight = 0.0;
     int iStartID, iEndID;
 
-    for(int i = 0; i < lNetworkEdges.size(); ++i) {
+    for(int i = 0; i < iNumberEdges; ++i) {
         //Plot in edges
-        NetworkEdge::SPtr pNetworkEdge = lNetworkEdges.at(i);
+        if(bIsCompact) {
+            if(!adjacency.getActiveEdges()(i)) {
+                continue;
+            }
+
+            iStartID = adjacency.getStartNodeIDs()(i);
+            iEndID = adjacency.getEndNodeIDs()(i);
+            dWeight = fabs(adjacency.getAveragedWeights()(i));
+        } else {
+            NetworkEdge::SPtr pNetworkEdge = lNetworkEdges.at(i);
+
+            if(!pNetworkEdge->isActive()) {
+                continue;
+            }
 
-        if(pNetworkEdge->isActive()) {
             iStartID = pNetworkEdge->getStartNodeID();
             iEndID = pNetworkEdge->getEndNodeID();
+            dWeight = fabs(pNetworkEdge->getWeight());
+        }
 
-            RowVectorXf vectorStart = lNetworkNodes.at(iStartID)->getVert();
-            startPos = QVector3D(vectorStart(0),
-                                 vectorStart(1),
-                                 vectorStart(2));
-
-            RowVectorXf vectorEnd = lNetworkNodes.at(iEndID)->getVert();
-            endPos = QVector3D(vectorEnd(0),
-                               vectorEnd(1),
-                               vectorEnd(2));
-
-            if(startPos != endPos) {
-                dWeight = fabs(pNetworkEdge->getWeight());
-                if(dWeight != 0.0) {
-                    diff = endPos - startPos;
-                    edgePos = endPos - diff/2;
-
-                    QMatrix4x4 tempTransform;
-                    tempTransform.translate(edgePos);
-                    tempTransform.rotate(QQuaternion::rotationTo(QVector3D(0,1,0), diff.normalized()).normalized());
-                    tempTransform.scale(fabs((dWeight-dMinWeight)/(dMaxWeight-dMinWeight)),diff.length(),fabs((dWeight-dMinWeight)/(dMaxWeight-dMinWeight)));
-                    //tempTransform.scale(pow(fabs(dWeight/dMaxWeight),4)*4,diff.length(),pow(fabs(dWeight/dMaxWeight),4)*4);
-
-                    vTransformsEdges.push_back(tempTransform);
-
-                    // Colors
-                    if(visualizationInfo.sMethod == "Map") {
-                        // Normalize colors
-                        if(dMaxWeight != 0.0f) {
-                            QColor color = ColorMap::valueToColor(fabs(dWeight/dMaxWeight), visualizationInfo.sColormap);
-                            color.setAlphaF(pow(fabs(dWeight/dMaxWeight),1.5));
-                            //qDebug() << "fabs(dWeight/dMaxWeight)"<< fabs(dWeight/dMaxWeight);
-                            //qDebug() << "color"<<color;
-                            vColorsEdges.push_back(color);
-                        } else {
-                            QColor color = ColorMap::valueToColor(0.0, visualizationInfo.sColormap);
-                            color.setAlphaF(0.0);
-                            vColorsEdges.push_back(color);
-                        }
+        startPos = QVector3D(matNodeVert(iStartID,0),
+                             matNodeVert(iStartID,1),
+                             matNodeVert(iStartID,2));
+
+        endPos = QVector3D(matNodeVert(iEndID,0),
+                           matNodeVert(iEndID,1),
+                           matNodeVert(iEndID,2));
+
+        if(startPos != endPos) {
+            if(dWeight != 0.0) {
+                diff = endPos - startPos;
+                edgePos = endPos - diff/2;
+
+                QMatrix4x4 tempTransform;
+                tempTransform.translate(edgePos);
+                tempTransform.rotate(QQuaternion::rotationTo(QVector3D(0,1,0), diff.normalized()).normalized());
+                tempTransform.scale(fabs((dWeight-dMinWeight)/(dMaxWeight-dMinWeight)),diff.length(),fabs((dWeight-dMinWeight)/(dMaxWeight-dMinWeight)));
+                //tempTransform.scale(pow(fabs(dWeight/dMaxWeight),4)*4,diff.length(),pow(fabs(dWeight/dMaxWeight),4)*4);
+
+                vTransformsEdges.push_back(tempTransform);
+
+                // Colors
+                if(visualizationInfo.sMethod == "Map") {
+                    // Normalize colors
+                    if(dMaxWeight != 0.0f) {
+                        QColor color = ColorMap::valueToColor(fabs(dWeight/dMaxWeight), visualizationInfo.sColormap);
+                        color.setAlphaF(pow(fabs(dWeight/dMaxWeight),1.5));
+                        //qDebug() << "fabs(dWeight/dMaxWeight)"<< fabs(dWeight/dMaxWeight);
+                        //qDebug() << "color"<<color;
+                        vColorsEdges.push_back(color);
                     } else {
-                        vColorsEdges.push_back(QColor(visualizationInfo.colNodes[0],
-                                                      visualizationInfo.colNodes[1],
-                                                      visualizationInfo.colNodes[2],
-                                                      visualizationInfo.colNodes[3]));
+                        QColor color = ColorMap::valueToColor(0.0, visualizationInfo.sColormap);
+                        color.setAlphaF(0.0);
+                        vColorsEdges.push_back(color);
                     }
+                } else {
+                    vColorsEdges.push_back(QColor(visualizationInfo.colNodes[0],
+                                                  visualizationInfo.colNodes[1],
+                                                  visualizationInfo.colNodes[2],
+                                                  visualizationInfo.colNodes[3]));
                 }
             }
         }
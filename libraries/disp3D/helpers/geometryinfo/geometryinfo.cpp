@@ -45,9 +45,13 @@
 // INCLUDES
 //=============================================================================================================
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <functional>
+#include <queue>
 #include <set>
+#include <vector>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -67,6 +71,12 @@ using namespace DISP3DLIB;
 using namespace Eigen;
 using namespace FIFFLIB;
 
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define KD_TREE_TOL 1e-9    /**< Relative slack of the split plane distance against rounding errors */
+
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
@@ -147,11 +157,81 @@ QSharedPointer<MatrixXd> GeometryInfo::scdc(const MatrixX3f &matVertices,
 
 //=============================================================================================================
 
+QSharedPointer<SparseMatrix<double> > GeometryInfo::scdcSparse(const MatrixX3f &matVertices,
+                                                               const QVector<QVector<int> > &vecNeighborVertices,
+                                                               QVector<int> &vecVertSubset,
+                                                               double dCancelDist)
+{
+    // check for empty subset:
+    if(vecVertSubset.empty()) {
+        // caller passed an empty subset, need to fill in all vertex IDs
+        vecVertSubset.reserve(matVertices.rows());
+        for(qint32 id = 0; id < matVertices.rows(); ++id) {
+            vecVertSubset.push_back(id);
+        }
+    }
+
+    // convention: first dimension in distance table is "from", second dimension "to"
+    QSharedPointer<SparseMatrix<double> > returnMat = QSharedPointer<SparseMatrix<double> >::create(matVertices.rows(), vecVertSubset.size());
+
+    // distribute calculation on cores
+    int iCores = QThread::idealThreadCount();
+    if (iCores <= 0) {
+        // assume that we have at least two available cores
+        iCores = 2;
+    }
+
+    // start threads with their respective parts of the final subset
+    qint32 iSubArraySize = int(double(vecVertSubset.size()) / double(iCores));
+    QVector<QFuture<QVector<Triplet<double> > > > vecThreads(iCores);
+    qint32 iBegin = 0;
+    qint32 iEnd = iSubArraySize;
+
+    for (int i = 0; i < vecThreads.size(); ++i) {
+        //last round
+        if(i == vecThreads.size()-1)
+        {
+            iEnd = vecVertSubset.size();
+        }
+
+        vecThreads[i] = QtConcurrent::run(std::bind(boundedDijkstra,
+                                                    std::cref(matVertices),
+                                                    std::cref(vecNeighborVertices),
+                                                    std::cref(vecVertSubset),
+                                                    iBegin,
+                                                    iEnd,
+                                                    dCancelDist));
+        iBegin += iSubArraySize;
+        iEnd += iSubArraySize;
+    }
+
+    // wait for all threads to finish and collect the triplets
+    std::vector<Triplet<double> > vecNonZeroEntries;
+    for (QFuture<QVector<Triplet<double> > >& f : vecThreads) {
+        const QVector<Triplet<double> > vecTriplets = f.result();
+        vecNonZeroEntries.insert(vecNonZeroEntries.end(), vecTriplets.constBegin(), vecTriplets.constEnd());
+    }
+
+    returnMat->setFromTriplets(vecNonZeroEntries.begin(), vecNonZeroEntries.end());
+
+    return returnMat;
+}
+
+//=============================================================================================================
+
 QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
                                           const QVector<Vector3f> &vecSensorPositions)
 {
     QVector<int> vecOutputArray;
 
+    // build the k-d tree once, all sensors are looked up in it
+    QVector<int> vecKdTree(matVertices.rows());
+    for(qint32 i = 0; i < vecKdTree.size(); ++i)
+    {
+        vecKdTree[i] = i;
+    }
+    buildKdTree(matVertices, vecKdTree, 0, vecKdTree.size(), 0);
+
     qint32 iCores = QThread::idealThreadCount();
     if (iCores <= 0)
     {
@@ -165,6 +245,7 @@ QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
     if(iSubArraySize <= 1)
     {
         vecOutputArray.append(nearestNeighbor(matVertices,
+                                              vecKdTree,
                                               vecSensorPositions.constBegin(),
                                               vecSensorPositions.constEnd()));
         return vecOutputArray;
@@ -181,6 +262,7 @@ QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
         {
             vecThreads[i] = QtConcurrent::run(nearestNeighbor,
                                               matVertices,
+                                              vecKdTree,
                                               vecSensorPositions.constBegin() + iBeginOffset,
                                               vecSensorPositions.constEnd());
             break;
@@ -189,6 +271,7 @@ QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
         {
             vecThreads[i] = QtConcurrent::run(nearestNeighbor,
                                               matVertices,
+                                              vecKdTree,
                                               vecSensorPositions.constBegin() + iBeginOffset,
                                               vecSensorPositions.constBegin() + iEndOffset);
             iBeginOffset = iEndOffset;
@@ -212,31 +295,99 @@ QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
 
 //=============================================================================================================
 
+void GeometryInfo::buildKdTree(const MatrixX3f &matVertices,
+                               QVector<int> &vecKdTree,
+                               qint32 iBegin,
+                               qint32 iEnd,
+                               qint32 iDepth)
+{
+    if(iEnd - iBegin <= 1)
+    {
+        return;
+    }
+
+    // place the median along the split axis in the middle, smaller coordinates left and larger ones right of it
+    const qint32 iAxis = iDepth % 3;
+    const qint32 iMid = iBegin + (iEnd - iBegin) / 2;
+    std::nth_element(vecKdTree.begin() + iBegin,
+                     vecKdTree.begin() + iMid,
+                     vecKdTree.begin() + iEnd,
+                     [&matVertices, iAxis](int iVertA, int iVertB) {
+        const float fA = matVertices(iVertA, iAxis);
+        const float fB = matVertices(iVertB, iAxis);
+        return (fA < fB) || (fA == fB && iVertA < iVertB);
+    });
+
+    buildKdTree(matVertices, vecKdTree, iBegin, iMid, iDepth + 1);
+    buildKdTree(matVertices, vecKdTree, iMid + 1, iEnd, iDepth + 1);
+}
+
+//=============================================================================================================
+
+void GeometryInfo::searchKdTree(const MatrixX3f &matVertices,
+                                const QVector<int> &vecKdTree,
+                                const Vector3f &vecPosition,
+                                qint32 iBegin,
+                                qint32 iEnd,
+                                qint32 iDepth,
+                                qint32 &iChampionId,
+                                double &dChampDist)
+{
+    if(iBegin >= iEnd)
+    {
+        return;
+    }
+
+    const qint32 iAxis = iDepth % 3;
+    const qint32 iMid = iBegin + (iEnd - iBegin) / 2;
+    const qint32 iVert = vecKdTree[iMid];
+
+    //calculate 3d euclidian distance
+    const double dDist = sqrt(squared(matVertices(iVert, 0) - vecPosition[0])  // x-cord
+                              + squared(matVertices(iVert, 1) - vecPosition[1])    // y-cord
+                              + squared(matVertices(iVert, 2) - vecPosition[2]));  // z-cord
+    if(dDist < dChampDist || (dDist == dChampDist && iVert < iChampionId))
+    {
+        iChampionId = iVert;
+        dChampDist = dDist;
+    }
+
+    // descend into the side of the split plane the position lies on first
+    const double dPlaneDist = vecPosition[iAxis] - matVertices(iVert, iAxis);
+    if(dPlaneDist < 0.0)
+    {
+        searchKdTree(matVertices, vecKdTree, vecPosition, iBegin, iMid, iDepth + 1, iChampionId, dChampDist);
+        if(-dPlaneDist * (1.0 - KD_TREE_TOL) <= dChampDist)
+        {
+            searchKdTree(matVertices, vecKdTree, vecPosition, iMid + 1, iEnd, iDepth + 1, iChampionId, dChampDist);
+        }
+    }
+    else
+    {
+        searchKdTree(matVertices, vecKdTree, vecPosition, iMid + 1, iEnd, iDepth + 1, iChampionId, dChampDist);
+        if(dPlaneDist * (1.0 - KD_TREE_TOL) <= dChampDist)
+        {
+            searchKdTree(matVertices, vecKdTree, vecPosition, iBegin, iMid, iDepth + 1, iChampionId, dChampDist);
+        }
+    }
+}
+
+//=============================================================================================================
+
 QVector<int> GeometryInfo::nearestNeighbor(const MatrixX3f &matVertices,
+                                           const QVector<int> &vecKdTree,
                                            QVector<Vector3f>::const_iterator itSensorBegin,
                                            QVector<Vector3f>::const_iterator itSensorEnd)
 {
-    //lin search sensor positions
+    //k-d tree search sensor positions
     QVector<int> vecMappedSensors;
     vecMappedSensors.reserve(std::distance(itSensorBegin, itSensorEnd));
-int u =0;
+
     for(auto sensor = itSensorBegin; sensor != itSensorEnd; ++sensor)
     {
-        qint32 iChampionId;
-        double iChampDist = std::numeric_limits<double>::max();
-        for(qint32 i = 0; i < matVertices.rows(); ++i)
-        {
-            //calculate 3d euclidian distance
-            double dDist = sqrt(squared(matVertices(i, 0) - (*sensor)[0])  // x-cord
-                                + squared(matVertices(i, 1) - (*sensor)[1])    // y-cord
-                                + squared(matVertices(i, 2) - (*sensor)[2]));  // z-cord
-            if(dDist < iChampDist)
-            {
-                iChampionId = i;
-                iChampDist = dDist;
-            }
-        }
-       // qDebug() << "[GeometryInfo::nearestNeighbor] u" << u++;
+        qint32 iChampionId = -1;
+        double dChampDist = std::numeric_limits<double>::max();
+        searchKdTree(matVertices, vecKdTree, *sensor, 0, vecKdTree.size(), 0, iChampionId, dChampDist);
         vecMappedSensors.push_back(iChampionId);
     }
 
@@ -311,6 +462,79 @@ void GeometryInfo::iterativeDijkstra(QSharedPointer<MatrixXd> matOutputDistMatri
 
 //=============================================================================================================
 
+QVector<Triplet<double> > GeometryInfo::boundedDijkstra(const MatrixX3f &matVertices,
+                                                        const QVector<QVector<int> > &vecNeighborVertices,
+                                                        const QVector<int> &vecVertSubset,
+                                                        qint32 iBegin,
+                                                        qint32 iEnd,
+                                                        double dCancelDistance)
+{
+    // initialization
+    const QVector<QVector<int> > &vecAdjacency = vecNeighborVertices;
+    qint32 n = vecAdjacency.size();
+    QVector<double> vecMinDists(n, FLOAT_INFINITY);
+    QVector<qint32> vecTouched;
+    QVector<Triplet<double> > vecTriplets;
+    typedef std::pair<double, qint32> DistVertex;
+
+    // outer loop, iterated for each vertex of 'vertSubset' between 'begin' and 'end'
+    for (qint32 i = iBegin; i < iEnd; ++i) {
+        // queue with lazy deletion: outdated entries are skipped when they are removed
+        std::priority_queue<DistVertex, std::vector<DistVertex>, std::greater<DistVertex> > vertexQ;
+        qint32 iRoot = vecVertSubset.at(i);
+        vecMinDists[iRoot] = 0.0;
+        vecTouched.push_back(iRoot);
+        vertexQ.push(std::make_pair(0.0, iRoot));
+
+        // dijkstra main loop
+        while (vertexQ.empty() == false) {
+            // remove next vertex from queue
+            const double dDist = vertexQ.top().first;
+            const qint32 u = vertexQ.top().second;
+            vertexQ.pop();
+
+            if (dDist > vecMinDists[u]) {
+                continue;
+            }
+
+            // the distance of u is final
+            vecTriplets.push_back(Triplet<double>(u, i, dDist));
+
+            // visit each neighbour of u
+            const QVector<int>& vecNeighbours = vecAdjacency[u];
+
+            for (qint32 ne = 0; ne < vecNeighbours.length(); ++ne) {
+                qint32 v = vecNeighbours[ne];
+
+                // distance from source (i.e. root) to v, using u as its predecessor
+                const double dDistX = matVertices(u, 0) - matVertices(v, 0);
+                const double dDistY = matVertices(u, 1) - matVertices(v, 1);
+                const double dDistZ = matVertices(u, 2) - matVertices(v, 2);
+                const double dDistWithU = dDist + sqrt(dDistX * dDistX + dDistY * dDistY + dDistZ * dDistZ);
+
+                // vertices beyond the cancel distance are never queued
+                if (dDistWithU < vecMinDists[v] && dDistWithU <= dCancelDistance) {
+                    if (vecMinDists[v] == FLOAT_INFINITY) {
+                        vecTouched.push_back(v);
+                    }
+                    vecMinDists[v] = dDistWithU;
+                    vertexQ.push(std::make_pair(dDistWithU, v));
+                }
+            }
+        }
+
+        // reset only the vertices this root reached
+        for (qint32 v : vecTouched) {
+            vecMinDists[v] = FLOAT_INFINITY;
+        }
+        vecTouched.clear();
+    }
+
+    return vecTriplets;
+}
+
+//=============================================================================================================
+
 QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<Eigen::MatrixXd> matDistanceTable,
                                                 const FIFFLIB::FiffInfo& fiffInfo,
                                                 qint32 iSensorType) {
@@ -339,3 +563,35 @@ QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<Eigen::MatrixXd> mat
     }
     return vecBadColumns;
 }
+
+//=============================================================================================================
+
+QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<Eigen::SparseMatrix<double> > matDistanceTable,
+                                             const FIFFLIB::FiffInfo& fiffInfo,
+                                             qint32 iSensorType) {
+    // use pointer to avoid copying of FiffChInfo objects
+    QVector<int> vecBadColumns;
+    QVector<const FiffChInfo*> vecSensors;
+    for(const FiffChInfo& s : fiffInfo.chs){
+        //Only take EEG with V as unit or MEG magnetometers with T as unit
+        if(s.kind == iSensorType && (s.unit == FIFF_UNIT_T || s.unit == FIFF_UNIT_V)){
+           vecSensors.push_back(&s);
+        }
+    }
+
+    for(const QString& b : fiffInfo.bads){
+        for(int col = 0; col < vecSensors.size(); ++col){
+            if(vecSensors[col]->ch_name == b){
+                vecBadColumns.push_back(col);
+                break;
+            }
+        }
+    }
+
+    // missing entries are infinite distances, so the whole column of a bad channel is removed
+    matDistanceTable->prune([&vecBadColumns](const Index&, const Index& col, const double&) {
+        return !vecBadColumns.contains(static_cast<int>(col));
+    });
+
+    return vecBadColumns;
+}
@@ -60,6 +60,7 @@
 //=============================================================================================================
 
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 
 //=============================================================================================================
 // FORWARD DECLARATIONS
@@ -121,6 +122,26 @@ public:
                                                 QVector<int> &pVecVertSubset,
                                                 double dCancelDist = FLOAT_INFINITY);
 
+    //=========================================================================================================
+    /**
+     * @brief scdcSparse                     Calculates surface constrained distances on a mesh up to a cancel distance.
+     *                                       In contrast to scdc only the distances below the cancel distance are
+     *                                       stored, so the memory grows with the number of vertices within reach
+     *                                       instead of vertices x subset.
+     *
+     * @param[in] matVertices                The surface on which distances should be calculated.
+     * @param[in] vecNeighborVertices        The neighbor vertex information.
+     * @param[in/out] pVecVertSubset         The subset of IDs for which the distances should be calculated.
+     * @param[in] dCancelDist                Distances higher than this are not stored.
+     *
+     * @return                               A sparse double matrix. One column holds the distances for one vertex inside of the passed subset,
+     *                                       missing entries correspond to infinite distances
+     */
+    static QSharedPointer<Eigen::SparseMatrix<double> > scdcSparse(const Eigen::MatrixX3f &matVertices,
+                                                                   const QVector<QVector<int> > &vecNeighborVertices,
+                                                                   QVector<int> &pVecVertSubset,
+                                                                   double dCancelDist = FLOAT_INFINITY);
+
     //=========================================================================================================
     /**
      * @brief                            Calculates the nearest neighbor (euclidian distance) vertex to each sensor
@@ -148,6 +169,20 @@ public:
                                           const FIFFLIB::FiffInfo& fiffInfo,
                                           qint32 iSensorType);
 
+    //=========================================================================================================
+    /**
+     * @brief filterBadChannels          Filters bad channels from a sparse distance table, i.e. removes all entries of their columns
+     *
+     * @param[out] matDistanceTable      Result of scdcSparse.
+     * @param[in] fiffInfo               Container for sensors.
+     * @param[in] iSensorType            Sensor type to be filtered out, use fiff constants.
+     *
+     * @return Vector of bad channel indices.
+     */
+    static QVector<int> filterBadChannels(QSharedPointer<Eigen::SparseMatrix<double> > matDistanceTable,
+                                          const FIFFLIB::FiffInfo& fiffInfo,
+                                          qint32 iSensorType);
+
 protected:
     //=========================================================================================================
     /**
@@ -159,17 +194,59 @@ protected:
      */
     static inline  double squared(double dBase);
 
+    //=========================================================================================================
+    /**
+     * @brief buildKdTree            Orders the vertex IDs as an implicit, balanced k-d tree: the median of each range
+     *                               along the split axis (x, y, z alternating with depth) is stored in the middle of the range
+     *
+     * @param[in] matVertices        The vertex positions
+     * @param[in/out] vecKdTree      The vertex IDs, reordered in place
+     * @param[in] iBegin             Start of the range
+     * @param[in] iEnd               End of the range, exclusive
+     * @param[in] iDepth             Depth of the range in the tree
+     */
+    static void buildKdTree(const Eigen::MatrixX3f &matVertices,
+                            QVector<int> &vecKdTree,
+                            qint32 iBegin,
+                            qint32 iEnd,
+                            qint32 iDepth);
+
+    //=========================================================================================================
+    /**
+     * @brief searchKdTree           Searches the nearest vertex to a position in the k-d tree. Equally close vertices are
+     *                               resolved in favor of the lowest vertex ID, as the linear search does.
+     *
+     * @param[in] matVertices        The vertex positions
+     * @param[in] vecKdTree          The k-d tree created by buildKdTree
+     * @param[in] vecPosition        The position to search for
+     * @param[in] iBegin             Start of the range
+     * @param[in] iEnd               End of the range, exclusive
+     * @param[in] iDepth             Depth of the range in the tree
+     * @param[in/out] iChampionId    The nearest vertex found so far, -1 if none
+     * @param[in/out] dChampDist     The distance of the nearest vertex found so far
+     */
+    static void searchKdTree(const Eigen::MatrixX3f &matVertices,
+                             const QVector<int> &vecKdTree,
+                             const Eigen::Vector3f &vecPosition,
+                             qint32 iBegin,
+                             qint32 iEnd,
+                             qint32 iDepth,
+                             qint32 &iChampionId,
+                             double &dChampDist);
+
     //=========================================================================================================
     /**
      * @brief nearestNeighbor        Calculates the nearest vertex of an MNEmatVertices for each position between the two iterators
      *
      * @param[in] matVertices        The MNEmatVertices that holds the vertex information
+     * @param[in] vecKdTree          The k-d tree over the vertices created by buildKdTree
      * @param[in] itSensorBegin      The iterator that indicates the start of the wanted section of positions
      * @param[in] itSensorEnd        The iterator that indicates the end of the wanted section of positions
      *
      * @return                       A vector of nearest vertex IDs that corresponds to the subvector between the two iterators
      */
     static QVector<int> nearestNeighbor(const Eigen::MatrixX3f &matVertices,
+                                        const QVector<int> &vecKdTree,
                                         QVector<Eigen::Vector3f>::const_iterator itSensorBegin,
                                         QVector<Eigen::Vector3f>::const_iterator itSensorEnd);
 
@@ -192,6 +269,27 @@ protected:
                                   qint32 iBegin,
                                   qint32 iEnd,
                                   double dCancelDistance);
+
+    //=========================================================================================================
+    /**
+     * @brief boundedDijkstra       Calculates shortest distances on the mesh for each vertex of the passed vector that lies between the two indices.
+     *                              The search of each root stops at the cancel distance, only the visited vertices are touched.
+     *
+     * @param[in] matVertices           The surface on which distances should be calculated
+     * @param[in] vecNeighborVertices   The neighbor vertex information.
+     * @param[in] vecVertSubset         The subset of vertices
+     * @param[in] iBegin                Start index of distance calculation
+     * @param[in] iEnd                  End index of distance calculation, exclusive
+     * @param[in] dCancelDistance       Distance threshold: only vertices within this distance to the respective root vertex are returned
+     *
+     * @return                          The (vertex, subset index, distance) triplets
+     */
+    static QVector<Eigen::Triplet<double> > boundedDijkstra(const Eigen::MatrixX3f &matVertices,
+                                                            const QVector<QVector<int> > &vecNeighborVertices,
+                                                            const QVector<int> &vecVertSubset,
+                                                            qint32 iBegin,
+                                                            qint32 iEnd,
+                                                            double dCancelDistance);
 };
 
 //=============================================================================================================
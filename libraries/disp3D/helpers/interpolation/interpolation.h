@@ -121,6 +121,25 @@ public:
                                                                               const double dCancelDist = FLOAT_INFINITY,
                                                                               const QVector<int> &vecExcludeIndex = QVector<int>());
 
+    //=========================================================================================================
+    /**
+     * Calculates the weight matrix like createInterpolationMat, but from a sparse distance table (see GeometryInfo::scdcSparse).
+     * Missing entries of the distance table are treated as infinite distances.
+     *
+     * @param[in] vecProjectedSensors           Vector of IDs of sensor vertices
+     * @param[in] matDistanceTable              Sparse matrix that contains all needed distances
+     * @param[in] interpolationFunction         Function that computes interpolation coefficients using the distance values
+     * @param[in] dCancelDist                   Distances higher than this are ignored, i.e. the respective coefficients are set to zero
+     * @param[in] vecExcludeIndex               The indices to be excluded from vecProjectedSensors, e.g., bad channels (empty by default)
+     *
+     * @return                                  The distance matrix created
+     */
+    static QSharedPointer<Eigen::SparseMatrix<float> > createInterpolationMat(const QVector<int> &vecProjectedSensors,
+                                                                              const QSharedPointer<Eigen::SparseMatrix<double> > matDistanceTable,
+                                                                              double (*interpolationFunction) (double),
+                                                                              const double dCancelDist = FLOAT_INFINITY,
+                                                                              const QVector<int> &vecExcludeIndex = QVector<int>());
+
     //=========================================================================================================
     /**
      * The interpolation essentially corresponds to a matrix * vector multiplication. A vector of sensor data (i.e. a vector of double-values)
@@ -275,7 +275,7 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
         //
         //  Do we need this buffer
         //
-        if (thisRawDir.last > from)
+        if (thisRawDir.last >= from)
         {
             if (thisRawDir.ent->kind == -1)
             {
@@ -608,7 +608,7 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
         //
         //  Do we need this buffer
         //
-        if (thisRawDir.last > from)
+        if (thisRawDir.last >= from)
         {
             if (thisRawDir.ent->kind == -1)
             {
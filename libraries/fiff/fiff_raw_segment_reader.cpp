@@ -0,0 +1,467 @@
+//=============================================================================================================
+/**
+ * @file     fiff_raw_segment_reader.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    FiffRawSegmentReader class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_segment_reader.h"
+#include "fiff_raw_data.h"
+#include "fiff_tag.h"
+#include "fiff_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+namespace {
+
+template<typename T>
+inline double decodeValue(const char* pSrc, bool bSwap)
+{
+    T value;
+
+    if(bSwap) {
+        char bytes[sizeof(T)];
+        for(size_t i = 0; i < sizeof(T); ++i) {
+            bytes[i] = pSrc[sizeof(T) - 1 - i];
+        }
+        std::memcpy(&value, bytes, sizeof(T));
+    } else {
+        std::memcpy(&value, pSrc, sizeof(T));
+    }
+
+    return static_cast<double>(value);
+}
+
+//=============================================================================================================
+
+template<typename T>
+void decodePicked(const char* pBuffer,
+                  int iNChan,
+                  int iNSamp,
+                  const VectorXi& vecRows,
+                  const VectorXd& vecScale,
+                  bool bSwap,
+                  double* pDest,
+                  int iDestStride)
+{
+    const int iNRows = vecRows.size();
+
+    for(int c = 0; c < iNSamp; ++c) {
+        const char* pColumn = pBuffer + static_cast<size_t>(c) * iNChan * sizeof(T);
+        double* pOut = pDest + static_cast<size_t>(c) * iDestStride;
+
+        for(int r = 0; r < iNRows; ++r) {
+            pOut[r] = vecScale[r] * decodeValue<T>(pColumn + static_cast<size_t>(vecRows[r]) * sizeof(T), bSwap);
+        }
+    }
+}
+
+//=============================================================================================================
+
+template<typename T>
+void decodeAll(const char* pBuffer,
+               qint64 iCount,
+               bool bSwap,
+               double* pDest)
+{
+    for(qint64 i = 0; i < iCount; ++i) {
+        pDest[i] = decodeValue<T>(pBuffer + i * sizeof(T), bSwap);
+    }
+}
+
+//=============================================================================================================
+
+inline bool isSame(const MatrixXd& matA, const MatrixXd& matB)
+{
+    return matA.rows() == matB.rows() && matA.cols() == matB.cols() && (matA.size() == 0 || matA == matB);
+}
+
+} // anonymous namespace
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawSegmentReader::FiffRawSegmentReader(const FiffRawData& p_FiffRawData)
+: m_rawData(p_FiffRawData)
+, m_bProjectorValid(false)
+, m_bUseMult(false)
+, m_iCompKindKey(-1)
+{
+    updateIndex();
+}
+
+//=============================================================================================================
+
+void FiffRawSegmentReader::updateIndex()
+{
+    m_vecBufferLast.resize(m_rawData.rawdir.size());
+
+    for(int k = 0; k < m_rawData.rawdir.size(); ++k) {
+        m_vecBufferLast[k] = m_rawData.rawdir[k].last;
+    }
+}
+
+//=============================================================================================================
+
+int FiffRawSegmentReader::findBuffer(fiff_int_t iSample) const
+{
+    if(iSample < m_rawData.first_samp || iSample > m_rawData.last_samp) {
+        return -1;
+    }
+
+    // The buffers are stored in ascending order, find the first one which ends at or after iSample
+    QVector<fiff_int_t>::const_iterator it = std::lower_bound(m_vecBufferLast.constBegin(),
+                                                              m_vecBufferLast.constEnd(),
+                                                              iSample);
+
+    if(it == m_vecBufferLast.constEnd()) {
+        return -1;
+    }
+
+    return static_cast<int>(it - m_vecBufferLast.constBegin());
+}
+
+//=============================================================================================================
+
+bool FiffRawSegmentReader::read_raw_segment(MatrixXd& data,
+                                            MatrixXd& times,
+                                            fiff_int_t from,
+                                            fiff_int_t to,
+                                            const RowVectorXi& sel)
+{
+    if(from == -1)
+        from = m_rawData.first_samp;
+    if(to == -1)
+        to = m_rawData.last_samp;
+    //
+    //  Initial checks
+    //
+    if(from < m_rawData.first_samp)
+        from = m_rawData.first_samp;
+    if(to > m_rawData.last_samp)
+        to = m_rawData.last_samp;
+    //
+    if(from > to)
+    {
+        printf("No data in this range %d ... %d  =  %9.3f ... %9.3f secs...", from, to, ((float)from)/m_rawData.info.sfreq, ((float)to)/m_rawData.info.sfreq);
+        return false;
+    }
+
+    if(m_vecBufferLast.size() != m_rawData.rawdir.size()) {
+        updateIndex();
+    }
+
+    updateProjector(sel);
+
+    const fiff_int_t iNSamp = to - from + 1;
+    const int iNRows = m_bUseMult ? static_cast<int>(m_matMult.rows()) : static_cast<int>(m_vecPickRows.size());
+
+    // Reuses the memory of data if the size did not change
+    data.resize(iNRows, iNSamp);
+
+    //
+    //  A memory-mapped stream is read without the device
+    //
+    QIODevice* pDevice = m_rawData.file->device();
+    if(!m_rawData.file->isMapped() && !pDevice->isOpen()) {
+        if(!pDevice->open(QIODevice::ReadOnly)) {
+            printf("Cannot open file %s",m_rawData.info.filename.toUtf8().constData());
+            return false;
+        }
+    }
+
+    fiff_int_t dest = 0;
+
+    for(int k = findBuffer(from); k >= 0 && k < m_rawData.rawdir.size() && dest < iNSamp; ++k) {
+        const FiffRawDir& thisRawDir = m_rawData.rawdir[k];
+
+        const fiff_int_t first_pick = std::max(from - thisRawDir.first, 0);
+        const fiff_int_t last_pick = std::min(to, thisRawDir.last) - thisRawDir.first;
+        const fiff_int_t picksamp = last_pick - first_pick + 1;
+
+        if(picksamp <= 0) {
+            continue;
+        }
+
+        if(!thisRawDir.ent || thisRawDir.ent->kind == -1) {
+            //
+            //  Take the easy route: skip is translated to zeros
+            //
+            data.middleCols(dest, picksamp).setZero();
+        } else if(!readBuffer(k, first_pick, picksamp, data, dest)) {
+            return false;
+        }
+
+        dest += picksamp;
+    }
+
+    if(dest != iNSamp) {
+        qWarning() << "[FiffRawSegmentReader::read_raw_segment] Raw directory does not cover the requested range. Read" << dest << "of" << iNSamp << "samples.";
+        data.rightCols(iNSamp - dest).setZero();
+    }
+
+    times.resize(1, iNSamp);
+
+    for(fiff_int_t i = 0; i < iNSamp; ++i) {
+        times(0, i) = ((float)(from+i)) / m_rawData.info.sfreq;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+bool FiffRawSegmentReader::read_raw_segment(MatrixXd& data,
+                                            MatrixXd& times,
+                                            SparseMatrix<double>& multSegment,
+                                            fiff_int_t from,
+                                            fiff_int_t to,
+                                            const RowVectorXi& sel)
+{
+    if(!read_raw_segment(data, times, from, to, sel)) {
+        return false;
+    }
+
+    if(m_bUseMult) {
+        multSegment = m_matMult;
+    } else {
+        multSegment = m_matCal;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+void FiffRawSegmentReader::updateProjector(const RowVectorXi& sel)
+{
+    const FiffCtfComp& comp = m_rawData.comp;
+
+    if(m_bProjectorValid
+       && m_iCompKindKey == comp.kind
+       && isSame(m_matProjKey, m_rawData.proj)
+       && (comp.kind == -1 || isSame(m_matCompKey, comp.data->data))
+       && m_vecCalsKey.size() == m_rawData.cals.size() && m_vecCalsKey == m_rawData.cals
+       && m_vecSelKey.size() == sel.size() && m_vecSelKey == sel) {
+        return;
+    }
+
+    m_matProjKey = m_rawData.proj;
+    m_iCompKindKey = comp.kind;
+    m_matCompKey = comp.kind == -1 ? MatrixXd() : comp.data->data;
+    m_vecCalsKey = m_rawData.cals;
+    m_vecSelKey = sel;
+
+    const int nchan = m_rawData.info.nchan;
+    const bool projAvailable = m_rawData.proj.size() != 0;
+
+    //
+    //  Output row to file channel mapping and calibration
+    //
+    if(sel.size() == 0) {
+        m_vecPickRows = VectorXi::LinSpaced(nchan, 0, nchan - 1);
+    } else {
+        m_vecPickRows = sel.transpose();
+    }
+
+    m_vecPickCals.resize(m_vecPickRows.size());
+    for(int r = 0; r < m_vecPickRows.size(); ++r) {
+        m_vecPickCals[r] = m_rawData.cals[m_vecPickRows[r]];
+    }
+
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+    tripletList.reserve(m_vecPickRows.size());
+    for(int r = 0; r < m_vecPickRows.size(); ++r) {
+        tripletList.push_back(T(r, r, m_vecPickCals[r]));
+    }
+    m_matCal = SparseMatrix<double>(m_vecPickRows.size(), m_vecPickRows.size());
+    m_matCal.setFromTriplets(tripletList.begin(), tripletList.end());
+
+    //
+    //  Compose the full multiplication matrix: proj * comp * cal, restricted to the selected rows
+    //
+    m_bUseMult = projAvailable || comp.kind != -1;
+
+    if(m_bUseMult) {
+        MatrixXd matMultFull;
+
+        if(comp.kind != -1) {
+            matMultFull = projAvailable ? MatrixXd(m_rawData.proj * comp.data->data) : comp.data->data;
+        } else {
+            matMultFull = m_rawData.proj;
+        }
+
+        if(sel.size() > 0) {
+            MatrixXd matSel(sel.size(), nchan);
+            for(int r = 0; r < sel.size(); ++r) {
+                matSel.row(r) = matMultFull.row(sel[r]);
+            }
+            matMultFull = matSel;
+        }
+
+        matMultFull = matMultFull * m_rawData.cals.asDiagonal();
+
+        m_matMult = matMultFull.sparseView();
+        m_matMult.makeCompressed();
+    } else {
+        m_matMult = SparseMatrix<double>();
+    }
+
+    m_bProjectorValid = true;
+}
+
+//=============================================================================================================
+
+bool FiffRawSegmentReader::readBuffer(int iBuffer,
+                                      fiff_int_t iFirstPick,
+                                      fiff_int_t iPickSamp,
+                                      MatrixXd& data,
+                                      fiff_int_t iDest)
+{
+    const FiffRawDir& thisRawDir = m_rawData.rawdir[iBuffer];
+    const int nchan = m_rawData.info.nchan;
+    const fiff_int_t type = thisRawDir.ent->type;
+
+    qint64 iValueSize = 0;
+
+    switch(type) {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            iValueSize = 2;
+            break;
+        case FIFFT_INT:
+        case FIFFT_FLOAT:
+            iValueSize = 4;
+            break;
+        default:
+            printf("Data Storage Format not known yet!! Type: %d\n", type);
+            return false;
+    }
+
+    //
+    //  Read only the requested samples of the buffer
+    //
+    const qint64 iOffset = thisRawDir.ent->pos + FIFFC_DATA_OFFSET + static_cast<qint64>(iFirstPick) * nchan * iValueSize;
+    const qint64 iBytes = static_cast<qint64>(iPickSamp) * nchan * iValueSize;
+
+    //
+    //  Decode straight from the mapped file if possible, otherwise read into the reused byte buffer
+    //
+    const char* pBuffer = m_rawData.file->mapped_data(iOffset, iBytes);
+
+    if(!pBuffer) {
+        if(m_baBuffer.size() < iBytes) {
+            m_baBuffer.resize(iBytes);
+        }
+
+        QIODevice* pDevice = m_rawData.file->device();
+
+        if(!pDevice->seek(iOffset) || pDevice->read(m_baBuffer.data(), iBytes) != iBytes) {
+            qWarning() << "[FiffRawSegmentReader::readBuffer] Could not read buffer" << iBuffer << "from" << m_rawData.info.filename;
+            return false;
+        }
+
+        pBuffer = m_baBuffer.constData();
+    }
+
+    const int iFileEndian = m_rawData.file->is_file_little_endian() ? FIFFV_LITTLE_ENDIAN : FIFFV_BIG_ENDIAN;
+    const bool bSwap = iFileEndian != NATIVE_ENDIAN;
+
+    if(!m_bUseMult) {
+        //
+        //  Picking and calibration are fused into the decode, write straight into the output
+        //
+        double* pDest = data.data() + static_cast<size_t>(iDest) * data.rows();
+
+        switch(type) {
+            case FIFFT_DAU_PACK16:
+                decodePicked<fiff_dau_pack16_t>(pBuffer, nchan, iPickSamp, m_vecPickRows, m_vecPickCals, bSwap, pDest, data.rows());
+                break;
+            case FIFFT_SHORT:
+                decodePicked<fiff_short_t>(pBuffer, nchan, iPickSamp, m_vecPickRows, m_vecPickCals, bSwap, pDest, data.rows());
+                break;
+            case FIFFT_INT:
+                decodePicked<fiff_int_t>(pBuffer, nchan, iPickSamp, m_vecPickRows, m_vecPickCals, bSwap, pDest, data.rows());
+                break;
+            case FIFFT_FLOAT:
+                decodePicked<fiff_float_t>(pBuffer, nchan, iPickSamp, m_vecPickRows, m_vecPickCals, bSwap, pDest, data.rows());
+                break;
+        }
+    } else {
+        //
+        //  Decode into the reused work buffer and apply the cached projector
+        //
+        m_matWork.resize(nchan, iPickSamp);
+        const qint64 iCount = static_cast<qint64>(iPickSamp) * nchan;
+
+        switch(type) {
+            case FIFFT_DAU_PACK16:
+                decodeAll<fiff_dau_pack16_t>(pBuffer, iCount, bSwap, m_matWork.data());
+                break;
+            case FIFFT_SHORT:
+                decodeAll<fiff_short_t>(pBuffer, iCount, bSwap, m_matWork.data());
+                break;
+            case FIFFT_INT:
+                decodeAll<fiff_int_t>(pBuffer, iCount, bSwap, m_matWork.data());
+                break;
+            case FIFFT_FLOAT:
+                decodeAll<fiff_float_t>(pBuffer, iCount, bSwap, m_matWork.data());
+                break;
+        }
+
+        data.middleCols(iDest, iPickSamp).noalias() = m_matMult * m_matWork;
+    }
+
+    return true;
+}
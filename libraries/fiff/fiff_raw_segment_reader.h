@@ -0,0 +1,206 @@
+//=============================================================================================================
+/**
+ * @file     fiff_raw_segment_reader.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    FiffRawSegmentReader class declaration.
+ *
+ */
+
+#ifndef FIFF_RAW_SEGMENT_READER_H
+#define FIFF_RAW_SEGMENT_READER_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QVector>
+
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+//=============================================================================================================
+// FIFFLIB FORWARD DECLARATIONS
+//=============================================================================================================
+
+class FiffRawData;
+
+//=============================================================================================================
+/**
+ * Random access reader for raw data segments. The raw directory is indexed once so that the buffers covering a
+ * segment are found by binary search. The calibrated projector (calibration, compensation, SSP and channel
+ * selection) is cached and only rebuilt if proj, comp, cals or the selection change. Buffers are decoded straight
+ * into the output matrix, with channel picking and calibration fused into the decode. Only the requested samples
+ * of a buffer are read from the device. If the stream is memory-mapped (see FiffStream::map) the buffers are decoded
+ * straight from the mapping without any intermediate copy.
+ *
+ * The reader keeps a reference to the FiffRawData object which therefore has to outlive the reader. Since it
+ * reuses internal work buffers a reader must not be shared between threads.
+ *
+ * @brief Indexed raw data segment reader.
+ */
+class FIFFSHARED_EXPORT FiffRawSegmentReader
+{
+public:
+    typedef QSharedPointer<FiffRawSegmentReader> SPtr;            /**< Shared pointer type for FiffRawSegmentReader. */
+    typedef QSharedPointer<const FiffRawSegmentReader> ConstSPtr; /**< Const shared pointer type for FiffRawSegmentReader. */
+
+    //=========================================================================================================
+    /**
+     * Constructs the reader and indexes the raw directory of p_FiffRawData.
+     *
+     * @param[in] p_FiffRawData  The raw data to read from. Must outlive the reader.
+     */
+    explicit FiffRawSegmentReader(const FiffRawData& p_FiffRawData);
+
+    //=========================================================================================================
+    /**
+     * Rebuilds the buffer index. Call this if the raw directory of the underlying FiffRawData has changed.
+     */
+    void updateIndex();
+
+    //=========================================================================================================
+    /**
+     * Read a specific raw data segment. Drop-in replacement for FiffRawData::read_raw_segment.
+     *
+     * @param[out] data      returns the data matrix (channels x samples). Its memory is reused if the size matches.
+     * @param[out] times     returns the time values corresponding to the samples
+     * @param[in] from       first sample to include. If omitted, defaults to the first sample in data (optional)
+     * @param[in] to         last sample to include. If omitted, defaults to the last sample in data (optional)
+     * @param[in] sel        channel selection vector (optional)
+     *
+     * @return true if succeeded, false otherwise
+     */
+    bool read_raw_segment(Eigen::MatrixXd& data,
+                          Eigen::MatrixXd& times,
+                          fiff_int_t from = -1,
+                          fiff_int_t to = -1,
+                          const Eigen::RowVectorXi& sel = defaultRowVectorXi);
+
+    //=========================================================================================================
+    /**
+     * Read a specific raw data segment and return the used multiplication matrix.
+     *
+     * @param[out] data          returns the data matrix (channels x samples)
+     * @param[out] times         returns the time values corresponding to the samples
+     * @param[out] multSegment   used multiplication matrix (compensator,projection,calibration)
+     * @param[in] from           first sample to include (optional)
+     * @param[in] to             last sample to include (optional)
+     * @param[in] sel            channel selection vector (optional)
+     *
+     * @return true if succeeded, false otherwise
+     */
+    bool read_raw_segment(Eigen::MatrixXd& data,
+                          Eigen::MatrixXd& times,
+                          Eigen::SparseMatrix<double>& multSegment,
+                          fiff_int_t from = -1,
+                          fiff_int_t to = -1,
+                          const Eigen::RowVectorXi& sel = defaultRowVectorXi);
+
+    //=========================================================================================================
+    /**
+     * Returns the index of the raw directory entry which contains the sample iSample, or -1 if the sample is out of
+     * range.
+     *
+     * @param[in] iSample    The sample to look up (in absolute samples, i.e. including first_samp).
+     *
+     * @return The index into FiffRawData::rawdir.
+     */
+    int findBuffer(fiff_int_t iSample) const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Rebuilds the cached projector if proj, comp, cals or the selection differ from the cached state.
+     *
+     * @param[in] sel    The channel selection.
+     */
+    void updateProjector(const Eigen::RowVectorXi& sel);
+
+    //=========================================================================================================
+    /**
+     * Reads samples [iFirstPick, iFirstPick + iPickSamp) of buffer iBuffer into the columns of data starting at
+     * iDest.
+     *
+     * @param[in] iBuffer        The raw directory index.
+     * @param[in] iFirstPick     The first sample within the buffer.
+     * @param[in] iPickSamp      The number of samples to read.
+     * @param[in, out] data      The output matrix.
+     * @param[in] iDest          The first destination column.
+     *
+     * @return true if succeeded, false otherwise
+     */
+    bool readBuffer(int iBuffer,
+                    fiff_int_t iFirstPick,
+                    fiff_int_t iPickSamp,
+                    Eigen::MatrixXd& data,
+                    fiff_int_t iDest);
+
+    const FiffRawData&              m_rawData;          /**< The raw data this reader operates on. */
+
+    QVector<fiff_int_t>             m_vecBufferLast;    /**< Cumulative last sample of each raw directory entry, used for the binary search. */
+
+    bool                            m_bProjectorValid;  /**< Whether the cached projector is set up. */
+    bool                            m_bUseMult;         /**< Whether the full multiplication matrix needs to be applied. If false, only calibration and picking are performed. */
+    Eigen::MatrixXd                 m_matProjKey;       /**< The SSP operator the cached projector was built from. */
+    Eigen::MatrixXd                 m_matCompKey;       /**< The compensator data the cached projector was built from. */
+    fiff_int_t                      m_iCompKindKey;     /**< The compensator kind the cached projector was built from. */
+    Eigen::RowVectorXd              m_vecCalsKey;       /**< The calibration values the cached projector was built from. */
+    Eigen::RowVectorXi              m_vecSelKey;        /**< The channel selection the cached projector was built from. */
+
+    Eigen::VectorXi                 m_vecPickRows;      /**< The file channel index of each output row. */
+    Eigen::VectorXd                 m_vecPickCals;      /**< The calibration factor of each output row. */
+    Eigen::SparseMatrix<double>     m_matMult;          /**< The cached multiplication matrix (output rows x file channels). */
+    Eigen::SparseMatrix<double>     m_matCal;           /**< The cached diagonal calibration matrix, returned as multSegment if no projector is active. */
+
+    QByteArray                      m_baBuffer;         /**< Reused raw byte buffer. */
+    Eigen::MatrixXd                 m_matWork;          /**< Reused decode buffer (file channels x samples) used when the projector is applied. */
+};
+} // NAMESPACE
+
+#endif // FIFF_RAW_SEGMENT_READER_H
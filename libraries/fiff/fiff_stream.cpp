@@ -69,6 +69,7 @@
 #endif
 
 #include <iostream>
+#include <cstring>
 #include <time.h>
 
 //=============================================================================================================
@@ -83,6 +84,7 @@
 //=============================================================================================================
 
 #include <QFile>
+#include <QtEndian>
 #include <QTcpSocket>
 
 //=============================================================================================================
@@ -99,6 +101,8 @@ using namespace Eigen;
 
 FiffStream::FiffStream(QIODevice *p_pIODevice)
 : QDataStream(p_pIODevice)
+, m_pMappedData(Q_NULLPTR)
+, m_iMappedSize(0)
 {
     this->setFloatingPointPrecision(QDataStream::SinglePrecision);
     this->setByteOrder(QDataStream::BigEndian);
@@ -110,6 +114,8 @@ FiffStream::FiffStream(QIODevice *p_pIODevice)
 FiffStream::FiffStream(QByteArray * a,
                        QIODevice::OpenMode mode)
 : QDataStream(a, mode)
+, m_pMappedData(Q_NULLPTR)
+, m_iMappedSize(0)
 {
     this->setFloatingPointPrecision(QDataStream::SinglePrecision);
     this->setByteOrder(QDataStream::BigEndian);
@@ -350,6 +356,80 @@ bool FiffStream::close()
 
 //=============================================================================================================
 
+bool FiffStream::map()
+{
+    if(this->isMapped()) {
+        return true;
+    }
+
+    QFile* t_pFile = qobject_cast<QFile*>(this->device());
+    if(!t_pFile || t_pFile->fileName().isEmpty()) {
+        return false;
+    }
+
+    m_pMappedFile = QSharedPointer<QFile>(new QFile(t_pFile->fileName()));
+
+    if(!m_pMappedFile->open(QIODevice::ReadOnly)) {
+        qWarning("FiffStream::map - Cannot open %s for mapping\n", t_pFile->fileName().toUtf8().constData());
+        m_pMappedFile.clear();
+        return false;
+    }
+
+    m_iMappedSize = m_pMappedFile->size();
+    m_pMappedData = m_pMappedFile->map(0, m_iMappedSize);
+
+    if(!m_pMappedData) {
+        qWarning("FiffStream::map - Cannot map %s: %s\n", t_pFile->fileName().toUtf8().constData(), m_pMappedFile->errorString().toUtf8().constData());
+        this->unmap();
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+void FiffStream::unmap()
+{
+    if(m_pMappedFile) {
+        if(m_pMappedData) {
+            m_pMappedFile->unmap(m_pMappedData);
+        }
+        m_pMappedFile->close();
+        m_pMappedFile.clear();
+    }
+
+    m_pMappedData = Q_NULLPTR;
+    m_iMappedSize = 0;
+}
+
+//=============================================================================================================
+
+bool FiffStream::isMapped() const
+{
+    return m_pMappedData != Q_NULLPTR;
+}
+
+//=============================================================================================================
+
+const char* FiffStream::mapped_data(fiff_long_t pos, fiff_long_t size) const
+{
+    if(!m_pMappedData || pos < 0 || size < 0 || pos + size > m_iMappedSize) {
+        return Q_NULLPTR;
+    }
+
+    return reinterpret_cast<const char*>(m_pMappedData + pos);
+}
+
+//=============================================================================================================
+
+bool FiffStream::is_file_little_endian() const
+{
+    return this->byteOrder() == QDataStream::LittleEndian;
+}
+
+//=============================================================================================================
+
 FiffDirNode::SPtr FiffStream::make_subtree(QList<FiffDirEntry::SPtr> &dentry)
 {
     FiffDirNode::SPtr defaultNode;
@@ -1571,7 +1651,14 @@ bool FiffStream::read_tag_data(FiffTag::SPtr &p_pTag, fiff_long_t pos)
     //
     if (p_pTag->size() > 0)
     {
-        this->readRawData(p_pTag->data(), p_pTag->size());
+        const char* pMapped = this->isMapped() ? this->mapped_data(this->device()->pos(), p_pTag->size()) : Q_NULLPTR;
+
+        if(pMapped) {
+            std::memcpy(p_pTag->data(), pMapped, p_pTag->size());
+            this->device()->seek(this->device()->pos() + p_pTag->size());
+        } else {
+            this->readRawData(p_pTag->data(), p_pTag->size());
+        }
         FiffTag::convert_tag_data(p_pTag,FIFFV_BIG_ENDIAN,FIFFV_NATIVE_ENDIAN);
     }
 
@@ -1659,6 +1746,13 @@ bool FiffStream::read_rt_tag(FiffTag::SPtr &p_pTag)
 bool FiffStream::read_tag(FiffTag::SPtr &p_pTag,
                           fiff_long_t pos)
 {
+    //
+    // Decode straight from the memory-mapped file if available
+    //
+    if (this->isMapped() && this->read_mapped_tag(p_pTag, pos >= 0 ? pos : this->device()->pos())) {
+        return true;
+    }
+
     if (pos >= 0) {
         this->device()->seek(pos);
     }
@@ -3182,28 +3276,53 @@ QList<FiffDirEntry::SPtr> FiffStream::make_dir(bool *ok)
     /*
      * Start from the very beginning...
      */
-    if(!this->device()->seek(SEEK_SET))
-        return dir;
-    while ((pos = this->read_tag_info(t_pTag)) != -1) {
-        /*
-        * Check that we haven't run into the directory
-        */
-        if (t_pTag->kind == FIFF_DIR)
-            break;
-        /*
-        * Put in the new entry
-        */
-        t_pFiffDirEntry = FiffDirEntry::SPtr(new FiffDirEntry);
-        t_pFiffDirEntry->kind = t_pTag->kind;
-        t_pFiffDirEntry->type = t_pTag->type;
-        t_pFiffDirEntry->size = t_pTag->size();
-        t_pFiffDirEntry->pos = (fiff_long_t)pos;
+    if(this->isMapped()) {
+        //
+        // Scan the headers in the mapped memory, the tag data is never touched
+        //
+        fiff_int_t kind, type, size, next;
+        pos = 0;
+        while (this->read_mapped_tag_info(pos, kind, type, size, next)) {
+            if (kind == FIFF_DIR)
+                break;
 
-        //qDebug() << "Kind: " << t_pTag->kind << "| Type:" << t_pTag->type << "| Size" << t_pTag->size() << "| Next:" << t_pTag->next;
+            t_pFiffDirEntry = FiffDirEntry::SPtr(new FiffDirEntry);
+            t_pFiffDirEntry->kind = kind;
+            t_pFiffDirEntry->type = type;
+            t_pFiffDirEntry->size = size;
+            t_pFiffDirEntry->pos = pos;
+            dir.append(t_pFiffDirEntry);
 
-        dir.append(t_pFiffDirEntry);
-        if (t_pTag->next < 0)
-            break;
+            if (next < 0)
+                break;
+
+            pos = next > 0 ? (fiff_long_t)next : pos + FIFFC_DATA_OFFSET + size;
+        }
+    }
+    else {
+        if(!this->device()->seek(SEEK_SET))
+            return dir;
+        while ((pos = this->read_tag_info(t_pTag)) != -1) {
+            /*
+            * Check that we haven't run into the directory
+            */
+            if (t_pTag->kind == FIFF_DIR)
+                break;
+            /*
+            * Put in the new entry
+            */
+            t_pFiffDirEntry = FiffDirEntry::SPtr(new FiffDirEntry);
+            t_pFiffDirEntry->kind = t_pTag->kind;
+            t_pFiffDirEntry->type = t_pTag->type;
+            t_pFiffDirEntry->size = t_pTag->size();
+            t_pFiffDirEntry->pos = (fiff_long_t)pos;
+
+            //qDebug() << "Kind: " << t_pTag->kind << "| Type:" << t_pTag->type << "| Size" << t_pTag->size() << "| Next:" << t_pTag->next;
+
+            dir.append(t_pFiffDirEntry);
+            if (t_pTag->next < 0)
+                break;
+        }
     }
     /*
      * Put in the new the terminating entry
@@ -3221,6 +3340,74 @@ QList<FiffDirEntry::SPtr> FiffStream::make_dir(bool *ok)
 
 //=============================================================================================================
 
+bool FiffStream::read_mapped_tag_info(fiff_long_t pos,
+                                      fiff_int_t& kind,
+                                      fiff_int_t& type,
+                                      fiff_int_t& size,
+                                      fiff_int_t& next) const
+{
+    const char* pHeader = this->mapped_data(pos, FIFFC_DATA_OFFSET);
+
+    if(!pHeader) {
+        return false;
+    }
+
+    if(this->is_file_little_endian()) {
+        kind = qFromLittleEndian<qint32>(pHeader);
+        type = qFromLittleEndian<qint32>(pHeader + 4);
+        size = qFromLittleEndian<qint32>(pHeader + 8);
+        next = qFromLittleEndian<qint32>(pHeader + 12);
+    } else {
+        kind = qFromBigEndian<qint32>(pHeader);
+        type = qFromBigEndian<qint32>(pHeader + 4);
+        size = qFromBigEndian<qint32>(pHeader + 8);
+        next = qFromBigEndian<qint32>(pHeader + 12);
+    }
+
+    return size >= 0;
+}
+
+//=============================================================================================================
+
+bool FiffStream::read_mapped_tag(FiffTag::SPtr &p_pTag, fiff_long_t pos)
+{
+    fiff_int_t kind, type, size, next;
+
+    if(!this->read_mapped_tag_info(pos, kind, type, size, next)) {
+        return false;
+    }
+
+    const char* pData = this->mapped_data(pos + FIFFC_DATA_OFFSET, size);
+
+    if(!pData) {
+        return false;
+    }
+
+    p_pTag = FiffTag::SPtr(new FiffTag());
+    p_pTag->kind = kind;
+    p_pTag->type = type;
+    p_pTag->next = next;
+
+    if (size > 0) {
+        p_pTag->resize(size);
+        std::memcpy(p_pTag->data(), pData, size);
+        FiffTag::convert_tag_data(p_pTag,
+                                  this->is_file_little_endian() ? FIFFV_LITTLE_ENDIAN : FIFFV_BIG_ENDIAN,
+                                  FIFFV_NATIVE_ENDIAN);
+    }
+
+    //
+    // Keep the device in sync for subsequent sequential reads
+    //
+    if (this->device()->isOpen()) {
+        this->device()->seek(next > 0 ? (fiff_long_t)next : pos + FIFFC_DATA_OFFSET + size);
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
 bool FiffStream::check_beginning(FiffTag::SPtr &p_pTag)
 {
     this->read_tag(p_pTag);
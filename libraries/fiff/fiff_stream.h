@@ -61,6 +61,7 @@
 
 #include <QByteArray>
 #include <QDataStream>
+#include <QFile>
 #include <QIODevice>
 #include <QList>
 #include <QSharedPointer>
@@ -248,6 +249,51 @@ public:
      */
     bool close();
 
+    //=========================================================================================================
+    /**
+     * Memory-maps the file the stream operates on. While the mapping is active, read_tag, read_tag_data and the
+     * directory scan decode the tags straight from the mapped memory instead of going through the device, and
+     * mapped_data gives zero-copy access to tag payloads. The mapping uses its own read-only file handle, so it
+     * stays valid if the device of the stream is closed or reopened. Only works for streams on a QFile.
+     *
+     * @return true if the file is mapped, false otherwise
+     */
+    bool map();
+
+    //=========================================================================================================
+    /**
+     * Releases the memory mapping. Pointers returned by mapped_data become invalid.
+     */
+    void unmap();
+
+    //=========================================================================================================
+    /**
+     * Returns whether the file is memory-mapped.
+     *
+     * @return true if the file is mapped, false otherwise
+     */
+    bool isMapped() const;
+
+    //=========================================================================================================
+    /**
+     * Returns a pointer into the memory-mapped file. The data is in file byte order, i.e. the caller is
+     * responsible for the endian conversion (see is_file_little_endian).
+     *
+     * @param[in] pos    The file position.
+     * @param[in] size   The number of bytes which need to be accessible.
+     *
+     * @return The pointer, or NULL if the file is not mapped or the range is out of bounds.
+     */
+    const char* mapped_data(fiff_long_t pos, fiff_long_t size) const;
+
+    //=========================================================================================================
+    /**
+     * Returns whether the data in the file is stored in little endian byte order.
+     *
+     * @return true if little endian, false if big endian
+     */
+    bool is_file_little_endian() const;
+
     //=========================================================================================================
     /**
      * Create the directory tree structure
@@ -880,6 +926,35 @@ private:
      */
     QList<FiffDirEntry::SPtr> make_dir(bool *ok=Q_NULLPTR);
 
+    //=========================================================================================================
+    /**
+     * Reads the tag header at pos from the memory-mapped file.
+     *
+     * @param[in] pos        The position of the tag.
+     * @param[out] kind      The tag kind.
+     * @param[out] type      The tag type.
+     * @param[out] size      The size of the tag data.
+     * @param[out] next      The next tag pointer.
+     *
+     * @return true if succeeded, false if the file is not mapped or the header is out of bounds.
+     */
+    bool read_mapped_tag_info(fiff_long_t pos,
+                              fiff_int_t& kind,
+                              fiff_int_t& type,
+                              fiff_int_t& size,
+                              fiff_int_t& next) const;
+
+    //=========================================================================================================
+    /**
+     * Reads a full tag at pos from the memory-mapped file and moves the device to the next tag if it is open.
+     *
+     * @param[out] p_pTag    The read tag.
+     * @param[in] pos        The position of the tag.
+     *
+     * @return true if succeeded, false if the tag could not be read from the mapping.
+     */
+    bool read_mapped_tag(QSharedPointer<FiffTag>& p_pTag, fiff_long_t pos);
+
 private:
 
 //    char         *file_name;    /**< Name of the file */ -> Use streamName() instead
@@ -888,6 +963,9 @@ private:
     QList<FiffDirEntry::SPtr>   m_dir;  /**< This is the directory. If no directory exists, open automatically scans the file to create one. */
 //    int         nent;           /**< How many entries? */ -> Use nent() instead
     FiffDirNode::SPtr           m_dirtree; /**< Directory compiled into a tree */
+    QSharedPointer<QFile>       m_pMappedFile;  /**< Read-only file handle holding the memory mapping */
+    uchar*                      m_pMappedData;  /**< The memory-mapped file content, NULL if not mapped */
+    qint64                      m_iMappedSize;  /**< The size of the memory mapping in bytes */
 //    char        *ext_file_name; /**< Name of the file holding the external data */
 //    FILE        *ext_fd;        /**< The file descriptor of the above file if open  */
 
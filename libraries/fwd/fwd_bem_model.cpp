@@ -54,8 +54,14 @@
 #include <fiff/fiff_named_matrix.h>
 
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QVector>
+#include <QCryptographicHash>
 #include <QList>
 #include <QThread>
+#include <QThreadPool>
+#include <QMutex>
 #include <QtConcurrent>
 
 #define _USE_MATH_DEFINES
@@ -117,6 +123,12 @@ static float Qz[] = {0.0,0.0,1.0};
 
 #define FREE_CMATRIX_40(m) mne_free_cmatrix_40((m))
 
+#define FWD_CHUNKS_PER_THREAD 8     /* Source point chunks per thread in the parallel forward computation */
+#define FWD_BEM_CACHE_VERSION 1     /* Bump when the solution computation changes */
+#define FWD_BEM_CACHE_ENV     "MNE_BEM_SOLUTION_CACHE"  /* The solution cache directory. The cache is off if this is not set */
+#define FWD_BEM_CACHE_MAX_FILES 8   /* Solutions kept in the cache directory, the oldest ones are removed */
+#define FWD_MIN_CHUNK_SOURCES 4     /* Minimum number of source points per chunk */
+
 void mne_free_cmatrix_40 (float **m)
 {
     if (m) {
@@ -185,13 +197,17 @@ void fromFloatEigenMatrix_40(const Eigen::MatrixXf& from_mat, float **& to_mat)
 
 float **mne_lu_invert_40(float **mat,int dim)
 /*
-      * Invert a matrix using the LU decomposition from
-      * LAPACK
+      * Invert a matrix using the LU decomposition
+      * The factorization is done in place in the contiguous
+      * storage of mat with Eigen's blocked partial-pivoting LU
       */
 {
-    Eigen::MatrixXf eigen_mat = toFloatEigenMatrix_40(mat, dim, dim);
-    Eigen::MatrixXf eigen_mat_inv = eigen_mat.inverse();
-    fromFloatEigenMatrix_40(eigen_mat_inv, mat);
+    typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMatrixXf;
+
+    Eigen::Map<RowMatrixXf> eigen_mat(mat[0],dim,dim);
+    Eigen::PartialPivLU<Eigen::Ref<RowMatrixXf> > lu(eigen_mat);
+    RowMatrixXf eigen_mat_inv = lu.inverse();
+    eigen_mat = eigen_mat_inv;
     return mat;
 }
 
@@ -1048,19 +1064,18 @@ void FwdBemModel::correct_auto_elements(MneSurfaceOld *surf, float **mat)
 float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
 /*
  * Calculate the coefficients for linear collocation approach
+ * The rows of each surface pair are filled in parallel
  */
 {
     float **mat = NULL;
     float **sub_mat = NULL;
     int   np1,np2,ntri,np_tot,np_max;
     float **nodes;
-    MneTriangle*   tri;
-    double omega[3];
-    double *row = NULL;
-    int    j,k,p,q,c;
+    int    j,k,p,q;
     int    joff,koff;
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
+    QVector<int> rows;
 
     for (p = 0, np_tot = np_max = 0; p < surfs.size(); p++) {
         np_tot += surfs[p]->np;
@@ -1072,7 +1087,6 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
     for (j = 0; j < np_tot; j++)
         for (k = 0; k < np_tot; k++)
             mat[j][k] = 0.0;
-    row        = MALLOC_40(np_max,double);
     sub_mat = MALLOC_40(np_max,float *);
     for (p = 0, joff = 0; p < surfs.size(); p++, joff = joff + np1) {
         surf1 = surfs[p];
@@ -1087,26 +1101,33 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
                     fwd_bem_explain_surface(surf1->id).toUtf8().constData(),np1,
                     fwd_bem_explain_surface(surf2->id).toUtf8().constData(),np2);
 
-            for (j = 0; j < np1; j++) {
-                for (k = 0; k < np2; k++)
-                    row[k] = 0.0;
-                for (k = 0, tri = surf2->tris; k < ntri; k++,tri++) {
+            std::function<void(int&)> fillRow = [&](int& jj) {
+                QVector<double> row(np2,0.0);
+                MneTriangle*    tri;
+                double          omega[3];
+                int             kk,c;
+
+                for (kk = 0, tri = surf2->tris; kk < ntri; kk++,tri++) {
                     /*
                * No contribution from a triangle that
                * this vertex belongs to
                */
-                    if (p == q && (tri->vert[0] == j || tri->vert[1] == j || tri->vert[2] == j))
+                    if (p == q && (tri->vert[0] == jj || tri->vert[1] == jj || tri->vert[2] == jj))
                         continue;
                     /*
                * Otherwise do the hard job
                */
-                    lin_pot_coeff (nodes[j],tri,omega);
+                    lin_pot_coeff (nodes[jj],tri,omega);
                     for (c = 0; c < 3; c++)
                         row[tri->vert[c]] = row[tri->vert[c]] - omega[c];
                 }
-                for (k = 0; k < np2; k++)
-                    mat[j+joff][k+koff] = row[k];
-            }
+                for (kk = 0; kk < np2; kk++)
+                    mat[jj+joff][kk+koff] = row[kk];
+            };
+            rows.resize(np1);
+            for (j = 0; j < np1; j++)
+                rows[j] = j;
+            QtConcurrent::blockingMap(rows, fillRow);
             if (p == q) {
                 for (j = 0; j < np1; j++)
                     sub_mat[j] = mat[j+joff]+koff;
@@ -1115,7 +1136,6 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
             fprintf(stderr,"[done]\n");
         }
     }
-    FREE_40(row);
     FREE_40(sub_mat);
     return(mat);
 }
@@ -1356,14 +1376,13 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
 {
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
-    MneTriangle* tri;
     int ntri1,ntri2,ntri_tot;
-    int j,k,p,q;
+    int j,p,q;
     int joff,koff;
     float **solids;
-    float result;
     float **sub_solids = NULL;
     float desired;
+    QVector<int> rows;
 
     for (p = 0,ntri_tot = 0; p < surfs.size(); p++)
         ntri_tot += surfs[p]->ntri;
@@ -1377,14 +1396,24 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
             surf2 = surfs[q];
             ntri2 = surf2->ntri;
             fprintf(stderr,"\t\t%s (%d) -> %s (%d) ... ",fwd_bem_explain_surface(surf1->id).toUtf8().constData(),ntri1,fwd_bem_explain_surface(surf2->id).toUtf8().constData(),ntri2);
-            for (j = 0; j < ntri1; j++)
-                for (k = 0, tri = surf2->tris; k < ntri2; k++, tri++) {
-                    if (p == q && j == k)
-                        result = 0.0;
+            /*
+             * The rows are independent of each other
+             */
+            std::function<void(int&)> fillRow = [&](int& jj) {
+                MneTriangle* tri;
+                int          kk;
+
+                for (kk = 0, tri = surf2->tris; kk < ntri2; kk++, tri++) {
+                    if (p == q && jj == kk)
+                        solids[jj+joff][kk+koff] = 0.0;
                     else
-                        result = MneSurfaceOrVolume::solid_angle (surf1->tris[j].cent,tri);
-                    solids[j+joff][k+koff] = result;
+                        solids[jj+joff][kk+koff] = MneSurfaceOrVolume::solid_angle (surf1->tris[jj].cent,tri);
                 }
+            };
+            rows.resize(ntri1);
+            for (j = 0; j < ntri1; j++)
+                rows[j] = j;
+            QtConcurrent::blockingMap(rows, fillRow);
             for (j = 0; j < ntri1; j++)
                 sub_solids[j] = solids[j+joff]+koff;
             fprintf(stderr,"[done]\n");
@@ -1492,9 +1521,12 @@ int FwdBemModel::fwd_bem_compute_solution(FwdBemModel *m, int bem_method)
 int FwdBemModel::fwd_bem_load_recompute_solution(const QString& name, int bem_method, int force_recompute, FwdBemModel *m)
 /*
  * Load or recompute the potential solution matrix
+ * A recomputed solution is stored in the solution cache and
+ * picked up from there next time the same model is used
  */
 {
-    int solres;
+    int     solres;
+    QString cache_name;
 
     if (!m) {
         printf ("No model specified for fwd_bem_load_recompute_solution");
@@ -1518,7 +1550,120 @@ int FwdBemModel::fwd_bem_load_recompute_solution(const QString& name, int bem_me
     }
     if (bem_method == FWD_BEM_UNKNOWN)
         bem_method = FWD_BEM_LINEAR_COLL;
-    return fwd_bem_compute_solution(m,bem_method);
+
+    cache_name = fwd_bem_solution_cache_name(m,bem_method);
+    if (!force_recompute && !cache_name.isEmpty()) {
+        if (fwd_bem_load_solution(cache_name,bem_method,m) == TRUE) {
+            fprintf(stderr,"\nLoaded cached %s BEM solution from %s\n",fwd_bem_explain_method(m->bem_method).toUtf8().constData(),cache_name.toUtf8().constData());
+            return OK;
+        }
+    }
+    if (fwd_bem_compute_solution(m,bem_method) != OK)
+        return FAIL;
+    if (!cache_name.isEmpty() && fwd_bem_save_solution_cache(cache_name,m) == OK)
+        fprintf(stderr,"Saved the BEM solution to %s\n",cache_name.toUtf8().constData());
+    return OK;
+}
+
+//=============================================================================================================
+
+QString FwdBemModel::fwd_bem_solution_hash(FwdBemModel *m, int bem_method)
+/*
+ * Hash everything the solution matrix depends on:
+ * the surface geometry, the conductivities, the approximation method,
+ * and the isolated problem approach limit
+ */
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    MneSurfaceOld* surf;
+    qint32         ival;
+    int            s,k;
+
+    ival = FWD_BEM_CACHE_VERSION;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = bem_method;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = m->nsurf;
+    hash.addData((const char*)&ival,sizeof(ival));
+    hash.addData((const char*)&m->ip_approach_limit,sizeof(float));
+    hash.addData((const char*)m->sigma,m->nsurf*sizeof(float));
+
+    for (s = 0; s < m->nsurf; s++) {
+        surf = m->surfs[s];
+        ival = surf->id;
+        hash.addData((const char*)&ival,sizeof(ival));
+        ival = surf->np;
+        hash.addData((const char*)&ival,sizeof(ival));
+        ival = surf->ntri;
+        hash.addData((const char*)&ival,sizeof(ival));
+        for (k = 0; k < surf->np; k++)
+            hash.addData((const char*)surf->rr[k],3*sizeof(float));
+        for (k = 0; k < surf->ntri; k++)
+            hash.addData((const char*)surf->tris[k].vert,3*sizeof(int));
+    }
+    return QString(hash.result().toHex());
+}
+
+//=============================================================================================================
+
+QString FwdBemModel::fwd_bem_solution_cache_name(FwdBemModel *m, int bem_method)
+/*
+ * The name of the cached solution file for this model
+ * Returns an empty string if the cache is not enabled
+ * with the MNE_BEM_SOLUTION_CACHE environment variable
+ */
+{
+    QString dir_name = QString::fromLocal8Bit(qgetenv(FWD_BEM_CACHE_ENV));
+
+    if (dir_name.isEmpty())
+        return QString();
+    if (!QDir().mkpath(dir_name))
+        return QString();
+    return QString("%1/%2-sol.fif").arg(dir_name).arg(fwd_bem_solution_hash(m,bem_method));
+}
+
+//=============================================================================================================
+
+int FwdBemModel::fwd_bem_save_solution_cache(const QString &name, FwdBemModel *m)
+/*
+ * Write the solution matrix so that fwd_bem_load_solution can read it.
+ * The file is written under a temporary name first so that concurrent
+ * runs never see a partially written solution.
+ */
+{
+    QString tmp_name = QString("%1.%2.tmp").arg(name).arg(QCoreApplication::applicationPid());
+    QFile   file(tmp_name);
+    int     method;
+
+    if (!m->solution || m->nsol <= 0)
+        return FAIL;
+    method = (m->bem_method == FWD_BEM_CONSTANT_COLL) ? FIFFV_BEM_APPROX_CONST : FIFFV_BEM_APPROX_LINEAR;
+    {
+        FiffStream::SPtr stream = FiffStream::start_file(file);
+        if (!stream)
+            return FAIL;
+        stream->start_block(FIFFB_BEM);
+        stream->write_int(FIFF_BEM_APPROX,&method);
+        stream->write_float_matrix(FIFF_BEM_POT_SOLUTION,
+                                   Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(m->solution[0],m->nsol,m->nsol));
+        stream->end_block(FIFFB_BEM);
+        stream->end_file();
+        stream->close();
+    }
+    QFile::remove(name);
+    if (!QFile::rename(tmp_name,name)) {
+        QFile::remove(tmp_name);
+        return FAIL;
+    }
+    /*
+     * Each solution takes nsol x nsol floats, keep the directory bounded
+     */
+    {
+        QFileInfoList cached = QFileInfo(name).dir().entryInfoList(QStringList() << "*-sol.fif",QDir::Files,QDir::Time);
+        for (int k = FWD_BEM_CACHE_MAX_FILES; k < cached.size(); k++)
+            QFile::remove(cached[k].absoluteFilePath());
+    }
+    return OK;
 }
 
 //=============================================================================================================
@@ -2923,22 +3068,257 @@ int FwdBemModel::fwd_bem_field_grad(float *rd,
 
 //=============================================================================================================
 
+void FwdBemModel::fwd_bem_inf_pot_batch(float **rd, int nsource, FwdBemModel *m, MatrixXf &v0)
+/*
+ * Compute the infinite-medium potentials of the x, y, and z dipoles at
+ * nsource locations. Column 3*j+c of v0 holds the potentials of component c
+ * of source j at the solution points, i.e., at the vertices (linear collocation)
+ * or at the triangle centers (constant collocation), scaled by source_mult.
+ */
+{
+    MneTriangle* tri;
+    float        **rr;
+    float        mri_rd[3],mri_Q[3][3];
+    float        diff[3],diff2,mult;
+    int          s,k,p,j,c,np;
+    int          constant = (m->bem_method == FWD_BEM_CONSTANT_COLL);
+    /*
+     * The dipole orientations are the same for all sources
+     */
+    for (c = 0; c < 3; c++) {
+        for (k = 0; k < 3; k++)
+            mri_Q[c][k] = (c == k) ? 1.0 : 0.0;
+        if (m->head_mri_t)
+            FiffCoordTransOld::fiff_coord_trans(mri_Q[c],m->head_mri_t,FIFFV_NO_MOVE);
+    }
+    v0.resize(m->nsol,3*nsource);
+
+    for (j = 0; j < nsource; j++) {
+        VEC_COPY_40(mri_rd,rd[j]);
+        if (m->head_mri_t)
+            FiffCoordTransOld::fiff_coord_trans(mri_rd,m->head_mri_t,FIFFV_MOVE);
+        float *v0x = v0.col(3*j).data();
+        float *v0y = v0.col(3*j+1).data();
+        float *v0z = v0.col(3*j+2).data();
+
+        for (s = 0, p = 0; s < m->nsurf; s++) {
+            np   = constant ? m->surfs[s]->ntri : m->surfs[s]->np;
+            rr   = m->surfs[s]->rr;
+            tri  = m->surfs[s]->tris;
+            mult = m->source_mult[s]/(4.0*M_PI);
+            for (k = 0; k < np; k++, p++) {
+                if (constant) {
+                    VEC_DIFF_40(mri_rd,tri[k].cent,diff);
+                }
+                else {
+                    VEC_DIFF_40(mri_rd,rr[k],diff);
+                }
+                diff2 = VEC_DOT_40(diff,diff);
+                diff2 = mult/(diff2*sqrt(diff2));
+                v0x[p] = diff2*VEC_DOT_40(mri_Q[X_40],diff);
+                v0y[p] = diff2*VEC_DOT_40(mri_Q[Y_40],diff);
+                v0z[p] = diff2*VEC_DOT_40(mri_Q[Z_40],diff);
+            }
+        }
+    }
+    return;
+}
+
+//=============================================================================================================
+
+int FwdBemModel::fwd_bem_field_batch(float **rd, int nsource, FwdCoilSet *coils, float **B, void *client)  /* The model */
+/*
+ * Calculate the magnetic fields of the x, y, and z dipoles at nsource
+ * locations in a set of coils. The volume current contribution of all
+ * sources is obtained with one matrix-matrix product.
+ * Call fwd_bem_specify_coils first to establish the coil-specific
+ * solution matrix
+ */
+{
+    FwdBemModel*    m = (FwdBemModel*)client;
+    FwdBemSolution* sol = (FwdBemSolution*)coils->user_data;
+    FwdCoil*        coil;
+    MatrixXf        v0;
+    float           diff[3],cross[3],this_cross[3],diff2,w;
+    int             j,k,p;
+
+    if (!m) {
+        printf("No BEM model specified to fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (!sol || !sol->solution || sol->ncoil != coils->ncoil) {
+        printf("No appropriate coil-specific data available in fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (m->bem_method != FWD_BEM_CONSTANT_COLL && m->bem_method != FWD_BEM_LINEAR_COLL) {
+        printf("Unknown BEM method : %d",m->bem_method);
+        return FAIL;
+    }
+    if (nsource <= 0 || coils->ncoil <= 0)
+        return OK;
+    /*
+     * Volume current contribution: (ncoil x nsol) x (nsol x 3*nsource)
+     */
+    fwd_bem_inf_pot_batch(rd,nsource,m,v0);
+    Map<const Matrix<float,Dynamic,Dynamic,RowMajor> > solution(sol->solution[0],sol->ncoil,m->nsol);
+    MatrixXf vol = solution*v0;
+    /*
+     * Primary current contribution
+     * (can be calculated in the coil/dipole coordinates)
+     * Since (Q x diff) . dir = Q . (diff x dir), the three dipole
+     * components are the components of one cross product.
+     */
+    for (j = 0; j < nsource; j++) {
+        for (k = 0; k < coils->ncoil; k++) {
+            coil = coils->coils[k];
+            cross[X_40] = cross[Y_40] = cross[Z_40] = 0.0;
+            for (p = 0; p < coil->np; p++) {
+                VEC_DIFF_40(rd[j],coil->rmag[p],diff);
+                diff2 = VEC_DOT_40(diff,diff);
+                w     = coil->w[p]/(diff2*sqrt(diff2));
+                CROSS_PRODUCT_40(diff,coil->cosmag[p],this_cross);
+                cross[X_40] += w*this_cross[X_40];
+                cross[Y_40] += w*this_cross[Y_40];
+                cross[Z_40] += w*this_cross[Z_40];
+            }
+            for (p = 0; p < 3; p++)
+                B[3*j+p][k] = MAG_FACTOR*(cross[p] + vol(k,3*j+p));
+        }
+    }
+    return OK;
+}
+
+//=============================================================================================================
+
+int FwdBemModel::fwd_bem_field_vec(float *rd, FwdCoilSet *coils, float **B, void *client)  /* The model */
+/*
+ * Calculate the magnetic fields of the x, y, and z dipoles at one location
+ */
+{
+    float *rds[1];
+    rds[0] = rd;
+    return fwd_bem_field_batch(rds,1,coils,B,client);
+}
+
+//=============================================================================================================
+
+int FwdBemModel::fwd_bem_pot_els_batch(float **rd, int nsource, FwdCoilSet *els, float **pot, void *client) /* The model */
+/*
+ * Calculate the electric potentials of the x, y, and z dipoles at nsource
+ * locations in a set of electrodes with one matrix-matrix product
+ */
+{
+    FwdBemModel*    m = (FwdBemModel*)client;
+    FwdBemSolution* sol = (FwdBemSolution*)els->user_data;
+    MatrixXf        v0;
+    int             j,k;
+
+    if (!m) {
+        printf("No BEM model specified to fwd_bem_pot_els_batch");
+        return FAIL;
+    }
+    if (!m->solution) {
+        printf("No solution available for fwd_bem_pot_els_batch");
+        return FAIL;
+    }
+    if (!sol || sol->ncoil != els->ncoil) {
+        printf("No appropriate electrode-specific data available in fwd_bem_pot_els_batch");
+        return FAIL;
+    }
+    if (m->bem_method != FWD_BEM_CONSTANT_COLL && m->bem_method != FWD_BEM_LINEAR_COLL) {
+        printf("Unknown BEM method : %d",m->bem_method);
+        return FAIL;
+    }
+    if (nsource <= 0 || els->ncoil <= 0)
+        return OK;
+
+    fwd_bem_inf_pot_batch(rd,nsource,m,v0);
+    Map<const Matrix<float,Dynamic,Dynamic,RowMajor> > solution(sol->solution[0],sol->ncoil,m->nsol);
+    MatrixXf res = solution*v0;
+    /*
+     * Each column of the result is one row of the output
+     */
+    for (j = 0; j < 3*nsource; j++)
+        for (k = 0; k < els->ncoil; k++)
+            pot[j][k] = res(k,j);
+    return OK;
+}
+
+//=============================================================================================================
+
+int FwdBemModel::fwd_bem_pot_els_vec(float *rd, FwdCoilSet *els, float **pot, void *client) /* The model */
+/*
+ * Calculate the electric potentials of the x, y, and z dipoles at one location
+ */
+{
+    float *rds[1];
+    rds[0] = rd;
+    return fwd_bem_pot_els_batch(rds,1,els,pot,client);
+}
+
+//=============================================================================================================
+
 void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
 /*
  * Compute the MEG or EEG forward solution for one source space
- * and possibly for only one source component
+ * and possibly for only one source component. If a vertex range
+ * is given, only the vertices within this range are processed.
  */
 {
     FwdThreadArg* a = (FwdThreadArg*)arg;
     MneSourceSpaceOld* s = a->s;
     int            j,p,q;
     float          *xyz[3];
+    int            last_vert = (a->last_vert < 0 || a->last_vert > s->np) ? s->np : a->last_vert;
 
     p = a->off;
     q = 3*a->off;
+    if (a->batch_field_pot && !(a->field_pot_grad && a->res_grad) && (a->fixed_ori || a->comp < 0)) {
+        /*
+         * Compute the fields of all three dipole components for a block of
+         * source locations at a time. Fixed orientations are formed afterwards.
+         */
+        float  *rd[FWD_BEM_BATCH_SOURCES];
+        float  *nn[FWD_BEM_BATCH_SOURCES];
+        float  **batch_res = NULL;
+        int    ncoil = a->coils_els->ncoil;
+        int    nbatch,k,c,stat = OK;
+
+        if (a->fixed_ori)
+            batch_res = ALLOC_CMATRIX_40(3*FWD_BEM_BATCH_SOURCES,ncoil);
+        for (j = a->first_vert; j < last_vert && stat == OK; ) {
+            for (nbatch = 0; j < last_vert && nbatch < FWD_BEM_BATCH_SOURCES; j++) {
+                if (s->inuse[j]) {
+                    rd[nbatch] = s->rr[j];
+                    nn[nbatch] = s->nn[j];
+                    nbatch++;
+                }
+            }
+            if (nbatch == 0)
+                break;
+            if (a->fixed_ori) {
+                if ((stat = a->batch_field_pot(rd,nbatch,a->coils_els,batch_res,a->client)) != OK)
+                    break;
+                for (k = 0; k < nbatch; k++, p++)
+                    for (c = 0; c < ncoil; c++)
+                        a->res[p][c] = nn[k][X_40]*batch_res[3*k][c] +
+                                nn[k][Y_40]*batch_res[3*k+1][c] +
+                                nn[k][Z_40]*batch_res[3*k+2][c];
+            }
+            else {
+                stat = a->batch_field_pot(rd,nbatch,a->coils_els,a->res+p,a->client);
+                p = p + 3*nbatch;
+            }
+        }
+        FREE_CMATRIX_40(batch_res);
+        if (stat != OK)
+            goto bad;
+        a->stat = OK;
+        return NULL;
+    }
     if (a->fixed_ori) {					  /* The normal source component only */
         if (a->field_pot_grad && a->res_grad) {                   /* Gradient requested? */
-            for (j = 0; j < s->np; j++) {
+            for (j = a->first_vert; j < last_vert; j++) {
                 if (s->inuse[j]) {
                     if (a->field_pot_grad(s->rr[j],
                                           s->nn[j],
@@ -2955,7 +3335,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
                 }
             }
         } else {
-            for (j = 0; j < s->np; j++)
+            for (j = a->first_vert; j < last_vert; j++)
                 if (s->inuse[j])
                     if (a->field_pot(s->rr[j],
                                      s->nn[j],
@@ -2967,7 +3347,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
     }
     else {						  /* All source components */
         if (a->field_pot_grad && a->res_grad) {               /* Gradient requested? */
-            for (j = 0; j < s->np; j++) {
+            for (j = a->first_vert; j < last_vert; j++) {
                 if (s->inuse[j]) {
                     if (a->comp < 0) {				  /* Compute all components */
                         if (a->field_pot_grad(s->rr[j],
@@ -3047,7 +3427,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
             }
         }
         else {
-            for (j = 0; j < s->np; j++) {
+            for (j = a->first_vert; j < last_vert; j++) {
                 if (s->inuse[j]) {
                     if (a->vec_field_pot) {
                         xyz[0] = a->res[p++];
@@ -3097,6 +3477,109 @@ bad : {
 
 //=============================================================================================================
 
+int FwdBemModel::compute_forward_parallel(FwdThreadArg *one_arg,
+                                          MneSourceSpaceOld **spaces,
+                                          int nspace,
+                                          bool meg,
+                                          bool bem_model)
+/*
+ * Compute the forward solution for all source spaces in parallel.
+ * The used source points are split into chunks, which are picked up
+ * by the threads of the global thread pool as they become available.
+ * Each thread borrows one workspace duplicate of one_arg from a pool,
+ * so there are never more duplicates than concurrently running threads.
+ * The chunks write disjoint rows of the solution, i.e., the result does
+ * not depend on the number of threads.
+ */
+{
+    struct FwdChunk {
+        MneSourceSpaceOld*  s;              /* The source space */
+        int                 first_vert;     /* First vertex of the chunk */
+        int                 last_vert;      /* One past the last vertex of the chunk */
+        int                 off;            /* Offset of the first used vertex within the result */
+        int                 stat;
+    };
+
+    int nthread = qMax(1,QThreadPool::globalInstance()->maxThreadCount());
+    int nsource = 0;
+    int k,j,nuse,off,chunk_size;
+
+    for (k = 0; k < nspace; k++)
+        nsource += spaces[k]->nuse;
+    /*
+     * Several chunks per thread, so threads finishing early pick up more work
+     */
+    chunk_size = qMax(FWD_MIN_CHUNK_SOURCES,nsource/(FWD_CHUNKS_PER_THREAD*nthread));
+
+    QVector<FwdChunk> chunks;
+    for (k = 0, off = 0; k < nspace; k++) {
+        MneSourceSpaceOld* s = spaces[k];
+        FwdChunk chunk = { s, 0, 0, off, FAIL };
+
+        for (j = 0, nuse = 0; j < s->np; j++) {
+            if (s->inuse[j]) {
+                nuse++;
+                off = one_arg->fixed_ori ? off + 1 : off + 3;
+            }
+            if (nuse == chunk_size || (j == s->np-1 && nuse > 0)) {
+                chunk.last_vert = j+1;
+                chunks.append(chunk);
+                chunk.first_vert = j+1;
+                chunk.off = off;
+                nuse = 0;
+            }
+        }
+    }
+    /*
+     * The workspace pool
+     */
+    QMutex mutex;
+    QList<FwdThreadArg*> free_args;
+    QList<FwdThreadArg*> all_args;
+
+    std::function<void(FwdChunk&)> computeChunk = [&](FwdChunk& chunk) {
+        FwdThreadArg* t_arg = NULL;
+
+        mutex.lock();
+        if (free_args.isEmpty()) {
+            t_arg = meg ? FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model)
+                        : FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model);
+            all_args.append(t_arg);
+        }
+        else
+            t_arg = free_args.takeLast();
+        mutex.unlock();
+
+        t_arg->s          = chunk.s;
+        t_arg->first_vert = chunk.first_vert;
+        t_arg->last_vert  = chunk.last_vert;
+        t_arg->off        = chunk.off;
+        t_arg->comp       = -1;
+        meg_eeg_fwd_one_source_space(t_arg);
+        chunk.stat = t_arg->stat;
+
+        mutex.lock();
+        free_args.append(t_arg);
+        mutex.unlock();
+    };
+
+    QtConcurrent::blockingMap(chunks, computeChunk);
+
+    for (k = 0; k < all_args.size(); k++) {
+        if (meg)
+            FwdThreadArg::free_meg_multi_thread_duplicate(all_args[k],bem_model);
+        else
+            FwdThreadArg::free_eeg_multi_thread_duplicate(all_args[k],bem_model);
+    }
+
+    for (k = 0; k < chunks.size(); k++)
+        if (chunks[k].stat != OK)
+            return FAIL;
+    return OK;
+}
+
+//=============================================================================================================
+
 int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
                                      int nspace,
                                      FwdCoilSet *coils,
@@ -3122,11 +3605,12 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
     FwdCompData         *comp = NULL;
     fwdFieldFunc        field;              /* Computes the field for one dipole orientation */
     fwdVecFieldFunc     vec_field;          /* Computes the field for all dipole orientations */
+    fwdBatchFieldFunc   batch_field;        /* Computes the field for all dipole orientations at several locations */
     fwdFieldGradFunc    field_grad;         /* Computes the field and gradient with respect to dipole position
                                              * for one dipole orientation */
     int                 nmeg = coils->ncoil;/* Number of channels */
     int                 nsource;            /* Total number of sources */
-    int                 k,p,q,off;
+    int                 k,off;
     QStringList         names;              /* Channel names */
     void                *client;
     FwdThreadArg*       one_arg = NULL;
@@ -3143,7 +3627,7 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
         comp = FwdCompData::fwd_make_comp_data(comp_data,
                                                coils,comp_coils,
                                                FwdBemModel::fwd_bem_field,
-                                               NULL,
+                                               FwdBemModel::fwd_bem_field_vec,
                                                my_bem_field_grad,
                                                bem_model,
                                                NULL);
@@ -3152,13 +3636,14 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
                                                coils,
                                                comp_coils,
                                                FwdBemModel::fwd_bem_field,
-                                               NULL,
+                                               FwdBemModel::fwd_bem_field_vec,
                                                FwdBemModel::fwd_bem_field_grad,
                                                bem_model,
                                                NULL);
 #endif
         if (!comp)
             goto bad;
+        comp->batch_field = FwdBemModel::fwd_bem_field_batch;
         /*
         * Field computation matrices...
         */
@@ -3174,10 +3659,11 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
                 goto bad;
             fprintf(stderr,"[done]\n");
         }
-        field      = FwdCompData::fwd_comp_field;
-        vec_field  = NULL;
-        field_grad = FwdCompData::fwd_comp_field_grad;
-        client     = comp;
+        field       = FwdCompData::fwd_comp_field;
+        vec_field   = FwdCompData::fwd_comp_field_vec;
+        batch_field = FwdCompData::fwd_comp_field_batch;
+        field_grad  = FwdCompData::fwd_comp_field_grad;
+        client      = comp;
     }
     else {
         /*
@@ -3202,6 +3688,7 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
             goto bad;
         field       = FwdCompData::fwd_comp_field;
         vec_field   = FwdCompData::fwd_comp_field_vec;
+        batch_field = NULL;
         field_grad  = FwdCompData::fwd_comp_field_grad;
         client      = comp;
     }
@@ -3236,60 +3723,16 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces,
     one_arg->fixed_ori      = fixed_ori;
     one_arg->field_pot      = field;
     one_arg->vec_field_pot  = vec_field;
+    one_arg->batch_field_pot = batch_field;
     one_arg->field_pot_grad = field_grad;
 
     if (nproc < 2)
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_field || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //fwdThreadArg   *args    = MALLOC_40(nthread,fwdThreadArg);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_field || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            fprintf(stderr,"%d processors. I will use one thread for each of the %d source spaces.\n",
-                    nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            fprintf(stderr,"%d processors. I will use %d threads : %d source spaces x 3 source components.\n",
-                    nproc,nthread,nspace);
-        }
         fprintf(stderr,"Computing MEG at %d source locations (%s orientations)...",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_meg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (compute_forward_parallel(one_arg,spaces,nspace,true,bem_model != NULL) != OK)
             goto bad;
     }
     else {
@@ -3383,11 +3826,12 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces,
     int nrow = 0;
     fwdFieldFunc     pot;                   /* Computes the potentials for one dipole orientation */
     fwdVecFieldFunc  vec_pot;               /* Computes the potentials for all dipole orientations */
+    fwdBatchFieldFunc batch_pot;            /* Computes the potentials for all dipole orientations at several locations */
     fwdFieldGradFunc pot_grad;              /* Computes the potential and gradient with respect to dipole position
                                              * for one dipole orientation */
     int             nsource;                /* Total number of sources */
     int             neeg = els->ncoil;      /* Number of channels */
-    int             k,p,q,off;
+    int             k,off;
     QStringList     names;                  /* Channel names */
     void            *client;
     FwdThreadArg*   one_arg = NULL;
@@ -3402,9 +3846,10 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces,
     if (bem_model) {
         if (fwd_bem_specify_els(bem_model,els) == FAIL)
             goto bad;
-        client   = bem_model;
-        pot      = fwd_bem_pot_els;
-        vec_pot  = NULL;
+        client    = bem_model;
+        pot       = fwd_bem_pot_els;
+        vec_pot   = fwd_bem_pot_els_vec;
+        batch_pot = fwd_bem_pot_els_batch;
 #ifdef TEST
         fprintf(stderr,"Using differences.\n");
         pot_grad = my_bem_pot_grad;
@@ -3415,15 +3860,17 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces,
     else {
         if (m->nfit == 0) {
             fprintf(stderr,"Using the standard series expansion for a multilayer sphere model for EEG\n");
-            pot      = FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1;
-            vec_pot  = NULL;
-            pot_grad = NULL;
+            pot       = FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1;
+            vec_pot   = NULL;
+            batch_pot = NULL;
+            pot_grad  = NULL;
         }
         else {
             fprintf(stderr,"Using the equivalent source approach in the homogeneous sphere for EEG\n");
-            pot      = FwdEegSphereModel::fwd_eeg_spherepot_coil;
-            vec_pot  = FwdEegSphereModel::fwd_eeg_spherepot_coil_vec;
-            pot_grad = FwdEegSphereModel::fwd_eeg_spherepot_grad_coil;
+            pot       = FwdEegSphereModel::fwd_eeg_spherepot_coil;
+            vec_pot   = FwdEegSphereModel::fwd_eeg_spherepot_coil_vec;
+            batch_pot = NULL;
+            pot_grad  = FwdEegSphereModel::fwd_eeg_spherepot_grad_coil;
         }
         client   = m;
     }
@@ -3457,58 +3904,16 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces,
     one_arg->fixed_ori      = fixed_ori;
     one_arg->field_pot      = pot;
     one_arg->vec_field_pot  = vec_pot;
+    one_arg->batch_field_pot = batch_pot;
     one_arg->field_pot_grad = pot_grad;
 
     if (nproc < 2)
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_pot || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //FwdThreadArg*   *args    = MALLOC_40(nthread,FwdThreadArg*);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_pot || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            printf("%d processors. I will use one thread for each of the %d source spaces.\n",nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            printf("%d processors. I will use %d threads : %d source spaces x 3 source components.\n",nproc,nthread,nspace);
-        }
         printf("Computing EEG at %d source locations (%s orientations)...",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_eeg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (compute_forward_parallel(one_arg,spaces,nspace,false,bem_model != NULL) != OK)
             goto bad;
     }
     else {
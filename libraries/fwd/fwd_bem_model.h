@@ -100,6 +100,7 @@ namespace FWDLIB
 //=============================================================================================================
 
 class FwdEegSphereModel;
+class FwdThreadArg;
 
 //=============================================================================================================
 /**
@@ -245,6 +246,21 @@ public:
                                         int         force_recompute,
                                         FwdBemModel* m);
 
+    /*
+     * On-disk cache of computed solutions. The file name is derived from a hash of
+     * the surfaces, the conductivities, and the approximation method. The cache is
+     * only used if its directory is set with the MNE_BEM_SOLUTION_CACHE environment
+     * variable. The directory keeps the most recently written solutions only.
+     */
+    static QString fwd_bem_solution_hash(FwdBemModel* m,
+                                         int         bem_method);
+
+    static QString fwd_bem_solution_cache_name(FwdBemModel* m,
+                                               int         bem_method);
+
+    static int fwd_bem_save_solution_cache(const QString& name,
+                                           FwdBemModel* m);
+
     //============================= fwd_bem_pot.c =============================
 
     static float fwd_bem_inf_field(float *rd,      /* Dipole position */
@@ -430,10 +446,51 @@ public:
                    float        zgrad[],
                    void         *client);
 
+    //============================= fwd_bem_batch.c =============================
+
+    /*
+     * Batched field and potential computations. The infinite-medium potentials of
+     * the x, y, and z dipoles at a block of source locations are assembled into
+     * one matrix, which is then multiplied by the coil or electrode specific
+     * solution matrix with a single matrix-matrix product.
+     */
+    static void fwd_bem_inf_pot_batch(float           **rd,         /* Dipole positions */
+                                      int             nsource,      /* How many? */
+                                      FwdBemModel*    m,            /* The model */
+                                      Eigen::MatrixXf &v0);         /* The potentials (nsol x 3*nsource) */
+
+    static int fwd_bem_field_batch(float       **rd,     /* Dipole positions */
+                                   int         nsource,  /* How many? */
+                                   FwdCoilSet* coils,    /* Coil descriptors */
+                                   float       **B,      /* Results (3*nsource x ncoil) */
+                                   void        *client); /* The model */
+
+    static int fwd_bem_field_vec(float       *rd,        /* Dipole position */
+                                 FwdCoilSet* coils,      /* Coil descriptors */
+                                 float       **B,        /* Results (3 x ncoil) */
+                                 void        *client);   /* The model */
+
+    static int fwd_bem_pot_els_batch(float       **rd,     /* Dipole positions */
+                                     int         nsource,  /* How many? */
+                                     FwdCoilSet* els,      /* Electrode descriptors */
+                                     float       **pot,    /* Results (3*nsource x nel) */
+                                     void        *client); /* The model */
+
+    static int fwd_bem_pot_els_vec(float       *rd,        /* Dipole position */
+                                   FwdCoilSet* els,        /* Electrode descriptors */
+                                   float       **pot,      /* Results (3 x nel) */
+                                   void        *client);   /* The model */
+
     //============================= compute_forward.c =============================
 
     static void *meg_eeg_fwd_one_source_space(void *arg);
 
+    static int compute_forward_parallel(FwdThreadArg*               one_arg,        /**< Argument to duplicate for each thread */
+                                        MNELIB::MneSourceSpaceOld*  *spaces,        /**< Source spaces */
+                                        int                         nspace,         /**< How many? */
+                                        bool                        meg,            /**< MEG or EEG workspace duplicates */
+                                        bool                        bem_model);     /**< Is a BEM model used? */
+
     // TODO check if this is the correct class or move
     static int compute_forward_meg( MNELIB::MneSourceSpaceOld*  *spaces,        /**< Source spaces */
                                     int                         nspace,         /**< How many? */
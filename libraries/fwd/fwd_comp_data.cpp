@@ -131,6 +131,7 @@ FwdCompData::FwdCompData()
 ,field      (NULL)
 ,vec_field  (NULL)
 ,field_grad (NULL)
+,batch_field(NULL)
 ,client     (NULL)
 ,client_free(NULL)
 ,set        (NULL)
@@ -356,6 +357,53 @@ int FwdCompData::fwd_comp_field_vec(float *rd, FwdCoilSet *coils, float **res, v
 
 //=============================================================================================================
 
+int FwdCompData::fwd_comp_field_batch(float **rd, int nsource, FwdCoilSet *coils, float **res, void *client)
+/*
+ * Calculate the compensated fields (all dipole components at nsource locations)
+ */
+{
+    FwdCompData* comp = (FwdCompData*)client;
+    float        **work;
+    int          k;
+
+    if (!comp->batch_field) {
+        printf("Field computation function is missing in fwd_comp_field_batch");
+        return FAIL;
+    }
+    /*
+     * First compute the field in the primary set of coils
+     */
+    if (comp->batch_field(rd,nsource,coils,res,comp->client) == FAIL)
+        return FAIL;
+    /*
+     * Compensation needed?
+     */
+    if (!comp->comp_coils || comp->comp_coils->ncoil <= 0 || !comp->set || !comp->set->current)
+        return OK;
+    /*
+     * Compute the field at the compensation sensors
+     * The workspace depends on the number of sources and is therefore not kept
+     */
+    work = ALLOC_CMATRIX_60(3*nsource,comp->comp_coils->ncoil);
+    if (comp->batch_field(rd,nsource,comp->comp_coils,work,comp->client) == FAIL) {
+        FREE_CMATRIX_60(work);
+        return FAIL;
+    }
+    /*
+     * Compute the compensated fields
+     */
+    for (k = 0; k < 3*nsource; k++) {
+        if (MneCTFCompDataSet::mne_apply_ctf_comp(comp->set,TRUE,res[k],coils->ncoil,work[k],comp->comp_coils->ncoil) == FAIL) {
+            FREE_CMATRIX_60(work);
+            return FAIL;
+        }
+    }
+    FREE_CMATRIX_60(work);
+    return OK;
+}
+
+//=============================================================================================================
+
 int FwdCompData::fwd_comp_field_grad(float *rd, float *Q, FwdCoilSet* coils, float *res, float *xgrad, float *ygrad, float *zgrad, void *client)
 /*
  * Calculate the compensated field (one dipole component)
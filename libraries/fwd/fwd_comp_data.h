@@ -129,6 +129,12 @@ public:
 
     static int fwd_comp_field_vec(float *rd, FwdCoilSet* coils, float **res, void *client);
 
+    /*
+     * Compensated fields of the x, y, and z dipoles at nsource locations.
+     * Requires batch_field to be set.
+     */
+    static int fwd_comp_field_batch(float **rd, int nsource, FwdCoilSet* coils, float **res, void *client);
+
     static int fwd_comp_field_grad(float *rd,float *Q, FwdCoilSet* coils,
                 float *res, float *xgrad, float *ygrad, float *zgrad,
                 void *client);
@@ -139,6 +145,7 @@ public:
     fwdFieldFunc        field;      /* Computes the field of given direction dipole */
     fwdVecFieldFunc     vec_field;  /* Computes the fields of all three dipole components  */
     fwdFieldGradFunc    field_grad; /* Computes the field and gradient of one dipole direction */
+    fwdBatchFieldFunc   batch_field;/* Computes the fields of all three dipole components at several locations */
     void                *client;    /* Client data to pass to the above functions */
     fwdUserFreeFunc     client_free;
     float               *work;      /* The work areas */
@@ -92,9 +92,12 @@ FwdThreadArg::FwdThreadArg()
 ,field_pot     (NULL)
 ,vec_field_pot (NULL)
 ,field_pot_grad(NULL)
+,batch_field_pot(NULL)
 ,coils_els     (NULL)
 ,client        (NULL)
 ,s             (NULL)
+,first_vert    (0)
+,last_vert     (-1)
 ,fixed_ori     (FALSE)
 ,stat          (FAIL)
 ,comp          (-1)
@@ -119,9 +119,12 @@ public:
     fwdFieldFunc        field_pot;         /* Computes the field or potential for one dipole orientation */
     fwdVecFieldFunc     vec_field_pot;     /* Computes the field or potential for all dipole orientations */
     fwdFieldGradFunc    field_pot_grad;    /* Computes the gradient of field or potential for one dipole orientation */
+    fwdBatchFieldFunc   batch_field_pot;   /* Computes the field or potential for all dipole orientations at several locations */
     FwdCoilSet          *coils_els;        /* The coil definitions */
     void                *client;           /* Client data for the field computation function */
     MNELIB::MneSourceSpaceOld   *s;                 /* The source space to process */
+    int                 first_vert;        /* First source space vertex to process */
+    int                 last_vert;         /* One past the last source space vertex to process (-1 = all vertices) */
     int                 fixed_ori;         /* Compute fixed orientation solution? */
     int                 comp;              /* Which component to compute for free orientations */
     int                 stat;
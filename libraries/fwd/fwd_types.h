@@ -21,6 +21,13 @@ typedef int (*fwdFieldFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils,float *
 typedef int (*fwdVecFieldFunc)(float *rd,FWDLIB::FwdCoilSet* coils,float **res,void *client);
 typedef int (*fwdFieldGradFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils, float *res,
                                 float *xgrad, float *ygrad, float *zgrad, void *client);
+/*
+ * Batched version: the fields of all three dipole components at nsource locations.
+ * The result has 3*nsource rows, ordered as x, y, and z for each source.
+ */
+typedef int (*fwdBatchFieldFunc)(float **rd,int nsource,FWDLIB::FwdCoilSet* coils,float **res,void *client);
+
+#define FWD_BEM_BATCH_SOURCES 64    /* Number of source locations handled by one batched field computation */
 
 //#define FWD_BEM_UNKNOWN           -1
 //#define FWD_BEM_CONSTANT_COLL     1
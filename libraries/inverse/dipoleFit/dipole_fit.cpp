@@ -5,7 +5,14 @@
 #include "guess_data.h"
 
 #include <string.h>
+#include <functional>
+
 #include <QScopedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QVector>
+#include <QtConcurrent>
 
 using namespace INVERSELIB;
 using namespace MNELIB;
@@ -48,6 +55,8 @@ using namespace FWDLIB;
 
 #define EPS_VALUES 0.05
 
+#define FIT_GUESS_BLOCK 16      /* Time points compared with the guesses at once */
+
 //=============================================================================================================
 // STATIC DEFINITIONS ToDo make members
 //=============================================================================================================
@@ -546,6 +555,134 @@ int mne_get_values_from_data_ch (float time,      /* Interesting time point */
     return (0);
 }
 
+//=============================================================================================================
+/*
+ * One time point to fit
+ */
+struct FitTimePoint {
+    float time;         /* The time point */
+    float *B;           /* The data, projected and whitened in place by fit_one */
+    bool  fitted;       /* Was the fit successful? */
+    ECD   dip;          /* The fitted dipole */
+};
+
+/*
+ * The fitting threads. The first one is the calling thread, which uses the original
+ * fitting data; each of the others has a copy of its own.
+ * The pool also runs the raw data reader.
+ */
+struct FitThreads {
+    QThreadPool           pool;
+    QList<DipoleFitData*> fits;
+    QAtomicInt            nfitted;  /* Successful fits so far, for the progress report */
+};
+
+static FitThreads* new_fit_threads(DipoleFitData* fit, int nthreads)
+{
+    FitThreads* t = new FitThreads;
+    int k;
+
+    if (nthreads <= 0)
+        nthreads = QThread::idealThreadCount();
+    nthreads = qMax(1,nthreads);
+
+    t->fits.append(fit);
+    for (k = 1; k < nthreads; k++)
+        t->fits.append(DipoleFitData::create_fit_thread_duplicate(fit));
+    t->pool.setMaxThreadCount(nthreads);     /* nthreads-1 fitting threads + the reader */
+    t->nfitted = 0;
+    return t;
+}
+
+static void free_fit_threads(FitThreads* t)
+{
+    int k;
+
+    if (!t)
+        return;
+    t->pool.waitForDone();
+    for (k = 1; k < t->fits.size(); k++)
+        DipoleFitData::free_fit_thread_duplicate(t->fits[k]);
+    delete t;
+}
+
+static void fit_time_points(FitThreads* t, GuessData* guess, QVector<FitTimePoint>& points, int verbose)
+/*
+ * Fit a dipole to each of the time points.
+ * The time points are processed in blocks of FIT_GUESS_BLOCK consecutive points:
+ * the best guesses of a block are found with one matrix product.
+ * The threads pick up the next block as soon as they are free.
+ * The results are stored with the time points and the blocks are fixed,
+ * i.e., the results do not depend on the number of threads.
+ */
+{
+    int            report_interval = 10;
+    int            nthread         = t->fits.size();
+    FitTimePoint   *p              = points.data();
+    int            np              = points.size();
+    int            nblock          = (np + FIT_GUESS_BLOCK - 1)/FIT_GUESS_BLOCK;
+    QAtomicInt     next(0);
+    QList<QFuture<void> > running;
+    int            k;
+
+    std::function<void(DipoleFitData*)> fitBlocks = [&](DipoleFitData* fit) {
+        float        *B[FIT_GUESS_BLOCK];
+        FitTimePoint *pp[FIT_GUESS_BLOCK];
+        int          best[FIT_GUESS_BLOCK];
+        float        good[FIT_GUESS_BLOCK];
+        int          b,j,first,n,nfitted;
+
+        while ((b = next.fetchAndAddOrdered(1)) < nblock) {
+            first = b*FIT_GUESS_BLOCK;
+            /*
+             * A time point which cannot be prepared stays unfitted,
+             * the rest of the block is fitted as usual
+             */
+            for (j = first, n = 0; j < first + FIT_GUESS_BLOCK && j < np; j++) {
+                p[j].fitted = false;
+                if (DipoleFitData::prepare_fit_data(fit,p[j].B) == FAIL)
+                    continue;
+                pp[n]  = p+j;
+                B[n++] = p[j].B;
+            }
+            if (n == 0 || guess->find_best_guesses(B,n,fit->nmeg+fit->neeg,FIT_RADIAL_LIMIT,best,good) == FAIL)
+                continue;
+            for (j = 0; j < n; j++) {
+                if (best[j] < 0)
+                    continue;
+                /*
+                 * The intermediate reports of several threads would be mixed up
+                 */
+                pp[j]->fitted = DipoleFitData::fit_one_from_guess(fit,guess,best[j],pp[j]->time,B[j],
+                                                                  nthread == 1 ? verbose : FALSE,pp[j]->dip);
+                if (pp[j]->fitted) {
+                    nfitted = t->nfitted.fetchAndAddOrdered(1) + 1;
+                    if (verbose) {
+                        if (nthread == 1)
+                            pp[j]->dip.print(stdout);
+                    }
+                    else if (nfitted % report_interval == 0)
+                        fprintf(stderr,"%d..",nfitted);
+                }
+            }
+        }
+    };
+
+    for (k = 1; k < nthread && k < nblock; k++)
+        running.append(QtConcurrent::run(&t->pool,fitBlocks,t->fits[k]));
+    fitBlocks(t->fits[0]);
+    for (k = 0; k < running.size(); k++)
+        running[k].waitForFinished();
+    /*
+     * In the threaded case the results are listed in order here
+     */
+    if (verbose && nthread > 1)
+        for (k = 0; k < np; k++)
+            if (p[k].fitted)
+                p[k].dip.print(stdout);
+    return;
+}
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -670,11 +807,11 @@ ECDSet DipoleFit::calculateFit() const
              1000*settings->tmin,1000*settings->tmax,1000*settings->tstep,1000*settings->integ);
 
     if (raw) {
-        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess.take(),settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose) == FAIL)
+        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess.take(),settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set,settings->nthreads) == FAIL)
             goto out;
     }
     else {
-        if (fit_dipoles(settings->measname,data,fit_data,guess.take(),settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set) == FAIL)
+        if (fit_dipoles(settings->measname,data,fit_data,guess.take(),settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set,settings->nthreads) == FAIL)
             goto out;
     }
     printf("%d dipoles fitted\n",set.size());
@@ -686,52 +823,57 @@ out : {
 
 //=============================================================================================================
 
-int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads)
 {
-    float *one = MALLOC(data->nchan,float);
+    QVector<FitTimePoint> points;
+    FitTimePoint point;
+    FitThreads*  threads = NULL;
     float time;
     ECDSet set;
-    ECD   dip;
-    int   s;
-    int   report_interval = 10;
+    int   s,k;
 
     set.dataname = dataname;
 
     fprintf(stderr,"Fitting...%c",verbose ? '\n' : '\0');
-    for (s = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
-        /*
-     * Pick the data point
+    /*
+     * Pick the data points
      */
+    for (s = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
+        point.time   = time;
+        point.B      = MALLOC(data->nchan,float);
+        point.fitted = false;
         if (mne_get_values_from_data(time,integ,data->current->data,data->current->np,data->nchan,data->current->tmin,
-                                     1.0/data->current->tstep,FALSE,one) == FAIL) {
+                                     1.0/data->current->tstep,FALSE,point.B) == FAIL) {
             fprintf(stderr,"Cannot pick time: %7.1f ms\n",1000*time);
+            FREE(point.B);
             continue;
         }
+        points.append(point);
+    }
+    /*
+     * Fit them all at once
+     */
+    threads = new_fit_threads(fit,nthreads);
+    fit_time_points(threads,guess,points,verbose);
+    free_fit_threads(threads);
 
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            printf("t = %7.1f ms : %s\n",1000*time,"error (tbd: catch)");
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
-        }
+    for (k = 0; k < points.size(); k++) {
+        if (!points[k].fitted)
+            printf("t = %7.1f ms : %s\n",1000*points[k].time,"error (tbd: catch)");
+        else
+            set.addEcd(points[k].dip);
+        FREE(points[k].B);
     }
     if (!verbose)
         fprintf(stderr,"[done]\n");
-    FREE(one);
     p_set = set;
     return OK;
 }
 
 //=============================================================================================================
 
-int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads)
 {
-    float *one    = MALLOC(sel->nchan,float);
     float sfreq   = raw->info->sfreq;
     float myinteg = integ > 0.0 ? 2*integ : 0.1;
     int   overlap = ceil(myinteg*sfreq);
@@ -739,63 +881,94 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
     int   step    = length - overlap;
     int   stepo   = step + overlap/2;
     int   start   = raw->first_samp;
-    int   s,picks;
+    int   s,k,seg,picks;
     float time,stime;
     float **data  = ALLOC_CMATRIX(sel->nchan,length);
-    ECD    dip;
+    float **next  = ALLOC_CMATRIX(sel->nchan,length);
+    float **tmp;
+    QVector<int>             starts;    /* First sample of each data segment needed */
+    QVector<QVector<float> > times;     /* The time points within each segment */
+    QVector<FitTimePoint>    points;
+    FitTimePoint             point;
+    QFuture<int>             reading;
+    FitThreads*              threads = new_fit_threads(fit,nthreads);
     ECDSet set;
-    int    report_interval = 10;
 
     set.dataname = dataname;
 
     /*
-   * Load the initial data segment
-   */
-    stime = start/sfreq;
-    if (MneRawData::mne_raw_pick_data_filt(raw,sel,start,length,data) == FAIL)
-        goto bad;
-    fprintf(stderr,"Fitting...%c",verbose ? '\n' : '\0');
+     * Assign the time points to the data segments
+     */
     for (s = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
         picks = time*sfreq - start;
-        if (picks > stepo) {		/* Need a new data segment? */
+        while (picks > stepo) {		/* Need a new data segment? */
             start = start + step;
-            if (MneRawData::mne_raw_pick_data_filt(raw,sel,start,length,data) == FAIL)
-                goto bad;
             picks = time*sfreq - start;
-            stime = start/sfreq;
         }
-        /*
-     * Get the values
-     */
-        if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,one) == FAIL) {
-            fprintf(stderr,"Cannot pick time: %8.3f s\n",time);
-            continue;
+        if (starts.isEmpty() || starts.last() != start) {
+            starts.append(start);
+            times.append(QVector<float>());
         }
-        /*
-     * Fit
+        times.last().append(time);
+    }
+    fprintf(stderr,"Fitting...%c",verbose ? '\n' : '\0');
+    /*
+     * Load the initial data segment
      */
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            qWarning() << "Error";
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
+    if (starts.size() > 0)
+        reading = QtConcurrent::run(&threads->pool,MneRawData::mne_raw_pick_data_filt,raw,sel,starts[0],length,next);
+    for (seg = 0; seg < starts.size(); seg++) {
+        reading.waitForFinished();
+        if (reading.result() == FAIL)
+            goto bad;
+        tmp  = data;
+        data = next;
+        next = tmp;
+        /*
+         * Read the next segment while fitting this one
+         */
+        if (seg < starts.size()-1)
+            reading = QtConcurrent::run(&threads->pool,MneRawData::mne_raw_pick_data_filt,raw,sel,starts[seg+1],length,next);
+        stime = starts[seg]/sfreq;
+        /*
+         * Get the values
+         */
+        points.clear();
+        for (k = 0; k < times[seg].size(); k++) {
+            point.time   = times[seg][k];
+            point.B      = MALLOC(sel->nchan,float);
+            point.fitted = false;
+            if (mne_get_values_from_data_ch (point.time,integ,data,length,sel->nchan,stime,sfreq,FALSE,point.B) == FAIL) {
+                fprintf(stderr,"Cannot pick time: %8.3f s\n",point.time);
+                FREE(point.B);
+                continue;
             }
+            points.append(point);
+        }
+        /*
+         * Fit
+         */
+        fit_time_points(threads,guess,points,verbose);
+        for (k = 0; k < points.size(); k++) {
+            if (!points[k].fitted)
+                qWarning() << "Error";
+            else
+                set.addEcd(points[k].dip);
+            FREE(points[k].B);
         }
     }
     if (!verbose)
         fprintf(stderr,"[done]\n");
+    free_fit_threads(threads);
     FREE_CMATRIX(data);
-    FREE(one);
+    FREE_CMATRIX(next);
     p_set = set;
     return OK;
 
 bad : {
+        free_fit_threads(threads);
         FREE_CMATRIX(data);
-        FREE(one);
+        FREE_CMATRIX(next);
         return FAIL;
     }
 }
@@ -805,5 +978,5 @@ bad : {
 int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose)
 {
     ECDSet set;
-    return fit_dipoles_raw(dataname, raw, sel, fit, guess, tmin, tmax, tstep, integ, verbose, set);
+    return fit_dipoles_raw(dataname, raw, sel, fit, guess, tmin, tmax, tstep, integ, verbose, set, 1);
 }
@@ -7,6 +7,7 @@
 #include "../c/mne_meas_data_set.h"
 #include <mne/c/mne_proj_item.h>
 #include <mne/c/mne_cov_matrix.h>
+#include <mne/c/mne_ctf_comp_data_set.h>
 #include "ecd.h"
 
 #include <fiff/fiff_stream.h>
@@ -1320,6 +1321,8 @@ static dipoleFitFuncs new_dipole_fit_funcs()
     f->eeg_pot       = NULL;
     f->meg_vec_field = NULL;
     f->eeg_vec_pot   = NULL;
+    f->meg_batch_field = NULL;
+    f->eeg_batch_pot   = NULL;
     f->meg_client      = NULL;
     f->meg_client_free = NULL;
     f->eeg_client      = NULL;
@@ -3465,9 +3468,10 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
            * It works the same way independent of whether or not the compensation is in effect
            */
             comp = FwdCompData::fwd_make_comp_data(comp_data,d->meg_coils,comp_coils,
-                                      FwdBemModel::fwd_bem_field,NULL,NULL,d->bem_model,NULL);
+                                      FwdBemModel::fwd_bem_field,FwdBemModel::fwd_bem_field_vec,NULL,d->bem_model,NULL);
             if (!comp)
                 goto out;
+            comp->batch_field = FwdBemModel::fwd_bem_field_batch;
             printf("Compensation setup done.\n");
 
             printf("MEG solution matrix...");
@@ -3478,7 +3482,8 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
             printf("[done]\n");
 
             f->meg_field       = FwdCompData::fwd_comp_field;
-            f->meg_vec_field   = NULL;
+            f->meg_vec_field   = FwdCompData::fwd_comp_field_vec;
+            f->meg_batch_field = FwdCompData::fwd_comp_field_batch;
             f->meg_client      = comp;
             f->meg_client_free = FwdCompData::fwd_free_comp_data;
         }
@@ -3487,9 +3492,10 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
             if (FwdBemModel::fwd_bem_specify_els(d->bem_model,d->eeg_els) == FAIL)
                 goto out;
             printf("[done]\n");
-            f->eeg_pot     = FwdBemModel::fwd_bem_pot_els;
-            f->eeg_vec_pot = NULL;
-            f->eeg_client  = d->bem_model;
+            f->eeg_pot       = FwdBemModel::fwd_bem_pot_els;
+            f->eeg_vec_pot   = FwdBemModel::fwd_bem_pot_els_vec;
+            f->eeg_batch_pot = FwdBemModel::fwd_bem_pot_els_batch;
+            f->eeg_client    = d->bem_model;
         }
     }
     if (d->neeg > 0 && !d->eeg_model) {
@@ -4237,21 +4243,15 @@ out : {
 
 //=============================================================================================================
 
-DipoleForward* dipole_forward(DipoleFitData* d,
-                              float         **rd,
-                              int           ndip,
-                              DipoleForward* old)
+static DipoleForward* alloc_dipole_forward(DipoleFitData* d,
+                                           int           ndip,
+                                           DipoleForward* old)
 /*
- * Compute the forward solution and do other nice stuff
+ * Reuse old if it has the right dimensions, otherwise allocate anew
  */
 {
     DipoleForward* res;
-    float         **this_fwd;
-    float         S[3];
-    int           k,p;
-    /*
-   * Allocate data if necessary
-   */
+
     if (old && old->ndip == ndip && old->nch == d->nmeg+d->neeg) {
         res = old;
     }
@@ -4267,15 +4267,21 @@ DipoleForward* dipole_forward(DipoleFitData* d,
         res->scales = MALLOC_3(3*ndip,float);
         res->ndip = ndip;
     }
+    return res;
+}
 
-    for (k = 0; k < ndip; k++) {
-        VEC_COPY_3(res->rd[k],rd[k]);
-        this_fwd = res->fwd + 3*k;
-        /*
-     * Calculate the field of three orthogonal dipoles
-     */
-        if ((DipoleFitData::compute_dipole_field(d,rd[k],TRUE,this_fwd)) == FAIL)
-            goto bad;
+//=============================================================================================================
+
+static int decompose_dipole_forward(DipoleFitData* d,
+                                    DipoleForward* res)
+/*
+ * Normalize the columns of the fields in res->fwd and compute the SVD
+ */
+{
+    float S[3];
+    int   k,p;
+
+    for (k = 0; k < res->ndip; k++) {
         /*
      * Choice of column normalization
      * (componentwise normalization is not recommended)
@@ -4312,7 +4318,38 @@ DipoleForward* dipole_forward(DipoleFitData* d,
     /*
    * SVD
    */
-    if (mne_svd_3(res->fwd,3*ndip,d->nmeg+d->neeg,res->sing,res->vv,res->uu) != 0)
+    if (mne_svd_3(res->fwd,3*res->ndip,res->nch,res->sing,res->vv,res->uu) != 0)
+        return FAIL;
+    return OK;
+}
+
+//=============================================================================================================
+
+DipoleForward* dipole_forward(DipoleFitData* d,
+                              float         **rd,
+                              int           ndip,
+                              DipoleForward* old)
+/*
+ * Compute the forward solution and do other nice stuff
+ */
+{
+    DipoleForward* res;
+    int           k;
+    /*
+   * Allocate data if necessary
+   */
+    res = alloc_dipole_forward(d,ndip,old);
+    if (res != old)
+        old = NULL;
+
+    for (k = 0; k < ndip; k++)
+        VEC_COPY_3(res->rd[k],rd[k]);
+    /*
+   * Calculate the field of three orthogonal dipoles at each location
+   */
+    if ((DipoleFitData::compute_dipole_fields(d,rd,ndip,TRUE,res->fwd)) == FAIL)
+        goto bad;
+    if (decompose_dipole_forward(d,res) == FAIL)
         goto bad;
 
     return res;
@@ -4338,6 +4375,44 @@ DipoleForward* DipoleFitData::dipole_forward_one(DipoleFitData* d,
     return dipole_forward(d,rds,1,old);
 }
 
+//=============================================================================================================
+
+int DipoleFitData::dipole_forward_many(DipoleFitData* d,
+                                       float         **rd,
+                                       int           nsource,
+                                       DipoleForward** fwds)
+/*
+ * Compute single-dipole forward solutions at many locations.
+ * The fields are computed FWD_BEM_BATCH_SOURCES locations at a time.
+ */
+{
+    int   nch = d->nmeg+d->neeg;
+    float **fields = ALLOC_CMATRIX_3(3*FWD_BEM_BATCH_SOURCES,nch);
+    int   j,k,p,c,nbatch;
+
+    for (j = 0; j < nsource; j += nbatch) {
+        nbatch = nsource - j < FWD_BEM_BATCH_SOURCES ? nsource - j : FWD_BEM_BATCH_SOURCES;
+        if (compute_dipole_fields(d,rd+j,nbatch,TRUE,fields) == FAIL)
+            goto bad;
+        for (k = 0; k < nbatch; k++) {
+            fwds[j+k] = alloc_dipole_forward(d,1,fwds[j+k]);
+            VEC_COPY_3(fwds[j+k]->rd[0],rd[j+k]);
+            for (p = 0; p < 3; p++)
+                for (c = 0; c < nch; c++)
+                    fwds[j+k]->fwd[p][c] = fields[3*k+p][c];
+            if (decompose_dipole_forward(d,fwds[j+k]) == FAIL)
+                goto bad;
+        }
+    }
+    FREE_CMATRIX_3(fields);
+    return OK;
+
+bad : {
+        FREE_CMATRIX_3(fields);
+        return FAIL;
+    }
+}
+
 //=============================================================================================================
 // fit_dipoles.c
 static float fit_eval(float *rd,int npar,void *user)
@@ -4363,48 +4438,6 @@ static float fit_eval(float *rd,int npar,void *user)
     return fuser->B2-Bm2;
 }
 
-static int find_best_guess(float     *B,         /* The whitened data */
-                           int       nch,
-                           GuessData* guess,	 /* Guesses */
-                           float     limit,	 /* Pseudoradial component omission limit */
-                           int       *bestp,	 /* Which is the best */
-                           float     *goodp)	 /* Best goodness of fit */
-/*
- * Thanks to the precomputed SVD everything is really simple
- */
-{
-    int    k,c;
-    double B2,Bm2,this_good,one;
-    int    best = -1;
-    float  good = 0.0;
-    DipoleForward* fwd;
-    int    ncomp;
-
-    B2 = mne_dot_vectors_3(B,B,nch);
-    for (k = 0; k < guess->nguess; k++) {
-        fwd = guess->guess_fwd[k];
-        if (fwd->nch == nch) {
-            ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
-            for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
-                one = mne_dot_vectors_3(fwd->uu[c],B,nch);
-                Bm2 = Bm2 + one*one;
-            }
-            this_good = 1.0 - (B2 - Bm2)/B2;
-            if (this_good > good) {
-                best = k;
-                good = this_good;
-            }
-        }
-    }
-    if (best < 0) {
-        printf("No reasonable initial guess found.");
-        return FAIL;
-    }
-     *bestp = best;
-     *goodp = good;
-    return OK;
-}
-
 static float **make_initial_dipole_simplex(float  *r0,
                                            float  size)
 /*
@@ -4658,6 +4691,22 @@ int simplex_minimize(float **p,		                              /* The initial si
 
 //=============================================================================================================
 // fit_dipoles.c
+int DipoleFitData::prepare_fit_data(DipoleFitData* fit, float *B)
+/*
+ * Project and whiten the data to fit
+ */
+{
+    int nchan = fit->nmeg+fit->neeg;
+
+    if (MneProjOp::mne_proj_op_proj_vector(fit->proj,B,nchan,TRUE) == FAIL)
+        return FAIL;
+    if (mne_whiten_one_data(B,B,nchan,fit->noise) == FAIL)
+        return FAIL;
+    return OK;
+}
+
+//=============================================================================================================
+
 bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitting data */
                     GuessData*     guess,	            /* The initial guesses */
                     float         time,              /* Which time is it? */
@@ -4665,10 +4714,34 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
                     int           verbose,
                     ECD&          res               /* The fitted dipole */
                     )
+{
+    int   best;
+    float good;
+
+    if (prepare_fit_data(fit,B) == FAIL)
+        return false;
+    /*
+   * Get the initial guess
+   */
+    if (guess->find_best_guesses(&B,1,fit->nmeg+fit->neeg,FIT_RADIAL_LIMIT,&best,&good) == FAIL || best < 0)
+        return false;
+    return fit_one_from_guess(fit,guess,best,time,B,verbose,res);
+}
+
+//=============================================================================================================
+
+bool DipoleFitData::fit_one_from_guess(DipoleFitData* fit,	    /* Precomputed fitting data */
+                               GuessData*     guess,	    /* The initial guesses */
+                               int           best,              /* The best initial guess */
+                               float         time,              /* Which time is it? */
+                               float         *B,	            /* The projected and whitened field to fit */
+                               int           verbose,
+                               ECD&          res                /* The fitted dipole */
+                               )
 {
     float  **simplex       = NULL;	       /* The simplex */
     float  vals[4];			       /* Values at the vertices */
-    float  limit           = 0.2;	               /* (pseudo) radial component omission limit */
+    float  limit           = FIT_RADIAL_LIMIT;   /* (pseudo) radial component omission limit */
     float  size            = 1e-2;	       /* Size of the initial simplex */
     float  ftol[]          = { 1e-2, 1e-2 };     /* Tolerances on the the two passes */
     float  atol[]          = { 0.2e-3, 0.2e-3 }; /* If dipole movement between two iterations is less than this,
@@ -4677,8 +4750,7 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     int    max_eval        = 1000;	       /* Limit for fit function evaluations */
     int    report_interval = verbose ? 1 : -1;   /* How often to report the intermediate result */
 
-    int        best;
-    float      good,rd_guess[3],rd_final[3],Q[3],final_val;
+    float      rd_guess[3],rd_final[3],Q[3],final_val;
     fitDipUserRec user;
     int        k,p,neval,neval_tot,nchan,ncomp;
     int        fit_fail;
@@ -4686,17 +4758,6 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     nchan = fit->nmeg+fit->neeg;
     user.fwd = NULL;
 
-    if (MneProjOp::mne_proj_op_proj_vector(fit->proj,B,nchan,TRUE) == FAIL)
-        goto bad;
-
-    if (mne_whiten_one_data(B,B,nchan,fit->noise) == FAIL)
-        goto bad;
-    /*
-   * Get the initial guess
-   */
-    if (find_best_guess(B,nchan,guess,limit,&best,&good) < 0)
-        goto bad;
-
     user.limit = limit;
     user.B     = B;
     user.B2    = mne_dot_vectors_3(B,B,nchan);
@@ -4786,6 +4847,167 @@ bad : {
 
 //=============================================================================================================
 
+static FwdBemModel* dup_bem_model_workspace(FwdBemModel* orig)
+/*
+ * Shallow copy of a BEM model with a private work area for the infinite-medium potentials
+ */
+{
+    FwdBemModel* res = new FwdBemModel;
+
+    *res    = *orig;
+    res->v0 = NULL;
+    return res;
+}
+
+//=============================================================================================================
+
+static void free_bem_model_workspace(FwdBemModel* m)
+/*
+ * Free a copy made with dup_bem_model_workspace. The shared parts are left alone.
+ */
+{
+    if (!m)
+        return;
+    m->surfs.clear();
+    m->nsurf       = 0;
+    m->ntri        = NULL;
+    m->np          = NULL;
+    m->sigma       = NULL;
+    m->gamma       = NULL;
+    m->source_mult = NULL;
+    m->field_mult  = NULL;
+    m->solution    = NULL;
+    m->head_mri_t  = NULL;
+    delete m;                   /* This frees v0 */
+}
+
+//=============================================================================================================
+
+static FwdCompData* dup_comp_data_workspace(FwdCompData* orig, void *client)
+/*
+ * Copy of the compensated field computation data with private work areas
+ */
+{
+    FwdCompData* comp = new FwdCompData;
+
+    *comp = *orig;
+    comp->work     = NULL;
+    comp->vec_work = NULL;
+    comp->set      = orig->set ? new MneCTFCompDataSet(*(orig->set)) : NULL;
+    comp->client   = client;
+    return comp;
+}
+
+//=============================================================================================================
+
+static void free_comp_data_workspace(void *d)
+{
+    FwdCompData* comp = (FwdCompData*)d;
+
+    if (!comp)
+        return;
+    comp->comp_coils  = NULL;   /* Shared with the original */
+    comp->client      = NULL;
+    comp->client_free = NULL;
+    delete comp;                /* This frees the compensation data and the work areas */
+}
+
+//=============================================================================================================
+
+static dipoleFitFuncs dup_dipole_fit_funcs(dipoleFitFuncs f, DipoleFitData* orig, DipoleFitData* res)
+/*
+ * Copy a set of forward functions. The client data pointing to the forward models
+ * of orig are replaced by the private ones of res.
+ */
+{
+    dipoleFitFuncs dup;
+    FwdCompData*   comp;
+    void           *client;
+
+    if (!f)
+        return NULL;
+    dup = new_dipole_fit_funcs();
+    *dup = *f;
+    if (f->meg_client) {
+        comp   = (FwdCompData*)f->meg_client;
+        client = comp->client;
+        if (client && client == orig->bem_model)
+            client = res->bem_model;
+        else if (client && client == orig->r0)
+            client = res->r0;
+        dup->meg_client      = dup_comp_data_workspace(comp,client);
+        dup->meg_client_free = free_comp_data_workspace;
+    }
+    if (f->eeg_client && f->eeg_client == orig->bem_model)
+        dup->eeg_client = res->bem_model;
+    else if (f->eeg_client && f->eeg_client == orig->eeg_model)
+        dup->eeg_client = res->eeg_model;
+    dup->eeg_client_free = NULL;    /* The models go with res */
+    return dup;
+}
+
+//=============================================================================================================
+
+DipoleFitData* DipoleFitData::create_fit_thread_duplicate(DipoleFitData* d)
+/*
+ * Create a duplicate to make fit_one thread safe
+ * Do not duplicate read-only parts of the relevant structures
+ */
+{
+    DipoleFitData* res = new DipoleFitData;
+
+    *res = *d;
+    res->user      = NULL;
+    res->user_free = NULL;
+    res->bem_model = d->bem_model ? dup_bem_model_workspace(d->bem_model) : NULL;
+    res->eeg_model = d->eeg_model ? new FwdEegSphereModel(*(d->eeg_model)) : NULL;
+
+    res->sphere_funcs     = dup_dipole_fit_funcs(d->sphere_funcs,d,res);
+    res->bem_funcs        = dup_dipole_fit_funcs(d->bem_funcs,d,res);
+    res->mag_dipole_funcs = dup_dipole_fit_funcs(d->mag_dipole_funcs,d,res);
+    if (d->funcs && d->funcs == d->bem_funcs)
+        res->funcs = res->bem_funcs;
+    else if (d->funcs && d->funcs == d->mag_dipole_funcs)
+        res->funcs = res->mag_dipole_funcs;
+    else
+        res->funcs = res->sphere_funcs;
+    return res;
+}
+
+//=============================================================================================================
+
+void DipoleFitData::free_fit_thread_duplicate(DipoleFitData* d)
+{
+    if (!d)
+        return;
+    free_dipole_fit_funcs(d->sphere_funcs);
+    free_dipole_fit_funcs(d->bem_funcs);
+    free_dipole_fit_funcs(d->mag_dipole_funcs);
+    d->sphere_funcs     = NULL;
+    d->bem_funcs        = NULL;
+    d->mag_dipole_funcs = NULL;
+    d->funcs            = NULL;
+
+    free_bem_model_workspace(d->bem_model);
+    d->bem_model = NULL;
+    /*
+     * The rest is shared with the original; the private EEG model goes with the destructor
+     */
+    d->mri_head_t = NULL;
+    d->meg_head_t = NULL;
+    d->meg_coils  = NULL;
+    d->eeg_els    = NULL;
+    d->noise      = NULL;
+    d->noise_orig = NULL;
+    d->pick       = NULL;
+    d->proj       = NULL;
+    d->user       = NULL;
+    d->user_free  = NULL;
+    delete d;
+}
+
+//=============================================================================================================
+
 int DipoleFitData::compute_dipole_field(DipoleFitData* d, float *rd, int whiten, float **fwd)
 /*
  * Compute the field and take whitening and projection into account
@@ -4873,3 +5095,58 @@ int DipoleFitData::compute_dipole_field(DipoleFitData* d, float *rd, int whiten,
 bad :
     return FAIL;
 }
+
+//=============================================================================================================
+
+int DipoleFitData::compute_dipole_fields(DipoleFitData* d, float **rd, int nsource, int whiten, float **fwd)
+/*
+ * Compute the fields of three orthogonal dipoles at several locations
+ * and take whitening and projection into account
+ */
+{
+    float **eeg_fwd = NULL;
+    int   j,k;
+    /*
+   * Without batched forward functions, go through the locations one by one
+   */
+    if ((d->nmeg > 0 && !d->funcs->meg_batch_field) || (d->neeg > 0 && !d->funcs->eeg_batch_pot)) {
+        for (j = 0; j < nsource; j++)
+            if (compute_dipole_field(d,rd[j],whiten,fwd+3*j) == FAIL)
+                return FAIL;
+        return OK;
+    }
+    /*
+   * Compute the fields
+   */
+    if (d->nmeg > 0) {
+        if (d->funcs->meg_batch_field(rd,nsource,d->meg_coils,fwd,d->funcs->meg_client) != OK)
+            goto bad;
+    }
+    if (d->neeg > 0) {
+        eeg_fwd = MALLOC_3(3*nsource,float *);
+        for (k = 0; k < 3*nsource; k++)
+            eeg_fwd[k] = fwd[k]+d->nmeg;
+        if (d->funcs->eeg_batch_pot(rd,nsource,d->eeg_els,eeg_fwd,d->funcs->eeg_client) != OK)
+            goto bad;
+        FREE_3(eeg_fwd); eeg_fwd = NULL;
+    }
+    /*
+   * Apply projection
+   */
+    for (k = 0; k < 3*nsource; k++)
+        if (MneProjOp::mne_proj_op_proj_vector(d->proj,fwd[k],d->nmeg+d->neeg,TRUE) == FAIL)
+            goto bad;
+    /*
+   * Whiten
+   */
+    if (d->noise && whiten) {
+        if (mne_whiten_data(fwd,fwd,3*nsource,d->nmeg+d->neeg,d->noise) == FAIL)
+            goto bad;
+    }
+    return OK;
+
+bad : {
+        FREE_3(eeg_fwd);
+        return FAIL;
+    }
+}
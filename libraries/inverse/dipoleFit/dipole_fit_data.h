@@ -67,6 +67,8 @@
 #define COLUMN_NORM_COMP 1	    /* Componentwise normalization */
 #define COLUMN_NORM_LOC  2	    /* Dipole locationwise normalization */
 
+#define FIT_RADIAL_LIMIT 0.2f	    /* (pseudo) radial component omission limit in fitting */
+
 //=============================================================================================================
 // DEFINE NAMESPACE INVERSELIB
 //=============================================================================================================
@@ -84,11 +86,13 @@ typedef void (*fitUserFreeFunc)(void *);
 typedef struct {
   fwdFieldFunc    meg_field;	    /* MEG forward calculation functions */
   fwdVecFieldFunc meg_vec_field;
+  fwdBatchFieldFunc meg_batch_field;  /* Fields of several dipole locations at once (optional) */
   void            *meg_client;	    /* Client data for MEG field computations */
   mneUserFreeFunc meg_client_free;
 
   fwdFieldFunc    eeg_pot;	    /* EEG forward calculation functions */
   fwdVecFieldFunc eeg_vec_pot;
+  fwdBatchFieldFunc eeg_batch_pot;    /* Potentials of several dipole locations at once (optional) */
   void            *eeg_client;	    /* Client data for EEG field computations */
   mneUserFreeFunc eeg_client_free;
 } *dipoleFitFuncs,dipoleFitFuncsRec;
@@ -180,16 +184,77 @@ public:
      */
     static bool fit_one(DipoleFitData* fit, GuessData* guess, float time, float *B, int verbose, ECD& res);
 
+    //=========================================================================================================
+    /**
+     * Project and whiten the data to fit. This is the first step of fit_one.
+     *
+     * @param[in] fit        Precomputed fitting data
+     * @param[in,out] B      The field to fit, processed in place
+     *
+     * @return OK or FAIL
+     */
+    static int prepare_fit_data(DipoleFitData* fit, float *B);
+
+    //=========================================================================================================
+    /**
+     * Fit a single dipole to data processed with prepare_fit_data, starting from a known best guess.
+     * This allows finding the best guesses of several time points at once with GuessData::find_best_guesses.
+     *
+     * @param[in] fit        Precomputed fitting data
+     * @param[in] guess      The initial guesses
+     * @param[in] best       Index of the best initial guess
+     * @param[in] time       Which time is it?
+     * @param[in] B          The projected and whitened field to fit
+     * @param[in] verbose
+     * @param[in] res        The fitted dipole
+     */
+    static bool fit_one_from_guess(DipoleFitData* fit, GuessData* guess, int best, float time, float *B, int verbose, ECD& res);
+
+    //=========================================================================================================
+    /**
+     * Create a copy of the fitting data for calling fit_one in a thread of its own.
+     * The forward model work areas and the fitting state are private to the copy,
+     * the read-only parts are shared with the original.
+     *
+     * @param[in] d          Precomputed fitting data
+     *
+     * @return The copy, to be released with free_fit_thread_duplicate
+     */
+    static DipoleFitData* create_fit_thread_duplicate(DipoleFitData* d);
+
+    //=========================================================================================================
+    /**
+     * Free a copy made with create_fit_thread_duplicate. The shared data is left alone.
+     *
+     * @param[in] d          The copy to free
+     */
+    static void free_fit_thread_duplicate(DipoleFitData* d);
+
 //============================= dipole_forward.c
 
     static int compute_dipole_field(DipoleFitData* d, float *rd, int whiten, float **fwd);
 
+    /*
+     * Compute the fields of three orthogonal dipoles at nsource locations into the 3*nsource rows of fwd.
+     * The batched forward functions are used if available.
+     */
+    static int compute_dipole_fields(DipoleFitData* d, float **rd, int nsource, int whiten, float **fwd);
+
     //============================= dipole_forward.c
 
     static DipoleForward* dipole_forward_one(DipoleFitData* d,
                                      float         *rd,
                                      DipoleForward* old);
 
+    /*
+     * Single-dipole forward solutions at nsource locations, computed in blocks of sources.
+     * Existing entries of fwds are reused.
+     */
+    static int dipole_forward_many(DipoleFitData* d,
+                                   float         **rd,
+                                   int           nsource,
+                                   DipoleForward** fwds);
+
 public:
       FIFFLIB::FiffCoordTransOld*    mri_head_t; /**< MRI <-> head coordinate transformation */
       FIFFLIB::FiffCoordTransOld*    meg_head_t; /**< MEG <-> head coordinate transformation */
@@ -103,6 +103,7 @@ void DipoleFitSettings::initMembers()
     do_baseline  = false;         
     setno        = 1;             
     verbose      = false;
+    nthreads     = 0;
     omit_data_proj = false;
 
          
@@ -263,6 +264,7 @@ void DipoleFitSettings::usage(char *name)
     printf("\t--mindist dist/mm Exclude points which are closer than this distance from the inner skull surface  (default = %6.1f mm).\n",1000*guess_mindist);
     printf("\t--grid    dist/mm Source space grid size (default = %6.1f mm).\n",1000*guess_grid);
     printf("\t--magdip          Fit magnetic dipoles instead of current dipoles.\n");
+    printf("\t--threads n       Number of threads used in fitting (default : one per core).\n");
     printf("\nOutput:\n\n");
     printf("\t--dip     name    xfit dip format output file name\n");
     printf("\t--bdip    name    xfit bdip format output file name\n");
@@ -823,6 +825,18 @@ bool DipoleFitSettings::check_args (int *argc,char **argv)
             }
             bdipname = QString(argv[k+1]);
         }
+        else if (strcmp(argv[k],"--threads") == 0) {
+            found = 2;
+            if (k == *argc - 1) {
+                qCritical ("--threads: argument required.");
+                return false;
+            }
+            if (sscanf(argv[k+1],"%d",&ival) != 1 || ival < 0) {
+                qCritical() << "Illegal number of threads:" << argv[k+1];
+                return false;
+            }
+            nthreads = ival;
+        }
         else if (strcmp(argv[k],"--verbose") == 0) {
             found = 1;
             verbose = true;
@@ -144,6 +144,7 @@ float guess_rad;       			/**< Radius of spherical guess surface */
     bool  do_baseline;         		/**< Are both baseline limits set? */
     int   setno;             		/**< Which data set */
     bool  verbose;
+    int   nthreads;         		/**< Number of fitting threads (0 = one per core) */
     MNELIB::mneFilterDefRec filter;
     QStringList projnames;              /**< Projection file names */
     bool omit_data_proj;
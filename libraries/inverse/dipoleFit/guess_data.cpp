@@ -48,6 +48,9 @@
 #include <fiff/fiff_tag.h>
 
 #include <QFile>
+#include <QDir>
+#include <QCoreApplication>
+#include <QCryptographicHash>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -76,6 +79,11 @@ using namespace INVERSELIB;
 #define OK 0
 #endif
 
+#define GUESS_CACHE_VERSION 1       /* Bump when the guess field computation changes */
+#define GUESS_CACHE_ENV     "MNE_GUESS_FIELD_CACHE"     /* The guess field cache directory, no caching if unset */
+#define GUESS_CACHE_MAGIC   0x4d4e4547  /* Also detects a different byte order */
+#define GUESS_CACHE_NPROBE  8           /* How many guess fields enter the cache file name */
+
 #define X_16 0
 #define Y_16 1
 #define Z_16 2
@@ -189,7 +197,6 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
     int            k,p;
     float          guessrad = 0.080;
     MneSourceSpaceOld* guesses = NULL;
-    dipoleFitFuncs orig;
 
     if (!guessname.isEmpty()) {
         /*
@@ -242,30 +249,14 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
         }
     delete guesses; guesses = NULL;
 
-    fprintf(stderr,"Go through all guess source locations...");
     this->guess_fwd = MALLOC_16(this->nguess,DipoleForward*);
     for (k = 0; k < this->nguess; k++)
         this->guess_fwd[k] = NULL;
     /*
         * Compute the guesses using the sphere model for speed
         */
-    orig = f->funcs;
-    if (f->fit_mag_dipoles)
-        f->funcs = f->mag_dipole_funcs;
-    else
-        f->funcs = f->sphere_funcs;
-
-    for (k = 0; k < this->nguess; k++) {
-        if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],NULL)) == NULL)
-            goto bad;
-#ifdef DEBUG
-        sing = this->guess_fwd[k]->sing;
-        printf("%f %f %f\n",sing[0],sing[1],sing[2]);
-#endif
-    }
-    f->funcs = orig;
-
-    fprintf(stderr,"[done %d sources]\n",p);
+    if (!this->compute_guess_fields(f))
+        goto bad;
 
     return;
 //    return res;
@@ -400,6 +391,7 @@ GuessData::~GuessData()
 bool GuessData::compute_guess_fields(DipoleFitData* f)
 {
     dipoleFitFuncs orig = NULL;
+    QString        cache_name;
 
     if (!f) {
         qCritical("Data missing in compute_guess_fields");
@@ -409,25 +401,266 @@ bool GuessData::compute_guess_fields(DipoleFitData* f)
         qCritical("Noise covariance missing in compute_guess_fields");
         return false;
     }
-    printf("Go through all guess source locations...");
     orig = f->funcs;
     if (f->fit_mag_dipoles)
         f->funcs = f->mag_dipole_funcs;
     else
         f->funcs = f->sphere_funcs;
-    for (int k = 0; k < this->nguess; k++) {
-        if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],this->guess_fwd[k])) == NULL){
+    /*
+     * Unless the same guesses were computed before
+     */
+    cache_name = guess_fields_cache_name(f);
+    if (!cache_name.isEmpty() && read_guess_fields_cache(cache_name,f->nmeg+f->neeg))
+        printf("Read the guess fields from %s [%d sources]\n",cache_name.toUtf8().constData(),this->nguess);
+    else {
+        printf("Go through all guess source locations...");
+        if (DipoleFitData::dipole_forward_many(f,this->rr,this->nguess,this->guess_fwd) == FAIL) {
             if (orig)
                 f->funcs = orig;
             return false;
         }
-#ifdef DEBUG
-        sing = this->guess_fwd[k]->sing;
-        printf("%f %f %f\n",sing[0],sing[1],sing[2]);
-#endif
+        printf("[done %d sources]\n",this->nguess);
+        if (!cache_name.isEmpty() && write_guess_fields_cache(cache_name))
+            printf("Saved the guess fields to %s\n",cache_name.toUtf8().constData());
     }
     f->funcs = orig;
-    printf("[done %d sources]\n",this->nguess);
+    make_guess_scan();
+
+    return true;
+}
+
+//=============================================================================================================
+
+void GuessData::make_guess_scan()
+{
+    int nch = 0;
+    int k,c;
+
+    for (k = 0; k < this->nguess; k++)
+        if (this->guess_fwd[k]) {
+            nch = this->guess_fwd[k]->nch;
+            break;
+        }
+    this->scan_uu    = MatrixXf::Zero(3*this->nguess,nch);
+    this->scan_ratio = VectorXf::Zero(this->nguess);
+    for (k = 0; k < this->nguess; k++) {
+        DipoleForward* fwd = this->guess_fwd[k];
+        /*
+         * Guesses with a different number of channels stay zero, i.e., they never win
+         */
+        if (!fwd || fwd->nch != nch)
+            continue;
+        for (c = 0; c < 3; c++)
+            this->scan_uu.row(3*k+c) = Map<RowVectorXf>(fwd->uu[c],nch);
+        this->scan_ratio[k] = fwd->sing[2]/fwd->sing[0];
+    }
+    return;
+}
+
+//=============================================================================================================
+
+int GuessData::find_best_guesses(float **B, int nB, int nch, float limit, int *best, float *good) const
+/*
+ * Thanks to the precomputed SVD everything is really simple
+ */
+{
+    MatrixXf Bm(nch,nB);
+    MatrixXf proj;
+    double   B2,Bm2,this_good,one;
+    int      b,k,c,ncomp;
+
+    if (nB <= 0)
+        return OK;
+    if (this->scan_uu.rows() != 3*this->nguess || this->scan_uu.cols() != nch) {
+        printf("Guess fields do not match the data in find_best_guesses");
+        return FAIL;
+    }
+    for (b = 0; b < nB; b++)
+        Bm.col(b) = Map<VectorXf>(B[b],nch);
+    /*
+     * Projections of all data vectors on the singular vectors of all guesses
+     */
+    proj.noalias() = this->scan_uu*Bm;
+
+    for (b = 0; b < nB; b++) {
+        B2      = Bm.col(b).cast<double>().squaredNorm();
+        best[b] = -1;
+        good[b] = 0.0;
+        for (k = 0; k < this->nguess; k++) {
+            ncomp = this->scan_ratio[k] > limit ? 3 : 2;
+            for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
+                one = proj(3*k+c,b);
+                Bm2 = Bm2 + one*one;
+            }
+            this_good = 1.0 - (B2 - Bm2)/B2;
+            if (this_good > good[b]) {
+                best[b] = k;
+                good[b] = this_good;
+            }
+        }
+        if (best[b] < 0)
+            printf("No reasonable initial guess found.");
+    }
+    return OK;
+}
+
+//=============================================================================================================
+
+QString GuessData::guess_fields_cache_name(DipoleFitData *f) const
+/*
+ * Hash everything the guess fields depend on. Rather than going through the details
+ * of the forward model, the noise covariance and the projection, a few whitened guess fields
+ * are included in the hash: if anything changes, so do they.
+ * The cache is off unless a directory is given with MNE_GUESS_FIELD_CACHE.
+ * Returns an empty string if no cache directory is available.
+ */
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    int     nch    = f->nmeg+f->neeg;
+    int     nprobe = this->nguess < GUESS_CACHE_NPROBE ? this->nguess : GUESS_CACHE_NPROBE;
+    float   **probe_rd = NULL;
+    float   **probe    = NULL;
+    QString dir_name;
+    qint32  ival;
+    int     k;
+
+    if (this->nguess <= 0 || nch <= 0)
+        return QString();
+    dir_name = QString::fromLocal8Bit(qgetenv(GUESS_CACHE_ENV));
+    if (dir_name.isEmpty())
+        return QString();
+
+    ival = GUESS_CACHE_VERSION;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = this->nguess;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = f->nmeg;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = f->neeg;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = f->column_norm;
+    hash.addData((const char*)&ival,sizeof(ival));
+    ival = f->fit_mag_dipoles;
+    hash.addData((const char*)&ival,sizeof(ival));
+    hash.addData(f->ch_names.join(" ").toUtf8());
+    hash.addData((const char*)this->rr[0],3*this->nguess*sizeof(float));
+    /*
+     * The probes are spread over the guess grid
+     */
+    probe_rd = MALLOC_16(nprobe,float*);
+    for (k = 0; k < nprobe; k++)
+        probe_rd[k] = this->rr[nprobe > 1 ? (k*(this->nguess-1))/(nprobe-1) : 0];
+    probe = ALLOC_CMATRIX_16(3*nprobe,nch);
+    if (DipoleFitData::compute_dipole_fields(f,probe_rd,nprobe,TRUE,probe) == FAIL) {
+        FREE_16(probe_rd);
+        FREE_CMATRIX_16(probe);
+        return QString();
+    }
+    hash.addData((const char*)probe[0],3*nprobe*nch*sizeof(float));
+    FREE_16(probe_rd);
+    FREE_CMATRIX_16(probe);
 
+    if (!QDir().mkpath(dir_name))
+        return QString();
+    return QString("%1/%2-guess.dat").arg(dir_name).arg(QString(hash.result().toHex()));
+}
+
+//=============================================================================================================
+
+bool GuessData::read_guess_fields_cache(const QString &name, int nch)
+/*
+ * The file has a header (magic, version, nguess, nch) followed by
+ * rd, scales, sing, vv, fwd, and uu of each guess as raw floats
+ */
+{
+    QFile  file(name);
+    qint32 header[4];
+    qint64 nfloat = 3+3+3+9+3*nch+3*nch;
+    DipoleForward* fwd;
+    int    k;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    if (file.size() != (qint64)sizeof(header) + this->nguess*nfloat*(qint64)sizeof(float))
+        return false;
+    if (file.read((char*)header,sizeof(header)) != (qint64)sizeof(header))
+        return false;
+    if (header[0] != GUESS_CACHE_MAGIC || header[1] != GUESS_CACHE_VERSION || header[2] != this->nguess || header[3] != nch)
+        return false;
+
+    for (k = 0; k < this->nguess; k++) {
+        if (!this->guess_fwd[k] || this->guess_fwd[k]->ndip != 1 || this->guess_fwd[k]->nch != nch) {
+            delete this->guess_fwd[k];
+            fwd = this->guess_fwd[k] = new DipoleForward;
+            fwd->fwd    = ALLOC_CMATRIX_16(3,nch);
+            fwd->uu     = ALLOC_CMATRIX_16(3,nch);
+            fwd->vv     = ALLOC_CMATRIX_16(3,3);
+            fwd->sing   = MALLOC_16(3,float);
+            fwd->nch    = nch;
+            fwd->rd     = ALLOC_CMATRIX_16(1,3);
+            fwd->scales = MALLOC_16(3,float);
+            fwd->ndip   = 1;
+        }
+        fwd = this->guess_fwd[k];
+        if (file.read((char*)fwd->rd[0],3*sizeof(float)) != (qint64)(3*sizeof(float)) ||
+                file.read((char*)fwd->scales,3*sizeof(float)) != (qint64)(3*sizeof(float)) ||
+                file.read((char*)fwd->sing,3*sizeof(float)) != (qint64)(3*sizeof(float)) ||
+                file.read((char*)fwd->vv[0],9*sizeof(float)) != (qint64)(9*sizeof(float)) ||
+                file.read((char*)fwd->fwd[0],3*nch*sizeof(float)) != (qint64)(3*nch*sizeof(float)) ||
+                file.read((char*)fwd->uu[0],3*nch*sizeof(float)) != (qint64)(3*nch*sizeof(float)))
+            return false;
+    }
+    return true;
+}
+
+//=============================================================================================================
+
+bool GuessData::write_guess_fields_cache(const QString &name) const
+/*
+ * The file is written under a temporary name first so that concurrent
+ * runs never see a partially written file
+ */
+{
+    QString tmp_name = QString("%1.%2.tmp").arg(name).arg(QCoreApplication::applicationPid());
+    QFile   file(tmp_name);
+    qint32  header[4];
+    DipoleForward* fwd;
+    int     nch,k;
+    bool    ok = true;
+
+    if (this->nguess <= 0 || !this->guess_fwd[0])
+        return false;
+    nch = this->guess_fwd[0]->nch;
+    header[0] = GUESS_CACHE_MAGIC;
+    header[1] = GUESS_CACHE_VERSION;
+    header[2] = this->nguess;
+    header[3] = nch;
+
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    ok = file.write((const char*)header,sizeof(header)) == (qint64)sizeof(header);
+    for (k = 0; ok && k < this->nguess; k++) {
+        fwd = this->guess_fwd[k];
+        if (!fwd || fwd->ndip != 1 || fwd->nch != nch) {
+            ok = false;
+            break;
+        }
+        ok = file.write((const char*)fwd->rd[0],3*sizeof(float)) == (qint64)(3*sizeof(float)) &&
+                file.write((const char*)fwd->scales,3*sizeof(float)) == (qint64)(3*sizeof(float)) &&
+                file.write((const char*)fwd->sing,3*sizeof(float)) == (qint64)(3*sizeof(float)) &&
+                file.write((const char*)fwd->vv[0],9*sizeof(float)) == (qint64)(9*sizeof(float)) &&
+                file.write((const char*)fwd->fwd[0],3*nch*sizeof(float)) == (qint64)(3*nch*sizeof(float)) &&
+                file.write((const char*)fwd->uu[0],3*nch*sizeof(float)) == (qint64)(3*nch*sizeof(float));
+    }
+    file.close();
+    if (!ok) {
+        QFile::remove(tmp_name);
+        return false;
+    }
+    QFile::remove(name);
+    if (!QFile::rename(tmp_name,name)) {
+        QFile::remove(tmp_name);
+        return false;
+    }
     return true;
 }
@@ -55,6 +55,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QString>
 
 //=============================================================================================================
 // DEFINE NAMESPACE INVERSELIB
@@ -134,11 +135,54 @@ public:
      */
     bool compute_guess_fields(DipoleFitData* f);
 
+    //=========================================================================================================
+    /**
+     * Find the best guess for each of several data vectors.
+     * The data vectors are correlated with the guess fields of all guesses in one matrix product.
+     *
+     * @param[in] B          The whitened data vectors
+     * @param[in] nB         How many data vectors
+     * @param[in] nch        Number of channels
+     * @param[in] limit      Pseudoradial component omission limit
+     * @param[out] best      The best guess for each data vector (-1 if none was found)
+     * @param[out] good      The corresponding goodness of fit
+     *
+     * @return OK or FAIL
+     */
+    int find_best_guesses(float **B, int nB, int nch, float limit, int *best, float *good) const;
+
+    //=========================================================================================================
+    /**
+     * On-disk cache of the guess fields. The file name is derived from a hash of the guess locations,
+     * the channels, and the whitened fields of a few guesses. The latter capture the forward model,
+     * the sensor definitions, the device to head transformation, the projection, and the noise covariance.
+     * The cache is used only if its directory is given with the MNE_GUESS_FIELD_CACHE environment variable.
+     *
+     * @param[in] f      Dipole Fit Data with the guess forward functions in effect
+     *
+     * @return The cache file name, empty if no cache is available
+     */
+    QString guess_fields_cache_name(DipoleFitData* f) const;
+
+    bool read_guess_fields_cache(const QString& name, int nch);
+
+    bool write_guess_fields_cache(const QString& name) const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Collect the left singular vectors of all guesses for find_best_guesses
+     */
+    void make_guess_scan();
+
 public:
     float          **rr;            /**< These are the guess dipole locations */
     DipoleForward** guess_fwd;      /**< Forward solutions for the guesses */
     int            nguess;          /**< How many sources */
 
+    Eigen::MatrixXf scan_uu;        /**< The left singular vectors of all guesses, three rows per guess */
+    Eigen::VectorXf scan_ratio;     /**< The ratio of the smallest and largest singular value of each guess */
+
 // ### OLD STRUCT ###
 //    typedef struct {
 //        float          **rr;                    /**< These are the guess dipole locations */
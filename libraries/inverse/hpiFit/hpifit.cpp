@@ -61,6 +61,7 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QElapsedTimer>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 
@@ -84,6 +85,7 @@ using namespace FWDLIB;
 HPIFit::HPIFit(FiffInfo::SPtr pFiffInfo,
                bool bDoFastFit)
     : m_bDoFastFit(bDoFastFit)
+    , m_bWarmStart(false)
 {
     // init member variables
     m_lChannels = QList<FIFFLIB::FiffChInfo>();
@@ -97,6 +99,8 @@ HPIFit::HPIFit(FiffInfo::SPtr pFiffInfo,
     m_coilTemplate = NULL;
     m_coilMeg = NULL;
 
+    resetTiming();
+
     updateChannels(pFiffInfo);
     updateSensor();
 }
@@ -116,6 +120,10 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
                     int iMaxIterations,
                     float fAbortError)
 {
+    QElapsedTimer timerTotal, timerStage;
+    timerTotal.start();
+    timerStage.start();
+
     //Check if data was passed
     if(t_mat.rows() == 0 || t_mat.cols() == 0 ) {
         std::cout<<std::endl<< "HPIFit::fitHPI - No data passed. Returning.";
@@ -128,6 +136,7 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
     }
 
     bool bUpdateModel = false;
+    bool bUpdateProjector = false;
 
     // check if bads have changed and update coils/channellist if so
     if(!(m_lBads == pFiffInfo->bads) || m_lChannels.isEmpty()) {
@@ -135,6 +144,7 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         updateChannels(pFiffInfo);
         updateSensor();
         bUpdateModel = true;
+        bUpdateProjector = true;
     }
 
     if(m_lChannels.isEmpty()) {
@@ -147,6 +157,17 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         updateModel(pFiffInfo->sfreq, t_mat.cols(), pFiffInfo->linefreq, vecFreqs);
         m_vecFreqs = vecFreqs;
         bUpdateModel = false;
+
+        // the last coil positions belong to other coils or channels
+        m_matCoilPosLast.resize(0,0);
+    }
+
+    // the inner channel projector only changes with the bads or the passed projectors
+    if(bUpdateProjector ||
+       m_matProjectors.rows() != t_matProjectors.rows() ||
+       m_matProjectors.cols() != t_matProjectors.cols() ||
+       m_matProjectors != t_matProjectors) {
+        updateProjector(t_matProjectors);
     }
 
     // Make sure the fitted digitzers are empty
@@ -199,17 +220,8 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         matHeadHPI.fill(0);
     }
 
-    //Create new projector based on the excluded channels, first exclude the rows then the columns
-    MatrixXd matProjectorsRows(m_vecInnerind.size(),t_matProjectors.cols());
-    MatrixXd matProjectorsInnerind(m_vecInnerind.size(),m_vecInnerind.size());
-
-    for (int i = 0; i < matProjectorsRows.rows(); ++i) {
-        matProjectorsRows.row(i) = t_matProjectors.row(m_vecInnerind.at(i));
-    }
-
-    for (int i = 0; i < matProjectorsInnerind.cols(); ++i) {
-        matProjectorsInnerind.col(i) = matProjectorsRows.col(m_vecInnerind.at(i));
-    }
+    m_timing.iSetup += timerStage.nsecsElapsed();
+    timerStage.restart();
 
     // Get the data from inner layer channels
     MatrixXd matInnerdata(m_vecInnerind.size(), t_mat.cols());
@@ -249,6 +261,9 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         }
     }
 
+    m_timing.iAmplitudes += timerStage.nsecsElapsed();
+    timerStage.restart();
+
     //Find good seed point/starting point for the coil position in 3D space
     //Find biggest amplitude per pickup coil (sensor) and store corresponding sensor channel index
     VectorXi vecChIdcs(iNumCoils);
@@ -275,21 +290,32 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
                 matCoilPos.row(j) = (-1 * pFiffInfo->chs.at(vecChIdcs(j)).chpos.ez * 0.03 + r0).cast<double>();
             }
         }
+    } else if(m_bWarmStart && m_matCoilPosLast.rows() == iNumCoils) {
+        // continue from the last fitted positions, they are closer to the coils than the transformed digitizers
+        matCoilPos = m_matCoilPosLast;
     } else {
         matCoilPos = transDevHead.apply_inverse_trans(matHeadHPI.cast<float>()).cast<double>();
     }
 
     coil.pos = matCoilPos;
 
+    m_timing.iSeed += timerStage.nsecsElapsed();
+    timerStage.restart();
+
     // Perform actual localization
     coil = dipfit(coil,
                   m_sensors,
                   matAmp,
                   iNumCoils,
-                  matProjectorsInnerind,
+                  m_matProjectorsInnerind,
                   iMaxIterations,
                   fAbortError);
 
+    m_matCoilPosLast = coil.pos;
+
+    m_timing.iDipfit += timerStage.nsecsElapsed();
+    timerStage.restart();
+
     Matrix4d matTrans = computeTransformation(matHeadHPI, coil.pos);
     //Eigen::Matrix4d matTrans = computeTransformation(coil.pos, matHeadHPI);
 
@@ -334,6 +360,10 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         fittedPointSet << digPoint;
     }
 
+    m_timing.iTransformation += timerStage.nsecsElapsed();
+    m_timing.iTotal += timerTotal.nsecsElapsed();
+    m_timing.iNumFits++;
+
     if(bDoDebug) {
         // DEBUG HPI fitting and write debug results
         std::cout << std::endl << std::endl << "HPIFit::fitHPI - dpfiterror" << coil.dpfiterror << std::endl << std::endl;
@@ -633,6 +663,33 @@ void HPIFit::storeHeadPosition(float fTime,
 
 //=============================================================================================================
 
+void HPIFit::setWarmStart(bool bWarmStart)
+{
+    m_bWarmStart = bWarmStart;
+}
+
+//=============================================================================================================
+
+const HpiFitTiming& HPIFit::getTiming() const
+{
+    return m_timing;
+}
+
+//=============================================================================================================
+
+void HPIFit::resetTiming()
+{
+    m_timing.iSetup = 0;
+    m_timing.iAmplitudes = 0;
+    m_timing.iSeed = 0;
+    m_timing.iDipfit = 0;
+    m_timing.iTransformation = 0;
+    m_timing.iTotal = 0;
+    m_timing.iNumFits = 0;
+}
+
+//=============================================================================================================
+
 void HPIFit::updateSensor()
 {
     // Create MEG-Coils and read data
@@ -663,6 +720,10 @@ void HPIFit::updateChannels(QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo)
     // Get the indices of inner layer channels and exclude bad channels and create channellist
     int iNumCh = pFiffInfo->nchan;
 
+    m_vecInnerind.clear();
+    m_lChannels.clear();
+    m_matCoilPosLast.resize(0,0);
+
     for (int i = 0; i < iNumCh; ++i) {
         if(pFiffInfo->chs[i].chpos.coil_type == FIFFV_COIL_BABY_MAG ||
            pFiffInfo->chs[i].chpos.coil_type == FIFFV_COIL_VV_PLANAR_T1 ||
@@ -724,3 +785,22 @@ void HPIFit::updateModel(const int iSamF,
     }
     m_matModel = matTemp;
 }
+
+//=============================================================================================================
+
+void HPIFit::updateProjector(const MatrixXd& t_matProjectors)
+{
+    //Create new projector based on the excluded channels, first exclude the rows then the columns
+    MatrixXd matProjectorsRows(m_vecInnerind.size(),t_matProjectors.cols());
+    m_matProjectorsInnerind.resize(m_vecInnerind.size(),m_vecInnerind.size());
+
+    for (int i = 0; i < matProjectorsRows.rows(); ++i) {
+        matProjectorsRows.row(i) = t_matProjectors.row(m_vecInnerind.at(i));
+    }
+
+    for (int i = 0; i < m_matProjectorsInnerind.cols(); ++i) {
+        m_matProjectorsInnerind.col(i) = matProjectorsRows.col(m_vecInnerind.at(i));
+    }
+
+    m_matProjectors = t_matProjectors;
+}
@@ -110,6 +110,19 @@ struct HpiFitResult {
     float                       fHeadMovementAngle;
 };
 
+/**
+ * The struct specifing the accumulated run times of the fit stages in nanoseconds.
+ */
+struct HpiFitTiming {
+    qint64 iSetup;              /**< Channel, sensor, model and projector updates */
+    qint64 iAmplitudes;         /**< Coil amplitude estimation from the data */
+    qint64 iSeed;               /**< Seed point generation */
+    qint64 iDipfit;             /**< Dipole fits of all coils */
+    qint64 iTransformation;     /**< Dev/head transformation and error computation */
+    qint64 iTotal;              /**< Whole fitHPI call */
+    int iNumFits;               /**< Number of fits the times are accumulated over */
+};
+
 /**
  * The strucut specifing the sensor parameters.
  */
@@ -222,6 +235,31 @@ public:
                                   Eigen::MatrixXd& matPosition,
                                   const Eigen::VectorXd& vecGoF,
                                   const QVector<double>& vecError);
+
+    //=========================================================================================================
+    /**
+     * Sets whether the coil fits start from the coil positions of the last fit. The warm start is only used if the
+     * coils, frequencies and bad channels did not change and the last fit was good, otherwise the seed points are
+     * generated as usual. Useful for continuous HPI fitting. Default is false.
+     *
+     * @param[in] bWarmStart    Whether to start from the last coil positions.
+     */
+    void setWarmStart(bool bWarmStart);
+
+    //=========================================================================================================
+    /**
+     * Returns the run times of the fit stages, accumulated since construction or the last call of resetTiming.
+     *
+     * @return The accumulated run times.
+     */
+    const HpiFitTiming& getTiming() const;
+
+    //=========================================================================================================
+    /**
+     * Resets the accumulated run times of the fit stages.
+     */
+    void resetTiming();
+
 protected:
     //=========================================================================================================
     /**
@@ -314,6 +352,22 @@ private:
 
     QVector<int>        m_vecFreqs;         /**< The frequencies for each coil in unknown order. */
 
+    //=========================================================================================================
+    /**
+     * Update the projector restricted to the inner channels
+     *
+     * @param[in] t_matProjectors   The projectors to apply. Bad channels are still included.
+     */
+    void updateProjector(const Eigen::MatrixXd& t_matProjectors);
+
+    Eigen::MatrixXd     m_matProjectors;            /**< The projectors the inner channel projector was created from */
+    Eigen::MatrixXd     m_matProjectorsInnerind;    /**< The projectors restricted to the inner channels */
+
+    Eigen::MatrixXd     m_matCoilPosLast;   /**< The coil positions of the last fit, empty if there is none to start from */
+    bool                m_bWarmStart;       /**< Start the coil fits from the last coil positions */
+
+    HpiFitTiming        m_timing;           /**< The accumulated run times of the fit stages */
+
 };
 
 //=============================================================================================================
@@ -105,54 +105,23 @@ void HPIFitData::doDipfitConcurrent()
 
 //=============================================================================================================
 
-Eigen::MatrixXd HPIFitData::magnetic_dipole(Eigen::MatrixXd matPos,
-                                            Eigen::MatrixXd matPnt,
-                                            Eigen::MatrixXd matOri)
+Eigen::MatrixXd HPIFitData::magnetic_dipole(const Eigen::MatrixXd& matPos,
+                                            const Eigen::MatrixXd& matPnt,
+                                            const Eigen::MatrixXd& matOri)
 {
-    double u0 = 1e-7;
-    int iNchan;
-    Eigen::MatrixXd r, r2, r5, x, y, z, mx, my, mz, Tx, Ty, Tz, lf;
+    const double u0 = 1e-7;
+    const int iNchan = matPnt.rows();
+    const Eigen::RowVector3d vecPos(matPos(0), matPos(1), matPos(2));
 
-    iNchan = matPnt.rows();
-
-    // Shift the magnetometers so that the dipole is in the origin
-    matPnt.array().col(0) -=matPos(0);
-    matPnt.array().col(1) -=matPos(1);
-    matPnt.array().col(2) -=matPos(2);
-
-    r = matPnt.array().square().rowwise().sum().sqrt();
-
-    r2 = r5 = x = y = z = mx = my = mz = Tx = Ty = Tz = lf = Eigen::MatrixXd::Zero(iNchan,3);
+    Eigen::MatrixXd lf(iNchan,3);
 
+    // lf_i = u0/(4*pi*r^5) * (3*(pnt_i . ori_i)*pnt_i - r^2*ori_i), with the dipole shifted into the origin
     for(int i = 0;i < iNchan;i++) {
-        r2.row(i).array().fill(pow(r(i),2));
-        r5.row(i).array().fill(pow(r(i),5));
-    }
+        const Eigen::RowVector3d vecPnt = matPnt.row(i) - vecPos;
+        const double r2 = vecPnt.squaredNorm();
+        const double r5 = r2 * r2 * std::sqrt(r2);
 
-    for(int i = 0;i < iNchan;i++) {
-        x.row(i).array().fill(matPnt(i,0));
-        y.row(i).array().fill(matPnt(i,1));
-        z.row(i).array().fill(matPnt(i,2));
-    }
-
-    mx.col(0).array().fill(1);
-    my.col(1).array().fill(1);
-    mz.col(2).array().fill(1);
-
-    Tx = 3 * x.cwiseProduct(matPnt) - mx.cwiseProduct(r2);
-    Ty = 3 * y.cwiseProduct(matPnt) - my.cwiseProduct(r2);
-    Tz = 3 * z.cwiseProduct(matPnt) - mz.cwiseProduct(r2);
-
-    for(int i = 0;i < iNchan;i++) {
-        lf(i,0) = Tx.row(i).dot(matOri.row(i));
-        lf(i,1) = Ty.row(i).dot(matOri.row(i));
-        lf(i,2) = Tz.row(i).dot(matOri.row(i));
-    }
-
-    for(int i = 0;i < iNchan;i++) {
-        for(int j = 0;j < 3;j++) {
-            lf(i,j) = u0 * lf(i,j)/(4 * M_PI * r5(i,j));
-        }
+        lf.row(i) = (u0 / (4 * M_PI * r5)) * (3 * vecPnt.dot(matOri.row(i)) * vecPnt - r2 * matOri.row(i));
     }
 
     return lf;
@@ -162,14 +131,8 @@ Eigen::MatrixXd HPIFitData::magnetic_dipole(Eigen::MatrixXd matPos,
 
 Eigen::MatrixXd HPIFitData::compute_leadfield(const Eigen::MatrixXd& matPos, const SensorSet& sensors)
 {
-
-    Eigen::MatrixXd matPnt, matOri, matLf;
-    matPnt = sensors.rmag; // position of each integrationpoint
-    matOri = sensors.cosmag; // mOrientation of each coil
-
-    matLf = magnetic_dipole(matPos, matPnt, matOri);
-
-    return matLf;
+    // position of each integrationpoint and orientation of each coil
+    return magnetic_dipole(matPos, sensors.rmag, sensors.cosmag);
 }
 
 //=============================================================================================================
@@ -198,7 +161,7 @@ DipFitError HPIFitData::dipfitError(const Eigen::MatrixXd& matPos,
     e.moment = UTILSLIB::MNEMath::pinv(matLf) * matData;
 
     //matDif = matData - matLf * e.moment;
-    matDif = matData - matProjectors * matLf * e.moment;
+    matDif = matData - matProjectors * (matLf * e.moment);
 
     e.error = matDif.array().square().sum()/matData.array().square().sum();
 
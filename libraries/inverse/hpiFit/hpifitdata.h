@@ -138,9 +138,9 @@ protected:
      * magnetic_dipole leadfield for a magnetic dipole in an infinite medium.
      * The function has been compared with matlab magnetic_dipole and it gives same output.
      */
-    Eigen::MatrixXd magnetic_dipole(Eigen::MatrixXd matPos,
-                                    Eigen::MatrixXd matPnt,
-                                    Eigen::MatrixXd matOri);
+    Eigen::MatrixXd magnetic_dipole(const Eigen::MatrixXd& matPos,
+                                    const Eigen::MatrixXd& matPnt,
+                                    const Eigen::MatrixXd& matOri);
 
     //=========================================================================================================
     /**
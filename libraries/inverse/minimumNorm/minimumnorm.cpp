@@ -68,6 +68,7 @@ using namespace FIFFLIB;
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bFactoredKernel(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -78,6 +79,7 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bFactoredKernel(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -188,39 +190,13 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
         return MNESourceEstimate();
     }
 
-    if(K.cols() != data.rows()) {
-        qWarning() << "MinimumNorm::calculateInverse - Dimension mismatch between K.cols() and data.rows() -" << K.cols() << "and" << data.rows();
+    qint32 iNumChannels = m_bFactoredKernel ? K_right.cols() : K.cols();
+    if(iNumChannels != data.rows()) {
+        qWarning() << "MinimumNorm::calculateInverse - Dimension mismatch between K.cols() and data.rows() -" << iNumChannels << "and" << data.rows();
         return MNESourceEstimate();
     }
 
-    MatrixXd sol = K * data; //apply imaging kernel
-
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI && pick_normal == false)
-    {
-        printf("combining the current components...\n");
-
-        MatrixXd sol1(sol.rows()/3,sol.cols());
-        for(qint32 i = 0; i < sol.cols(); ++i)
-        {
-            VectorXd* tmp = MNEMath::combine_xyz(sol.col(i));
-            sol1.block(0,i,sol.rows()/3,1) = tmp->cwiseSqrt();
-            delete tmp;
-        }
-        sol.resize(sol1.rows(),sol1.cols());
-        sol = sol1;
-    }
-
-    if (m_bdSPM)
-    {
-        printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
-    }
-    else if (m_bsLORETA)
-    {
-        printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
-    }
-    printf("[done]\n");
+    MatrixXd sol = applyKernel(data, VectorXi(), pick_normal);
 
     //Results
     VectorXi p_vecVertices(inv.src[0].vertno.size() + inv.src[1].vertno.size());
@@ -235,6 +211,58 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
 
 //=============================================================================================================
 
+MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data,
+                                                float tmin,
+                                                float tstep,
+                                                const FSLIB::Label &label,
+                                                qint32 iSample,
+                                                bool pick_normal) const
+{
+    if(!inverseSetup)
+    {
+        qWarning("MinimumNorm::calculateInverse - Inverse not setup -> call doInverseSetup first!");
+        return MNESourceEstimate();
+    }
+
+    qint32 iNumChannels = m_bFactoredKernel ? K_right.cols() : K.cols();
+    if(iNumChannels != data.rows()) {
+        qWarning() << "MinimumNorm::calculateInverse - Dimension mismatch between K.cols() and data.rows() -" << iNumChannels << "and" << data.rows();
+        return MNESourceEstimate();
+    }
+
+    if(iSample >= data.cols()) {
+        qWarning() << "MinimumNorm::calculateInverse - Sample" << iSample << "exceeds the number of samples" << data.cols();
+        return MNESourceEstimate();
+    }
+
+    //Source selection
+    VectorXi src_sel;
+    VectorXi p_vecVertices;
+
+    if(label.isEmpty()) {
+        p_vecVertices = VectorXi(inv.src[0].vertno.size() + inv.src[1].vertno.size());
+        p_vecVertices << inv.src[0].vertno, inv.src[1].vertno;
+    } else {
+        QList<VectorXi> vertno_sel = inv.src.label_src_vertno_sel(label, src_sel);
+
+        if(src_sel.size() == 0) {
+            qWarning("MinimumNorm::calculateInverse - No sources within the label.");
+            return MNESourceEstimate();
+        }
+
+        p_vecVertices = VectorXi(vertno_sel[0].size() + vertno_sel[1].size());
+        p_vecVertices.head(vertno_sel[0].size()) = vertno_sel[0];
+        p_vecVertices.tail(vertno_sel[1].size()) = vertno_sel[1];
+    }
+
+    if(iSample < 0)
+        return MNESourceEstimate(applyKernel(data, src_sel, pick_normal), p_vecVertices, tmin, tstep);
+
+    return MNESourceEstimate(applyKernel(data.col(iSample), src_sel, pick_normal), p_vecVertices, tmin + iSample*tstep, tstep);
+}
+
+//=============================================================================================================
+
 void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
 {
     //
@@ -243,15 +271,99 @@ void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
     inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
 
     printf("Computing inverse...\n");
-    inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+    if(m_bFactoredKernel)
+    {
+        inv.assemble_kernel_factors(label, m_sMethod, pick_normal, K_left, K_right, noise_norm, vertno);
+        K = MatrixXd();
+
+        //
+        //   The noise normalization is a positive scaling per source -> it commutes with the norm over the
+        //   current components and can be folded into the left factor
+        //
+        if (m_bdSPM || m_bsLORETA)
+        {
+            VectorXd vecNoiseNorm = inv.noisenorm.diagonal();
+            qint32 iRowsPerSource = K_left.rows() / vecNoiseNorm.size();
 
-    std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+            for(qint32 i = 0; i < vecNoiseNorm.size(); ++i)
+                K_left.middleRows(i*iRowsPerSource, iRowsPerSource) *= vecNoiseNorm[i];
+        }
+
+        std::cout << "K " << K_left.rows() << " x " << K_left.cols() << " * " << K_right.rows() << " x " << K_right.cols() << std::endl;
+    }
+    else
+    {
+        inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+        K_left = MatrixXd();
+        K_right = MatrixXd();
+
+        std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+    }
 
     inverseSetup = true;
 }
 
 //=============================================================================================================
 
+MatrixXd MinimumNorm::applyKernel(const MatrixXd &data, const VectorXi &vecSel, bool pick_normal) const
+{
+    const MatrixXd& matKernel = m_bFactoredKernel ? K_left : K;
+    qint32 iRowsPerSource = matKernel.rows() / inv.nsource;
+
+    MatrixXd sol;
+
+    if(vecSel.size() == 0)
+    {
+        if(m_bFactoredKernel)
+            sol = K_left * (K_right * data); //apply imaging kernel
+        else
+            sol = K * data; //apply imaging kernel
+    }
+    else
+    {
+        MatrixXd matKernelSel(vecSel.size()*iRowsPerSource, matKernel.cols());
+        for(qint32 i = 0; i < vecSel.size(); ++i)
+            matKernelSel.middleRows(i*iRowsPerSource, iRowsPerSource) = matKernel.middleRows(vecSel[i]*iRowsPerSource, iRowsPerSource);
+
+        if(m_bFactoredKernel)
+            sol = matKernelSel * (K_right * data); //apply imaging kernel
+        else
+            sol = matKernelSel * data; //apply imaging kernel
+    }
+
+    if (inv.source_ori == FIFFV_MNE_FREE_ORI && pick_normal == false && iRowsPerSource == 3)
+    {
+        printf("combining the current components...\n");
+
+        MatrixXd sol1(sol.rows()/3,sol.cols());
+        for(qint32 i = 0; i < sol.cols(); ++i)
+            for(qint32 j = 0; j < sol1.rows(); ++j)
+                sol1(j,i) = sol.block<3,1>(3*j,i).norm();
+        sol = sol1;
+    }
+
+    //Already folded into the factored kernel
+    if (!m_bFactoredKernel && (m_bdSPM || m_bsLORETA))
+    {
+        printf("%s", m_bdSPM ? "(dSPM)..." : "(sLORETA)...");
+        if(vecSel.size() == 0)
+        {
+            sol = inv.noisenorm*sol;
+        }
+        else
+        {
+            VectorXd vecNoiseNorm = inv.noisenorm.diagonal();
+            for(qint32 i = 0; i < vecSel.size(); ++i)
+                sol.row(i) *= vecNoiseNorm[vecSel[i]];
+        }
+    }
+    printf("[done]\n");
+
+    return sol;
+}
+
+//=============================================================================================================
+
 const char* MinimumNorm::getName() const
 {
     return "Minimum Norm Estimate";
@@ -314,3 +426,10 @@ void MinimumNorm::setRegularization(float lambda)
 {
     m_fLambda = lambda;
 }
+
+//=============================================================================================================
+
+void MinimumNorm::setFactoredKernel(bool bFactored)
+{
+    m_bFactoredKernel = bFactored;
+}
@@ -114,6 +114,28 @@ public:
 
     virtual MNELIB::MNESourceEstimate calculateInverse(const Eigen::MatrixXd &data, float tmin, float tstep, bool pick_normal = false) const;
 
+    //=========================================================================================================
+    /**
+     * Computes the source estimate of the sources within a label and/or of a single sample only. Only the
+     * corresponding kernel rows and data columns are applied.
+     *
+     * @param[in] data           The data matrix (channels x samples).
+     * @param[in] tmin           Time of the first sample.
+     * @param[in] tstep          Time between two samples.
+     * @param[in] label          Only sources within this label are computed (empty label: all sources).
+     * @param[in] iSample        Only this sample is computed (-1: all samples).
+     * @param[in] pick_normal    If True, rather than pooling the orientations by taking the norm, only the
+     *                           radial component is kept. This is only applied when working with loose orientations.
+     *
+     * @return the calculated source estimation
+     */
+    MNELIB::MNESourceEstimate calculateInverse(const Eigen::MatrixXd &data,
+                                               float tmin,
+                                               float tstep,
+                                               const FSLIB::Label &label,
+                                               qint32 iSample = -1,
+                                               bool pick_normal = false) const;
+
     //=========================================================================================================
     /**
      * Perform the inverse setup: Prepares this inverse operator and assembles the kernel.
@@ -175,13 +197,36 @@ public:
 
     //=========================================================================================================
     /**
-     * Get the assembled kernel
+     * Keep the imaging kernel factored as K = K_left*K_right (rank <= number of channels) with the noise
+     * normalization folded into K_left. A source estimate then costs O(rank*(sources + channels)) per sample.
+     * Takes effect with the next doInverseSetup.
+     *
+     * @param[in] bFactored   Whether to keep the kernel factored (default false).
+     */
+    void setFactoredKernel(bool bFactored);
+
+    //=========================================================================================================
+    /**
+     * Get the assembled kernel. The kernel is empty when it is kept factored.
      *
      * @return the assembled kernel
      */
     inline Eigen::MatrixXd& getKernel();
 
 private:
+    //=========================================================================================================
+    /**
+     * Applies the imaging kernel to the data, combines the current components and applies the noise
+     * normalization.
+     *
+     * @param[in] data           The data matrix (channels x samples).
+     * @param[in] vecSel         Indices of the sources to compute (empty: all sources).
+     * @param[in] pick_normal    Whether only the normal component is kept.
+     *
+     * @return the source values (sources x samples)
+     */
+    Eigen::MatrixXd applyKernel(const Eigen::MatrixXd &data, const Eigen::VectorXi &vecSel, bool pick_normal) const;
+
     MNELIB::MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
     float m_fLambda;                                /**< Regularization parameter */
     QString m_sMethod;                              /**< Selected method */
@@ -194,6 +239,10 @@ private:
     QList<Eigen::VectorXi> vertno;                  /**< The vertices numbers */
     FSLIB::Label label;                             /**< The corresponding labels */
     Eigen::MatrixXd K;                              /**< Imaging kernel */
+
+    bool m_bFactoredKernel;                         /**< Keep the imaging kernel factored */
+    Eigen::MatrixXd K_left;                         /**< Left kernel factor, noise normalization folded in (sources x rank) */
+    Eigen::MatrixXd K_right;                        /**< Right kernel factor (rank x channels) */
 };
 
 //=============================================================================================================
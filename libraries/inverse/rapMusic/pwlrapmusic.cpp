@@ -165,6 +165,7 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
 //        p_pRapDipoles = new RapDipoles<T>();
 //    }
     p_RapDipoles.clear();
+    m_pairSearchStats = PairSearchStats();
 
     std::cout << "##### Calculation of PWL RAP MUSIC started ######\n\n";
 
@@ -212,31 +213,112 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
 
         int t_iNumVecElements = m_iNumGridPoints;
 
+        //Per-source factors for the row evaluation, shared by all Powell steps of this iteration
+        PairSearchFactors t_factors;
+        if(!m_bExhaustiveSearch)
+            calcPairSearchFactors(t_matProj_LeadField, t_matU_B, t_factors);
+
         while(t_iMaxFound == 0)
         {
-
-            //Multithreading correlation calculation
-            #ifdef _OPENMP
-            #pragma omp parallel num_threads(m_iMaxNumThreads)
-            #endif
+            if(m_bExhaustiveSearch)
             {
-            #ifdef _OPENMP
-            #pragma omp for
-            #endif
-                for(int i = 0; i < t_iNumVecElements; i++)
+                //Multithreading correlation calculation
+                #ifdef _OPENMP
+                #pragma omp parallel num_threads(m_iMaxNumThreads)
+                #endif
                 {
-                    int k = t_pVecIdxElements(i);
-                    //new Version: calculate matrix multiplication before
-                    //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
-                    MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
+                #ifdef _OPENMP
+                #pragma omp for
+                #endif
+                    for(int i = 0; i < t_iNumVecElements; i++)
+                    {
+                        int k = t_pVecIdxElements(i);
+                        //new Version: calculate matrix multiplication before
+                        //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
+                        MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
+
+                        int idx1 = m_ppPairIdxCombinations[k]->x1;
+                        int idx2 = m_ppPairIdxCombinations[k]->x2;
+
+                        RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
+
+                        t_vecRoh(k) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
+                    }
+                }
+
+                m_pairSearchStats.iNumPairs += t_iNumVecElements;
+                m_pairSearchStats.iNumVerified += t_iNumVecElements;
+            }
+            else
+            {
+                //All entries of the previous rows are exact or below their maximum
+                double t_dMax = t_vecRoh.maxCoeff();
 
-                    int idx1 = m_ppPairIdxCombinations[k]->x1;
-                    int idx2 = m_ppPairIdxCombinations[k]->x2;
+                //Gram blocks of the current row with all sources
+                MatrixXT t_matX = t_factors.matQ.middleCols(3*t_iCurrentRow, 3).transpose() * t_factors.matQ;
+                MatrixXT t_matY = t_factors.matW.middleCols(3*t_iCurrentRow, 3).transpose() * t_factors.matW;
 
-                    RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
+                qint64 t_iNumEvaluated = 0;
+                qint64 t_iNumPruned = 0;
+                qint64 t_iNumDegenerate = 0;
 
-                    t_vecRoh(k) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
+                #ifdef _OPENMP
+                #pragma omp parallel num_threads(m_iMaxNumThreads)
+                #endif
+                {
+                #ifdef _OPENMP
+                #pragma omp for reduction(+:t_iNumEvaluated,t_iNumPruned,t_iNumDegenerate)
+                #endif
+                    for(int i = 0; i < t_iNumVecElements; i++)
+                    {
+                        int k = t_pVecIdxElements(i);
+
+                        int idx1 = m_ppPairIdxCombinations[k]->x1;
+                        int idx2 = m_ppPairIdxCombinations[k]->x2;
+
+                        Eigen::Matrix3d t_matX_Pair, t_matY_Pair;
+                        if(idx1 == t_iCurrentRow)
+                        {
+                            t_matX_Pair = t_matX.block<3,3>(0, 3*idx2);
+                            t_matY_Pair = t_matY.block<3,3>(0, 3*idx2);
+                        }
+                        else
+                        {
+                            t_matX_Pair = t_matX.block<3,3>(0, 3*idx1).transpose();
+                            t_matY_Pair = t_matY.block<3,3>(0, 3*idx1).transpose();
+                        }
+
+                        double t_dRoh;
+                        switch(RapMusic::pairCorrelation(t_factors, idx1, idx2, t_matX_Pair, t_matY_Pair, t_dMax, t_dRoh))
+                        {
+                        case PAIR_EVALUATED:
+                            ++t_iNumEvaluated;
+                            break;
+                        case PAIR_PRUNED:
+                            ++t_iNumPruned;
+                            break;
+                        default:
+                        {
+                            ++t_iNumDegenerate;
+                            MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
+                            RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
+                            t_dRoh = RapMusic::subcorr(t_matProj_G, t_matU_B);
+                            break;
+                        }
+                        }
+
+                        t_vecRoh(k) = t_dRoh;
+                    }
                 }
+
+                //Replace the bounds which could still hold the maximum by subcorr
+                std::vector<int> t_vecCandidates(t_pVecIdxElements.data(), t_pVecIdxElements.data() + t_iNumVecElements);
+                int t_iNumVerified = verifyPairCorrelations(t_matProj_LeadField, t_matU_B, t_vecCandidates, t_vecRoh, t_dMax);
+
+                m_pairSearchStats.iNumPairs += t_iNumVecElements;
+                m_pairSearchStats.iNumEvaluated += t_iNumEvaluated;
+                m_pairSearchStats.iNumPruned += t_iNumPruned;
+                m_pairSearchStats.iNumVerified += t_iNumDegenerate + t_iNumVerified;
             }
 
     //         if(r==0)
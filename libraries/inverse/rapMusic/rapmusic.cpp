@@ -41,10 +41,22 @@
 
 #include <utils/mnemath.h>
 
+#include <algorithm>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define PAIR_SEARCH_BLOCK       32      /**< Sources per row block of the pruned pair search */
+#define PAIR_SEARCH_TILE        512     /**< Sources per column tile of the pruned pair search */
+#define PAIR_SEARCH_SEED        32      /**< Best single sources whose pairs seed the pruning threshold */
+#define PAIR_SEARCH_SLACK       1e-8    /**< Rounding tolerance of the correlation upper bounds */
+#define PAIR_SEARCH_MIN_SIN2    1e-6    /**< Smallest squared sine of the principal angles of a regular pair */
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
@@ -66,6 +78,8 @@ RapMusic::RapMusic()
 , m_iNumLeadFieldCombinations(0)
 , m_ppPairIdxCombinations(NULL)
 , m_iMaxNumThreads(1)
+, m_bExhaustiveSearch(false)
+, m_pairSearchStats()
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
 , m_fStcOverlap(-1)
@@ -82,6 +96,8 @@ RapMusic::RapMusic(MNEForwardSolution& p_pFwd, bool p_bSparsed, int p_iN, double
 , m_iNumLeadFieldCombinations(0)
 , m_ppPairIdxCombinations(NULL)
 , m_iMaxNumThreads(1)
+, m_bExhaustiveSearch(false)
+, m_pairSearchStats()
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
 , m_fStcOverlap(-1)
@@ -439,6 +455,7 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
 //        p_pRapDipoles = new RapDipoles<T>();
 //    }
     p_RapDipoles.clear();
+    m_pairSearchStats = PairSearchStats();
 
     std::cout << "##### Calculation of RAP MUSIC started ######\n\n";
 
@@ -468,27 +485,38 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         clock_t start_subcorr, end_subcorr;
         start_subcorr = clock();
 
-        //Multithreading correlation calculation
-        #ifdef _OPENMP
-        #pragma omp parallel num_threads(m_iMaxNumThreads)
-        #endif
+        if(m_bExhaustiveSearch)
         {
-        #ifdef _OPENMP
-        #pragma omp for
-        #endif
-            for(int i = 0; i < m_iNumLeadFieldCombinations; i++)
+            //Multithreading correlation calculation
+            #ifdef _OPENMP
+            #pragma omp parallel num_threads(m_iMaxNumThreads)
+            #endif
             {
-                //new Version: calculate matrix multiplication before
-                //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
-                MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
-
-                int idx1 = m_ppPairIdxCombinations[i]->x1;
-                int idx2 = m_ppPairIdxCombinations[i]->x2;
-
-                RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
-
-                t_vecRoh(i) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
+            #ifdef _OPENMP
+            #pragma omp for
+            #endif
+                for(int i = 0; i < m_iNumLeadFieldCombinations; i++)
+                {
+                    //new Version: calculate matrix multiplication before
+                    //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
+                    MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
+
+                    int idx1 = m_ppPairIdxCombinations[i]->x1;
+                    int idx2 = m_ppPairIdxCombinations[i]->x2;
+
+                    RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
+
+                    t_vecRoh(i) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
+                }
             }
+
+            m_pairSearchStats.iNumPairs += m_iNumLeadFieldCombinations;
+            m_pairSearchStats.iNumVerified += m_iNumLeadFieldCombinations;
+        }
+        else
+        {
+            //Pruned search -> same maximum as the exhaustive search, the other entries are upper bounds
+            searchPairs(t_matProj_LeadField, t_matU_B, t_vecRoh);
         }
 
 //         if(r==0)
@@ -843,6 +871,255 @@ void RapMusic::getGainMatrixPair(   const MatrixXT& p_matGainMarix,
 
 //=============================================================================================================
 
+void RapMusic::calcPairSearchFactors(   const MatrixXT& p_matProj_LeadField,
+                                        const MatrixXT& p_matU_B,
+                                        PairSearchFactors& p_factors) const
+{
+    int t_iNumSources = m_iNumGridPoints;
+    int t_iNumRows = p_matProj_LeadField.rows();
+
+    p_factors.matQ.resize(t_iNumRows, 3*t_iNumSources);
+
+    //Orthonormal basis of each projected source -> spans (at least) the range of the source gain
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(m_iMaxNumThreads)
+    #endif
+    for(int i = 0; i < t_iNumSources; ++i)
+    {
+        Eigen::HouseholderQR<MatrixXT> t_qrG(p_matProj_LeadField.middleCols(3*i, 3));
+        p_factors.matQ.middleCols(3*i, 3) = t_qrG.householderQ() * MatrixXT::Identity(t_iNumRows, 3);
+    }
+
+    //Coordinates in the signal subspace
+    p_factors.matW.noalias() = p_matU_B.transpose() * p_factors.matQ;
+
+    p_factors.matH.resize(3, 3*t_iNumSources);
+    p_factors.vecRoh.resize(t_iNumSources);
+    p_factors.vecRoh2.resize(t_iNumSources);
+
+    for(int i = 0; i < t_iNumSources; ++i)
+    {
+        Eigen::Matrix3d t_matH = p_factors.matW.middleCols(3*i, 3).transpose() * p_factors.matW.middleCols(3*i, 3);
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> t_eigH(t_matH, Eigen::EigenvaluesOnly);
+
+        p_factors.matH.middleCols(3*i, 3) = t_matH;
+        p_factors.vecRoh2(i) = std::max(t_eigH.eigenvalues()(2), 0.0);
+        p_factors.vecRoh(i) = sqrt(p_factors.vecRoh2(i));
+    }
+}
+
+//=============================================================================================================
+
+int RapMusic::pairCorrelation(  const PairSearchFactors& p_factors,
+                                int p_iIdx1, int p_iIdx2,
+                                const Eigen::Matrix3d& p_matX,
+                                const Eigen::Matrix3d& p_matY,
+                                double p_dThreshold,
+                                double& p_dRoh)
+{
+    //Both sources span the same subspace
+    if(p_iIdx1 == p_iIdx2)
+    {
+        p_dRoh = p_factors.vecRoh(p_iIdx1);
+        return PAIR_EVALUATED;
+    }
+
+    //||X||_F >= cos of the smallest principal angle between both source subspaces
+    double t_dCos = p_matX.norm();
+    if(t_dCos < 1.0)
+    {
+        double t_dBound = sqrt((p_factors.vecRoh2(p_iIdx1) + p_factors.vecRoh2(p_iIdx2)) / (1.0 - t_dCos));
+        if(t_dBound < p_dThreshold)
+        {
+            p_dRoh = t_dBound;
+            return PAIR_PRUNED;
+        }
+    }
+
+    //Orthonormalize Q_2 against Q_1: Z = (Q_2 - Q_1*X)*T with T^T*(I - X^T*X)*T = I
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> t_eigK(Eigen::Matrix3d::Identity() - p_matX.transpose()*p_matX);
+    if(t_eigK.eigenvalues()(0) < PAIR_SEARCH_MIN_SIN2)
+        return PAIR_DEGENERATE;
+
+    Eigen::Matrix3d t_matT = t_eigK.eigenvectors() * t_eigK.eigenvalues().cwiseSqrt().cwiseInverse().asDiagonal();
+
+    const Eigen::Matrix3d t_matH1 = p_factors.matH.block<3,3>(0, 3*p_iIdx1);
+    const Eigen::Matrix3d t_matH2 = p_factors.matH.block<3,3>(0, 3*p_iIdx2);
+
+    //Gram matrix of the signal coordinates [W_1, (W_2 - W_1*X)*T] of the orthonormal pair basis
+    Eigen::Matrix3d t_matB = (p_matY - t_matH1*p_matX) * t_matT;
+    Eigen::Matrix3d t_matD = t_matT.transpose() * (t_matH2 - p_matX.transpose()*p_matY - p_matY.transpose()*p_matX
+                                                   + p_matX.transpose()*t_matH1*p_matX) * t_matT;
+
+    Matrix6T t_matC;
+    t_matC << t_matH1, t_matB,
+              t_matB.transpose(), t_matD;
+
+    Eigen::SelfAdjointEigenSolver<Matrix6T> t_eigC(t_matC, Eigen::EigenvaluesOnly);
+
+    p_dRoh = sqrt(std::max(t_eigC.eigenvalues()(5), 0.0));
+
+    return PAIR_EVALUATED;
+}
+
+//=============================================================================================================
+
+int RapMusic::verifyPairCorrelations(   const MatrixXT& p_matProj_LeadField,
+                                        const MatrixXT& p_matU_B,
+                                        std::vector<int>& p_vecIdx,
+                                        VectorXT& p_vecRoh,
+                                        double p_dMax) const
+{
+    //Largest upper bound first, ties in index order like maxCoeff
+    std::sort(p_vecIdx.begin(), p_vecIdx.end(), [&p_vecRoh](int a, int b) {
+        return p_vecRoh(a) > p_vecRoh(b) || (p_vecRoh(a) == p_vecRoh(b) && a < b);
+    });
+
+    MatrixX6T t_matProj_G(p_matProj_LeadField.rows(), 6);
+    int t_iNumVerified = 0;
+
+    for(size_t i = 0; i < p_vecIdx.size(); ++i)
+    {
+        int k = p_vecIdx[i];
+
+        //All remaining pairs stay below the current maximum
+        if(p_vecRoh(k) + PAIR_SEARCH_SLACK < p_dMax)
+            break;
+
+        RapMusic::getGainMatrixPair(p_matProj_LeadField, t_matProj_G, m_ppPairIdxCombinations[k]->x1, m_ppPairIdxCombinations[k]->x2);
+
+        p_vecRoh(k) = RapMusic::subcorr(t_matProj_G, p_matU_B);
+        if(p_vecRoh(k) > p_dMax)
+            p_dMax = p_vecRoh(k);
+
+        ++t_iNumVerified;
+    }
+
+    return t_iNumVerified;
+}
+
+//=============================================================================================================
+
+void RapMusic::searchPairs( const MatrixXT& p_matProj_LeadField,
+                            const MatrixXT& p_matU_B,
+                            VectorXT& p_vecRoh) const
+{
+    int t_iNumSources = m_iNumGridPoints;
+
+    PairSearchFactors t_factors;
+    calcPairSearchFactors(p_matProj_LeadField, p_matU_B, t_factors);
+
+    //Seed the pruning threshold with the pairs of the best correlated single sources
+    std::vector<int> t_vecOrder(t_iNumSources);
+    for(int i = 0; i < t_iNumSources; ++i)
+        t_vecOrder[i] = i;
+
+    int t_iNumSeeds = std::min(t_iNumSources, PAIR_SEARCH_SEED);
+    std::partial_sort(t_vecOrder.begin(), t_vecOrder.begin() + t_iNumSeeds, t_vecOrder.end(), [&t_factors](int a, int b) {
+        return t_factors.vecRoh(a) > t_factors.vecRoh(b) || (t_factors.vecRoh(a) == t_factors.vecRoh(b) && a < b);
+    });
+
+    double t_dThreshold = t_factors.vecRoh.maxCoeff();
+    for(int a = 0; a < t_iNumSeeds; ++a)
+    {
+        for(int b = a+1; b < t_iNumSeeds; ++b)
+        {
+            int idx1 = std::min(t_vecOrder[a], t_vecOrder[b]);
+            int idx2 = std::max(t_vecOrder[a], t_vecOrder[b]);
+
+            Eigen::Matrix3d t_matX = t_factors.matQ.middleCols(3*idx1, 3).transpose() * t_factors.matQ.middleCols(3*idx2, 3);
+            Eigen::Matrix3d t_matY = t_factors.matW.middleCols(3*idx1, 3).transpose() * t_factors.matW.middleCols(3*idx2, 3);
+
+            double t_dRoh;
+            if(pairCorrelation(t_factors, idx1, idx2, t_matX, t_matY, t_dThreshold, t_dRoh) == PAIR_EVALUATED && t_dRoh > t_dThreshold)
+                t_dThreshold = t_dRoh;
+        }
+    }
+
+    //Scan all pairs in row blocks; the Gram blocks of a block and a column tile are two matrix products
+    qint64 t_iNumEvaluated = 0;
+    qint64 t_iNumPruned = 0;
+    qint64 t_iNumDegenerate = 0;
+
+    int t_iNumBlocks = (t_iNumSources + PAIR_SEARCH_BLOCK - 1) / PAIR_SEARCH_BLOCK;
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(m_iMaxNumThreads) reduction(+:t_iNumEvaluated,t_iNumPruned,t_iNumDegenerate)
+    #endif
+    for(int b = 0; b < t_iNumBlocks; ++b)
+    {
+        int i0 = b*PAIR_SEARCH_BLOCK;
+        int i1 = std::min(t_iNumSources, i0 + PAIR_SEARCH_BLOCK);
+
+        //Only raised from this block's own pairs -> pruning is independent of the thread scheduling
+        double t_dBlockThreshold = t_dThreshold;
+
+        MatrixXT t_matX, t_matY;
+        MatrixX6T t_matProj_G(p_matProj_LeadField.rows(), 6);
+
+        for(int j0 = i0; j0 < t_iNumSources; j0 += PAIR_SEARCH_TILE)
+        {
+            int j1 = std::min(t_iNumSources, j0 + PAIR_SEARCH_TILE);
+
+            t_matX.noalias() = t_factors.matQ.middleCols(3*i0, 3*(i1-i0)).transpose() * t_factors.matQ.middleCols(3*j0, 3*(j1-j0));
+            t_matY.noalias() = t_factors.matW.middleCols(3*i0, 3*(i1-i0)).transpose() * t_factors.matW.middleCols(3*j0, 3*(j1-j0));
+
+            for(int i = i0; i < i1; ++i)
+            {
+                for(int j = std::max(i, j0); j < j1; ++j)
+                {
+                    int k = getPairIdx(t_iNumSources, i, j);
+                    double t_dRoh;
+
+                    switch(pairCorrelation(t_factors, i, j,
+                                           t_matX.block<3,3>(3*(i-i0), 3*(j-j0)),
+                                           t_matY.block<3,3>(3*(i-i0), 3*(j-j0)),
+                                           t_dBlockThreshold, t_dRoh))
+                    {
+                    case PAIR_EVALUATED:
+                        ++t_iNumEvaluated;
+                        if(t_dRoh > t_dBlockThreshold)
+                            t_dBlockThreshold = t_dRoh;
+                        break;
+                    case PAIR_PRUNED:
+                        ++t_iNumPruned;
+                        break;
+                    default:
+                        ++t_iNumDegenerate;
+                        RapMusic::getGainMatrixPair(p_matProj_LeadField, t_matProj_G, i, j);
+                        t_dRoh = RapMusic::subcorr(t_matProj_G, p_matU_B);
+                        break;
+                    }
+
+                    p_vecRoh(k) = t_dRoh;
+                }
+            }
+        }
+    }
+
+    //Verify the candidates for the maximum with subcorr
+    VectorXT::Index t_iMaxIdx;
+    p_vecRoh.maxCoeff(&t_iMaxIdx);
+
+    std::vector<int> t_vecCandidates(1, (int)t_iMaxIdx);
+    int t_iNumVerified = verifyPairCorrelations(p_matProj_LeadField, p_matU_B, t_vecCandidates, p_vecRoh, 0.0);
+
+    double t_dMax = p_vecRoh(t_iMaxIdx);
+    t_vecCandidates.clear();
+    for(int k = 0; k < m_iNumLeadFieldCombinations; ++k)
+        if(k != t_iMaxIdx && p_vecRoh(k) + PAIR_SEARCH_SLACK >= t_dMax)
+            t_vecCandidates.push_back(k);
+
+    t_iNumVerified += verifyPairCorrelations(p_matProj_LeadField, p_matU_B, t_vecCandidates, p_vecRoh, t_dMax);
+
+    m_pairSearchStats.iNumPairs += m_iNumLeadFieldCombinations;
+    m_pairSearchStats.iNumEvaluated += t_iNumEvaluated;
+    m_pairSearchStats.iNumPruned += t_iNumPruned;
+    m_pairSearchStats.iNumVerified += t_iNumDegenerate + t_iNumVerified;
+}
+
+//=============================================================================================================
+
 void RapMusic::insertSource(    int p_iDipoleIdx1, int p_iDipoleIdx2,
                                 const Vector6T &p_vec_phi_k_1,
                                 double p_valCor,
@@ -881,3 +1158,17 @@ void RapMusic::setStcAttr(int p_iSampStcWin, float p_fStcOverlap)
     m_iSamplesStcWindow = p_iSampStcWin;
     m_fStcOverlap = p_fStcOverlap;
 }
+
+//=============================================================================================================
+
+void RapMusic::setExhaustiveSearch(bool p_bExhaustive)
+{
+    m_bExhaustiveSearch = p_bExhaustive;
+}
+
+//=============================================================================================================
+
+RapMusic::PairSearchStats RapMusic::getPairSearchStats() const
+{
+    return m_pairSearchStats;
+}
@@ -48,6 +48,7 @@
 #include <mne/mne_forwardsolution.h>
 #include <mne/mne_sourceestimate.h>
 #include <time.h>
+#include <vector>
 
 #include <QVector>
 
@@ -58,6 +59,8 @@
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include <Eigen/LU>
+#include <Eigen/QR>
+#include <Eigen/Eigenvalues>
 
 //=============================================================================================================
 // DEFINE NAMESPACE INVERSELIB
@@ -73,6 +76,10 @@ namespace INVERSELIB
 #define NOT_TRANSPOSED   0  /**< Defines NOT_TRANSPOSED */
 #define IS_TRANSPOSED   1   /**< Defines IS_TRANSPOSED */
 
+#define PAIR_EVALUATED  0   /**< Pair correlation was computed from the source factors */
+#define PAIR_PRUNED     1   /**< Pair correlation was replaced by its upper bound */
+#define PAIR_DEGENERATE 2   /**< Pair subspaces are (nearly) parallel, pair has to be evaluated by subcorr */
+
 //=============================================================================================================
 /**
  * Declares a pair structure for index combinations used in RAP MUSIC algorithm.
@@ -165,7 +172,51 @@ public:
      */
     void setStcAttr(int p_iSampStcWin, float p_fStcOverlap);
 
+    //=========================================================================================================
+    /**
+     * Selects how the dipole pairs are scanned. The default pruned search evaluates the pair correlations from
+     * per-source factors and skips pairs by an upper bound. The selected pairs and correlations are identical
+     * to the exhaustive search, which evaluates subcorr for every pair.
+     *
+     * @param[in] p_bExhaustive  True when every pair should be evaluated by subcorr.
+     */
+    void setExhaustiveSearch(bool p_bExhaustive);
+
+    //=========================================================================================================
+    /**
+     * Pair counts of the pair searches of the last calculateInverse call, summed over all iterations.
+     */
+    struct PairSearchStats
+    {
+        qint64 iNumPairs;       /**< Number of pair correlations which were searched. */
+        qint64 iNumEvaluated;   /**< Pairs evaluated from the per-source factors. */
+        qint64 iNumPruned;      /**< Pairs skipped by their upper bound. */
+        qint64 iNumVerified;    /**< Pairs evaluated by subcorr (every pair of the exhaustive search). */
+    };
+
+    //=========================================================================================================
+    /**
+     * Returns the pair counts of the last calculateInverse call. Comparing the subcorr evaluations of the
+     * pruned and the exhaustive search gives the work saved by the pruning.
+     *
+     * @return   The pair search counts.
+     */
+    PairSearchStats getPairSearchStats() const;
+
 protected:
+    //=========================================================================================================
+    /**
+     * Per-source factors of the projected gain matrix used by the pruned pair search.
+     */
+    struct PairSearchFactors
+    {
+        MatrixXT matQ;      /**< Orthonormal bases Q_i of the projected source gains (channels x 3*sources). */
+        MatrixXT matW;      /**< Signal subspace coordinates W = U_B^T*Q (rank x 3*sources). */
+        MatrixXT matH;      /**< Per source Gram blocks H_i = W_i^T*W_i (3 x 3*sources). */
+        VectorXT vecRoh;    /**< Single source correlations rho_i. */
+        VectorXT vecRoh2;   /**< Squared single source correlations. */
+    };
+
     //=========================================================================================================
     /**
      * Computes the signal subspace Phi_s out of the measurement F.
@@ -280,6 +331,88 @@ protected:
                                     MatrixX6T& p_matGainMarix_Pair,
                                     int p_iIdx1, int p_iIdx2);
 
+    //=========================================================================================================
+    /**
+     * Computes the per-source factors of the projected gain matrix: a QR factorization of every source's
+     * 3 columns, its coordinates in the signal subspace and the single source correlations.
+     *
+     * @param[in] p_matProj_LeadField    The projected gain matrix.
+     * @param[in] p_matU_B   The orthonormal basis of the projected signal subspace.
+     * @param[out] p_factors The per-source factors.
+     */
+    void calcPairSearchFactors( const MatrixXT& p_matProj_LeadField,
+                                const MatrixXT& p_matU_B,
+                                PairSearchFactors& p_factors) const;
+
+    //=========================================================================================================
+    /**
+     * Computes the subspace correlation of the dipole pair (p_iIdx1, p_iIdx2), p_iIdx1 <= p_iIdx2, from the
+     * source factors and the 3 x 3 Gram blocks of the pair. The correlation is the square root of the largest
+     * eigenvalue of a 6 x 6 matrix. Before the eigenproblem is solved the correlation is bounded by
+     * rho^2 <= (rho_1^2 + rho_2^2)/(1 - ||Q_1^T*Q_2||); pairs whose bound is below p_dThreshold are pruned
+     * and the bound is returned instead.
+     *
+     * @param[in] p_factors  The per-source factors.
+     * @param[in] p_iIdx1    Index of the first source.
+     * @param[in] p_iIdx2    Index of the second source.
+     * @param[in] p_matX     The Gram block Q_1^T*Q_2.
+     * @param[in] p_matY     The Gram block W_1^T*W_2.
+     * @param[in] p_dThreshold   Pairs whose upper bound is smaller than this threshold are pruned.
+     * @param[out] p_dRoh    The correlation, or its upper bound when pruned. This is never smaller than the
+     *                       value subcorr returns for the pair (up to rounding).
+     * @return   PAIR_EVALUATED, PAIR_PRUNED or PAIR_DEGENERATE. For degenerate pairs p_dRoh is not set.
+     */
+    static int pairCorrelation( const PairSearchFactors& p_factors,
+                                int p_iIdx1, int p_iIdx2,
+                                const Eigen::Matrix3d& p_matX,
+                                const Eigen::Matrix3d& p_matY,
+                                double p_dThreshold,
+                                double& p_dRoh);
+
+    //=========================================================================================================
+    /**
+     * Replaces pair correlation upper bounds by the exact subcorr value wherever the pair could still hold the
+     * maximum. Afterwards the maximum of p_vecRoh and the index where it occurs first are the same as if all
+     * given pairs had been evaluated by subcorr.
+     *
+     * @param[in] p_matProj_LeadField    The projected gain matrix.
+     * @param[in] p_matU_B   The orthonormal basis of the projected signal subspace.
+     * @param[in] p_vecIdx   The pair combination indices whose entries in p_vecRoh are upper bounds.
+     * @param[in, out] p_vecRoh  The pair correlations.
+     * @param[in] p_dMax     The largest exact correlation outside p_vecIdx (0 if there is none).
+     * @return   The number of pairs which were evaluated by subcorr.
+     */
+    int verifyPairCorrelations( const MatrixXT& p_matProj_LeadField,
+                                const MatrixXT& p_matU_B,
+                                std::vector<int>& p_vecIdx,
+                                VectorXT& p_vecRoh,
+                                double p_dMax) const;
+
+    //=========================================================================================================
+    /**
+     * Pruned search over all dipole pairs (branch-and-bound). The Gram blocks of the source factors are
+     * computed in tiles, pairs are pruned by their upper bound and the remaining candidates for the maximum
+     * are verified with subcorr.
+     *
+     * @param[in] p_matProj_LeadField    The projected gain matrix.
+     * @param[in] p_matU_B   The orthonormal basis of the projected signal subspace.
+     * @param[out] p_vecRoh  The pair correlations. The maximum and its first index match the exhaustive search.
+     */
+    void searchPairs(   const MatrixXT& p_matProj_LeadField,
+                        const MatrixXT& p_matU_B,
+                        VectorXT& p_vecRoh) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the pair combination index of the sources p_iIdx1 <= p_iIdx2 (inverse of getPointPair).
+     *
+     * @param[in] p_iPoints  The number of points n which are combined with each other.
+     * @param[in] p_iIdx1    The index of the first source.
+     * @param[in] p_iIdx2    The index of the second source.
+     * @return   The pair combination index.
+     */
+    static inline int getPairIdx(const int p_iPoints, const int p_iIdx1, const int p_iIdx2);
+
     //=========================================================================================================
     /**
      * Adds a new correlated dipole pair to th RapDipoles. This function is called by the RAP MUSIC Algorithm.
@@ -310,6 +443,10 @@ protected:
 
     int m_iMaxNumThreads;   /**< Number of available CPU threads. */
 
+    bool m_bExhaustiveSearch;   /**< Whether every pair is evaluated by subcorr instead of the pruned search. */
+
+    mutable PairSearchStats m_pairSearchStats;  /**< Pair counts of the last calculateInverse call. */
+
     bool m_bIsInit; /**< Whether the algorithm is initialized. */
 
     //Stc stuff
@@ -388,6 +525,14 @@ inline int RapMusic::useFullRank(   const MatrixXT& p_Mat,
 
 //=============================================================================================================
 
+inline int RapMusic::getPairIdx(const int p_iPoints, const int p_iIdx1, const int p_iIdx2)
+{
+    //row p_iIdx1 starts after the p_iIdx1 preceding rows of length p_iPoints, p_iPoints-1, ...
+    return (int)((qint64)p_iIdx1*p_iPoints - ((qint64)(p_iIdx1-1)*p_iIdx1)/2) + (p_iIdx2 - p_iIdx1);
+}
+
+//=============================================================================================================
+
 inline RapMusic::MatrixXT RapMusic::makeSquareMat(const MatrixXT& p_matF)
 {
     //Make rectangular - p_matF*p_matF^T
@@ -216,6 +216,31 @@ public:
                          Eigen::SparseMatrix<double> &noise_norm,
                          QList<Eigen::VectorXi> &vertno);
 
+    //=========================================================================================================
+    /**
+     * Assembles the imaging kernel in factored form K = K_left*K_right. K_left (sources x rank) holds the
+     * weighted eigenleads, K_right (rank x channels) the regularized eigenfields applied to the whitened and
+     * projected data. The rank is at most the number of channels, so applying the factors costs
+     * O(rank*(sources + channels)) per sample instead of O(sources*channels).
+     *
+     * @param[in] label          labels.
+     * @param[in] method         The applied normals. ("MNE" | "dSPM" | "sLORETA")
+     * @param[in] pick_normal    Pick normals.
+     * @param[out] K_left        Left kernel factor.
+     * @param[out] K_right       Right kernel factor.
+     * @param[out] noise_norm    Noise normals.
+     * @param[out] vertno        Vertices of the hemispheres.
+     *
+     * @return true if succeeded, false otherwise
+     */
+    bool assemble_kernel_factors(const FSLIB::Label &label,
+                                 QString method,
+                                 bool pick_normal,
+                                 Eigen::MatrixXd &K_left,
+                                 Eigen::MatrixXd &K_right,
+                                 Eigen::SparseMatrix<double> &noise_norm,
+                                 QList<Eigen::VectorXi> &vertno);
+
     //=========================================================================================================
     /**
      * Check that channels in inverse operator are measurements.
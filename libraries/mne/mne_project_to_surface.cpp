@@ -46,10 +46,19 @@
 #include <mne/mne_bem_surface.h>
 #include <mne/mne_surface.h>
 
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+#include <limits>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QtConcurrent>
+
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
@@ -63,6 +72,16 @@
 using namespace MNELIB;
 using namespace Eigen;
 
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define BVH_LEAF_SIZE       4       /**< Maximal number of triangles in a leaf of the hierarchy */
+#define BVH_STACK_SIZE      64      /**< Traversal stack depth, the median split keeps the depth at log2(ntri) */
+#define BVH_NORMAL_TOL      5e-4f   /**< Allowed deviation of the triangle normal lengths from one */
+#define BVH_PRUNE_TOL       1e-3f   /**< Relative slack of the distance lower bound (normal lengths and rounding) */
+#define PROJ_CHUNK_SIZE     64      /**< Number of points projected by one thread */
+
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
@@ -80,6 +99,7 @@ MNEProjectToSurface::MNEProjectToSurface()
 , b(VectorXf::Zero(1))
 , c(VectorXf::Zero(1))
 , det(VectorXf::Zero(1))
+, useBvh(true)
 {
 }
 
@@ -94,6 +114,7 @@ MNEProjectToSurface::MNEProjectToSurface(const MNEBemSurface &p_MNEBemSurf)
 , b(VectorXf::Zero(p_MNEBemSurf.ntri))
 , c(VectorXf::Zero(p_MNEBemSurf.ntri))
 , det(VectorXf::Zero(p_MNEBemSurf.ntri))
+, useBvh(true)
 {
     for (int i = 0; i < p_MNEBemSurf.ntri; ++i)
     {
@@ -117,6 +138,8 @@ MNEProjectToSurface::MNEProjectToSurface(const MNEBemSurface &p_MNEBemSurf)
         }
     }
     det = (a.array()*b.array() - c.array()*c.array()).matrix();
+
+    build_bvh();
 }
 
 //=============================================================================================================
@@ -130,6 +153,7 @@ MNEProjectToSurface::MNEProjectToSurface(const MNESurface &p_MNESurf)
 , b(VectorXf::Zero(p_MNESurf.ntri))
 , c(VectorXf::Zero(p_MNESurf.ntri))
 , det(VectorXf::Zero(p_MNESurf.ntri))
+, useBvh(true)
 {
     for (int i = 0; i < p_MNESurf.ntri; ++i)
     {
@@ -143,6 +167,8 @@ MNEProjectToSurface::MNEProjectToSurface(const MNESurface &p_MNESurf)
     }
 
     det = (a.array()*b.array() - c.array()*c.array()).matrix();
+
+    build_bvh();
 }
 
 //=============================================================================================================
@@ -160,34 +186,231 @@ bool MNEProjectToSurface::mne_find_closest_on_surface(const MatrixXf &r, const i
         qDebug() << "No surface loaded to make the projection./n";
         return false;
     }
-    int bestTri = -1;
-    float bestDist = -1;
-    Vector3f rTriK;
-    for (int k = 0; k < np; ++k)
+    // project the points chunk wise, each point is independent from the others
+    auto projectChunk = [&](const QPair<int,int> &range) {
+        int bestTri = -1;
+        float bestDist = -1;
+        Vector3f rTriK;
+        for (int k = range.first; k < range.second; ++k)
+        {
+            if (!this->mne_project_to_surface(r.row(k).transpose(), rTriK, bestTri, bestDist))
+            {
+                qDebug() << "The projection of point number " << k << " didn't work./n";
+                nearest[k] = -1;
+                continue;
+            }
+            rTri.row(k) = rTriK.transpose();
+            nearest[k] = bestTri;
+            dist[k] = bestDist;
+        }
+    };
+
+    if (np <= PROJ_CHUNK_SIZE)
+    {
+        projectChunk(qMakePair(0, np));
+    }
+    else
     {
-        /*
-         * To do: decide_search_restriction for the use in an iterative closest point to plane algorithm
-         * For now it's OK to go through all triangles.
-         */
-        if (!this->mne_project_to_surface(r.row(k).transpose(), rTriK, bestTri, bestDist))
+        QVector<QPair<int,int> > vecChunks;
+        for (int k = 0; k < np; k += PROJ_CHUNK_SIZE)
         {
-            qDebug() << "The projection of point number " << k << " didn't work./n";
+            vecChunks.append(qMakePair(k, qMin(k + PROJ_CHUNK_SIZE, np)));
+        }
+        QtConcurrent::blockingMap(vecChunks, projectChunk);
+    }
+
+    return (np == 0) || (nearest.minCoeff() >= 0);
+}
+
+//=============================================================================================================
+
+void MNEProjectToSurface::setUseBvh(bool bUseBvh)
+{
+    useBvh = bUseBvh;
+}
+
+//=============================================================================================================
+
+void MNEProjectToSurface::build_bvh()
+{
+    const int ntri = static_cast<int>(a.size());
+
+    bvh.clear();
+    bvhTri.resize(ntri);
+    if (ntri == 0 || r1.rows() != ntri)
+    {
+        return;
+    }
+
+    /*
+     * The distance returned by nearest_triangle_point is measured along nn in normal direction. Only with unit
+     * normals it is the euclidean distance and the distance to a bounding box is a lower bound for it. The
+     * normals of MNESurface are not normalized, for these surfaces all triangles are searched.
+     */
+    const VectorXf vecNormLength = nn.rowwise().norm();
+    if ((vecNormLength.array() - 1.0f).abs().maxCoeff() > BVH_NORMAL_TOL)
+    {
+        return;
+    }
+
+    MatrixX3f matCentroids(ntri,3);
+    for (int tri = 0; tri < ntri; ++tri)
+    {
+        bvhTri(tri) = tri;
+        matCentroids.row(tri) = r1.row(tri) + (r12.row(tri) + r13.row(tri)) / 3.0f;
+    }
+
+    bvh.reserve(2 * ntri / BVH_LEAF_SIZE + 1);
+    build_bvh_node(0, ntri, matCentroids);
+}
+
+//=============================================================================================================
+
+int MNEProjectToSurface::build_bvh_node(int iStart,
+                                        int iCount,
+                                        const MatrixX3f &matCentroids)
+{
+    BvhNode node;
+    node.vecMin.setConstant(std::numeric_limits<float>::max());
+    node.vecMax.setConstant(-std::numeric_limits<float>::max());
+    node.iLeft = -1;
+    node.iRight = -1;
+    node.iStart = iStart;
+    node.iCount = iCount;
+
+    Vector3f vecCenMin = node.vecMin;
+    Vector3f vecCenMax = node.vecMax;
+    for (int i = iStart; i < iStart + iCount; ++i)
+    {
+        const int tri = bvhTri(i);
+        const Vector3f r1Tri = r1.row(tri).transpose();
+        const Vector3f r2Tri = r1Tri + r12.row(tri).transpose();
+        const Vector3f r3Tri = r1Tri + r13.row(tri).transpose();
+        node.vecMin = node.vecMin.cwiseMin(r1Tri).cwiseMin(r2Tri).cwiseMin(r3Tri);
+        node.vecMax = node.vecMax.cwiseMax(r1Tri).cwiseMax(r2Tri).cwiseMax(r3Tri);
+        vecCenMin = vecCenMin.cwiseMin(matCentroids.row(tri).transpose());
+        vecCenMax = vecCenMax.cwiseMax(matCentroids.row(tri).transpose());
+    }
+
+    const int iNode = bvh.size();
+    bvh.append(node);
+
+    if (iCount <= BVH_LEAF_SIZE)
+    {
+        return iNode;
+    }
+
+    // median split along the longest axis of the centroid box
+    int iAxis = 0;
+    (vecCenMax - vecCenMin).maxCoeff(&iAxis);
+    const int iHalf = iCount / 2;
+    int* pStart = bvhTri.data() + iStart;
+    std::nth_element(pStart, pStart + iHalf, pStart + iCount, [&](int iTriA, int iTriB) {
+        const float fA = matCentroids(iTriA, iAxis);
+        const float fB = matCentroids(iTriB, iAxis);
+        return (fA < fB) || (fA == fB && iTriA < iTriB);
+    });
+
+    const int iLeft = build_bvh_node(iStart, iHalf, matCentroids);
+    const int iRight = build_bvh_node(iStart + iHalf, iCount - iHalf, matCentroids);
+    bvh[iNode].iLeft = iLeft;
+    bvh[iNode].iRight = iRight;
+
+    return iNode;
+}
+
+//=============================================================================================================
+
+bool MNEProjectToSurface::find_closest_bvh(const Vector3f &r, int &bestTri, float &bestDist, float &bestP, float &bestQ) const
+{
+    auto boxDist = [&](const BvhNode &node) {
+        const Vector3f vecOut = (node.vecMin - r).cwiseMax(r - node.vecMax).cwiseMax(0.0f);
+        return vecOut.norm() * (1.0f - BVH_PRUNE_TOL);
+    };
+
+    float p0 = 0, q0 = 0, dist0 = 0;
+    bestTri = -1;
+    bestDist = 0.0f;
+
+    int vecStack[BVH_STACK_SIZE];
+    int iStackSize = 0;
+    vecStack[iStackSize++] = 0;
+
+    while (iStackSize > 0)
+    {
+        const BvhNode &node = bvh[vecStack[--iStackSize]];
+
+        // the node can not contain a closer triangle, ties are kept for the lowest triangle index
+        if (bestTri >= 0 && boxDist(node) > std::fabs(bestDist))
+        {
+            continue;
+        }
+
+        if (node.iLeft < 0)
+        {
+            for (int i = node.iStart; i < node.iStart + node.iCount; ++i)
+            {
+                const int tri = bvhTri(i);
+                if (!this->nearest_triangle_point(r, tri, p0, q0, dist0))
+                {
+                    qDebug() << "The projection on triangle " << tri << " didn't work./n";
+                    return false;
+                }
+                // same result as going through the triangles in order: first of equally close triangles wins
+                if ((bestTri < 0) || (std::fabs(dist0) < std::fabs(bestDist))
+                    || (std::fabs(dist0) == std::fabs(bestDist) && tri < bestTri))
+                {
+                    bestDist = dist0;
+                    bestP = p0;
+                    bestQ = q0;
+                    bestTri = tri;
+                }
+            }
+            continue;
+        }
+
+        if (iStackSize + 2 > BVH_STACK_SIZE)
+        {
+            qDebug() << "The bounding volume hierarchy is too deep./n";
             return false;
         }
-        rTri.row(k) = rTriK.transpose();
-        nearest[k] = bestTri;
-        dist[k] = bestDist;
+
+        // push the farther child first, so that the nearer one is visited first
+        const float fDistLeft = boxDist(bvh[node.iLeft]);
+        const float fDistRight = boxDist(bvh[node.iRight]);
+        if (fDistLeft <= fDistRight)
+        {
+            vecStack[iStackSize++] = node.iRight;
+            vecStack[iStackSize++] = node.iLeft;
+        }
+        else
+        {
+            vecStack[iStackSize++] = node.iLeft;
+            vecStack[iStackSize++] = node.iRight;
+        }
     }
-    return true;
+
+    return bestTri >= 0;
 }
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rTri, int &bestTri, float &bestDist)
+bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rTri, int &bestTri, float &bestDist) const
 {
     float p = 0, q = 0, p0 = 0, q0 = 0, dist0 = 0;
     bestDist = 0.0f;
     bestTri = -1;
+
+    if (useBvh && !bvh.isEmpty())
+    {
+        if (!this->find_closest_bvh(r, bestTri, bestDist, p, q))
+        {
+            qDebug() << "No best Triangle found./n";
+            return false;
+        }
+        return this->project_to_triangle(rTri, p, q, bestTri);
+    }
+
     for (int tri = 0; tri < a .size(); ++tri)
     {
         if (!this->nearest_triangle_point(r, tri, p0, q0, dist0))
@@ -221,7 +444,7 @@ bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rT
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tri, float &p, float &q, float &dist)
+bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tri, float &p, float &q, float &dist) const
 {
     //Calculate some helpers
     Vector3f rr = r - this->r1.row(tri).transpose(); //Vector from triangle corner #1 to r
@@ -329,7 +552,7 @@ bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tr
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::project_to_triangle(Vector3f &rTri, const float p, const float q, const int tri)
+bool MNEProjectToSurface::project_to_triangle(Vector3f &rTri, const float p, const float q, const int tri) const
 {
     rTri = this->r1.row(tri) + p*this->r12.row(tri) + q*this->r13.row(tri);
     return true;
@@ -47,6 +47,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QVector>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -126,9 +127,66 @@ public:
     bool mne_find_closest_on_surface(const Eigen::MatrixXf &r, const int np, Eigen::MatrixXf &rTri,
                                      Eigen::VectorXi &nearest, Eigen::VectorXf &dist);
 
+    //=========================================================================================================
+    /**
+     * Selects how the closest triangle is searched. By default the bounding volume hierarchy over the triangles
+     * is used if the surface has unit triangle normals, which gives the same triangles and distances as going
+     * through all triangles.
+     *
+     * @param[in] bUseBvh   Whether to use the bounding volume hierarchy (true) or to go through all triangles.
+     */
+    void setUseBvh(bool bUseBvh);
+
 protected:
 
 private:
+    //=========================================================================================================
+    /**
+     * Node of the bounding volume hierarchy over the triangles.
+     */
+    struct BvhNode
+    {
+        Eigen::Vector3f vecMin;     /**< Lower corner of the bounding box of all triangles in this node */
+        Eigen::Vector3f vecMax;     /**< Upper corner of the bounding box of all triangles in this node */
+        int iLeft;                  /**< Index of the first child node, -1 for leaves */
+        int iRight;                 /**< Index of the second child node, -1 for leaves */
+        int iStart;                 /**< First entry of the leaf triangles in bvhTri */
+        int iCount;                 /**< Number of triangles in this node */
+    };
+
+    //=========================================================================================================
+    /**
+     * Builds the bounding volume hierarchy over the triangles (median split along the longest axis). The
+     * hierarchy is only built for surfaces with unit triangle normals.
+     */
+    void build_bvh();
+
+    //=========================================================================================================
+    /**
+     * Builds the bounding volume hierarchy node of the triangles bvhTri[iStart...iStart+iCount-1].
+     *
+     * @param[in] iStart        First triangle entry in bvhTri.
+     * @param[in] iCount        Number of triangles.
+     * @param[in] matCentroids  The triangle centroids.
+     *
+     * @return the index of the node
+     */
+    int build_bvh_node(int iStart, int iCount, const Eigen::MatrixX3f &matCentroids);
+
+    //=========================================================================================================
+    /**
+     * Finds the closest triangle to a point r by traversing the bounding volume hierarchy.
+     *
+     * @param[in] r         Point in space.
+     * @param[out] bestTri  Closest triangle.
+     * @param[out] bestDist Distance between r and the triangle.
+     * @param[out] bestP    Coordiante in Triangel System of the closest point.
+     * @param[out] bestQ    Coordiante in Triangel System of the closest point.
+     *
+     * @return true if succeeded, false otherwise
+     */
+    bool find_closest_bvh(const Eigen::Vector3f &r, int &bestTri, float &bestDist, float &bestP, float &bestQ) const;
+
     //=========================================================================================================
     /**
      * Projects a point r on the Surface
@@ -142,7 +200,7 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool mne_project_to_surface(const Eigen::Vector3f &r, Eigen::Vector3f &rTri, int &bestTri, float &bestDist);
+    bool mne_project_to_surface(const Eigen::Vector3f &r, Eigen::Vector3f &rTri, int &bestTri, float &bestDist) const;
 
     //=========================================================================================================
     /**
@@ -158,7 +216,7 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool nearest_triangle_point(const Eigen::Vector3f &r, const int tri, float &p, float &q, float &dist);
+    bool nearest_triangle_point(const Eigen::Vector3f &r, const int tri, float &p, float &q, float &dist) const;
 
     //=========================================================================================================
     /**
@@ -173,7 +231,7 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool project_to_triangle(Eigen::Vector3f &rTri, const float p, const float q, const int tri);
+    bool project_to_triangle(Eigen::Vector3f &rTri, const float p, const float q, const int tri) const;
 
     Eigen::MatrixX3f r1;         /**< Cartesian Vector to the first triangel corner */
     Eigen::MatrixX3f r12;        /**< Cartesian Vector from the first to the second triangel corner */
@@ -183,6 +241,10 @@ private:
     Eigen::VectorXf b;           /**< r13*r13 */
     Eigen::VectorXf c;           /**< r12*r13 */
     Eigen::VectorXf det;         /**< Determinant of the Matrix [a c, c b] */
+
+    QVector<BvhNode> bvh;        /**< Bounding volume hierarchy over the triangles, bvh[0] is the root */
+    Eigen::VectorXi bvhTri;      /**< Triangle indices ordered by the leaves of the hierarchy */
+    bool useBvh;                 /**< Whether the closest triangles are searched with the hierarchy */
 };
 
 //=============================================================================================================
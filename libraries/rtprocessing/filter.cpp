@@ -47,6 +47,12 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -55,6 +61,12 @@
 #include <Eigen/Dense>
 #include <Eigen/Core>
 
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <functional>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
@@ -64,6 +76,145 @@ using namespace Eigen;
 using namespace FIFFLIB;
 using namespace UTILSLIB;
 
+//=============================================================================================================
+// DEFINE STATIC METHODS
+//=============================================================================================================
+
+namespace {
+
+/**
+ * One block of the filterFile pipeline.
+ */
+struct FilterFileBlock {
+    int         iIndex;         /**< The position of the block in the file. */
+    fiff_int_t  iFirst;         /**< The first sample of the block. */
+    fiff_int_t  iLast;          /**< The last sample of the block. */
+    MatrixXd    matData;        /**< The raw or, after the filter stage, the filtered data. */
+};
+
+/**
+ * The shared state of the filterFile pipeline. All members are guarded by the mutex.
+ */
+struct FilterFilePipeline {
+    QMutex                          mutex;
+    QWaitCondition                  conditionRead;          /**< Signals that a block was read or reading finished. */
+    QWaitCondition                  conditionQueueFree;     /**< Signals that a block was taken from the read queue. */
+    QWaitCondition                  conditionFiltered;      /**< Signals that a block was filtered or reading finished. */
+    QWaitCondition                  conditionWritten;       /**< Signals that a block was taken by the writer. */
+    QQueue<FilterFileBlock>         queueRead;              /**< The read blocks waiting to be filtered. */
+    QMap<int,FilterFileBlock>       mapFiltered;            /**< The filtered blocks waiting to be written, keyed by their index. */
+    int                             iQueueDepth;            /**< The maximum number of blocks per queue. */
+    int                             iNumBlocks;             /**< The number of read blocks. -1 until reading finished. */
+    int                             iNextWrite;             /**< The index of the next block to write. */
+    bool                            bAbort;                 /**< Whether the pipeline was aborted because of an error. */
+};
+
+//=============================================================================================================
+
+void readFileBlocks(FilterFilePipeline& pipeline,
+                    QSharedPointer<FiffRawData> pFiffRawData,
+                    fiff_int_t from,
+                    fiff_int_t to,
+                    fiff_int_t quantum)
+{
+    SparseMatrix<double> mult;
+    RowVectorXi sel;
+    MatrixXd times;
+    int iIndex = 0;
+
+    for(fiff_int_t first = from; first < to; first+=quantum) {
+        FilterFileBlock block;
+        block.iIndex = iIndex;
+        block.iFirst = first;
+        block.iLast = first+quantum-1;
+        if (block.iLast > to) {
+            block.iLast = to;
+        }
+
+        bool bRead = pFiffRawData->read_raw_segment(block.matData, times, mult, block.iFirst, block.iLast, sel);
+
+        QMutexLocker locker(&pipeline.mutex);
+
+        if(!bRead) {
+            qWarning("[Filter::filterFile] Error during read_raw_segment\n");
+            pipeline.bAbort = true;
+        }
+
+        while(!pipeline.bAbort && pipeline.queueRead.size() >= pipeline.iQueueDepth) {
+            pipeline.conditionQueueFree.wait(&pipeline.mutex);
+        }
+
+        if(pipeline.bAbort) {
+            pipeline.conditionRead.wakeAll();
+            pipeline.conditionFiltered.wakeAll();
+            pipeline.conditionWritten.wakeAll();
+            return;
+        }
+
+        pipeline.queueRead.enqueue(block);
+        pipeline.conditionRead.wakeOne();
+        iIndex++;
+    }
+
+    QMutexLocker locker(&pipeline.mutex);
+    pipeline.iNumBlocks = iIndex;
+    pipeline.conditionRead.wakeAll();
+    pipeline.conditionFiltered.wakeAll();
+}
+
+//=============================================================================================================
+
+void filterFileBlocks(FilterFilePipeline& pipeline,
+                      MultiChannelFilter multiChannelFilter,
+                      const RowVectorXi& vecPicks)
+{
+    FilterFileBlock block;
+    MatrixXd matDataFiltered;
+
+    while(true) {
+        {
+            QMutexLocker locker(&pipeline.mutex);
+
+            while(!pipeline.bAbort && pipeline.queueRead.isEmpty() && pipeline.iNumBlocks < 0) {
+                pipeline.conditionRead.wait(&pipeline.mutex);
+            }
+
+            if(pipeline.bAbort || pipeline.queueRead.isEmpty()) {
+                return;
+            }
+
+            block = pipeline.queueRead.dequeue();
+            pipeline.conditionQueueFree.wakeOne();
+        }
+
+        // Blocks are filtered independently, the overlap add is done by the writer. Blocks shorter than the filter
+        // order (usually the last one) are filtered as well, so every block carries the iOrder wide tail the writer expects.
+        multiChannelFilter.filterBlock(block.matData,
+                                       vecPicks,
+                                       matDataFiltered,
+                                       false);
+        block.matData.swap(matDataFiltered);
+
+        QMutexLocker locker(&pipeline.mutex);
+
+        // The block the writer is waiting for is always accepted, otherwise the pipeline could stall
+        while(!pipeline.bAbort
+              && pipeline.mapFiltered.size() >= pipeline.iQueueDepth
+              && block.iIndex != pipeline.iNextWrite) {
+            pipeline.conditionWritten.wait(&pipeline.mutex);
+        }
+
+        if(pipeline.bAbort) {
+            return;
+        }
+
+        pipeline.mapFiltered.insert(block.iIndex, block);
+        pipeline.conditionFiltered.wakeAll();
+    }
+}
+
+} // anonymous namespace
+
 //=============================================================================================================
 // DEFINE GLOBAL RTPROCESSINGLIB METHODS
 //=============================================================================================================
@@ -108,75 +259,121 @@ bool RTPROCESSINGLIB::filterFile(QIODevice &pIODevice,
                                  QSharedPointer<FiffRawData> pFiffRawData,
                                  const FilterKernel& filterKernel,
                                  const RowVectorXi& vecPicks,
-                                 bool bUseThreads)
+                                 bool bUseThreads,
+                                 int iBlockSize,
+                                 int iQueueDepth)
 {
     int iOrder = filterKernel.getFilterOrder();
 
     RowVectorXd cals;
-    SparseMatrix<double> mult;
-    RowVectorXi sel;
     FiffStream::SPtr outfid = FiffStream::start_writing_raw(pIODevice, pFiffRawData->info, cals);
 
     //Setup reading parameters
     fiff_int_t from = pFiffRawData->first_samp;
     fiff_int_t to = pFiffRawData->last_samp;
 
-    // slice input data into data junks with proper length so that the slices are always >= the filter order
-    float fFactor = 2.0f;
-    int iSize = fFactor * iOrder;
-    int residual = (to - from) % iSize;
-    while(residual < iOrder) {
-        fFactor = fFactor - 0.1f;
-        iSize = fFactor * iOrder;
-        residual = (to - from) % iSize;
-
-        if((iSize < iOrder)) {
-            qInfo() << "[Filter::filterData] Sliced data block size is too small. Filtering whole block at once.";
-            iSize = to - from;
-            break;
+    fiff_int_t quantum;
+
+    if(iBlockSize >= iOrder && iBlockSize > 0) {
+        quantum = iBlockSize;
+    } else {
+        if(iBlockSize > 0) {
+            qWarning() << "[Filter::filterFile] Block size" << iBlockSize << "is smaller than the filter order" << iOrder << ". Using the default block size.";
         }
+
+        // slice input data into data junks with proper length so that the slices are always >= the filter order
+        float fFactor = 2.0f;
+        int iSize = fFactor * iOrder;
+        int residual = (to - from) % iSize;
+        while(residual < iOrder) {
+            fFactor = fFactor - 0.1f;
+            iSize = fFactor * iOrder;
+            residual = (to - from) % iSize;
+
+            if((iSize < iOrder)) {
+                qInfo() << "[Filter::filterData] Sliced data block size is too small. Filtering whole block at once.";
+                iSize = to - from;
+                break;
+            }
+        }
+
+        float quantum_sec = iSize/pFiffRawData->info.sfreq;
+        quantum = ceil(quantum_sec*pFiffRawData->info.sfreq);
     }
 
-    float quantum_sec = iSize/pFiffRawData->info.sfreq;
-    fiff_int_t quantum = ceil(quantum_sec*pFiffRawData->info.sfreq);
+    // Setup the pipeline: one reader, iNumWorkers filter workers and the writer running in this thread
+    FilterFilePipeline pipeline;
+    pipeline.iQueueDepth = qMax(1, iQueueDepth);
+    pipeline.iNumBlocks = -1;
+    pipeline.iNextWrite = 0;
+    pipeline.bAbort = false;
+
+    int iNumWorkers = bUseThreads ? qMax(1, QThread::idealThreadCount() - 2) : 1;
+
+    // The filter engine keeps the kernel spectrum. Every worker gets its own copy and with it its own FFT workspaces.
+    MultiChannelFilter multiChannelFilter(filterKernel);
+    multiChannelFilter.prepare(quantum);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(iNumWorkers + 1);
+
+    QtConcurrent::run(&threadPool, std::bind(readFileBlocks,
+                                             std::ref(pipeline),
+                                             pFiffRawData,
+                                             from,
+                                             to,
+                                             quantum));
+
+    for(int i = 0; i < iNumWorkers; ++i) {
+        QtConcurrent::run(&threadPool, std::bind(filterFileBlocks,
+                                                 std::ref(pipeline),
+                                                 multiChannelFilter,
+                                                 vecPicks));
+    }
 
-    // Read, filter and write the data
+    // Write the data in order
+    bool bSuccess = true;
     bool first_buffer = true;
+    MatrixXd matDataOverlap;
+    FilterFileBlock block;
 
-    fiff_int_t first, last;
-    MatrixXd matData, matDataOverlap;
-    MatrixXd times;
+    while(true) {
+        {
+            QMutexLocker locker(&pipeline.mutex);
 
-    for(first = from; first < to; first+=quantum) {
-        last = first+quantum-1;
-        if (last > to) {
-            last = to;
-        }
+            while(!pipeline.bAbort
+                  && !pipeline.mapFiltered.contains(pipeline.iNextWrite)
+                  && !(pipeline.iNumBlocks >= 0 && pipeline.iNextWrite >= pipeline.iNumBlocks)) {
+                pipeline.conditionFiltered.wait(&pipeline.mutex);
+            }
 
-        if (!pFiffRawData->read_raw_segment(matData, times, mult, first, last, sel)) {
-            qWarning("[Filter::filterData] Error during read_raw_segment\n");
-            return false;
+            if(pipeline.bAbort) {
+                bSuccess = false;
+                break;
+            }
+
+            if(pipeline.iNumBlocks >= 0 && pipeline.iNextWrite >= pipeline.iNumBlocks) {
+                break;
+            }
+
+            block = pipeline.mapFiltered.take(pipeline.iNextWrite);
+            pipeline.iNextWrite++;
+            pipeline.conditionWritten.wakeAll();
         }
 
-        qInfo() << "Filtering and writing block" << first << "to" << last;
+        qInfo() << "Filtering and writing block" << block.iFirst << "to" << block.iLast;
 
         if (first_buffer) {
-           if (first > 0) {
-               outfid->write_int(FIFF_FIRST_SAMPLE,&first);
+           if (block.iFirst > 0) {
+               outfid->write_int(FIFF_FIRST_SAMPLE,&block.iFirst);
            }
            first_buffer = false;
         }
 
-        matData = filterDataBlock(matData,
-                                  vecPicks,
-                                  filterKernel,
-                                  bUseThreads);
+        MatrixXd& matData = block.matData;
 
-        if(first == from) {
+        if(block.iFirst == from) {
             outfid->write_raw_buffer(matData.block(0,iOrder/2,matData.rows(),matData.cols()-iOrder), cals);
-        } else if(first + quantum >= to) {
-            matData.block(0,0,matData.rows(),iOrder) += matDataOverlap;
-            outfid->write_raw_buffer(matData.block(0,0,matData.rows(),matData.cols()-iOrder), cals);
         } else {
             matData.block(0,0,matData.rows(),iOrder) += matDataOverlap;
             outfid->write_raw_buffer(matData.block(0,0,matData.rows(),matData.cols()-iOrder), cals);
@@ -185,9 +382,11 @@ bool RTPROCESSINGLIB::filterFile(QIODevice &pIODevice,
         matDataOverlap = matData.block(0,matData.cols()-iOrder,matData.rows(),iOrder);
     }
 
+    threadPool.waitForDone();
+
     outfid->finish_writing_raw();
 
-    return true;
+    return bSuccess;
 }
 
 //=============================================================================================================
@@ -248,57 +447,14 @@ MatrixXd RTPROCESSINGLIB::filterData(const MatrixXd& mataData,
         return mataData;
     }
 
-    // Create output matrix with size of input matrix
-    MatrixXd matDataOut(mataData.rows(), mataData.cols()+iOrder);
-    matDataOut.setZero();
-    MatrixXd sliceFiltered;
-
-    // slice input data into data junks with proper length so that the slices are always >= the filter order
-    float fFactor = 2.0f;
-    int iSize = fFactor * iOrder;
-    int residual = mataData.cols() % iSize;
-    while(residual < iOrder) {
-        fFactor = fFactor - 0.1f;
-        iSize = fFactor * iOrder;
-        residual = mataData.cols() % iSize;
-
-        if(iSize < iOrder) {
-            iSize = mataData.cols();
-            break;
-        }
-    }
-
-    if(mataData.cols() > iSize) {
-        int from = 0;
-        int numSlices = ceil(float(mataData.cols())/float(iSize)); //calculate number of data slices
-
-        for (int i = 0; i < numSlices; i++) {
-            if(i == numSlices-1) {
-                //catch the last one that might be shorter than the other blocks
-                iSize = mataData.cols() - (iSize * (numSlices -1));
-            }
-
-            // Filter the data block. This will return data with a fitler delay of iOrder/2 in front and back
-            sliceFiltered = filterDataBlock(mataData.block(0,from,mataData.rows(),iSize),
-                                            vecPicks,
-                                            filterKernel,
-                                            bUseThreads);
-
-            // Perform overlap add
-            if(i == 0) {
-                matDataOut.block(0,0,mataData.rows(),sliceFiltered.cols()) += sliceFiltered;
-            } else {
-                matDataOut.block(0,from,mataData.rows(),sliceFiltered.cols()) += sliceFiltered;
-            }
-
-            from += iSize;
-        }
-    } else {
-        matDataOut = filterDataBlock(mataData,
-                                     vecPicks,
-                                     filterKernel,
-                                     bUseThreads);
-    }
+    // Filter the whole block at once. Long blocks are split into overlap-add segments by the filter engine.
+    // This will return data with a filter delay of iOrder/2 in front and back.
+    MatrixXd matDataOut;
+    MultiChannelFilter multiChannelFilter(filterKernel);
+    multiChannelFilter.filterBlock(mataData,
+                                   vecPicks,
+                                   matDataOut,
+                                   bUseThreads);
 
     if(bKeepOverhead) {
         return matDataOut;
@@ -322,50 +478,13 @@ MatrixXd RTPROCESSINGLIB::filterDataBlock(const MatrixXd& mataData,
         return mataData;
     }
 
-    // Setup filters to the correct length, so we do not have to do this everytime we call the FFT filter function
-    FilterKernel filterKernelSetup = filterKernel;
-    filterKernelSetup.prepareFilter(mataData.cols());
-
-    // Do the concurrent filtering
-    RowVectorXi vecPicksNew = vecPicks;
-    if(vecPicksNew.cols() == 0) {
-        vecPicksNew = RowVectorXi::LinSpaced(mataData.rows(), 0, mataData.rows());
-    }
-
-    // Generate QList structure which can be handled by the QConcurrent framework
-    QList<FilterObject> timeData;
-
-    // Only select channels specified in vecPicksNew
-    FilterObject data;
-    for(qint32 i = 0; i < vecPicksNew.cols(); ++i) {
-        data.filterKernel = filterKernelSetup;
-        data.iRow = vecPicksNew[i];
-        data.vecData = mataData.row(vecPicksNew[i]);
-        timeData.append(data);
-    }
-
-    // Copy in data from last data block. This is necessary in order to also delay channels which are not filtered
-    MatrixXd matDataOut(mataData.rows(), mataData.cols()+iOrder);
-    matDataOut.setZero();
-    matDataOut.block(0, iOrder/2, mataData.rows(), mataData.cols()) = mataData;
-
-    if(bUseThreads) {
-        QFuture<void> future = QtConcurrent::map(timeData,
-                                                 filterChannel);
-        future.waitForFinished();
-    } else {
-        for(int i = 0; i < timeData.size(); ++i) {
-            filterChannel(timeData[i]);
-        }
-    }
-
-    // Do the overlap add method and store in matDataOut
-    RowVectorXd tempData;
-
-    for(int r = 0; r < timeData.size(); r++) {
-        // Write the newly calculated filtered data to the filter data matrix. This data has a delay of iOrder/2 in front and back
-        matDataOut.row(timeData.at(r).iRow) = timeData.at(r).vecData;
-    }
+    // Filter the picked channels and delay the other ones by iOrder/2
+    MatrixXd matDataOut;
+    MultiChannelFilter multiChannelFilter(filterKernel);
+    multiChannelFilter.filterBlock(mataData,
+                                   vecPicks,
+                                   matDataOut,
+                                   bUseThreads);
 
     return matDataOut;
 }
@@ -442,77 +561,28 @@ MatrixXd FilterOverlapAdd::calculate(const MatrixXd& mataData,
     }
 
     // Init overlaps from last block
-    if(m_matOverlapBack.cols() != iOrder || m_matOverlapBack.rows() < mataData.rows()) {
+    if(m_matOverlapBack.cols() != iOrder || m_matOverlapBack.rows() != mataData.rows()) {
         m_matOverlapBack.resize(mataData.rows(), iOrder);
         m_matOverlapBack.setZero();
     }
 
-    if(m_matOverlapFront.cols() != iOrder || m_matOverlapFront.rows() < mataData.rows()) {
+    if(m_matOverlapFront.cols() != iOrder || m_matOverlapFront.rows() != mataData.rows()) {
         m_matOverlapFront.resize(mataData.rows(), iOrder);
         m_matOverlapFront.setZero();
     }
 
-    // Create output matrix with size of input matrix
-    MatrixXd matDataOut(mataData.rows(), mataData.cols()+iOrder);
-    matDataOut.setZero();
-    MatrixXd sliceFiltered;
-
-    // slice input data into data junks with proper length so that the slices are always >= the filter order
-    float fFactor = 2.0f;
-    int iSize = fFactor * iOrder;
-    int residual = mataData.cols() % iSize;
-    while(residual < iOrder) {
-        fFactor = fFactor - 0.1f;
-        iSize = fFactor * iOrder;
-        residual = mataData.cols() % iSize;
-
-        if(iSize < iOrder) {
-            iSize = mataData.cols();
-            break;
-        }
-    }
-
-    if(mataData.cols() > iSize) {
-        int from = 0;
-        int numSlices = ceil(float(mataData.cols())/float(iSize)); //calculate number of data slices
-
-        for (int i = 0; i < numSlices; i++) {
-            if(i == numSlices-1) {
-                //catch the last one that might be shorter than the other blocks
-                iSize = mataData.cols() - (iSize * (numSlices -1));
-            }
-
-            // Filter the data block. This will return data with a fitler delay of iOrder/2 in front and back
-            sliceFiltered = filterDataBlock(mataData.block(0,from,mataData.rows(),iSize),
-                                            vecPicks,
-                                            filterKernel,
-                                            bUseThreads);
-
-            if(i == 0) {
-                matDataOut.block(0,0,mataData.rows(),sliceFiltered.cols()) += sliceFiltered;
-            } else {
-                matDataOut.block(0,from,mataData.rows(),sliceFiltered.cols()) += sliceFiltered;
-            }
-
-            if(bFilterEnd && (i == 0)) {
-                matDataOut.block(0,0,matDataOut.rows(),iOrder) += m_matOverlapBack;
-            } else if (!bFilterEnd && (i == numSlices-1)) {
-                matDataOut.block(0,matDataOut.cols()-iOrder,matDataOut.rows(),iOrder) += m_matOverlapFront;
-            }
-
-            from += iSize;
-        }
-    } else {
-        matDataOut = filterDataBlock(mataData,
+    // Filter the data block with the persistent filter engine. This will return data with a filter delay of iOrder/2 in front and back
+    MatrixXd matDataOut;
+    m_multiChannelFilter.setFilterKernel(filterKernel);
+    m_multiChannelFilter.filterBlock(mataData,
                                      vecPicks,
-                                     filterKernel,
+                                     matDataOut,
                                      bUseThreads);
 
-        if(bFilterEnd) {
-            matDataOut.block(0,0,matDataOut.rows(),iOrder) += m_matOverlapBack;
-        } else {
-            matDataOut.block(0,matDataOut.cols()-iOrder,matDataOut.rows(),iOrder) += m_matOverlapFront;
-        }
+    if(bFilterEnd) {
+        matDataOut.block(0,0,matDataOut.rows(),iOrder) += m_matOverlapBack;
+    } else {
+        matDataOut.block(0,matDataOut.cols()-iOrder,matDataOut.rows(),iOrder) += m_matOverlapFront;
     }
 
     // Refresh the overlap matrix with the new calculated filtered data
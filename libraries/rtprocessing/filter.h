@@ -43,6 +43,7 @@
 #include "rtprocessing_global.h"
 
 #include "helpers/filterkernel.h"
+#include "helpers/multichannelfilter.h"
 
 #include <fiff/fiff_info.h>
 
@@ -114,13 +115,17 @@ RTPROCESINGSHARED_EXPORT bool filterFile(QIODevice& pIODevice,
 //=========================================================================================================
 /**
  * Filters data from an input file based on an exisiting filter kernel and writes the filtered data to a
- * pIODevice.
+ * pIODevice. Reading, filtering and writing run as a pipeline: One thread reads the blocks, a set of workers
+ * filters them and the calling thread writes them in order. The output does not depend on the number of workers.
  *
  * @param [in] pIODevice            The IO device to write to.
  * @param [in] pFiffRawData         The fiff raw data object to read from.
  * @param [in] filterKernel         The list of filter kernels to use.
  * @param [in] vecPicks             Channel indexes to filter. Default is filter all channels.
- * @param [in] bUseThreads          hether to use multiple threads. Default is set to true.
+ * @param [in] bUseThreads          Whether to use multiple filter workers. Default is set to false.
+ * @param [in] iBlockSize           The number of samples per block. Must not be smaller than the filter order, only the
+ *                                  last block may be shorter. Default (-1) derives the block size from the filter order.
+ * @param [in] iQueueDepth          The maximum number of blocks waiting to be filtered and to be written. Default is 4.
  *
  * @return Returns true if successfull, false otherwise.
  */
@@ -128,7 +133,9 @@ RTPROCESINGSHARED_EXPORT bool filterFile(QIODevice& pIODevice,
                                          QSharedPointer<FIFFLIB::FiffRawData> pFiffRawData,
                                          const RTPROCESSINGLIB::FilterKernel& filterKernel,
                                          const Eigen::RowVectorXi &vecPicks = Eigen::RowVectorXi(),
-                                         bool bUseThreads = false);
+                                         bool bUseThreads = false,
+                                         int iBlockSize = -1,
+                                         int iQueueDepth = 4);
 
 //=========================================================================================================
 /**
@@ -279,6 +286,7 @@ public:
 private:
     Eigen::MatrixXd                 m_matOverlapBack;                   /**< Overlap block for the end of the data block */
     Eigen::MatrixXd                 m_matOverlapFront;                  /**< Overlap block for the beginning of the data block */
+    MultiChannelFilter              m_multiChannelFilter;               /**< Filter engine holding the kernel spectrum and FFT workspaces across calls */
 };
 
 //=============================================================================================================
@@ -0,0 +1,291 @@
+//=============================================================================================================
+/**
+ * @file     multichannelfilter.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MultiChannelFilter class definition.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "multichannelfilter.h"
+
+#include <utils/mnemath.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <functional>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+using namespace UTILSLIB;
+
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define MAX_FFT_LENGTH 65536    // Blocks needing a longer FFT are split into overlap-add segments of this FFT length
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MultiChannelFilter::Workspace::Workspace()
+{
+    fft.SetFlag(fft.HalfSpectrum);
+}
+
+//=============================================================================================================
+
+MultiChannelFilter::MultiChannelFilter()
+: m_iFilterOrder(0)
+, m_iBlockLength(-1)
+, m_iFftLength(-1)
+, m_iSegmentLength(-1)
+{
+}
+
+//=============================================================================================================
+
+MultiChannelFilter::MultiChannelFilter(const FilterKernel& filterKernel)
+: m_iFilterOrder(0)
+, m_iBlockLength(-1)
+, m_iFftLength(-1)
+, m_iSegmentLength(-1)
+{
+    setFilterKernel(filterKernel);
+}
+
+//=============================================================================================================
+
+MultiChannelFilter::MultiChannelFilter(const MultiChannelFilter& other)
+: m_vecCoeff(other.m_vecCoeff)
+, m_vecFftCoeff(other.m_vecFftCoeff)
+, m_iFilterOrder(other.m_iFilterOrder)
+, m_iBlockLength(other.m_iBlockLength)
+, m_iFftLength(other.m_iFftLength)
+, m_iSegmentLength(other.m_iSegmentLength)
+{
+}
+
+//=============================================================================================================
+
+MultiChannelFilter& MultiChannelFilter::operator=(const MultiChannelFilter& other)
+{
+    if(this != &other) {
+        m_vecCoeff = other.m_vecCoeff;
+        m_vecFftCoeff = other.m_vecFftCoeff;
+        m_iFilterOrder = other.m_iFilterOrder;
+        m_iBlockLength = other.m_iBlockLength;
+        m_iFftLength = other.m_iFftLength;
+        m_iSegmentLength = other.m_iSegmentLength;
+        m_lWorkspaces.clear();
+    }
+
+    return *this;
+}
+
+//=============================================================================================================
+
+void MultiChannelFilter::setFilterKernel(const FilterKernel& filterKernel)
+{
+    RowVectorXd vecCoeff = filterKernel.getCoefficients();
+
+    if(vecCoeff.cols() == m_vecCoeff.cols() && vecCoeff == m_vecCoeff && filterKernel.getFilterOrder() == m_iFilterOrder) {
+        return;
+    }
+
+    m_vecCoeff = vecCoeff;
+    m_iFilterOrder = filterKernel.getFilterOrder();
+
+    // Invalidate the kernel spectrum
+    m_vecFftCoeff.resize(0);
+    m_iBlockLength = -1;
+    m_iFftLength = -1;
+    m_iSegmentLength = -1;
+}
+
+//=============================================================================================================
+
+int MultiChannelFilter::getFilterOrder() const
+{
+    return m_iFilterOrder;
+}
+
+//=============================================================================================================
+
+void MultiChannelFilter::prepare(int iBlockLength)
+{
+    if(m_vecCoeff.cols() == 0 || iBlockLength <= 0 || iBlockLength == m_iBlockLength) {
+        return;
+    }
+
+    m_iBlockLength = iBlockLength;
+
+    // Make sure we always have the correct FFT length for the given block length and filter overlap
+    int iNumCoeff = m_vecCoeff.cols();
+    int iFftLength = pow(2, ceil(MNEMath::log2(iBlockLength + iNumCoeff)));
+
+    if(iFftLength > MAX_FFT_LENGTH) {
+        iFftLength = qMax(MAX_FFT_LENGTH, int(pow(2, ceil(MNEMath::log2(4 * iNumCoeff)))));
+    }
+
+    m_iSegmentLength = qMin(iBlockLength, iFftLength - iNumCoeff);
+
+    if(iFftLength == m_iFftLength) {
+        return;
+    }
+
+    m_iFftLength = iFftLength;
+
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    // Transform the zero padded coefficients once for this FFT length
+    Eigen::FFT<double> fft;
+    fft.SetFlag(fft.HalfSpectrum);
+
+    RowVectorXd vecInputFft = RowVectorXd::Zero(m_iFftLength);
+    vecInputFft.head(iNumCoeff) = m_vecCoeff;
+
+    fft.fwd(m_vecFftCoeff, vecInputFft, m_iFftLength);
+}
+
+//=============================================================================================================
+
+void MultiChannelFilter::filterBlock(const MatrixXd& matData,
+                                     const RowVectorXi& vecPicks,
+                                     MatrixXd& matDataOut,
+                                     bool bUseThreads)
+{
+    const int iOrder = m_iFilterOrder;
+
+    // Copy in the data with a delay of iOrder/2. This is necessary in order to also delay channels which are not filtered
+    matDataOut.resize(matData.rows(), matData.cols() + iOrder);
+    matDataOut.leftCols(iOrder/2).setZero();
+    matDataOut.middleCols(iOrder/2, matData.cols()) = matData;
+    matDataOut.rightCols(iOrder - iOrder/2).setZero();
+
+    if(m_vecCoeff.cols() == 0 || matData.cols() == 0) {
+        return;
+    }
+
+    prepare(matData.cols());
+
+    if(vecPicks.cols() == 0) {
+        m_vecRows = VectorXi::LinSpaced(matData.rows(), 0, matData.rows() - 1);
+    } else {
+        m_vecRows = vecPicks.transpose();
+    }
+
+    const int iNumRows = m_vecRows.size();
+
+    if(iNumRows == 0) {
+        return;
+    }
+
+    int iNumBatches = bUseThreads ? qBound(1, QThread::idealThreadCount(), iNumRows) : 1;
+
+    while(m_lWorkspaces.size() < iNumBatches) {
+        m_lWorkspaces.append(QSharedPointer<Workspace>::create());
+    }
+
+    if(iNumBatches == 1) {
+        filterRows(matData, 0, iNumRows, *m_lWorkspaces.first(), matDataOut);
+        return;
+    }
+
+    // Every batch works on its own contiguous range of rows and its own workspace
+    QVector<int> vecBatches(iNumBatches);
+    for(int i = 0; i < iNumBatches; ++i) {
+        vecBatches[i] = i;
+    }
+
+    std::function<void(int&)> computeLambda = [&](int& iBatch) {
+        filterRows(matData,
+                   iBatch * iNumRows / iNumBatches,
+                   (iBatch + 1) * iNumRows / iNumBatches,
+                   *m_lWorkspaces.at(iBatch),
+                   matDataOut);
+    };
+
+    QtConcurrent::blockingMap(vecBatches, computeLambda);
+}
+
+//=============================================================================================================
+
+void MultiChannelFilter::filterRows(const MatrixXd& matData,
+                                    int iStart,
+                                    int iEnd,
+                                    Workspace& workspace,
+                                    MatrixXd& matDataOut) const
+{
+    const int iNumCoeff = m_vecCoeff.cols();
+    const int iNumCols = matData.cols();
+    const int iNumColsOut = matDataOut.cols();
+
+    for(int i = iStart; i < iEnd; ++i) {
+        const int iRow = m_vecRows[i];
+
+        matDataOut.row(iRow).setZero();
+
+        // Overlap add over the segments. Usually the whole block fits into one segment.
+        for(int iFrom = 0; iFrom < iNumCols; iFrom += m_iSegmentLength) {
+            int iLength = qMin(m_iSegmentLength, iNumCols - iFrom);
+
+            workspace.vecTime.setZero(m_iFftLength);
+            workspace.vecTime.head(iLength) = matData.row(iRow).segment(iFrom, iLength);
+
+            workspace.fft.fwd(workspace.vecFreq, workspace.vecTime, m_iFftLength);
+            workspace.vecFreq.array() *= m_vecFftCoeff.array();
+            workspace.fft.inv(workspace.vecTime, workspace.vecFreq);
+
+            int iLengthOut = qMin(iLength + iNumCoeff, iNumColsOut - iFrom);
+            matDataOut.row(iRow).segment(iFrom, iLengthOut) += workspace.vecTime.head(iLengthOut);
+        }
+    }
+}
@@ -0,0 +1,198 @@
+//=============================================================================================================
+/**
+ * @file     multichannelfilter.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MultiChannelFilter class declaration.
+ *
+ */
+
+
+#ifndef MULTICHANNELFILTER_H
+#define MULTICHANNELFILTER_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../rtprocessing_global.h"
+
+#include "filterkernel.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QList>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+//=============================================================================================================
+// DEFINE NAMESPACE RTPROCESSINGLIB
+//=============================================================================================================
+
+namespace RTPROCESSINGLIB
+{
+
+//=============================================================================================================
+/**
+ * Reusable FFT filter engine for multichannel data. The frequency-domain kernel is computed once per FFT length
+ * and every worker keeps its own FFT object (and therefore its own FFT plan) plus padded time/frequency buffers.
+ * Channels are processed in batches directly on the output matrix, so no per-channel copies of the kernel or the
+ * data are created. Long blocks are split internally into overlap-add segments of a fixed FFT length.
+ *
+ * @brief Multichannel FFT filter engine with cached kernel spectrum and per-thread workspaces
+ */
+class RTPROCESINGSHARED_EXPORT MultiChannelFilter
+{
+
+public:
+    typedef QSharedPointer<MultiChannelFilter> SPtr;             /**< Shared pointer type for MultiChannelFilter. */
+    typedef QSharedPointer<const MultiChannelFilter> ConstSPtr;  /**< Const shared pointer type for MultiChannelFilter. */
+
+    //=========================================================================================================
+    /**
+     * Constructs a MultiChannelFilter object without a filter kernel.
+     */
+    MultiChannelFilter();
+
+    //=========================================================================================================
+    /**
+     * Constructs a MultiChannelFilter object
+     *
+     * @param[in] filterKernel      The filter kernel to use.
+     */
+    explicit MultiChannelFilter(const FilterKernel& filterKernel);
+
+    //=========================================================================================================
+    /**
+     * Copy constructor. The configuration and the kernel spectrum are copied, the FFT workspaces are not shared.
+     *
+     * @param[in] other             The MultiChannelFilter to copy.
+     */
+    MultiChannelFilter(const MultiChannelFilter& other);
+
+    //=========================================================================================================
+    /**
+     * Assignment operator. The configuration and the kernel spectrum are copied, the FFT workspaces are not shared.
+     *
+     * @param[in] other             The MultiChannelFilter to copy.
+     */
+    MultiChannelFilter& operator=(const MultiChannelFilter& other);
+
+    //=========================================================================================================
+    /**
+     * Sets the filter kernel. Nothing is recomputed if the coefficients did not change. Otherwise the kernel
+     * spectrum is invalidated.
+     *
+     * @param[in] filterKernel      The filter kernel to use.
+     */
+    void setFilterKernel(const FilterKernel& filterKernel);
+
+    //=========================================================================================================
+    /**
+     * Returns the order of the current filter kernel.
+     *
+     * @return The filter order.
+     */
+    int getFilterOrder() const;
+
+    //=========================================================================================================
+    /**
+     * Prepares the kernel spectrum for a given block length. This is done implicitly by filterBlock, but can be
+     * called beforehand in order to keep the FFT of the coefficients out of the processing loop.
+     *
+     * @param[in] iBlockLength      The number of samples of the blocks which are going to be filtered.
+     */
+    void prepare(int iBlockLength);
+
+    //=========================================================================================================
+    /**
+     * Filters a block of data. The output has iOrder additional columns and is laid out like the result of
+     * filterDataBlock: Channels which are not picked are copied with a delay of iOrder/2, picked channels hold the
+     * full linear convolution with the filter kernel.
+     *
+     * @param[in] matData           The data to filter (channels x samples).
+     * @param[in] vecPicks          Channel indexes to filter. All channels are filtered if empty.
+     * @param[out] matDataOut       The filtered data (channels x samples+iOrder). Must not alias matData.
+     * @param[in] bUseThreads       Whether to process the channel batches in parallel.
+     */
+    void filterBlock(const Eigen::MatrixXd& matData,
+                     const Eigen::RowVectorXi& vecPicks,
+                     Eigen::MatrixXd& matDataOut,
+                     bool bUseThreads = true);
+
+private:
+    //=========================================================================================================
+    /**
+     * The per-thread FFT workspace. The FFT object caches its plans, so it is reused across calls.
+     */
+    struct Workspace {
+        Workspace();
+
+        Eigen::FFT<double>      fft;                /**< The FFT object holding the plans. */
+        Eigen::RowVectorXd      vecTime;            /**< The zero padded time domain buffer. */
+        Eigen::RowVectorXcd     vecFreq;            /**< The half spectrum buffer. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Filters the rows m_vecRows[iStart] to m_vecRows[iEnd-1] in place on matDataOut.
+     *
+     * @param[in] matData           The data to filter.
+     * @param[in] iStart            The first index into m_vecRows.
+     * @param[in] iEnd              The index after the last one into m_vecRows.
+     * @param[in] workspace         The workspace to use.
+     * @param[out] matDataOut       The output matrix.
+     */
+    void filterRows(const Eigen::MatrixXd& matData,
+                    int iStart,
+                    int iEnd,
+                    Workspace& workspace,
+                    Eigen::MatrixXd& matDataOut) const;
+
+    Eigen::RowVectorXd                  m_vecCoeff;         /**< The filter coefficients. */
+    Eigen::RowVectorXcd                 m_vecFftCoeff;      /**< The half spectrum of the zero padded coefficients for m_iFftLength. */
+    Eigen::VectorXi                     m_vecRows;          /**< The rows to filter in the current call. */
+
+    QList<QSharedPointer<Workspace> >   m_lWorkspaces;      /**< One workspace per channel batch. */
+
+    int                                 m_iFilterOrder;     /**< The filter order. */
+    int                                 m_iBlockLength;     /**< The block length the kernel spectrum was prepared for. */
+    int                                 m_iFftLength;       /**< The FFT length. */
+    int                                 m_iSegmentLength;   /**< The number of input samples per FFT segment. */
+};
+} // NAMESPACE RTPROCESSINGLIB
+
+#endif // MULTICHANNELFILTER_H
@@ -0,0 +1,365 @@
+//=============================================================================================================
+/**
+ * @file     spatialoperatorcompositor.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Definition of the SpatialOperatorCompositor class.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "spatialoperatorcompositor.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define DENSE_OPERATOR_FILL 0.15    /**< Fill ratio above which a dense product is faster than a sparse one. */
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+SpatialOperatorCompositor::SpatialOperatorCompositor(int iNumChannels)
+: m_iNumChannels(0)
+, m_iNumRebuilds(0)
+, m_bDirty(true)
+, m_bFoldAcrossFilter(true)
+{
+    setNumChannels(iNumChannels);
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setNumChannels(int iNumChannels)
+{
+    m_iNumChannels = qMax(0, iNumChannels);
+
+    m_matComp.resize(0,0);
+    m_matProj.resize(0,0);
+    m_matSphara.resize(0,0);
+    m_vecBadIndices.clear();
+    m_vecFilterPicks.resize(0);
+
+    m_bCompActive = false;
+    m_bProjActive = false;
+    m_bBadsActive = false;
+    m_bSpharaActive = false;
+    m_bFilterActive = false;
+
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+int SpatialOperatorCompositor::getNumChannels() const
+{
+    return m_iNumChannels;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setCompensator(const SparseMatrix<double>& matComp,
+                                               bool bActive)
+{
+    m_matComp = matComp;
+    m_bCompActive = bActive;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setProjector(const SparseMatrix<double>& matProj,
+                                             bool bActive)
+{
+    m_matProj = matProj;
+    m_bProjActive = bActive;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setBadChannels(const QStringList& lBads,
+                                               const QStringList& lChNames,
+                                               bool bActive)
+{
+    QVector<int> vecBadIndices;
+    vecBadIndices.reserve(lBads.size());
+
+    for(const QString& sBad : lBads) {
+        int iIndex = lChNames.indexOf(sBad);
+        if(iIndex >= 0 && iIndex < m_iNumChannels) {
+            vecBadIndices.append(iIndex);
+        }
+    }
+
+    if(bActive == m_bBadsActive && vecBadIndices == m_vecBadIndices) {
+        return;
+    }
+
+    m_vecBadIndices = vecBadIndices;
+    m_bBadsActive = bActive;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setSphara(const SparseMatrix<double>& matSphara,
+                                          bool bActive)
+{
+    m_matSphara = matSphara;
+    m_bSpharaActive = bActive;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setTemporalFilter(const RowVectorXi& vecPicks,
+                                                  bool bActive)
+{
+    if(bActive == m_bFilterActive
+       && vecPicks.size() == m_vecFilterPicks.size()
+       && vecPicks == m_vecFilterPicks) {
+        return;
+    }
+
+    m_vecFilterPicks = vecPicks;
+    m_bFilterActive = bActive;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setFoldAcrossFilter(bool bFold)
+{
+    if(bFold != m_bFoldAcrossFilter) {
+        m_bFoldAcrossFilter = bFold;
+        m_bDirty = true;
+    }
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::applyBeforeFilter(Ref<MatrixXd> matData)
+{
+    update();
+    apply(m_opBeforeFilter, matData);
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::applyAfterFilter(Ref<MatrixXd> matData)
+{
+    update();
+    apply(m_opAfterFilter, matData);
+}
+
+//=============================================================================================================
+
+bool SpatialOperatorCompositor::hasOperatorBeforeFilter()
+{
+    update();
+    return !m_opBeforeFilter.bIdentity;
+}
+
+//=============================================================================================================
+
+bool SpatialOperatorCompositor::hasOperatorAfterFilter()
+{
+    update();
+    return !m_opAfterFilter.bIdentity;
+}
+
+//=============================================================================================================
+
+int SpatialOperatorCompositor::getNumRebuilds() const
+{
+    return m_iNumRebuilds;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::update()
+{
+    if(!m_bDirty) {
+        return;
+    }
+
+    m_bDirty = false;
+    ++m_iNumRebuilds;
+
+    const int n = m_iNumChannels;
+
+    auto isValid = [n](const SparseMatrix<double>& mat) {
+        return mat.rows() == n && mat.cols() == n;
+    };
+
+    // Compensator and projector are applied to the raw data in front of the filter
+    SparseMatrix<double> matBefore;
+    bool bBefore = false;
+
+    if(m_bCompActive && isValid(m_matComp)) {
+        matBefore = m_matComp;
+        bBefore = true;
+    }
+
+    if(m_bProjActive && isValid(m_matProj)) {
+        matBefore = bBefore ? SparseMatrix<double>(m_matProj * matBefore) : m_matProj;
+        bBefore = true;
+    }
+
+    // Bad channel mask and SPHARA are applied to the filtered data
+    SparseMatrix<double> matAfter;
+    bool bAfter = false;
+
+    if(m_bBadsActive && !m_vecBadIndices.isEmpty()) {
+        VectorXd vecMask = VectorXd::Ones(n);
+        for(int iIndex : m_vecBadIndices) {
+            vecMask[iIndex] = 0.0;
+        }
+        matAfter = SparseMatrix<double>(n, n);
+        matAfter.reserve(VectorXi::Ones(n));
+        for(int i = 0; i < n; ++i) {
+            if(vecMask[i] != 0.0) {
+                matAfter.insert(i, i) = 1.0;
+            }
+        }
+        matAfter.makeCompressed();
+        bAfter = true;
+    }
+
+    if(m_bSpharaActive && isValid(m_matSphara)) {
+        matAfter = bAfter ? SparseMatrix<double>(m_matSphara * matAfter) : m_matSphara;
+        bAfter = true;
+    }
+
+    // Move everything in front of the filter if the order does not matter
+    if(bAfter && (!m_bFilterActive || (m_bFoldAcrossFilter && commutesWithFilter(matAfter)))) {
+        matBefore = bBefore ? SparseMatrix<double>(matAfter * matBefore) : matAfter;
+        bBefore = true;
+        bAfter = false;
+    }
+
+    setFused(matBefore, bBefore, m_opBeforeFilter);
+    setFused(matAfter, bAfter, m_opAfterFilter);
+}
+
+//=============================================================================================================
+
+bool SpatialOperatorCompositor::commutesWithFilter(const SparseMatrix<double>& matOperator) const
+{
+    // All channels are filtered
+    if(m_vecFilterPicks.size() == 0) {
+        return true;
+    }
+
+    QVector<bool> vecFiltered(m_iNumChannels, false);
+    for(int i = 0; i < m_vecFilterPicks.size(); ++i) {
+        if(m_vecFilterPicks[i] >= 0 && m_vecFilterPicks[i] < m_iNumChannels) {
+            vecFiltered[m_vecFilterPicks[i]] = true;
+        }
+    }
+
+    for(int k = 0; k < matOperator.outerSize(); ++k) {
+        for(SparseMatrix<double>::InnerIterator it(matOperator, k); it; ++it) {
+            if(it.value() != 0.0 && vecFiltered[int(it.row())] != vecFiltered[int(it.col())]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::setFused(SparseMatrix<double>& matOperator,
+                                         bool bActive,
+                                         FusedOperator& fusedOperator)
+{
+    fusedOperator.bIdentity = !bActive;
+    fusedOperator.bDense = false;
+    fusedOperator.matSparse.resize(0,0);
+    fusedOperator.matDense.resize(0,0);
+
+    if(!bActive) {
+        return;
+    }
+
+    matOperator.prune(0.0);
+    matOperator.makeCompressed();
+
+    double dFill = matOperator.rows() > 0 ? double(matOperator.nonZeros()) / (double(matOperator.rows()) * double(matOperator.cols())) : 0.0;
+
+    if(dFill > DENSE_OPERATOR_FILL) {
+        fusedOperator.bDense = true;
+        fusedOperator.matDense = MatrixXd(matOperator);
+    } else {
+        fusedOperator.matSparse = matOperator;
+    }
+}
+
+//=============================================================================================================
+
+void SpatialOperatorCompositor::apply(const FusedOperator& fusedOperator,
+                                      Ref<MatrixXd> matData)
+{
+    if(fusedOperator.bIdentity) {
+        return;
+    }
+
+    if(matData.rows() != m_iNumChannels) {
+        qWarning() << "[SpatialOperatorCompositor::apply] Data has" << matData.rows() << "rows, operator expects" << m_iNumChannels << ". Returning.";
+        return;
+    }
+
+    // The work buffer keeps its memory as long as the block size does not change
+    if(fusedOperator.bDense) {
+        m_matWork.noalias() = fusedOperator.matDense * matData;
+    } else {
+        m_matWork.noalias() = fusedOperator.matSparse * matData;
+    }
+
+    matData = m_matWork;
+}
@@ -0,0 +1,286 @@
+//=============================================================================================================
+/**
+ * @file     spatialoperatorcompositor.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Contains the declaration of the SpatialOperatorCompositor class.
+ *
+ */
+
+#ifndef SPATIALOPERATORCOMPOSITOR_H
+#define SPATIALOPERATORCOMPOSITOR_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../rtprocessing_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// DEFINE NAMESPACE RTPROCESSINGLIB
+//=============================================================================================================
+
+namespace RTPROCESSINGLIB
+{
+
+//=============================================================================================================
+/**
+ * Folds the linear spatial operators of a real-time processing chain into cached matrices. The chain is
+ * compensator, SSP projector, [temporal filter], bad channel mask and SPHARA. The operators in front of the
+ * filter are multiplied into one matrix, the ones behind it into a second one. If no filter is active, or if the
+ * operators behind the filter do not mix filtered with unfiltered channels and therefore commute with it, all of
+ * them are folded into the first matrix. Every fused matrix is stored sparse or dense, whichever is cheaper to
+ * apply, and is only rebuilt when one of its parts changed.
+ *
+ * @brief Composes compensator, projector, bad channel mask and SPHARA into cached spatial operators
+ */
+class RTPROCESINGSHARED_EXPORT SpatialOperatorCompositor
+{
+
+public:
+    typedef QSharedPointer<SpatialOperatorCompositor> SPtr;             /**< Shared pointer type for SpatialOperatorCompositor. */
+    typedef QSharedPointer<const SpatialOperatorCompositor> ConstSPtr;  /**< Const shared pointer type for SpatialOperatorCompositor. */
+
+    //=========================================================================================================
+    /**
+     * Constructs a SpatialOperatorCompositor with all operators inactive.
+     *
+     * @param[in] iNumChannels      The number of channels.
+     */
+    explicit SpatialOperatorCompositor(int iNumChannels = 0);
+
+    //=========================================================================================================
+    /**
+     * Sets the number of channels and deactivates all operators.
+     *
+     * @param[in] iNumChannels      The number of channels.
+     */
+    void setNumChannels(int iNumChannels);
+
+    //=========================================================================================================
+    /**
+     * Returns the number of channels.
+     *
+     * @return The number of channels.
+     */
+    int getNumChannels() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the compensator.
+     *
+     * @param[in] matComp           The compensator (channels x channels).
+     * @param[in] bActive           Whether the compensator is applied.
+     */
+    void setCompensator(const Eigen::SparseMatrix<double>& matComp,
+                        bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Sets the SSP projector.
+     *
+     * @param[in] matProj           The projector (channels x channels).
+     * @param[in] bActive           Whether the projector is applied.
+     */
+    void setProjector(const Eigen::SparseMatrix<double>& matProj,
+                      bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Sets the bad channels which are zeroed before SPHARA, so they do not get smeared into the good ones.
+     * Nothing is rebuilt if the bad channels and the activation did not change.
+     *
+     * @param[in] lBads             The names of the bad channels.
+     * @param[in] lChNames          The names of all channels.
+     * @param[in] bActive           Whether the bad channels are zeroed.
+     */
+    void setBadChannels(const QStringList& lBads,
+                        const QStringList& lChNames,
+                        bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Sets the SPHARA operator.
+     *
+     * @param[in] matSphara         The SPHARA operator (channels x channels).
+     * @param[in] bActive           Whether SPHARA is applied.
+     */
+    void setSphara(const Eigen::SparseMatrix<double>& matSphara,
+                   bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Sets the channels the temporal filter is applied to. All channels are filtered the same way, the others
+     * are only delayed. Nothing is rebuilt if the picks and the activation did not change.
+     *
+     * @param[in] vecPicks          The filtered channels. All channels are filtered if empty.
+     * @param[in] bActive           Whether the temporal filter is active.
+     */
+    void setTemporalFilter(const Eigen::RowVectorXi& vecPicks,
+                           bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Sets whether the operators behind the filter may be moved in front of it if they commute with it. Must be
+     * switched off if the data between the operators is needed on its own, e.g. to display unfiltered data.
+     * Default is true.
+     *
+     * @param[in] bFold             Whether to fold across the filter.
+     */
+    void setFoldAcrossFilter(bool bFold);
+
+    //=========================================================================================================
+    /**
+     * Applies the fused operator in front of the temporal filter in place.
+     *
+     * @param[in,out] matData       The data (channels x samples).
+     */
+    void applyBeforeFilter(Eigen::Ref<Eigen::MatrixXd> matData);
+
+    //=========================================================================================================
+    /**
+     * Applies the fused operator behind the temporal filter in place.
+     *
+     * @param[in,out] matData       The data (channels x samples).
+     */
+    void applyAfterFilter(Eigen::Ref<Eigen::MatrixXd> matData);
+
+    //=========================================================================================================
+    /**
+     * Returns whether there is an operator in front of the temporal filter, i.e. applyBeforeFilter changes data.
+     *
+     * @return Whether there is an operator in front of the temporal filter.
+     */
+    bool hasOperatorBeforeFilter();
+
+    //=========================================================================================================
+    /**
+     * Returns whether there is an operator behind the temporal filter, i.e. applyAfterFilter changes data.
+     *
+     * @return Whether there is an operator behind the temporal filter.
+     */
+    bool hasOperatorAfterFilter();
+
+    //=========================================================================================================
+    /**
+     * Returns how often the fused operators were rebuilt.
+     *
+     * @return The number of rebuilds.
+     */
+    int getNumRebuilds() const;
+
+private:
+    //=========================================================================================================
+    /**
+     * A fused operator, stored in the representation which is cheaper to apply.
+     */
+    struct FusedOperator {
+        bool                            bIdentity = true;   /**< Whether the operator is the identity and can be skipped. */
+        bool                            bDense = false;     /**< Whether matDense or matSparse holds the operator. */
+        Eigen::SparseMatrix<double>     matSparse;          /**< The sparse operator. */
+        Eigen::MatrixXd                 matDense;           /**< The dense operator. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Rebuilds the fused operators if one of their parts changed.
+     */
+    void update();
+
+    //=========================================================================================================
+    /**
+     * Returns whether an operator commutes with the temporal filter, i.e. does not mix filtered and
+     * unfiltered channels.
+     *
+     * @param[in] matOperator       The operator.
+     *
+     * @return Whether the operator commutes with the filter.
+     */
+    bool commutesWithFilter(const Eigen::SparseMatrix<double>& matOperator) const;
+
+    //=========================================================================================================
+    /**
+     * Stores an operator in the cheaper representation.
+     *
+     * @param[in] matOperator       The operator.
+     * @param[in] bActive           Whether there is an operator at all.
+     * @param[out] fusedOperator    The fused operator.
+     */
+    static void setFused(Eigen::SparseMatrix<double>& matOperator,
+                         bool bActive,
+                         FusedOperator& fusedOperator);
+
+    //=========================================================================================================
+    /**
+     * Applies a fused operator in place.
+     *
+     * @param[in] fusedOperator     The fused operator.
+     * @param[in,out] matData       The data.
+     */
+    void apply(const FusedOperator& fusedOperator,
+               Eigen::Ref<Eigen::MatrixXd> matData);
+
+    int                             m_iNumChannels;         /**< The number of channels. */
+    int                             m_iNumRebuilds;         /**< How often the fused operators were rebuilt. */
+    bool                            m_bDirty;               /**< Whether a part changed since the last rebuild. */
+    bool                            m_bFoldAcrossFilter;    /**< Whether operators may be moved in front of the filter. */
+
+    Eigen::SparseMatrix<double>     m_matComp;              /**< The compensator. */
+    Eigen::SparseMatrix<double>     m_matProj;              /**< The SSP projector. */
+    Eigen::SparseMatrix<double>     m_matSphara;            /**< The SPHARA operator. */
+    QVector<int>                    m_vecBadIndices;        /**< The indices of the bad channels. */
+    Eigen::RowVectorXi              m_vecFilterPicks;       /**< The channels the filter is applied to. */
+
+    bool                            m_bCompActive;          /**< Whether the compensator is applied. */
+    bool                            m_bProjActive;          /**< Whether the projector is applied. */
+    bool                            m_bBadsActive;          /**< Whether bad channels are zeroed. */
+    bool                            m_bSpharaActive;        /**< Whether SPHARA is applied. */
+    bool                            m_bFilterActive;        /**< Whether the temporal filter is active. */
+
+    FusedOperator                   m_opBeforeFilter;       /**< The fused operator in front of the filter. */
+    FusedOperator                   m_opAfterFilter;        /**< The fused operator behind the filter. */
+    Eigen::MatrixXd                 m_matWork;              /**< Work buffer for the products, reused across blocks. */
+};
+} // NAMESPACE RTPROCESSINGLIB
+
+#endif // SPATIALOPERATORCOMPOSITOR_H
@@ -87,10 +87,13 @@ RtAveragingWorker::RtAveragingWorker(quint32 numAverages,
 , m_bDoBaselineCorrection(false)
 , m_pairBaselineSec(qMakePair(float(iBaselineFromMSecs),float(iBaselineToMSecs)))
 , m_bActivateThreshold(false)
+, m_averagingMode(SlidingWindow)
+, m_bComputeStdErr(false)
 {
     m_mapThresholds["eog"] = 300e-6;
 
     m_stimEvokedSet.info = *m_pFiffInfo.data();
+    m_stimStdErrSet.info = *m_pFiffInfo.data();
 
     m_iNewPreStimSamples = m_iPreStimSamples;
     m_iNewPostStimSamples = m_iPostStimSamples;
@@ -125,25 +128,14 @@ void RtAveragingWorker::setAverageNumber(qint32 numAve)
         return;
     }
 
-    if(numAve < m_iNumAverages) {
-        int iDiff = m_iNumAverages - numAve;
-
-        //Do averaging for each trigger type
-        QMutableMapIterator<double,QList<Eigen::MatrixXd> > idx(m_mapStimAve);
+    m_iNumAverages = numAve;
 
-        while(idx.hasNext()) {
-            idx.next();
+    //Subtract the epochs which are not part of the window anymore for each trigger type
+    QList<double> lTriggerTypes = m_mapStimAve.keys();
 
-            if(idx.value().size() > iDiff) {
-                //Pop data from buffer
-                for(int i = 0; i < iDiff; ++i) {
-                    idx.value().pop_front();
-                }
-            }
-        }
+    for(int i = 0; i < lTriggerTypes.size(); ++i) {
+        removeOldestEpochs(m_mapStimAve[lTriggerTypes.at(i)].size() - m_iNumAverages, lTriggerTypes.at(i));
     }
-
-    m_iNumAverages = numAve;
 }
 
 //=============================================================================================================
@@ -229,6 +221,41 @@ void RtAveragingWorker::setBaselineTo(int toSamp,
 
 //=============================================================================================================
 
+void RtAveragingWorker::setAveragingMode(AveragingMode mode)
+{
+    if(mode == m_averagingMode) {
+        return;
+    }
+
+    m_averagingMode = mode;
+
+    //Restart the running sums since the stored epochs do not match the new mode
+    QList<double> lTriggerTypes = m_mapStimSum.keys();
+
+    for(int i = 0; i < lTriggerTypes.size(); ++i) {
+        m_mapStimAve[lTriggerTypes.at(i)].clear();
+        recomputeRunningSums(lTriggerTypes.at(i));
+    }
+}
+
+//=============================================================================================================
+
+void RtAveragingWorker::setComputeStdErr(bool bComputeStdErr)
+{
+    if(bComputeStdErr == m_bComputeStdErr) {
+        return;
+    }
+
+    m_bComputeStdErr = bComputeStdErr;
+
+    //The sums of squares are always kept, so the standard error is available right away in both modes
+    if(!m_bComputeStdErr) {
+        m_stimStdErrSet.evoked.clear();
+    }
+}
+
+//=============================================================================================================
+
 void RtAveragingWorker::doAveraging(const MatrixXd& rawSegment)
 {
     //Detect trigger
@@ -354,6 +381,10 @@ void RtAveragingWorker::emitEvoked(double dTriggerType, QStringList& lResponsibl
         emit resultReady(m_stimEvokedSet, lResponsibleTriggerTypes);
     }
 
+    if(m_bComputeStdErr && m_stimStdErrSet.evoked.size() > 0) {
+        emit stdErrReady(m_stimStdErrSet, lResponsibleTriggerTypes);
+    }
+
 //    qDebug()<<"RtAveragingWorker::emitEvoked() - dTriggerType:" << dTriggerType;
 //    qDebug()<<"RtAveragingWorker::emitEvoked() - m_mapStimAve[dTriggerType].size():" << m_mapStimAve[dTriggerType].size();
 }
@@ -439,44 +470,110 @@ void RtAveragingWorker::mergeData(double dTriggerType)
     }
 
     if(!bArtifactDetected) {
-        //Add cut data to average buffer
-        m_mapStimAve[dTriggerType].append(mergedData);
-
-        //Pop data from buffer
-        int iDiff =  m_mapStimAve[dTriggerType].size() - m_iNumAverages;
-        if(iDiff > 0) {
-            for(int i = 0; i < iDiff; ++i) {
-                m_mapStimAve[dTriggerType].pop_front();
-            }
-        }
+        //Add cut data to the running average
+        addEpoch(mergedData, dTriggerType);
+    }
+}
+
+//=============================================================================================================
+
+void RtAveragingWorker::addEpoch(const MatrixXd& matEpoch,
+                                 double dTriggerType)
+{
+    MatrixXd& matSum = m_mapStimSum[dTriggerType];
+
+    //(Re)start the running sums if the epoch size changed
+    if(matSum.rows() != matEpoch.rows() || matSum.cols() != matEpoch.cols()) {
+        m_mapStimAve[dTriggerType].clear();
+        matSum = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+        m_mapStimSumSquared[dTriggerType] = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+        m_mapStimCount[dTriggerType] = 0;
+        m_mapStimRemoved[dTriggerType] = 0;
+    }
+
+    matSum += matEpoch;
+    m_mapStimSumSquared[dTriggerType].array() += matEpoch.array().square();
+    m_mapStimCount[dTriggerType]++;
+
+    if(m_averagingMode == SlidingWindow) {
+        //Add cut data to average buffer and subtract the data leaving the window
+        m_mapStimAve[dTriggerType].append(matEpoch);
+        removeOldestEpochs(m_mapStimAve[dTriggerType].size() - m_iNumAverages, dTriggerType);
     }
 }
 
 //=============================================================================================================
 
+void RtAveragingWorker::removeOldestEpochs(int iNumEpochs,
+                                           double dTriggerType)
+{
+    if(iNumEpochs <= 0) {
+        return;
+    }
+
+    QList<MatrixXd>& lEpochs = m_mapStimAve[dTriggerType];
+    MatrixXd& matSum = m_mapStimSum[dTriggerType];
+
+    //Pop data from buffer
+    for(int i = 0; i < iNumEpochs && !lEpochs.isEmpty(); ++i) {
+        matSum -= lEpochs.first();
+        m_mapStimSumSquared[dTriggerType].array() -= lEpochs.first().array().square();
+        lEpochs.pop_front();
+
+        m_mapStimCount[dTriggerType]--;
+        m_mapStimRemoved[dTriggerType]++;
+    }
+
+    //Recompute the sums once per window length to keep the rounding errors of the subtractions bounded
+    if(m_mapStimRemoved[dTriggerType] >= m_iNumAverages) {
+        recomputeRunningSums(dTriggerType);
+    }
+}
+
+//=============================================================================================================
+
+void RtAveragingWorker::recomputeRunningSums(double dTriggerType)
+{
+    const QList<MatrixXd>& lEpochs = m_mapStimAve[dTriggerType];
+    MatrixXd& matSum = m_mapStimSum[dTriggerType];
+    MatrixXd& matSumSquared = m_mapStimSumSquared[dTriggerType];
+
+    matSum.setZero();
+    matSumSquared.setZero(matSum.rows(), matSum.cols());
+
+    for(int i = 0; i < lEpochs.size(); ++i) {
+        matSum += lEpochs.at(i);
+        matSumSquared.array() += lEpochs.at(i).array().square();
+    }
+
+    m_mapStimCount[dTriggerType] = lEpochs.size();
+    m_mapStimRemoved[dTriggerType] = 0;
+}
+
+//=============================================================================================================
+
 void RtAveragingWorker::generateEvoked(double dTriggerType)
 {
-    if(m_mapStimAve[dTriggerType].isEmpty()) {
-        qDebug() << "[RtAveragingWorker::generateEvoked] m_mapStimAve is empty for type" << dTriggerType << "Returning.";
+    const int iNumEpochs = m_mapStimCount.value(dTriggerType, 0);
+
+    if(iNumEpochs <= 0) {
+        qDebug() << "[RtAveragingWorker::generateEvoked] No epochs averaged for type" << dTriggerType << "Returning.";
         return;
     }
 
-    //Init evoked
-    m_stimEvokedSet.info = *m_pFiffInfo.data();
-    FiffEvoked evoked;
-    evoked.setInfo(*m_pFiffInfo.data());
     int iEvokedIdx = -1;
 
     for(int i = 0; i < m_stimEvokedSet.evoked.size(); ++i) {
         if(m_stimEvokedSet.evoked.at(i).comment == QString::number(dTriggerType)) {
-            evoked = m_stimEvokedSet.evoked.at(i);
             iEvokedIdx = i;
             break;
         }
     }
 
-    //If the evoked is not yet present add it here
+    //If the evoked is not yet present add it here. The times only need to be computed once.
     if(iEvokedIdx == -1) {
+        FiffEvoked evoked;
+        evoked.setInfo(*m_pFiffInfo.data());
         evoked.baseline = m_pairBaselineSec;
         evoked.times.resize(m_iPreStimSamples + m_iPostStimSamples);
         evoked.times = RowVectorXf::LinSpaced(m_iPreStimSamples + m_iPostStimSamples,
@@ -486,35 +583,70 @@ void RtAveragingWorker::generateEvoked(double dTriggerType)
         evoked.first = 0;
         evoked.last = m_iPreStimSamples + m_iPostStimSamples;
         evoked.comment = QString::number(dTriggerType);
+
+        m_stimEvokedSet.evoked.append(evoked);
+        iEvokedIdx = m_stimEvokedSet.evoked.size() - 1;
     }
 
-    // Generate final evoked
-    MatrixXd finalAverage = MatrixXd::Zero(m_mapStimAve[dTriggerType].first().rows(), m_iPreStimSamples+m_iPostStimSamples);
+    FiffEvoked& evoked = m_stimEvokedSet.evoked[iEvokedIdx];
+
+    // Generate final evoked from the running sum
+    evoked.data = m_mapStimSum[dTriggerType] / iNumEpochs;
 
-    for(int i = 0; i < m_mapStimAve[dTriggerType].size(); ++i) {
-        finalAverage += m_mapStimAve[dTriggerType].at(i);
+    if(m_bDoBaselineCorrection) {
+        evoked.data = MNEMath::rescale(evoked.data, evoked.times, m_pairBaselineSec, QString("mean"));
     }
 
-    if(!m_mapStimAve[dTriggerType].isEmpty()) {
-        finalAverage = finalAverage/m_mapStimAve[dTriggerType].size();
+    evoked.nave = iNumEpochs;
+
+    if(m_bComputeStdErr) {
+        generateStdErr(dTriggerType, evoked);
     }
+}
 
-    if(m_bDoBaselineCorrection) {
-        finalAverage = MNEMath::rescale(finalAverage, evoked.times, m_pairBaselineSec, QString("mean"));
+//=============================================================================================================
+
+void RtAveragingWorker::generateStdErr(double dTriggerType,
+                                       const FiffEvoked& evoked)
+{
+    int iEvokedIdx = -1;
+
+    for(int i = 0; i < m_stimStdErrSet.evoked.size(); ++i) {
+        if(m_stimStdErrSet.evoked.at(i).comment == evoked.comment) {
+            iEvokedIdx = i;
+            break;
+        }
     }
 
-    evoked.data = finalAverage;
+    if(iEvokedIdx == -1) {
+        FiffEvoked stdErr;
+        stdErr.setInfo(*m_pFiffInfo.data());
+        stdErr.aspect_kind = FIFFV_ASPECT_STD_ERR;
+        stdErr.baseline = evoked.baseline;
+        stdErr.times = evoked.times;
+        stdErr.first = evoked.first;
+        stdErr.last = evoked.last;
+        stdErr.comment = evoked.comment;
+
+        m_stimStdErrSet.evoked.append(stdErr);
+        iEvokedIdx = m_stimStdErrSet.evoked.size() - 1;
+    }
+
+    FiffEvoked& stdErr = m_stimStdErrSet.evoked[iEvokedIdx];
 
-    evoked.nave = m_mapStimAve[dTriggerType].size();
+    const int iNumEpochs = m_mapStimCount.value(dTriggerType, 0);
+    const MatrixXd& matSum = m_mapStimSum[dTriggerType];
+    const MatrixXd& matSumSquared = m_mapStimSumSquared[dTriggerType];
 
-    //Add new data to evoked data set
-    if(iEvokedIdx != -1) {
-        //Evoked data is already present
-        m_stimEvokedSet.evoked[iEvokedIdx] = evoked;
+    if(iNumEpochs > 1) {
+        // Unbiased variance from the running sums, clamped against negative rounding errors
+        stdErr.data = ((matSumSquared.array() - matSum.array().square() / iNumEpochs) / (iNumEpochs - 1)).max(0.0).matrix();
+        stdErr.data = (stdErr.data.array() / iNumEpochs).sqrt().matrix();
     } else {
-        //Evoked data is not present yet
-        m_stimEvokedSet.evoked.append(evoked);
+        stdErr.data = MatrixXd::Zero(matSum.rows(), matSum.cols());
     }
+
+    stdErr.nave = iNumEpochs;
 }
 
 //=============================================================================================================
@@ -528,9 +660,14 @@ void RtAveragingWorker::reset()
 
     //Clear all evoked data information
     m_stimEvokedSet.evoked.clear();
+    m_stimStdErrSet.evoked.clear();
 
     //Clear all maps
     m_mapStimAve.clear();
+    m_mapStimSum.clear();
+    m_mapStimSumSquared.clear();
+    m_mapStimCount.clear();
+    m_mapStimRemoved.clear();
     m_mapDataPre.clear();
     m_mapDataPre[-1.0] = MatrixXd::Zero(m_pFiffInfo->chs.size(), m_iPreStimSamples);
     m_mapDataPost.clear();
@@ -561,6 +698,28 @@ RtAveraging::RtAveraging(quint32 numAverages,
                                                       iBaselineToSecs,
                                                       iTriggerIndex,
                                                       pFiffInfo);
+
+    startWorker(worker);
+}
+
+//=============================================================================================================
+
+RtAveraging::~RtAveraging()
+{
+    stop();
+}
+
+//=============================================================================================================
+
+void RtAveraging::append(const MatrixXd &data)
+{
+    emit operate(data);
+}
+
+//=============================================================================================================
+
+void RtAveraging::startWorker(RtAveragingWorker* worker)
+{
     worker->moveToThread(&m_workerThread);
 
     connect(&m_workerThread, &QThread::finished,
@@ -571,6 +730,8 @@ RtAveraging::RtAveraging(quint32 numAverages,
 
     connect(worker, &RtAveragingWorker::resultReady,
             this, &RtAveraging::handleResults, Qt::DirectConnection);
+    connect(worker, &RtAveragingWorker::stdErrReady,
+            this, &RtAveraging::handleStdErrResults, Qt::DirectConnection);
 
     connect(this, &RtAveraging::averageNumberChanged,
             worker, &RtAveragingWorker::setAverageNumber);
@@ -588,6 +749,10 @@ RtAveraging::RtAveraging(quint32 numAverages,
             worker, &RtAveragingWorker::setBaselineFrom);
     connect(this, &RtAveraging::averageBaselineToChanged,
             worker, &RtAveragingWorker::setBaselineTo);
+    connect(this, &RtAveraging::averagingModeChanged,
+            worker, &RtAveragingWorker::setAveragingMode);
+    connect(this, &RtAveraging::averageComputeStdErrChanged,
+            worker, &RtAveragingWorker::setComputeStdErr);
     connect(this, &RtAveraging::averageResetRequested,
             worker, &RtAveragingWorker::reset);
 
@@ -596,25 +761,20 @@ RtAveraging::RtAveraging(quint32 numAverages,
 
 //=============================================================================================================
 
-RtAveraging::~RtAveraging()
-{
-    stop();
-}
-
-//=============================================================================================================
-
-void RtAveraging::append(const MatrixXd &data)
+void RtAveraging::handleResults(const FiffEvokedSet& evokedStimSet,
+                          const QStringList &lResponsibleTriggerTypes)
 {
-    emit operate(data);
+    emit evokedStim(evokedStimSet,
+                    lResponsibleTriggerTypes);
 }
 
 //=============================================================================================================
 
-void RtAveraging::handleResults(const FiffEvokedSet& evokedStimSet,
-                          const QStringList &lResponsibleTriggerTypes)
+void RtAveraging::handleStdErrResults(const FiffEvokedSet& evokedStimStdErrSet,
+                                      const QStringList &lResponsibleTriggerTypes)
 {
-    emit evokedStim(evokedStimSet,
-                    lResponsibleTriggerTypes);
+    emit evokedStimStdErr(evokedStimStdErrSet,
+                          lResponsibleTriggerTypes);
 }
 
 //=============================================================================================================
@@ -636,37 +796,8 @@ void RtAveraging::restart(quint32 numAverages,
                                                       iBaselineToSecs,
                                                       iTriggerIndex,
                                                       pFiffInfo);
-    worker->moveToThread(&m_workerThread);
-
-    connect(&m_workerThread, &QThread::finished,
-            worker, &QObject::deleteLater);
-
-    connect(this, &RtAveraging::operate,
-            worker, &RtAveragingWorker::doWork);
-
-    connect(worker, &RtAveragingWorker::resultReady,
-            this, &RtAveraging::handleResults, Qt::DirectConnection);
-
-    connect(this, &RtAveraging::averageNumberChanged,
-            worker, &RtAveragingWorker::setAverageNumber);
-    connect(this, &RtAveraging::averagePreStimChanged,
-            worker, &RtAveragingWorker::setPreStim);
-    connect(this, &RtAveraging::averagePostStimChanged,
-            worker, &RtAveragingWorker::setPostStim);
-    connect(this, &RtAveraging::averageTriggerChIdxChanged,
-            worker, &RtAveragingWorker::setTriggerChIndx);
-    connect(this, &RtAveraging::averageArtifactReductionChanged,
-            worker, &RtAveragingWorker::setArtifactReduction);
-    connect(this, &RtAveraging::averageBaselineActiveChanged,
-            worker, &RtAveragingWorker::setBaselineActive);
-    connect(this, &RtAveraging::averageBaselineFromChanged,
-            worker, &RtAveragingWorker::setBaselineFrom);
-    connect(this, &RtAveraging::averageBaselineToChanged,
-            worker, &RtAveragingWorker::setBaselineTo);
-    connect(this, &RtAveraging::averageResetRequested,
-            worker, &RtAveragingWorker::reset);
 
-    m_workerThread.start();
+    startWorker(worker);
 }
 
 //=============================================================================================================
@@ -748,6 +879,20 @@ void RtAveraging::setBaselineTo(int toSamp,
 
 //=============================================================================================================
 
+void RtAveraging::setAveragingMode(RtAveragingWorker::AveragingMode mode)
+{
+    emit averagingModeChanged(mode);
+}
+
+//=============================================================================================================
+
+void RtAveraging::setComputeStdErr(bool bComputeStdErr)
+{
+    emit averageComputeStdErrChanged(bComputeStdErr);
+}
+
+//=============================================================================================================
+
 void RtAveraging::reset()
 {
     emit averageResetRequested();
@@ -85,6 +85,12 @@ class RTPROCESINGSHARED_EXPORT RtAveragingWorker : public QObject
     Q_OBJECT
 
 public:
+    enum AveragingMode {
+        SlidingWindow,      /**< Average over the last m_iNumAverages epochs. The epochs are kept to subtract them once they leave the window. */
+        Cumulative          /**< Average over all epochs since the last reset. Only the running sums are kept. */
+    };
+    Q_ENUM(AveragingMode)
+
     //=========================================================================================================
     /**
      * Creates the real-time averaging object.
@@ -185,6 +191,23 @@ public:
     void setBaselineTo(int toSamp,
                        int toMSec);
 
+    //=========================================================================================================
+    /**
+     * Sets the averaging mode. The running sums of all trigger types are restarted.
+     *
+     * @param[in] mode    the new averaging mode
+     */
+    void setAveragingMode(RTPROCESSINGLIB::RtAveragingWorker::AveragingMode mode);
+
+    //=========================================================================================================
+    /**
+     * Sets whether the standard error of the averages is emitted. The running sum of squares is always kept, so
+     * the standard error also covers the epochs averaged before it was switched on.
+     *
+     * @param[in] bComputeStdErr    whether to compute the standard error
+     */
+    void setComputeStdErr(bool bComputeStdErr);
+
     //=========================================================================================================
     /**
      * Resets the averaged data stored.
@@ -221,12 +244,51 @@ protected:
      */
     void mergeData(double dTriggerType);
 
+    //=========================================================================================================
+    /**
+     * Adds an accepted epoch to the running sums and, in sliding window mode, subtracts the epochs leaving the window.
+     *
+     * @param[in] matEpoch        the epoch (pre and post stim data)
+     * @param[in] dTriggerType    the trigger type
+     */
+    void addEpoch(const Eigen::MatrixXd& matEpoch,
+                  double dTriggerType);
+
+    //=========================================================================================================
+    /**
+     * Subtracts the oldest stored epochs from the running sums.
+     *
+     * @param[in] iNumEpochs      the number of epochs to remove
+     * @param[in] dTriggerType    the trigger type
+     */
+    void removeOldestEpochs(int iNumEpochs,
+                            double dTriggerType);
+
+    //=========================================================================================================
+    /**
+     * Recomputes the running sums from the stored epochs. This removes the rounding errors accumulated by the
+     * subtractions. In cumulative mode no epochs are stored and the sums are restarted.
+     *
+     * @param[in] dTriggerType    the trigger type
+     */
+    void recomputeRunningSums(double dTriggerType);
+
     //=========================================================================================================
     /**
      * Generates the final evoke variable.
      */
     void generateEvoked(double dTriggerType);
 
+    //=========================================================================================================
+    /**
+     * Generates the standard error of the average from the running sum of squares.
+     *
+     * @param[in] dTriggerType    the trigger type
+     * @param[in] evoked          the evoked average to take the time information from
+     */
+    void generateStdErr(double dTriggerType,
+                        const FIFFLIB::FiffEvoked& evoked);
+
     //=========================================================================================================
     /**
      * Check if control values have been changed
@@ -256,8 +318,17 @@ protected:
     FIFFLIB::FiffInfo::SPtr                         m_pFiffInfo;                /**< Holds the fiff measurement information. */
     FIFFLIB::FiffEvokedSet                          m_stimEvokedSet;            /**< Holds the evoked information. */
 
+    AveragingMode                                   m_averagingMode;            /**< The averaging mode. */
+    bool                                            m_bComputeStdErr;           /**< Whether to compute and emit the standard error. */
+
+    FIFFLIB::FiffEvokedSet                          m_stimStdErrSet;            /**< Holds the standard error of the evoked information. */
+
     QMap<QString,double>                            m_mapThresholds;            /**< Holds the current thresholds for artifact rejection. */
-    QMap<double,QList<Eigen::MatrixXd> >            m_mapStimAve;               /**< the current stimulus average buffer. Holds m_iNumAverages vectors */
+    QMap<double,QList<Eigen::MatrixXd> >            m_mapStimAve;               /**< the current stimulus average buffer. Holds m_iNumAverages vectors in sliding window mode, nothing in cumulative mode. */
+    QMap<double,Eigen::MatrixXd>                    m_mapStimSum;               /**< The running sum of the averaged epochs. */
+    QMap<double,Eigen::MatrixXd>                    m_mapStimSumSquared;        /**< The running sum of the squared averaged epochs. */
+    QMap<double,qint32>                             m_mapStimCount;             /**< The number of epochs in the running sums. */
+    QMap<double,qint32>                             m_mapStimRemoved;           /**< The number of epochs subtracted from the running sums since they were last recomputed. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPre;               /**< The matrix holding pre stim data. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPost;              /**< The matrix holding post stim data. */
     QMap<double,qint32>                             m_mapMatDataPostIdx;        /**< Current index inside of the matrix m_matDataPost */
@@ -273,6 +344,17 @@ signals:
      */
     void resultReady(const FIFFLIB::FiffEvokedSet& evokedStimSet,
                      const QStringList& lResponsibleTriggerTypes);
+
+    //=========================================================================================================
+    /**
+     * Signal which is emitted together with resultReady if the standard error is computed. The evoked data hold the
+     * standard error of the averages (aspect kind FIFFV_ASPECT_STD_ERR). The SNR follows as average / standard error.
+     *
+     * @param[in] evokedStimStdErrSet        The standard error of the evoked stimulus data set.
+     * @param[in] lResponsibleTriggerTypes   List of all trigger types which lead to the recent emit of a new evoked set.
+     */
+    void stdErrReady(const FIFFLIB::FiffEvokedSet& evokedStimStdErrSet,
+                     const QStringList& lResponsibleTriggerTypes);
 };
 
 //=============================================================================================================
@@ -423,6 +505,22 @@ public:
     void setBaselineTo(int toSamp,
                        int toMSec);
 
+    //=========================================================================================================
+    /**
+     * Sets the averaging mode
+     *
+     * @param[in] mode    the new averaging mode
+     */
+    void setAveragingMode(RTPROCESSINGLIB::RtAveragingWorker::AveragingMode mode);
+
+    //=========================================================================================================
+    /**
+     * Sets whether the standard error of the averages is computed and emitted via evokedStimStdErr
+     *
+     * @param[in] bComputeStdErr    whether to compute the standard error
+     */
+    void setComputeStdErr(bool bComputeStdErr);
+
     //=========================================================================================================
     /**
      * Reset the data processing in the real-time worker
@@ -430,6 +528,14 @@ public:
     void reset();
 
 protected:
+    //=========================================================================================================
+    /**
+     * Connects the worker to this object and starts the worker thread.
+     *
+     * @param[in] worker     The worker to connect.
+     */
+    void startWorker(RtAveragingWorker* worker);
+
     //=========================================================================================================
     /**
      * Handles the results.
@@ -437,11 +543,20 @@ protected:
     void handleResults(const FIFFLIB::FiffEvokedSet& evokedStimSet,
                        const QStringList& lResponsibleTriggerTypes);
 
+    //=========================================================================================================
+    /**
+     * Handles the standard error results.
+     */
+    void handleStdErrResults(const FIFFLIB::FiffEvokedSet& evokedStimStdErrSet,
+                             const QStringList& lResponsibleTriggerTypes);
+
     QThread             m_workerThread;         /**< The worker thread. */
 
 signals:
     void evokedStim(const FIFFLIB::FiffEvokedSet& evokedStimSet,
                     const QStringList& lResponsibleTriggerTypes);
+    void evokedStimStdErr(const FIFFLIB::FiffEvokedSet& evokedStimStdErrSet,
+                          const QStringList& lResponsibleTriggerTypes);
     void operate(const Eigen::MatrixXd& matData);
     void averageNumberChanged(qint32 numAve);
     void averagePreStimChanged(qint32 samples,
@@ -455,6 +570,8 @@ signals:
                                     int fromMSec);
     void averageBaselineToChanged(int toSamp,
                                   int toMSec);
+    void averagingModeChanged(RTPROCESSINGLIB::RtAveragingWorker::AveragingMode mode);
+    void averageComputeStdErrChanged(bool bComputeStdErr);
     void averageResetRequested();
 };
 
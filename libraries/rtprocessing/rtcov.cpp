@@ -40,13 +40,17 @@
 
 #include "rtcov.h"
 
-
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -61,9 +65,69 @@ using namespace Eigen;
 //=============================================================================================================
 
 RtCov::RtCov(QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo)
-: m_fiffInfo(*pFiffInfo)
+: m_estimationMode(Block)
 , m_iSamples(0)
+, m_iSamplesSinceUpdate(0)
+, m_iSamplesRemoved(0)
+, m_iUpdateInterval(0)
+, m_dWeight(0.0)
+, m_dWeightSquared(0.0)
+, m_dRegMag(0.05)
+, m_dRegGrad(0.05)
+, m_dRegEeg(0.1)
+, m_fiffInfo(*pFiffInfo)
+{
+    for(int i = 0; i < m_fiffInfo.chs.size(); i++) {
+        if(m_fiffInfo.chs.at(i).kind != FIFFV_MEG_CH &&
+           m_fiffInfo.chs.at(i).kind != FIFFV_EEG_CH) {
+            m_lExclude << m_fiffInfo.chs.at(i).ch_name;
+        }
+    }
+}
+
+//=============================================================================================================
+
+void RtCov::setEstimationMode(EstimationMode mode)
+{
+    if(mode == m_estimationMode) {
+        return;
+    }
+
+    m_estimationMode = mode;
+    reset();
+}
+
+//=============================================================================================================
+
+void RtCov::setUpdateInterval(int iUpdateSamples)
+{
+    m_iUpdateInterval = iUpdateSamples;
+}
+
+//=============================================================================================================
+
+void RtCov::setRegularization(double dRegMag,
+                              double dRegGrad,
+                              double dRegEeg)
+{
+    m_dRegMag = dRegMag;
+    m_dRegGrad = dRegGrad;
+    m_dRegEeg = dRegEeg;
+}
+
+//=============================================================================================================
+
+void RtCov::reset()
 {
+    m_vecSum.setZero();
+    m_matSumOuter.setZero();
+    m_dWeight = 0.0;
+    m_dWeightSquared = 0.0;
+
+    m_lData.clear();
+    m_iSamples = 0;
+    m_iSamplesSinceUpdate = 0;
+    m_iSamplesRemoved = 0;
 }
 
 //=============================================================================================================
@@ -76,93 +140,139 @@ FiffCov RtCov::estimateCovariance(const Eigen::MatrixXd& matData,
         return FiffCov();
     }
 
-    m_lData.append(matData);
-    m_iSamples += matData.cols();
+    update(matData, iNewMaxSamples);
 
+    // Wait until the estimation window was filled once
     if(m_iSamples < iNewMaxSamples) {
         return FiffCov();
     }
 
-    QFuture<RtCovComputeResult> result = QtConcurrent::mappedReduced(m_lData,
-                                                                     compute,
-                                                                     reduce);
+    if(m_estimationMode == Block) {
+        FiffCov computedCov = computeCovariance();
+        reset();
+        return computedCov;
+    }
 
-    result.waitForFinished();
+    int iUpdateInterval = m_iUpdateInterval > 0 ? m_iUpdateInterval : iNewMaxSamples;
 
-    RtCovComputeResult finalResult = result.result();
+    if(m_iSamplesSinceUpdate < iUpdateInterval) {
+        return FiffCov();
+    }
 
-    //Final computation
-    FiffCov computedCov;
-    computedCov.data = finalResult.matData;
+    m_iSamplesSinceUpdate = 0;
 
-    QStringList exclude;
-    for(int i = 0; i<m_fiffInfo.chs.size(); i++) {
-        if(m_fiffInfo.chs.at(i).kind != FIFFV_MEG_CH &&
-           m_fiffInfo.chs.at(i).kind != FIFFV_EEG_CH) {
-            exclude << m_fiffInfo.chs.at(i).ch_name;
-        }
+    return computeCovariance();
+}
+
+//=============================================================================================================
+
+void RtCov::update(const MatrixXd& matData,
+                   int iWindowSamples)
+{
+    if(matData.cols() == 0) {
+        return;
     }
-    bool doProj = true;
 
-    if(m_iSamples > 0) {
-        finalResult.mu /= (float)m_iSamples;
-        computedCov.data.array() -= m_iSamples * (finalResult.mu * finalResult.mu.transpose()).array();
-        computedCov.data.array() /= (m_iSamples - 1);
+    // (Re)start if the number of channels changed
+    if(m_vecSum.size() != matData.rows()) {
+        m_vecSum = VectorXd::Zero(matData.rows());
+        m_matSumOuter = MatrixXd::Zero(matData.rows(), matData.rows());
+        reset();
+    }
 
-        computedCov.kind = FIFFV_MNE_NOISE_COV;
-        computedCov.diag = false;
-        computedCov.dim = computedCov.data.rows();
+    if(m_estimationMode == ExponentiallyWeighted && iWindowSamples > 0) {
+        // Forget old samples with a per sample factor of 1 - 1/iWindowSamples
+        double dDecay = std::pow(1.0 - 1.0 / iWindowSamples, static_cast<double>(matData.cols()));
 
-        //ToDo do picks
-        computedCov.names = m_fiffInfo.ch_names;
-        computedCov.projs = m_fiffInfo.projs;
-        computedCov.bads = m_fiffInfo.bads;
-        computedCov.nfree = m_iSamples;
+        m_vecSum *= dDecay;
+        m_matSumOuter.triangularView<Eigen::Lower>() *= dDecay;
+        m_dWeight *= dDecay;
+        m_dWeightSquared *= dDecay * dDecay;
+    }
+
+    // Rank-k update of the accumulators
+    m_vecSum += matData.rowwise().sum();
+    m_matSumOuter.selfadjointView<Eigen::Lower>().rankUpdate(matData);
+    m_dWeight += matData.cols();
+    m_dWeightSquared += matData.cols();
 
-        // regularize noise covariance
-        computedCov = computedCov.regularize(m_fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
+    m_iSamples += matData.cols();
+    m_iSamplesSinceUpdate += matData.cols();
 
-//            qint32 samples = rawSegment.cols();
-//            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
+    if(m_estimationMode != SlidingWindow) {
+        return;
+    }
 
-//            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-//            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-//            noise_covariance.array() /= (samples - 1);
+    // Subtract the blocks which left the window
+    m_lData.append(matData);
 
-//            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
+    while(m_lData.size() > 1 && m_iSamples - m_lData.first().cols() >= iWindowSamples) {
+        const MatrixXd& matOldest = m_lData.first();
 
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
+        m_vecSum -= matOldest.rowwise().sum();
+        m_matSumOuter.selfadjointView<Eigen::Lower>().rankUpdate(matOldest, -1.0);
+        m_dWeight -= matOldest.cols();
+        m_dWeightSquared -= matOldest.cols();
 
-        m_lData.clear();
-        m_iSamples = 0;
+        m_iSamples -= matOldest.cols();
+        m_iSamplesRemoved += matOldest.cols();
 
-        return computedCov;
-    } else {
-        qWarning() << "[RtCov::estimateCovariance] Number of samples equals zero. Regularization not possible. Returning empty covariance estimation.";
-        return FiffCov();
+        m_lData.pop_front();
     }
 
+    // Recompute once per window length to keep the rounding errors of the subtractions bounded
+    if(m_iSamplesRemoved >= iWindowSamples) {
+        recompute();
+    }
 }
 
 //=============================================================================================================
 
-RtCovComputeResult RtCov::compute(const MatrixXd &matData)
+void RtCov::recompute()
 {
-    RtCovComputeResult result;
-    result.mu = matData.rowwise().sum();
-    result.matData = matData * matData.transpose();
-    return result;
+    m_vecSum.setZero();
+    m_matSumOuter.setZero();
+    m_dWeight = 0.0;
+
+    for(int i = 0; i < m_lData.size(); ++i) {
+        m_vecSum += m_lData.at(i).rowwise().sum();
+        m_matSumOuter.selfadjointView<Eigen::Lower>().rankUpdate(m_lData.at(i));
+        m_dWeight += m_lData.at(i).cols();
+    }
+
+    m_dWeightSquared = m_dWeight;
+    m_iSamplesRemoved = 0;
 }
 
 //=============================================================================================================
 
-void RtCov::reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult)
+FiffCov RtCov::computeCovariance() const
 {
-    if(finalResult.matData.size() == 0 || finalResult.mu.size() == 0) {
-        finalResult.mu = tempResult.mu;
-        finalResult.matData = tempResult.matData;
-    } else {
-        finalResult.mu += tempResult.mu;
-        finalResult.matData += tempResult.matData;
+    // Unbiased estimate for the sample weights: W - sum(w^2)/W equals n - 1 for unit weights
+    double dNorm = m_dWeight > 0.0 ? m_dWeight - m_dWeightSquared / m_dWeight : 0.0;
+
+    if(dNorm <= 0.0) {
+        qWarning() << "[RtCov::computeCovariance] Number of samples too small. Regularization not possible. Returning empty covariance estimation.";
+        return FiffCov();
     }
+
+    VectorXd mu = m_vecSum / m_dWeight;
+
+    FiffCov computedCov;
+    computedCov.data = m_matSumOuter.selfadjointView<Eigen::Lower>();
+    computedCov.data.noalias() -= m_dWeight * (mu * mu.transpose());
+    computedCov.data /= dNorm;
+
+    computedCov.kind = FIFFV_MNE_NOISE_COV;
+    computedCov.diag = false;
+    computedCov.dim = computedCov.data.rows();
+
+    //ToDo do picks
+    computedCov.names = m_fiffInfo.ch_names;
+    computedCov.projs = m_fiffInfo.projs;
+    computedCov.bads = m_fiffInfo.bads;
+    computedCov.nfree = static_cast<int>(m_dWeight * m_dWeight / m_dWeightSquared + 0.5);
+
+    // regularize noise covariance
+    return computedCov.regularize(m_fiffInfo, m_dRegMag, m_dRegGrad, m_dRegEeg, true, m_lExclude);
 }
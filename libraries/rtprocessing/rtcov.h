@@ -51,6 +51,8 @@
 
 #include <QSharedPointer>
 #include <QThread>
+#include <QList>
+#include <QStringList>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -77,14 +79,10 @@ namespace RTPROCESSINGLIB
 // RTPROCESSINGLIB FORWARD DECLARATIONS
 //=============================================================================================================
 
-struct RtCovComputeResult {
-    Eigen::VectorXd mu;
-    Eigen::MatrixXd matData;
-};
-
 //=============================================================================================================
 /**
- * Real-time covariance worker.
+ * Real-time covariance worker. Incoming data blocks are folded into a running sum and a running sum of outer
+ * products (rank-k update), so the memory footprint does not depend on how often an estimate is requested.
  *
  * @brief Real-time covariance worker.
  */
@@ -93,13 +91,57 @@ class RTPROCESINGSHARED_EXPORT RtCov : public QObject
     Q_OBJECT
 
 public:
+    enum EstimationMode {
+        Block,                  /**< Accumulate the estimation window, emit one estimate and start over. */
+        ExponentiallyWeighted,  /**< Exponentially forget old samples. The window defines the effective number of samples. */
+        SlidingWindow           /**< Use the latest samples of the estimation window. The blocks inside the window are kept. */
+    };
+
     RtCov(QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo);
 
+    //=========================================================================================================
+    /**
+     * Sets the estimation mode. Changing the mode restarts the estimation.
+     *
+     * @param[in] mode  The new estimation mode.
+     */
+    void setEstimationMode(EstimationMode mode);
+
+    //=========================================================================================================
+    /**
+     * Sets the number of samples after which a new covariance is emitted in the ExponentiallyWeighted and
+     * SlidingWindow modes. Values <= 0 emit once per estimation window. The Block mode always emits once per window.
+     *
+     * @param[in] iUpdateSamples  The number of samples between two estimates.
+     */
+    void setUpdateInterval(int iUpdateSamples);
+
+    //=========================================================================================================
+    /**
+     * Sets the regularization which is applied to each emitted covariance.
+     *
+     * @param[in] dRegMag   Regularization of the magnetometers.
+     * @param[in] dRegGrad  Regularization of the gradiometers.
+     * @param[in] dRegEeg   Regularization of the EEG channels.
+     */
+    void setRegularization(double dRegMag,
+                           double dRegGrad,
+                           double dRegEeg);
+
+    //=========================================================================================================
+    /**
+     * Clears all accumulated data.
+     */
+    void reset();
+
     //=========================================================================================================
     /**
      * Perform actual covariance estimation.
      *
-     * @param[in] inputData  Data to estimate the covariance from.
+     * @param[in] matData           Data to estimate the covariance from.
+     * @param[in] iNewMaxSamples    The estimation window in samples.
+     *
+     * @return The regularized covariance if a new estimate is due, an empty covariance otherwise.
      */
     FIFFLIB::FiffCov estimateCovariance(const Eigen::MatrixXd& matData,
                                         int iNewMaxSamples);
@@ -107,26 +149,47 @@ public:
 protected:
     //=========================================================================================================
     /**
-     * Computer multiplication with transposed.
-     *
-     * @param[in] matData  Data to self multiply with.
+     * Adds a data block to the accumulators and removes or forgets old samples depending on the mode.
      *
-     * @return   The multiplication result.
+     * @param[in] matData           The new data block.
+     * @param[in] iWindowSamples    The estimation window in samples.
      */
-    static RtCovComputeResult compute(const Eigen::MatrixXd &matData);
+    void update(const Eigen::MatrixXd& matData,
+                int iWindowSamples);
 
     //=========================================================================================================
     /**
-     * Computer multiplication with transposed.
+     * Recomputes the accumulators from the blocks stored in the sliding window.
+     */
+    void recompute();
+
+    //=========================================================================================================
+    /**
+     * Computes and regularizes the covariance from the current accumulators.
      *
-     * @param[out]   finalResult     The final covariance estimation.
-     * @param[in]    tempResult      The intermediate result from the compute function
+     * @return The regularized covariance.
      */
-    static void reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult);
+    FIFFLIB::FiffCov computeCovariance() const;
+
+    EstimationMode          m_estimationMode;           /**< The estimation mode. */
+
+    int                     m_iSamples;                 /**< The number of samples in the estimation. In ExponentiallyWeighted mode all samples since the last (re)start are counted. */
+    int                     m_iSamplesSinceUpdate;      /**< The number of samples since the last emitted estimate. */
+    int                     m_iSamplesRemoved;          /**< The number of samples subtracted since the last recompute. */
+    int                     m_iUpdateInterval;          /**< The number of samples between two estimates. */
+
+    double                  m_dWeight;                  /**< The sum of the sample weights. */
+    double                  m_dWeightSquared;           /**< The sum of the squared sample weights. */
+    double                  m_dRegMag;                  /**< Regularization of the magnetometers. */
+    double                  m_dRegGrad;                 /**< Regularization of the gradiometers. */
+    double                  m_dRegEeg;                  /**< Regularization of the EEG channels. */
+
+    Eigen::VectorXd         m_vecSum;                   /**< The weighted sum of the samples. */
+    Eigen::MatrixXd         m_matSumOuter;              /**< The weighted sum of the outer products. Only the lower triangle is kept up to date. */
 
-    int                     m_iSamples;                 /**< The number of stored samples. */
+    QList<Eigen::MatrixXd>  m_lData;                    /**< The data blocks inside the sliding window. */
 
-    QList<Eigen::MatrixXd>  m_lData;                    /**< The stored data blocks. */
+    QStringList             m_lExclude;                 /**< The channels excluded from the regularization. */
 
     FIFFLIB::FiffInfo       m_fiffInfo;                 /**< Holds the fiff measurement information. */
 };
@@ -94,6 +94,8 @@ SOURCES += \
     helpers/parksmcclellan.cpp \
     helpers/filterkernel.cpp \
     helpers/filterio.cpp \
+    helpers/multichannelfilter.cpp \
+    helpers/spatialoperatorcompositor.cpp \
 
 HEADERS +=  \
     icp.h \
@@ -112,6 +114,8 @@ HEADERS +=  \
     helpers/parksmcclellan.h \
     helpers/filterkernel.h \
     helpers/filterio.h \
+    helpers/multichannelfilter.h \
+    helpers/spatialoperatorcompositor.h \
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
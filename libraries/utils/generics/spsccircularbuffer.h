@@ -0,0 +1,470 @@
+//=============================================================================================================
+/**
+ * @file     spsccircularbuffer.h
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    SpscCircularBuffer class declaration
+ *
+ */
+
+
+#ifndef SPSCCIRCULARBUFFER_H
+#define SPSCCIRCULARBUFFER_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+
+#include <utility>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QSharedPointer>
+#include <QThread>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+ * TEMPLATE SINGLE PRODUCER SINGLE CONSUMER CIRCULAR BUFFER
+ *
+ * Lock-free ring for exactly one producer thread and one consumer thread. The slots are allocated once and reused:
+ * pushSwap and pop exchange the element with the slot instead of copying it, so the caller gets the storage of
+ * an old slot back and can fill it again without allocating. push copies into the slot, which for Eigen matrices
+ * of the same size does not allocate either. Since swapped back elements can have any size (e.g. the empty matrix
+ * the consumer passed to its first pop), Eigen matrices should be resized before filling them, which is a no-op if the
+ * size did not change. The blocking calls back off from spinning to yielding to sleeping,
+ * so waiting does not burn a core, and give up after the timeout like CircularBuffer.
+ *
+ * @brief The TEMPLATE SINGLE PRODUCER SINGLE CONSUMER CIRCULAR BUFFER provides a lock-free circular buffer for one producer and one consumer.
+ */
+template<typename _Tp>
+class SpscCircularBuffer
+{
+public:
+    typedef QSharedPointer<SpscCircularBuffer> SPtr;              /**< Shared pointer type for SpscCircularBuffer. */
+    typedef QSharedPointer<const SpscCircularBuffer> ConstSPtr;   /**< Const shared pointer type for SpscCircularBuffer. */
+
+    //=========================================================================================================
+    /**
+     * Constructs a SpscCircularBuffer.
+     *
+     * @param [in] uiMaxNumElements     length of buffer.
+     */
+    explicit SpscCircularBuffer(unsigned int uiMaxNumElements);
+
+    //=========================================================================================================
+    /**
+     * Constructs a SpscCircularBuffer and preallocates all slots with copies of a prototype element.
+     *
+     * @param [in] uiMaxNumElements     length of buffer.
+     * @param [in] prototype            element used to preallocate the slots, e.g. a matrix of the block size.
+     */
+    SpscCircularBuffer(unsigned int uiMaxNumElements,
+                       const _Tp& prototype);
+
+    //=========================================================================================================
+    /**
+     * Destroys the SpscCircularBuffer.
+     */
+    ~SpscCircularBuffer();
+
+    //=========================================================================================================
+    /**
+     * Adds an element at the end of the buffer by copying it into the slot. Returns immediately.
+     *
+     * @param [in] newElement   the element to add.
+     *
+     * @return true if the element was added, false if the buffer is full.
+     */
+    inline bool tryPush(const _Tp& newElement);
+
+    //=========================================================================================================
+    /**
+     * Adds an element at the end of the buffer by swapping it with the slot. Returns immediately.
+     *
+     * @param [in, out] newElement  the element to add. Holds the previous content of the slot afterwards.
+     *
+     * @return true if the element was added, false if the buffer is full.
+     */
+    inline bool tryPushSwap(_Tp& newElement);
+
+    //=========================================================================================================
+    /**
+     * Returns the first element (first in first out) by swapping it with the slot. Returns immediately.
+     *
+     * @param [in, out] element     receives the first element. Its previous content is kept in the slot for reuse.
+     *
+     * @return true if an element was returned, false if the buffer is empty.
+     */
+    inline bool tryPop(_Tp& element);
+
+    //=========================================================================================================
+    /**
+     * Adds an element at the end of the buffer by copying it into the slot. Waits with backoff until there is
+     * space or the timeout is reached.
+     *
+     * @param [in] newElement   the element to add.
+     *
+     * @return true if the element was added, false if the timeout was reached.
+     */
+    inline bool push(const _Tp& newElement);
+
+    //=========================================================================================================
+    /**
+     * Adds an element at the end of the buffer by swapping it with the slot. Waits with backoff until there is
+     * space or the timeout is reached.
+     *
+     * @param [in, out] newElement  the element to add. Holds the previous content of the slot afterwards.
+     *
+     * @return true if the element was added, false if the timeout was reached.
+     */
+    inline bool pushSwap(_Tp& newElement);
+
+    //=========================================================================================================
+    /**
+     * Returns the first element (first in first out) by swapping it with the slot. Waits with backoff until an
+     * element is available or the timeout is reached.
+     *
+     * @param [in, out] element     receives the first element. Its previous content is kept in the slot for reuse.
+     *
+     * @return true if an element was returned, false if the timeout was reached.
+     */
+    inline bool pop(_Tp& element);
+
+    //=========================================================================================================
+    /**
+     * Clears the buffer. Must not be called while the producer or the consumer are accessing the buffer.
+     */
+    void clear();
+
+    //=========================================================================================================
+    /**
+     * Sets the timeout of the blocking calls.
+     *
+     * @param [in] iTimeout     the timeout in ms. A negative value waits forever.
+     */
+    inline void setTimeout(int iTimeout);
+
+    //=========================================================================================================
+    /**
+     * Returns the number of elements which can be read.
+     */
+    inline int getFreeElementsRead() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of elements which can be written.
+     */
+    inline int getFreeElementsWrite() const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Waits before the next retry of a blocking call. Spins first, then yields and finally sleeps with an
+     * exponentially growing period of at most 1 ms.
+     *
+     * @param [in, out] iRetry  the number of retries so far.
+     * @param [in] timer        the timer started with the blocking call.
+     *
+     * @return false if the timeout was reached.
+     */
+    inline bool backoff(int& iRetry,
+                        const QElapsedTimer& timer) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the index following the given one.
+     *
+     * @param [in] iIndex   the index.
+     *
+     * @return the next index.
+     */
+    inline int nextIndex(int iIndex) const;
+
+    int             m_iNumSlots;            /**< Holds the number of slots, which is one more than the maximal number of buffer elements.*/
+    _Tp*            m_pBuffer;              /**< Holds the circular buffer.*/
+    int             m_iTimeout;             /**< Holds the timeout value after which the blocking calls return false.*/
+
+    char            m_cPadRead[64];         /**< Keeps the read index on its own cache line.*/
+    QAtomicInt      m_iReadIndex;           /**< Holds the next index to read. Only written by the consumer.*/
+    char            m_cPadWrite[64];        /**< Keeps the write index on its own cache line.*/
+    QAtomicInt      m_iWriteIndex;          /**< Holds the next index to write. Only written by the producer.*/
+    char            m_cPadEnd[64];          /**< Keeps the members following the buffer off the write index cache line.*/
+};
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+SpscCircularBuffer<_Tp>::SpscCircularBuffer(unsigned int uiMaxNumElements)
+: m_iNumSlots(int(uiMaxNumElements) + 1)
+, m_pBuffer(new _Tp[m_iNumSlots])
+, m_iTimeout(1000)
+, m_iReadIndex(0)
+, m_iWriteIndex(0)
+{
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+SpscCircularBuffer<_Tp>::SpscCircularBuffer(unsigned int uiMaxNumElements,
+                                            const _Tp& prototype)
+: SpscCircularBuffer(uiMaxNumElements)
+{
+    for(int i = 0; i < m_iNumSlots; ++i) {
+        m_pBuffer[i] = prototype;
+    }
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+SpscCircularBuffer<_Tp>::~SpscCircularBuffer()
+{
+    delete [] m_pBuffer;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::tryPush(const _Tp& newElement)
+{
+    const int iWrite = m_iWriteIndex.loadAcquire();
+    const int iNext = nextIndex(iWrite);
+
+    if(iNext == m_iReadIndex.loadAcquire()) {
+        return false;
+    }
+
+    m_pBuffer[iWrite] = newElement;
+    m_iWriteIndex.storeRelease(iNext);
+
+    return true;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::tryPushSwap(_Tp& newElement)
+{
+    const int iWrite = m_iWriteIndex.loadAcquire();
+    const int iNext = nextIndex(iWrite);
+
+    if(iNext == m_iReadIndex.loadAcquire()) {
+        return false;
+    }
+
+    using std::swap;
+    swap(m_pBuffer[iWrite], newElement);
+    m_iWriteIndex.storeRelease(iNext);
+
+    return true;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::tryPop(_Tp& element)
+{
+    const int iRead = m_iReadIndex.loadAcquire();
+
+    if(iRead == m_iWriteIndex.loadAcquire()) {
+        return false;
+    }
+
+    using std::swap;
+    swap(m_pBuffer[iRead], element);
+    m_iReadIndex.storeRelease(nextIndex(iRead));
+
+    return true;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::push(const _Tp& newElement)
+{
+    if(tryPush(newElement)) {
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int iRetry = 0;
+
+    while(backoff(iRetry, timer)) {
+        if(tryPush(newElement)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::pushSwap(_Tp& newElement)
+{
+    if(tryPushSwap(newElement)) {
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int iRetry = 0;
+
+    while(backoff(iRetry, timer)) {
+        if(tryPushSwap(newElement)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::pop(_Tp& element)
+{
+    if(tryPop(element)) {
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int iRetry = 0;
+
+    while(backoff(iRetry, timer)) {
+        if(tryPop(element)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline void SpscCircularBuffer<_Tp>::clear()
+{
+    m_iReadIndex.storeRelease(0);
+    m_iWriteIndex.storeRelease(0);
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline void SpscCircularBuffer<_Tp>::setTimeout(int iTimeout)
+{
+    m_iTimeout = iTimeout;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline int SpscCircularBuffer<_Tp>::getFreeElementsRead() const
+{
+    return (m_iWriteIndex.loadAcquire() - m_iReadIndex.loadAcquire() + m_iNumSlots) % m_iNumSlots;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline int SpscCircularBuffer<_Tp>::getFreeElementsWrite() const
+{
+    return m_iNumSlots - 1 - getFreeElementsRead();
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline bool SpscCircularBuffer<_Tp>::backoff(int& iRetry,
+                                             const QElapsedTimer& timer) const
+{
+    if(m_iTimeout >= 0 && timer.elapsed() >= m_iTimeout) {
+        return false;
+    }
+
+    if(iRetry < 16) {
+        // Spin, the other thread is most likely just about to finish its access
+    } else if(iRetry < 64) {
+        QThread::yieldCurrentThread();
+    } else {
+        QThread::usleep(qMin(1000, 1 << qMin(iRetry - 64, 10)));
+    }
+
+    ++iRetry;
+
+    return true;
+}
+
+//=============================================================================================================
+
+template<typename _Tp>
+inline int SpscCircularBuffer<_Tp>::nextIndex(int iIndex) const
+{
+    return (iIndex + 1) == m_iNumSlots ? 0 : iIndex + 1;
+}
+
+//=============================================================================================================
+// TYPEDEF
+//=============================================================================================================
+
+typedef SpscCircularBuffer<int>                      SpscCircularBuffer_int;                 /**< Defines SpscCircularBuffer of integer type.*/
+typedef SpscCircularBuffer<double>                   SpscCircularBuffer_double;              /**< Defines SpscCircularBuffer of double type.*/
+typedef SpscCircularBuffer< QPair<int, int> >        SpscCircularBuffer_pair_int_int;        /**< Defines SpscCircularBuffer of integer Pair type.*/
+typedef SpscCircularBuffer< Eigen::MatrixXd >        SpscCircularBuffer_Matrix_double;       /**< Defines SpscCircularBuffer of Eigen::MatrixXd type.*/
+typedef SpscCircularBuffer< Eigen::MatrixXf >        SpscCircularBuffer_Matrix_float;        /**< Defines SpscCircularBuffer of Eigen::MatrixXf type.*/
+
+} // NAMESPACE
+
+#endif // SPSCCIRCULARBUFFER_H
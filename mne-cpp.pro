@@ -65,3 +65,7 @@ applications.depends = libraries
 examples.depends = libraries
 testframes.depends = libraries
 
+!contains(MNECPP_CONFIG, noApplications) {
+    testframes.depends += applications
+}
+
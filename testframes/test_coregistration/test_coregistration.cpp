@@ -56,6 +56,7 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QTest>
 
@@ -93,6 +94,7 @@ private slots:
     void initTestCase();
     void compareFitMatchedPoints();
     void comparePerformIcp();
+    void benchmarkProjectToSurface();
     void cleanupTestCase();
 
 private:
@@ -102,6 +104,10 @@ private:
     FiffCoordTrans transPerformICP;
     FiffCoordTrans transFitMatchedRef;
     FiffCoordTrans transPerformICPRef;
+
+    MNEBemSurface::SPtr bemSurface;
+    MatrixXf matHsp;
+    VectorXf vecWeightsICP;
 };
 
 //=============================================================================================================
@@ -132,7 +138,7 @@ void TestCoregistration::initTestCase()
 
     // read Bem
     MNEBem bemHead(t_fileBem);
-    MNEBemSurface::SPtr bemSurface = MNEBemSurface::SPtr::create(bemHead[0]);
+    bemSurface = MNEBemSurface::SPtr::create(bemHead[0]);
     MNEProjectToSurface::SPtr mneSurfacePoints = MNEProjectToSurface::SPtr::create(*bemSurface);
 
     // read digitizer data
@@ -176,9 +182,9 @@ void TestCoregistration::initTestCase()
     transPerformICP = *new FiffCoordTrans(transFitMatched);
 
     // Prepare Icp:
-    VectorXf vecWeightsICP(digSetHsp.size()); // Weigths vector
+    vecWeightsICP.resize(digSetHsp.size()); // Weigths vector
     int iMaxIter = 20;
-    MatrixXf matHsp(digSetHsp.size(),3);
+    matHsp.resize(digSetHsp.size(),3);
 
     for(int i = 0; i < digSetHsp.size(); ++i) {
         matHsp(i,0) = digSetHsp[i].r[0]; matHsp(i,1) = digSetHsp[i].r[1]; matHsp(i,2) = digSetHsp[i].r[2];
@@ -226,6 +232,54 @@ void TestCoregistration::comparePerformIcp()
 
 //=============================================================================================================
 
+void TestCoregistration::benchmarkProjectToSurface()
+{
+    // run the coregistration loop (outlier rejection + icp) with and without the bounding volume hierarchy
+    float fTol = 0.01/1000;
+    float fMaxDist = 0.02;
+    int iMaxIter = 20;
+    bool bScale = true;
+    int iRepetitions = 10;
+
+    FiffCoordTrans transIcp[2];
+    qint64 iTime[2];
+
+    for(int iMode = 0; iMode < 2; ++iMode) {
+        QElapsedTimer timer;
+        timer.start();
+
+        MNEProjectToSurface::SPtr mneSurfacePoints = MNEProjectToSurface::SPtr::create(*bemSurface);
+        mneSurfacePoints->setUseBvh(iMode == 0);
+
+        for(int iRep = 0; iRep < iRepetitions; ++iRep) {
+            transIcp[iMode] = FiffCoordTrans(transFitMatched);
+
+            MatrixXf matHspClean;
+            VectorXi vecTake;
+            QVERIFY(RTPROCESSINGLIB::discard3DPointOutliers(mneSurfacePoints, matHsp, transIcp[iMode], vecTake, matHspClean, fMaxDist));
+
+            VectorXf vecWeightsICPClean(vecTake.size());
+            for(int i = 0; i < vecTake.size(); ++i) {
+                vecWeightsICPClean(i) = vecWeightsICP(vecTake(i));
+            }
+
+            float fRMSE = 0.0;
+            RTPROCESSINGLIB::performIcp(mneSurfacePoints, matHspClean, transIcp[iMode], fRMSE, bScale, iMaxIter, fTol, vecWeightsICPClean);
+        }
+
+        iTime[iMode] = timer.elapsed();
+    }
+
+    qInfo() << "Coregistration loop" << iRepetitions << "runs: bvh" << iTime[0] << "ms, all triangles" << iTime[1]
+            << "ms, speedup" << static_cast<double>(iTime[1]) / static_cast<double>(qMax(iTime[0], static_cast<qint64>(1)));
+
+    // the hierarchy finds the same closest triangles, so the results have to be identical
+    QVERIFY(transIcp[0] == transIcp[1]);
+    QVERIFY(transIcp[0] == transPerformICP);
+}
+
+//=============================================================================================================
+
 void TestCoregistration::cleanupTestCase()
 {
 }
@@ -39,6 +39,21 @@
 
 #include <inverse/dipoleFit/dipole_fit_settings.h>
 #include <inverse/dipoleFit/dipole_fit.h>
+#include <inverse/dipoleFit/dipole_fit_data.h>
+#include <inverse/dipoleFit/dipole_forward.h>
+
+#include <fwd/fwd_bem_model.h>
+#include <fwd/fwd_coil_set.h>
+#include <fwd/fwd_types.h>
+
+#include <mne/c/mne_surface_old.h>
+#include <mne/c/mne_triangle.h>
+
+#include <fiff/c/fiff_coord_trans_old.h>
+#include <fiff/fiff_constants.h>
+
+#include <random>
+#include <vector>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -46,11 +61,21 @@
 
 #include <QtTest>
 
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace INVERSELIB;
+using namespace FWDLIB;
+using namespace MNELIB;
+using namespace FIFFLIB;
+using namespace Eigen;
 
 //=============================================================================================================
 /**
@@ -70,11 +95,24 @@ private slots:
     void initTestCase();
     void dipoleFitSimple();
     void dipoleFitAdvanced();
+    void compareBatchedForward();
+    void compareThreadedEvoked();
+    void compareThreadedRaw();
     void cleanupTestCase();
 
 private:
     void compareFit();
 
+    void compareThreadedFit(const ECDSet& setThreaded,
+                            const ECDSet& setSingle);
+
+    ECDSet fitEvoked(int nthreads);
+
+    ECDSet fitRaw(int nthreads);
+
+    float relativeError(const VectorXf& vecTest,
+                        const VectorXf& vecRef) const;
+
     double epsilon;
 
     ECDSet m_ECDSet;
@@ -258,6 +296,176 @@ void TestDipoleFit::dipoleFitAdvanced()
 
 //=============================================================================================================
 
+void TestDipoleFit::compareBatchedForward()
+{
+    QFile testFile;
+
+    //*********************************************************************************************************
+    // Set up the BEM fitting data as in dipoleFitAdvanced
+    //*********************************************************************************************************
+
+    DipoleFitSettings settings;
+
+    testFile.setFileName(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif"); QVERIFY( testFile.exists() );
+    settings.measname = testFile.fileName();
+    settings.projnames.append(testFile.fileName());
+
+    testFile.setFileName(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/subjects/sample/bem/sample-5120-bem.fif"); QVERIFY( testFile.exists() );
+    settings.bemname = testFile.fileName();
+
+    testFile.setFileName(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/all-trans.fif"); QVERIFY( testFile.exists() );
+    settings.mriname = testFile.fileName();
+
+    testFile.setFileName(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif"); QVERIFY( testFile.exists() );
+    settings.noisename = testFile.fileName();
+
+    DipoleFitData* pFitData = DipoleFitData::setup_dipole_fit_data(settings.mriname,
+                                                                   settings.measname,
+                                                                   settings.bemname,
+                                                                   &settings.r0,
+                                                                   NULL,
+                                                                   settings.accurate,
+                                                                   settings.badname,
+                                                                   settings.noisename,
+                                                                   settings.grad_std,
+                                                                   settings.mag_std,
+                                                                   settings.eeg_std,
+                                                                   settings.mag_reg,
+                                                                   settings.grad_reg,
+                                                                   settings.eeg_reg,
+                                                                   settings.diagnoise,
+                                                                   settings.projnames,
+                                                                   true,
+                                                                   false);
+    QVERIFY( pFitData != NULL );
+    QVERIFY( pFitData->bem_model != NULL );
+    QVERIFY( pFitData->funcs->meg_batch_field != NULL );
+
+    FwdBemModel* pBemModel = pFitData->bem_model;
+    FwdCoilSet* pCoils = pFitData->meg_coils;
+
+    //*********************************************************************************************************
+    // More source locations than fit into one batch, inside the inner skull
+    //*********************************************************************************************************
+
+    const int iNumSources = FWD_BEM_BATCH_SOURCES + 6;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> uniform(-0.03f, 0.03f);
+
+    std::vector<float> vecLocations(3 * iNumSources);
+    std::vector<float*> vecRd(iNumSources);
+    for(int j = 0; j < iNumSources; ++j) {
+        vecRd[j] = vecLocations.data() + 3 * j;
+        vecRd[j][0] = uniform(generator);
+        vecRd[j][1] = uniform(generator);
+        vecRd[j][2] = settings.r0[2] + uniform(generator);
+    }
+
+    //*********************************************************************************************************
+    // Infinite-medium potentials against fwd_bem_inf_pot at each solution point
+    //*********************************************************************************************************
+
+    MatrixXf matV0;
+    FwdBemModel::fwd_bem_inf_pot_batch(vecRd.data(), iNumSources, pBemModel, matV0);
+
+    QCOMPARE( static_cast<int>(matV0.rows()), pBemModel->nsol );
+    QCOMPARE( static_cast<int>(matV0.cols()), 3 * iNumSources );
+
+    bool bConstant = (pBemModel->bem_method == FWD_BEM_CONSTANT_COLL);
+
+    for(int j = 0; j < iNumSources; ++j) {
+        for(int c = 0; c < 3; ++c) {
+            float rd[3] = { vecRd[j][0], vecRd[j][1], vecRd[j][2] };
+            float Q[3] = { 0.0f, 0.0f, 0.0f };
+            Q[c] = 1.0f;
+            if(pBemModel->head_mri_t) {
+                FiffCoordTransOld::fiff_coord_trans(rd, pBemModel->head_mri_t, FIFFV_MOVE);
+                FiffCoordTransOld::fiff_coord_trans(Q, pBemModel->head_mri_t, FIFFV_NO_MOVE);
+            }
+
+            VectorXf vecRef(pBemModel->nsol);
+            for(int s = 0, p = 0; s < pBemModel->nsurf; ++s) {
+                MneSurfaceOld* pSurf = pBemModel->surfs[s];
+                int np = bConstant ? pSurf->ntri : pSurf->np;
+                for(int k = 0; k < np; ++k, ++p) {
+                    float* rp = bConstant ? pSurf->tris[k].cent : pSurf->rr[k];
+                    vecRef[p] = pBemModel->source_mult[s] * FwdBemModel::fwd_bem_inf_pot(rd, Q, rp);
+                }
+            }
+
+            QVERIFY( relativeError(matV0.col(3 * j + c), vecRef) < 1e-4f );
+        }
+    }
+
+    //*********************************************************************************************************
+    // Batched magnetic fields against fwd_bem_field for each source and orientation
+    //*********************************************************************************************************
+
+    // Each column holds one row of the 3*nsource x ncoil result
+    MatrixXf matB(pCoils->ncoil, 3 * iNumSources);
+    std::vector<float*> vecB(3 * iNumSources);
+    for(int k = 0; k < 3 * iNumSources; ++k) {
+        vecB[k] = matB.col(k).data();
+    }
+
+    QCOMPARE( FwdBemModel::fwd_bem_field_batch(vecRd.data(), iNumSources, pCoils, vecB.data(), pBemModel), 0 );
+
+    for(int j = 0; j < iNumSources; ++j) {
+        for(int c = 0; c < 3; ++c) {
+            float Q[3] = { 0.0f, 0.0f, 0.0f };
+            Q[c] = 1.0f;
+
+            VectorXf vecRef(pCoils->ncoil);
+            QCOMPARE( FwdBemModel::fwd_bem_field(vecRd[j], Q, pCoils, vecRef.data(), pBemModel), 0 );
+
+            QVERIFY( relativeError(matB.col(3 * j + c), vecRef) < 1e-4f );
+        }
+    }
+
+    //*********************************************************************************************************
+    // Batched single-dipole forward solutions against the per-dipole path
+    //*********************************************************************************************************
+
+    std::vector<DipoleForward*> vecFwdMany(iNumSources, NULL);
+    QCOMPARE( DipoleFitData::dipole_forward_many(pFitData, vecRd.data(), iNumSources, vecFwdMany.data()), 0 );
+
+    // Without the batched field function the locations are computed one by one
+    fwdBatchFieldFunc batchField = pFitData->funcs->meg_batch_field;
+    pFitData->funcs->meg_batch_field = NULL;
+
+    for(int j = 0; j < iNumSources; ++j) {
+        DipoleForward* pFwdOne = DipoleFitData::dipole_forward_one(pFitData, vecRd[j], NULL);
+        QVERIFY( pFwdOne != NULL );
+        QCOMPARE( vecFwdMany[j]->nch, pFwdOne->nch );
+
+        for(int p = 0; p < 3; ++p) {
+            QVERIFY( relativeError(Map<VectorXf>(vecFwdMany[j]->fwd[p], pFwdOne->nch), Map<VectorXf>(pFwdOne->fwd[p], pFwdOne->nch)) < 1e-4f );
+        }
+        QVERIFY( relativeError(Map<VectorXf>(vecFwdMany[j]->scales, 3), Map<VectorXf>(pFwdOne->scales, 3)) < 1e-4f );
+        QVERIFY( relativeError(Map<VectorXf>(vecFwdMany[j]->sing, 3), Map<VectorXf>(pFwdOne->sing, 3)) < 1e-4f );
+
+        delete pFwdOne;
+    }
+
+    pFitData->funcs->meg_batch_field = batchField;
+
+    for(int j = 0; j < iNumSources; ++j) {
+        delete vecFwdMany[j];
+    }
+    delete pFitData;
+}
+
+//=============================================================================================================
+
+float TestDipoleFit::relativeError(const VectorXf& vecTest,
+                                   const VectorXf& vecRef) const
+{
+    return (vecTest - vecRef).cwiseAbs().maxCoeff() / vecRef.cwiseAbs().maxCoeff();
+}
+
+//=============================================================================================================
+
 void TestDipoleFit::compareFit()
 {
     //*********************************************************************************************************
@@ -294,6 +502,107 @@ void TestDipoleFit::compareFit()
 
 //=============================================================================================================
 
+ECDSet TestDipoleFit::fitEvoked(int nthreads)
+{
+    //The fit clamps the time range in the settings, so every fit gets its own
+    DipoleFitSettings settings;
+    settings.measname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif";
+    settings.is_raw = false;
+    settings.setno = 1;
+    settings.include_meg = true;
+    settings.include_eeg = true;
+    settings.tmin = 32.0f/1000.0f;
+    settings.tmax = 148.0f/1000.0f;
+    settings.bmin = -100.0f/1000.0f;
+    settings.bmax = 0.0f/1000.0f;
+    settings.dipname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/Result/dip_fit_threads.dat";
+    settings.nthreads = nthreads;
+
+    settings.checkIntegrity();
+
+    DipoleFit dipFit(&settings);
+    return dipFit.calculateFit();
+}
+
+//=============================================================================================================
+
+ECDSet TestDipoleFit::fitRaw(int nthreads)
+{
+    //The whole file is fitted, the next data segment is read while the current one is fitted
+    DipoleFitSettings settings;
+    settings.measname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif";
+    settings.is_raw = true;
+    settings.include_meg = true;
+    settings.include_eeg = false;
+    settings.tstep = 50.0f/1000.0f;
+    settings.dipname = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/Result/dip_fit_threads.dat";
+    settings.nthreads = nthreads;
+
+    settings.checkIntegrity();
+
+    DipoleFit dipFit(&settings);
+    return dipFit.calculateFit();
+}
+
+//=============================================================================================================
+
+void TestDipoleFit::compareThreadedFit(const ECDSet& setThreaded,
+                                       const ECDSet& setSingle)
+{
+    //The time points are fitted in fixed blocks, so the results must not depend on the number of threads
+    QVERIFY( setSingle.size() > 0 );
+    QCOMPARE( setThreaded.size(), setSingle.size() );
+
+    for (int i = 0; i < setSingle.size(); ++i)
+    {
+        if (i > 0)
+            QVERIFY( setThreaded[i].time > setThreaded[i-1].time );
+
+        QVERIFY( setThreaded[i].valid == setSingle[i].valid );
+        QVERIFY( setThreaded[i].time == setSingle[i].time );
+        QVERIFY( setThreaded[i].rd == setSingle[i].rd );
+        QVERIFY( setThreaded[i].Q == setSingle[i].Q );
+        QVERIFY( setThreaded[i].good == setSingle[i].good );
+        QVERIFY( setThreaded[i].khi2 == setSingle[i].khi2 );
+        QVERIFY( setThreaded[i].nfree == setSingle[i].nfree );
+        QVERIFY( setThreaded[i].neval == setSingle[i].neval );
+    }
+}
+
+//=============================================================================================================
+
+void TestDipoleFit::compareThreadedEvoked()
+{
+    QVERIFY( QFile::exists(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif") );
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare Threaded Evoked Fit >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    ECDSet setSingle = fitEvoked(1);
+    ECDSet setThreaded = fitEvoked(4);
+
+    compareThreadedFit(setThreaded, setSingle);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare Threaded Evoked Fit Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+//=============================================================================================================
+
+void TestDipoleFit::compareThreadedRaw()
+{
+    QVERIFY( QFile::exists(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif") );
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare Threaded Raw Fit >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    ECDSet setSingle = fitRaw(1);
+    ECDSet setThreaded = fitRaw(4);
+
+    compareThreadedFit(setThreaded, setSingle);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare Threaded Raw Fit Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+//=============================================================================================================
+
 void TestDipoleFit::cleanupTestCase()
 {
 }
@@ -76,6 +76,8 @@ private slots:
     void compareData();
     void compareTimes();
     void compareInfo();
+    void compareSegmentReader();
+    void compareMappedRead();
     void cleanupTestCase();
 
 private:
@@ -308,6 +310,70 @@ void TestFiffRWR::compareInfo()
 
 //=============================================================================================================
 
+void TestFiffRWR::compareSegmentReader()
+{
+    FiffRawSegmentReader reader(rawFirstInRaw);
+
+    QStringList include;
+    include << "STI 014";
+    RowVectorXi vPicks = rawFirstInRaw.info.pick_types(true, false, false, include, rawFirstInRaw.info.bads);
+
+    MatrixXd mDataLegacy, mTimesLegacy, mDataIndexed, mTimesIndexed;
+
+    // Segments at the start, across buffer borders, starting at the last sample of a buffer and at the end
+    QList<QPair<fiff_int_t,fiff_int_t> > lSegments;
+    lSegments << qMakePair(rawFirstInRaw.first_samp, rawFirstInRaw.first_samp + 99)
+              << qMakePair(rawFirstInRaw.first_samp + 150, rawFirstInRaw.first_samp + 2345)
+              << qMakePair(rawFirstInRaw.rawdir.first().last, rawFirstInRaw.rawdir.first().last + 10)
+              << qMakePair(rawFirstInRaw.last_samp - 500, rawFirstInRaw.last_samp);
+
+    for(int i = 0; i < lSegments.size(); ++i) {
+        QVERIFY(rawFirstInRaw.read_raw_segment(mDataLegacy, mTimesLegacy, lSegments[i].first, lSegments[i].second));
+        QVERIFY(reader.read_raw_segment(mDataIndexed, mTimesIndexed, lSegments[i].first, lSegments[i].second));
+        QVERIFY(mDataLegacy.rows() == mDataIndexed.rows() && mDataLegacy.cols() == mDataIndexed.cols());
+        QVERIFY((mDataLegacy - mDataIndexed).cwiseAbs().maxCoeff() < dEpsilon);
+        QVERIFY((mTimesLegacy - mTimesIndexed).cwiseAbs().maxCoeff() < dEpsilon);
+
+        QVERIFY(rawFirstInRaw.read_raw_segment(mDataLegacy, mTimesLegacy, lSegments[i].first, lSegments[i].second, vPicks));
+        QVERIFY(reader.read_raw_segment(mDataIndexed, mTimesIndexed, lSegments[i].first, lSegments[i].second, vPicks));
+        QVERIFY(mDataLegacy.rows() == mDataIndexed.rows() && mDataLegacy.cols() == mDataIndexed.cols());
+        QVERIFY((mDataLegacy - mDataIndexed).cwiseAbs().maxCoeff() < dEpsilon);
+    }
+
+    QVERIFY(reader.findBuffer(rawFirstInRaw.first_samp) == 0);
+    QVERIFY(reader.findBuffer(rawFirstInRaw.last_samp) == rawFirstInRaw.rawdir.size() - 1);
+    QVERIFY(reader.findBuffer(rawFirstInRaw.last_samp + 1) == -1);
+}
+
+//=============================================================================================================
+
+void TestFiffRWR::compareMappedRead()
+{
+    QFile t_fileIn(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif");
+    FiffRawData raw(t_fileIn);
+
+    MatrixXd mDataStream, mDataMapped, mTimes;
+    fiff_int_t from = raw.first_samp + 123;
+    fiff_int_t to = raw.first_samp + 1234;
+
+    QVERIFY(raw.read_raw_segment(mDataStream, mTimes, from, to));
+
+    QVERIFY(raw.file->map());
+    QVERIFY(raw.file->isMapped());
+
+    QVERIFY(raw.read_raw_segment(mDataMapped, mTimes, from, to));
+    QVERIFY((mDataStream - mDataMapped).cwiseAbs().maxCoeff() < dEpsilon);
+
+    FiffRawSegmentReader reader(raw);
+    QVERIFY(reader.read_raw_segment(mDataMapped, mTimes, from, to));
+    QVERIFY((mDataStream - mDataMapped).cwiseAbs().maxCoeff() < dEpsilon);
+
+    raw.file->unmap();
+    QVERIFY(!raw.file->isMapped());
+}
+
+//=============================================================================================================
+
 void TestFiffRWR::cleanupTestCase()
 {
 }
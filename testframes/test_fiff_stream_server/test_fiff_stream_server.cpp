@@ -0,0 +1,356 @@
+//=============================================================================================================
+/**
+ * @file     test_fiff_stream_server.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test the broadcast of raw buffers from the mne_rt_server FiffStreamServer to its clients
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiffstreamserver.h>
+#include <fiffstreamthread.h>
+#include <mne_rt_commands.h>
+
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_file.h>
+#include <fiff/fiff_constants.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+using namespace RTSERVER;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestFiffStreamServer
+ *
+ * @brief The TestFiffStreamServer class connects plain sockets to a FiffStreamServer, which stands in for the
+ *        one of mne_rt_server, and checks what the clients receive.
+ */
+class TestFiffStreamServer: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFiffStreamServer();
+
+private slots:
+    void initTestCase();
+    void broadcastToTwoClients();
+    void dropForSlowClient();
+    void cleanupTestCase();
+
+private:
+    bool connectClient(QTcpSocket& socket,
+                       qint32& iClientId);
+
+    bool readTag(QTcpSocket& socket,
+                 QByteArray& tag,
+                 int iTimeoutMs = 10000);
+
+    static qint32 tagKind(const QByteArray& tag);
+
+    static qint32 tagInt(const QByteArray& tag);
+
+    QSharedPointer<MatrixXf> rawBuffer(int iNumChannels,
+                                       int iNumSamples,
+                                       float fValue) const;
+
+    static QByteArray serialize(const MatrixXf& matData);
+
+    FiffStreamServer* m_pServer;
+    quint16 m_iPort;
+
+    QList<QTcpSocket*> m_lOpenSockets;
+};
+
+//=============================================================================================================
+
+TestFiffStreamServer::TestFiffStreamServer()
+: m_pServer(Q_NULLPTR)
+, m_iPort(0)
+{
+}
+
+//=============================================================================================================
+
+void TestFiffStreamServer::initTestCase()
+{
+    m_pServer = new FiffStreamServer();
+    QVERIFY(m_pServer->listen(QHostAddress::LocalHost, 0));
+    m_iPort = m_pServer->serverPort();
+}
+
+//=============================================================================================================
+
+bool TestFiffStreamServer::readTag(QTcpSocket& socket,
+                                   QByteArray& tag,
+                                   int iTimeoutMs)
+{
+    const qint64 iHeaderSize = 4 * sizeof(qint32);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while(timer.elapsed() < iTimeoutMs) {
+        if(socket.bytesAvailable() >= iHeaderSize) {
+            QByteArray header = socket.peek(iHeaderSize);
+            qint32 iTagSize = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(header.constData()) + 2 * sizeof(qint32));
+
+            if(socket.bytesAvailable() >= iHeaderSize + iTagSize) {
+                tag = socket.read(iHeaderSize + iTagSize);
+                return true;
+            }
+        }
+
+        // The server accepts connections and broadcasts from the event loop of this thread
+        QCoreApplication::processEvents();
+        socket.waitForReadyRead(10);
+    }
+
+    return false;
+}
+
+//=============================================================================================================
+
+qint32 TestFiffStreamServer::tagKind(const QByteArray& tag)
+{
+    return qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(tag.constData()));
+}
+
+//=============================================================================================================
+
+qint32 TestFiffStreamServer::tagInt(const QByteArray& tag)
+{
+    return qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(tag.constData()) + 4 * sizeof(qint32));
+}
+
+//=============================================================================================================
+
+bool TestFiffStreamServer::connectClient(QTcpSocket& socket,
+                                         qint32& iClientId)
+{
+    socket.connectToHost(QHostAddress::LocalHost, m_iPort);
+    if(!socket.waitForConnected(10000)) {
+        return false;
+    }
+
+    // The reply shows that the client thread serves the socket from its event loop
+    FiffStream t_FiffStreamOut(&socket);
+    t_FiffStreamOut.write_rt_command(MNE_RT_GET_CLIENT_ID, QString());
+    socket.flush();
+
+    QByteArray tag;
+    if(!readTag(socket, tag) || tagKind(tag) != FIFF_MNE_RT_CLIENT_ID) {
+        return false;
+    }
+
+    iClientId = tagInt(tag);
+    return true;
+}
+
+//=============================================================================================================
+
+QSharedPointer<MatrixXf> TestFiffStreamServer::rawBuffer(int iNumChannels,
+                                                         int iNumSamples,
+                                                         float fValue) const
+{
+    QSharedPointer<MatrixXf> pMatData(new MatrixXf(iNumChannels, iNumSamples));
+    pMatData->setConstant(fValue);
+    (*pMatData)(0, 0) = 0.0f;
+    return pMatData;
+}
+
+//=============================================================================================================
+
+QByteArray TestFiffStreamServer::serialize(const MatrixXf& matData)
+{
+    QByteArray block;
+    FiffStream t_FiffStreamOut(&block, QIODevice::WriteOnly);
+    t_FiffStreamOut.write_float(FIFF_DATA_BUFFER, matData.data(), matData.rows() * matData.cols());
+    return block;
+}
+
+//=============================================================================================================
+
+void TestFiffStreamServer::broadcastToTwoClients()
+{
+    const int iNumBuffers = 20;
+
+    QTcpSocket* pClient1 = new QTcpSocket(this);
+    QTcpSocket* pClient2 = new QTcpSocket(this);
+    m_lOpenSockets << pClient1 << pClient2;
+
+    qint32 iId1 = -1, iId2 = -1;
+    QVERIFY(connectClient(*pClient1, iId1));
+    QVERIFY(connectClient(*pClient2, iId2));
+    QVERIFY(iId1 != iId2);
+
+    emit m_pServer->startMeasFiffStreamClient(iId1);
+    emit m_pServer->startMeasFiffStreamClient(iId2);
+
+    QList<QByteArray> lSent;
+    for(int i = 0; i < iNumBuffers; ++i) {
+        QSharedPointer<MatrixXf> pMatData = rawBuffer(32, 100, static_cast<float>(i + 1));
+        lSent.append(serialize(*pMatData));
+        m_pServer->forwardRawBuffer(pMatData);
+    }
+
+    emit m_pServer->stopMeasFiffStreamClient(iId1);
+    emit m_pServer->stopMeasFiffStreamClient(iId2);
+
+    QList<QTcpSocket*> lClients;
+    lClients << pClient1 << pClient2;
+
+    for(QTcpSocket* pClient : lClients) {
+        QByteArray tag;
+
+        QVERIFY(readTag(*pClient, tag));
+        QCOMPARE(tagKind(tag), FIFF_BLOCK_START);
+        QCOMPARE(tagInt(tag), FIFFB_RAW_DATA);
+
+        // Every client receives every raw buffer, byte for byte as serialized once by the server
+        for(int i = 0; i < iNumBuffers; ++i) {
+            QVERIFY(readTag(*pClient, tag));
+            QCOMPARE(tagKind(tag), FIFF_DATA_BUFFER);
+            QVERIFY(tag == lSent.at(i));
+        }
+
+        QVERIFY(readTag(*pClient, tag));
+        QCOMPARE(tagKind(tag), FIFF_BLOCK_END);
+        QCOMPARE(tagInt(tag), FIFFB_RAW_DATA);
+    }
+}
+
+//=============================================================================================================
+
+void TestFiffStreamServer::dropForSlowClient()
+{
+    // More than the send queue, the socket buffer and the kernel buffers can take together
+    const int iNumBuffers = 80;
+    const int iNumChannels = 300;
+    const int iNumSamples = 1000;
+
+    QTcpSocket* pClient = new QTcpSocket(this);
+    m_lOpenSockets << pClient;
+
+    qint32 iId = -1;
+    QVERIFY(connectClient(*pClient, iId));
+
+    // The client stops reading once its small read buffer is full
+    pClient->setReadBufferSize(64 * 1024);
+
+    emit m_pServer->startMeasFiffStreamClient(iId);
+
+    QList<QByteArray> lSent;
+    for(int i = 0; i < iNumBuffers; ++i) {
+        QSharedPointer<MatrixXf> pMatData = rawBuffer(iNumChannels, iNumSamples, static_cast<float>(i + 1));
+        lSent.append(serialize(*pMatData));
+        m_pServer->forwardRawBuffer(pMatData);
+        QCoreApplication::processEvents();
+    }
+
+    emit m_pServer->stopMeasFiffStreamClient(iId);
+
+    // Read everything that was kept
+    pClient->setReadBufferSize(0);
+
+    QByteArray tag;
+    QVERIFY(readTag(*pClient, tag));
+    QCOMPARE(tagKind(tag), FIFF_BLOCK_START);
+    QCOMPARE(tagInt(tag), FIFFB_RAW_DATA);
+
+    int iNumReceived = 0;
+    int iLast = -1;
+
+    while(true) {
+        QVERIFY(readTag(*pClient, tag));
+
+        if(tagKind(tag) != FIFF_DATA_BUFFER) {
+            break;
+        }
+
+        // The buffers which were kept arrive intact and in order
+        int iIdx = iLast + 1;
+        while(iIdx < iNumBuffers && tag != lSent.at(iIdx)) {
+            ++iIdx;
+        }
+        QVERIFY(iIdx < iNumBuffers);
+
+        iLast = iIdx;
+        ++iNumReceived;
+    }
+
+    // The end marker is never dropped
+    QCOMPARE(tagKind(tag), FIFF_BLOCK_END);
+    QCOMPARE(tagInt(tag), FIFFB_RAW_DATA);
+
+    QVERIFY(iNumReceived > 0);
+    QVERIFY(iNumReceived < iNumBuffers);
+}
+
+//=============================================================================================================
+
+void TestFiffStreamServer::cleanupTestCase()
+{
+    // The clients are still connected, so the client threads have to be stopped from within their event loops
+    delete m_pServer;
+    m_pServer = Q_NULLPTR;
+
+    qDeleteAll(m_lOpenSockets);
+    m_lOpenSockets.clear();
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestFiffStreamServer)
+#include "test_fiff_stream_server.moc"
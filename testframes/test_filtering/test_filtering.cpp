@@ -45,6 +45,7 @@
 #include <fiff/fiff.h>
 #include <rtprocessing/helpers/filterkernel.h>
 #include <rtprocessing/filter.h>
+#include <rtprocessing/helpers/spatialoperatorcompositor.h>
 
 #include <Eigen/Dense>
 
@@ -84,10 +85,14 @@ private slots:
     void initTestCase();
     void compareData();
     void compareTimes();
+    void compareMultiChannelFilter();
+    void compareFilterFileShortLastBlock();
+    void compareSpatialOperatorCompositor();
     void cleanupTestCase();
 
 private:
     double dEpsilon;
+    double dSFreq;
     int iOrder;
 
     MatrixXd mFirstInData;
@@ -98,6 +103,7 @@ private:
     MatrixXd mRefInTimes;
     MatrixXd mRefFiltered;
 
+    RowVectorXi vPicks;
 };
 
 //=============================================================================================================
@@ -138,7 +144,7 @@ void TestFiltering::initTestCase()
     rawFirstInRaw = FiffRawData(t_fileIn);
 
     // Only filter MEG channels
-    RowVectorXi vPicks = rawFirstInRaw.info.pick_types(true, true, false);
+    vPicks = rawFirstInRaw.info.pick_types(true, true, false);
     RowVectorXd vCals;
     FiffStream::SPtr outfid = FiffStream::start_writing_raw(t_fileOut, rawFirstInRaw.info, vCals);
 
@@ -151,7 +157,7 @@ void TestFiltering::initTestCase()
     // initialize filter settings
     QString sFilterName = "example_cosine";
     FilterKernel::FilterType type = FilterKernel::BPF;
-    double dSFreq = rawFirstInRaw.info.sfreq;
+    dSFreq = rawFirstInRaw.info.sfreq;
     double dCenterfreq = 10;
     double dBandwidth = 10;
     double dTransition = 1;
@@ -231,6 +237,187 @@ void TestFiltering::compareTimes()
     QVERIFY( mTimesDiff.sum() < dEpsilon );
 }
 
+//=============================================================================================================
+
+void TestFiltering::compareMultiChannelFilter()
+{
+    FilterKernel filterKernel("example_cosine",
+                              FilterKernel::BPF,
+                              iOrder,
+                              10.0/(dSFreq/2.0),
+                              10.0/(dSFreq/2.0),
+                              1.0/(dSFreq/2.0),
+                              dSFreq,
+                              FilterKernel::Cosine);
+
+    int iBlockSize = 4 * iOrder;
+    MatrixXd matBlock = mFirstInData.leftCols(iBlockSize);
+
+    // Compare the block filtering against the single channel FFT filtering
+    MultiChannelFilter multiChannelFilter(filterKernel);
+    MatrixXd matFiltered;
+    multiChannelFilter.filterBlock(matBlock, vPicks, matFiltered, true);
+
+    QVERIFY( matFiltered.rows() == matBlock.rows() );
+    QVERIFY( matFiltered.cols() == matBlock.cols() + iOrder );
+
+    FilterKernel filterKernelChannel = filterKernel;
+    double dMaxDiff = 0.0;
+    for(int i = 0; i < vPicks.cols(); ++i) {
+        RowVectorXd vecData = matBlock.row(vPicks[i]);
+        filterKernelChannel.applyFftFilter(vecData, true);
+        dMaxDiff = qMax(dMaxDiff, (matFiltered.row(vPicks[i]) - vecData).cwiseAbs().maxCoeff());
+    }
+    QVERIFY( dMaxDiff < dEpsilon );
+
+    // Continuous filtering over several blocks via FilterOverlapAdd has to match filtering everything at once
+    MatrixXd matData = mFirstInData.leftCols(4 * iBlockSize);
+    MatrixXd matFilteredAll;
+    multiChannelFilter.filterBlock(matData, vPicks, matFilteredAll, false);
+
+    FilterOverlapAdd filterOverlapAdd;
+    MatrixXd matFilteredBlock;
+    for(int i = 0; i < 4; ++i) {
+        matFilteredBlock = filterOverlapAdd.calculate(matData.middleCols(i * iBlockSize, iBlockSize), filterKernel, vPicks);
+        MatrixXd matDiff = matFilteredBlock - matFilteredAll.middleCols(i * iBlockSize, iBlockSize);
+        QVERIFY( matDiff.cwiseAbs().maxCoeff() < dEpsilon );
+    }
+}
+
+//=============================================================================================================
+
+void TestFiltering::compareFilterFileShortLastBlock()
+{
+    QFile t_fileIn(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif");
+    QFile t_fileOut(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/rtfilter_filterfile_out_raw.fif");
+
+    QSharedPointer<FiffRawData> pFiffRawData = QSharedPointer<FiffRawData>::create(t_fileIn);
+    fiff_int_t from = pFiffRawData->first_samp;
+    fiff_int_t to = pFiffRawData->last_samp;
+
+    FilterKernel filterKernel("example_cosine",
+                              FilterKernel::BPF,
+                              iOrder,
+                              10.0/(dSFreq/2.0),
+                              10.0/(dSFreq/2.0),
+                              1.0/(dSFreq/2.0),
+                              dSFreq,
+                              FilterKernel::Cosine);
+
+    // Pick a block size which leaves a last block shorter than the filter order
+    int iNumSamples = to - from + 1;
+    int iBlockSize = iOrder;
+    while(iNumSamples % iBlockSize < 2 || iNumSamples % iBlockSize >= iOrder) {
+        iBlockSize++;
+    }
+
+    QVERIFY( RTPROCESSINGLIB::filterFile(t_fileOut, pFiffRawData, filterKernel, vPicks, true, iBlockSize) );
+
+    FiffRawData rawOut(t_fileOut);
+    MatrixXd matFileFiltered, matTimes;
+    QVERIFY( rawOut.read_raw_segment(matFileFiltered, matTimes, from, to, vPicks) );
+
+    // The file is written in single precision, so compare relative to the signal amplitude
+    MatrixXd matFiltered = RTPROCESSINGLIB::filterData(mFirstInData, filterKernel, vPicks);
+    double dMaxDiff = 0.0;
+    double dMaxAbs = 0.0;
+    for(int i = 0; i < vPicks.cols(); ++i) {
+        dMaxDiff = qMax(dMaxDiff, (matFileFiltered.row(i) - matFiltered.row(vPicks[i])).cwiseAbs().maxCoeff());
+        dMaxAbs = qMax(dMaxAbs, matFiltered.row(vPicks[i]).cwiseAbs().maxCoeff());
+    }
+    QVERIFY( dMaxDiff < 0.0001 * dMaxAbs );
+}
+
+//=============================================================================================================
+
+void TestFiltering::compareSpatialOperatorCompositor()
+{
+    int iNumChannels = mFirstInData.rows();
+    MatrixXd matData = mFirstInData.leftCols(4 * iOrder);
+
+    // Compensator and projector are sparse, SPHARA mixes neighbouring channels
+    SparseMatrix<double> matComp(iNumChannels, iNumChannels);
+    SparseMatrix<double> matProj(iNumChannels, iNumChannels);
+    SparseMatrix<double> matSphara(iNumChannels, iNumChannels);
+    for(int i = 0; i < iNumChannels; ++i) {
+        matComp.insert(i, i) = 1.0;
+        matProj.insert(i, i) = 0.9;
+        matProj.insert(i, (i + 3) % iNumChannels) = 0.1;
+        matSphara.insert(i, i) = 0.5;
+        matSphara.insert(i, (i + 1) % iNumChannels) = 0.5;
+    }
+    matComp.insert(0, 1) = -0.2;
+
+    QStringList lChNames;
+    for(int i = 0; i < iNumChannels; ++i) {
+        lChNames << QString::number(i);
+    }
+    QStringList lBads = QStringList() << "2" << "5";
+
+    // Without filtering everything is folded into one operator and has to match the sequential chain
+    SpatialOperatorCompositor compositor(iNumChannels);
+    compositor.setCompensator(matComp, true);
+    compositor.setProjector(matProj, true);
+    compositor.setSphara(matSphara, true);
+    compositor.setBadChannels(lBads, lChNames, true);
+
+    MatrixXd matRef = matProj * (matComp * matData);
+    matRef.row(2).setZero();
+    matRef.row(5).setZero();
+    matRef = matSphara * matRef;
+
+    MatrixXd matFused = matData;
+    compositor.applyBeforeFilter(matFused);
+    compositor.applyAfterFilter(matFused);
+
+    QVERIFY( !compositor.hasOperatorAfterFilter() );
+    QVERIFY( (matFused - matRef).cwiseAbs().maxCoeff() < dEpsilon * matRef.cwiseAbs().maxCoeff() );
+
+    // SPHARA mixes filtered and unfiltered channels and has to stay behind the filter
+    compositor.setTemporalFilter(vPicks, true);
+    QVERIFY( compositor.hasOperatorAfterFilter() );
+
+    // Nothing is rebuilt if the parts did not change
+    int iNumRebuilds = compositor.getNumRebuilds();
+    compositor.setBadChannels(lBads, lChNames, true);
+    compositor.setTemporalFilter(vPicks, true);
+    QVERIFY( compositor.hasOperatorAfterFilter() );
+    QVERIFY( compositor.getNumRebuilds() == iNumRebuilds );
+
+    // An operator which only mixes filtered channels commutes with the filter
+    SparseMatrix<double> matPicked(iNumChannels, iNumChannels);
+    matPicked.setIdentity();
+    for(int i = 1; i < vPicks.cols(); ++i) {
+        matPicked.coeffRef(vPicks[i], vPicks[i-1]) = 0.5;
+    }
+
+    compositor.setNumChannels(iNumChannels);
+    compositor.setSphara(matPicked, true);
+    compositor.setTemporalFilter(vPicks, true);
+    QVERIFY( !compositor.hasOperatorAfterFilter() );
+
+    FilterKernel filterKernel("example_cosine",
+                              FilterKernel::BPF,
+                              iOrder,
+                              10.0/(dSFreq/2.0),
+                              10.0/(dSFreq/2.0),
+                              1.0/(dSFreq/2.0),
+                              dSFreq,
+                              FilterKernel::Cosine);
+    MultiChannelFilter multiChannelFilter(filterKernel);
+
+    MatrixXd matFilteredFirst;
+    multiChannelFilter.filterBlock(matData, vPicks, matFilteredFirst, false);
+    matFilteredFirst = matPicked * matFilteredFirst;
+
+    MatrixXd matFolded = matData;
+    compositor.applyBeforeFilter(matFolded);
+    MatrixXd matFilteredFolded;
+    multiChannelFilter.filterBlock(matFolded, vPicks, matFilteredFolded, false);
+
+    QVERIFY( (matFilteredFolded - matFilteredFirst).cwiseAbs().maxCoeff() < dEpsilon * matFilteredFirst.cwiseAbs().maxCoeff() );
+}
+
 void TestFiltering::cleanupTestCase()
 {
 }
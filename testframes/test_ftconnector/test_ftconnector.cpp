@@ -0,0 +1,568 @@
+//=============================================================================================================
+/**
+ * @file     test_ftconnector.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    The FieldTrip buffer connector test implementation
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <ftconnector.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <time.h>
+#endif
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FTBUFFERPLUGIN;
+
+//=============================================================================================================
+/**
+ * Stand-in for a FieldTrip buffer. Answers GET_HDR, WAIT_DAT and GET_DAT requests of one client at a time.
+ * The value of channel c at sample s is c * 100 + s % 100, which every supported data type holds exactly.
+ */
+class FtBufferStandIn : public QThread
+{
+public:
+    FtBufferStandIn(qint32 iDataType,
+                    qint32 iNumChannels,
+                    float fSampleFreq)
+    : m_iDataType(iDataType)
+    , m_iNumChannels(iNumChannels)
+    , m_fSampleFreq(fSampleFreq)
+    , m_iPort(0)
+    , m_iNumSamples(0)
+    , m_iStallMs(0)
+    , m_bStreaming(false)
+    , m_bStop(false)
+    {
+    }
+
+    //=========================================================================================================
+    /**
+     * Starts listening and returns the port.
+     */
+    quint16 listen()
+    {
+        start();
+        m_semListening.acquire();
+        return m_iPort;
+    }
+
+    //=========================================================================================================
+    /**
+     * Sets the number of samples in the buffer.
+     */
+    void setNumSamples(int iNumSamples)
+    {
+        m_iNumSamples.storeRelease(iNumSamples);
+    }
+
+    //=========================================================================================================
+    /**
+     * From now on, the buffer fills up in real time with the sampling frequency.
+     */
+    void startStreaming()
+    {
+        m_timerStreaming.start();
+        m_bStreaming.storeRelease(true);
+    }
+
+    //=========================================================================================================
+    /**
+     * The response to the next GET_DAT request is sent only after the given time.
+     */
+    void stallNextData(int iMs)
+    {
+        m_iStallMs.storeRelease(iMs);
+    }
+
+    //=========================================================================================================
+    /**
+     * Stops the server thread.
+     */
+    void stop()
+    {
+        m_bStop.storeRelease(true);
+        wait();
+    }
+
+    //=========================================================================================================
+    /**
+     * The value the buffer holds for a channel and a sample.
+     */
+    static double value(int iChannel,
+                        int iSample)
+    {
+        return iChannel * 100 + iSample % 100;
+    }
+
+protected:
+    void run() override
+    {
+        QTcpServer server;
+        server.listen(QHostAddress::LocalHost, 0);
+        m_iPort = server.serverPort();
+        m_semListening.release();
+
+        while(!m_bStop.loadAcquire()) {
+            if(!server.waitForNewConnection(50)) {
+                continue;
+            }
+
+            QScopedPointer<QTcpSocket> pSocket(server.nextPendingConnection());
+            while(handleRequest(*pSocket)) {
+            }
+        }
+    }
+
+private:
+    int numSamples() const
+    {
+        if(m_bStreaming.loadAcquire()) {
+            return static_cast<int>(m_timerStreaming.elapsed() * m_fSampleFreq / 1000.0f);
+        }
+        return m_iNumSamples.loadAcquire();
+    }
+
+    bool read(QTcpSocket& socket,
+              char* pData,
+              qint64 iNumBytes)
+    {
+        qint64 iRead = 0;
+        while(iRead < iNumBytes) {
+            if(m_bStop.loadAcquire() || socket.state() != QAbstractSocket::ConnectedState) {
+                return false;
+            }
+            if(socket.bytesAvailable() == 0) {
+                socket.waitForReadyRead(50);
+                continue;
+            }
+            iRead += socket.read(pData + iRead, iNumBytes - iRead);
+        }
+        return true;
+    }
+
+    void respond(QTcpSocket& socket,
+                 qint16 command,
+                 const QByteArray& payload)
+    {
+        messagedef_t messagedef;
+        messagedef.version = VERSION;
+        messagedef.command = command;
+        messagedef.bufsize = payload.size();
+
+        socket.write(reinterpret_cast<const char*>(&messagedef), sizeof(messagedef_t));
+        socket.write(payload);
+        while(socket.bytesToWrite() > 0 && socket.waitForBytesWritten(1000)) {
+        }
+    }
+
+    template<typename T>
+    void appendSamples(QByteArray& payload,
+                       int iBegin,
+                       int iEnd) const
+    {
+        int iOffset = payload.size();
+        payload.resize(iOffset + (iEnd - iBegin + 1) * m_iNumChannels * static_cast<int>(sizeof(T)));
+        char* pData = payload.data() + iOffset;
+
+        // Sample by sample, each with all channels
+        for(int s = iBegin; s <= iEnd; ++s) {
+            for(int c = 0; c < m_iNumChannels; ++c) {
+                T v = static_cast<T>(value(c, s));
+                std::memcpy(pData, &v, sizeof(T));
+                pData += sizeof(T);
+            }
+        }
+    }
+
+    bool handleRequest(QTcpSocket& socket)
+    {
+        messagedef_t request;
+        if(!read(socket, reinterpret_cast<char*>(&request), sizeof(messagedef_t))) {
+            return false;
+        }
+
+        QByteArray requestPayload(request.bufsize, 0);
+        if(!read(socket, requestPayload.data(), request.bufsize)) {
+            return false;
+        }
+
+        QByteArray payload;
+
+        if(request.command == GET_HDR) {
+            headerdef_t headerdef;
+            headerdef.nchans = m_iNumChannels;
+            headerdef.nsamples = numSamples();
+            headerdef.nevents = 0;
+            headerdef.fsample = m_fSampleFreq;
+            headerdef.data_type = m_iDataType;
+            headerdef.bufsize = 0;
+            payload.append(reinterpret_cast<const char*>(&headerdef), sizeof(headerdef_t));
+            respond(socket, GET_OK, payload);
+        } else if(request.command == WAIT_DAT) {
+            samples_events_t threshold;
+            qint32 iTimeout;
+            std::memcpy(&threshold, requestPayload.constData(), sizeof(samples_events_t));
+            std::memcpy(&iTimeout, requestPayload.constData() + sizeof(samples_events_t), sizeof(qint32));
+
+            QElapsedTimer timer;
+            timer.start();
+            while(numSamples() <= threshold.nsamples && timer.elapsed() < iTimeout && !m_bStop.loadAcquire()) {
+                QThread::msleep(1);
+            }
+
+            samples_events_t samplesEvents;
+            samplesEvents.nsamples = numSamples();
+            samplesEvents.nevents = 0;
+            payload.append(reinterpret_cast<const char*>(&samplesEvents), sizeof(samples_events_t));
+            respond(socket, WAIT_OK, payload);
+        } else if(request.command == GET_DAT) {
+            datasel_t datasel;
+            std::memcpy(&datasel, requestPayload.constData(), sizeof(datasel_t));
+
+            int iStallMs = m_iStallMs.fetchAndStoreOrdered(0);
+            if(iStallMs > 0) {
+                QThread::msleep(iStallMs);
+            }
+
+            datadef_t datadef;
+            datadef.nchans = m_iNumChannels;
+            datadef.nsamples = datasel.endsample - datasel.begsample + 1;
+            datadef.data_type = m_iDataType;
+            datadef.bufsize = 0;
+            payload.append(reinterpret_cast<const char*>(&datadef), sizeof(datadef_t));
+
+            switch(m_iDataType) {
+                case DATATYPE_INT16:
+                    appendSamples<qint16>(payload, datasel.begsample, datasel.endsample);
+                    break;
+                case DATATYPE_INT32:
+                    appendSamples<qint32>(payload, datasel.begsample, datasel.endsample);
+                    break;
+                case DATATYPE_FLOAT32:
+                    appendSamples<float>(payload, datasel.begsample, datasel.endsample);
+                    break;
+                case DATATYPE_FLOAT64:
+                    appendSamples<double>(payload, datasel.begsample, datasel.endsample);
+                    break;
+            }
+
+            datadef.bufsize = payload.size() - static_cast<int>(sizeof(datadef_t));
+            std::memcpy(payload.data(), &datadef, sizeof(datadef_t));
+            respond(socket, GET_OK, payload);
+        } else {
+            respond(socket, GET_ERR, payload);
+        }
+
+        return true;
+    }
+
+    qint32          m_iDataType;
+    qint32          m_iNumChannels;
+    float           m_fSampleFreq;
+    quint16         m_iPort;
+    QSemaphore      m_semListening;
+    QElapsedTimer   m_timerStreaming;
+    QAtomicInt      m_iNumSamples;
+    QAtomicInt      m_iStallMs;
+    QAtomicInt      m_bStreaming;
+    QAtomicInt      m_bStop;
+};
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestFtConnector
+ *
+ * @brief The TestFtConnector class provides tests of the FtConnector against a FieldTrip buffer stand-in
+ *
+ */
+class TestFtConnector: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFtConnector();
+
+private slots:
+    void initTestCase();
+    void waitForData_data();
+    void waitForData();
+    void timeoutReconnects();
+    void cpuIdle();
+    void cpuStreaming();
+    void cleanupTestCase();
+
+private:
+    bool compareBlock(const MatrixXd& matData,
+                      int iFirstSample);
+    double threadCpuTimeMs();
+};
+
+//=============================================================================================================
+
+TestFtConnector::TestFtConnector()
+{
+}
+
+//=============================================================================================================
+
+void TestFtConnector::initTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestFtConnector::waitForData_data()
+{
+    QTest::addColumn<int>("iDataType");
+
+    QTest::newRow("int16") << static_cast<int>(DATATYPE_INT16);
+    QTest::newRow("int32") << static_cast<int>(DATATYPE_INT32);
+    QTest::newRow("float32") << static_cast<int>(DATATYPE_FLOAT32);
+    QTest::newRow("float64") << static_cast<int>(DATATYPE_FLOAT64);
+}
+
+//=============================================================================================================
+
+void TestFtConnector::waitForData()
+{
+    QFETCH(int, iDataType);
+
+    FtBufferStandIn standIn(iDataType, 32, 1000.0f);
+    standIn.setNumSamples(500);
+
+    FtConnector connector;
+    connector.setPort(standIn.listen());
+    connector.setWaitThreshold(1, 100);
+
+    QVERIFY(connector.connect());
+    QVERIFY(connector.getHeader());
+
+    // All samples in the buffer
+    QVERIFY(connector.waitForData());
+    QVERIFY(connector.newData());
+    QCOMPARE(connector.getMatrix().rows(), 32);
+    QCOMPARE(connector.getMatrix().cols(), 500);
+    QVERIFY(compareBlock(connector.getMatrix(), 0));
+    connector.resetEmitData();
+
+    // Only the new samples
+    standIn.setNumSamples(700);
+    QVERIFY(connector.waitForData());
+    QCOMPARE(connector.getMatrix().cols(), 200);
+    QVERIFY(compareBlock(connector.getMatrix(), 500));
+    connector.resetEmitData();
+
+    // Nothing new before the timeout
+    QVERIFY(!connector.waitForData());
+    QVERIFY(!connector.newData());
+
+    connector.disconnect();
+    standIn.stop();
+}
+
+//=============================================================================================================
+
+void TestFtConnector::timeoutReconnects()
+{
+    FtBufferStandIn standIn(DATATYPE_FLOAT32, 8, 1000.0f);
+    standIn.setNumSamples(100);
+
+    FtConnector connector;
+    connector.setPort(standIn.listen());
+
+    // The connector gives up on a response after the wait timeout plus one second
+    connector.setWaitThreshold(1, 0);
+    QVERIFY(connector.connect());
+
+    standIn.stallNextData(1200);
+    QVERIFY(!connector.waitForData());
+
+    // The late response must not be taken as the answer to the next request
+    QVERIFY(connector.waitForData());
+    QCOMPARE(connector.getMatrix().rows(), 8);
+    QCOMPARE(connector.getMatrix().cols(), 100);
+    QVERIFY(compareBlock(connector.getMatrix(), 0));
+
+    connector.disconnect();
+    standIn.stop();
+}
+
+//=============================================================================================================
+
+void TestFtConnector::cpuIdle()
+{
+#ifndef Q_OS_UNIX
+    QSKIP("Thread CPU time is only measured on Unix.");
+#endif
+
+    FtBufferStandIn standIn(DATATYPE_FLOAT32, 300, 2000.0f);
+
+    FtConnector connector;
+    connector.setPort(standIn.listen());
+    connector.setWaitThreshold(1, 200);
+    QVERIFY(connector.connect());
+
+    QElapsedTimer timer;
+    timer.start();
+    double dCpuStart = threadCpuTimeMs();
+
+    while(timer.elapsed() < 1000) {
+        QVERIFY(!connector.waitForData());
+    }
+
+    double dCpu = threadCpuTimeMs() - dCpuStart;
+    qint64 iWall = timer.elapsed();
+    qInfo() << "Idle:" << dCpu << "ms CPU in" << iWall << "ms," << 100.0 * dCpu / iWall << "%";
+
+    // The thread sleeps in the socket while the buffer is idle
+    QVERIFY(dCpu < 0.05 * iWall);
+
+    connector.disconnect();
+    standIn.stop();
+}
+
+//=============================================================================================================
+
+void TestFtConnector::cpuStreaming()
+{
+#ifndef Q_OS_UNIX
+    QSKIP("Thread CPU time is only measured on Unix.");
+#endif
+
+    FtBufferStandIn standIn(DATATYPE_FLOAT32, 300, 2000.0f);
+
+    FtConnector connector;
+    connector.setPort(standIn.listen());
+    connector.setWaitThreshold(100, 200);
+    QVERIFY(connector.connect());
+
+    standIn.startStreaming();
+
+    QElapsedTimer timer;
+    timer.start();
+    double dCpuStart = threadCpuTimeMs();
+    int iNumReceived = 0;
+    bool bCorrect = true;
+
+    while(timer.elapsed() < 2000) {
+        if(connector.waitForData()) {
+            bCorrect &= compareBlock(connector.getMatrix(), iNumReceived);
+            iNumReceived += connector.getMatrix().cols();
+            connector.resetEmitData();
+        }
+    }
+
+    double dCpu = threadCpuTimeMs() - dCpuStart;
+    qint64 iWall = timer.elapsed();
+    qInfo() << "2 kHz x 300 channels:" << iNumReceived << "samples," << dCpu << "ms CPU in" << iWall << "ms,"
+            << 100.0 * dCpu / iWall << "%";
+
+    QVERIFY(bCorrect);
+    QVERIFY(iNumReceived >= 0.8 * 2 * iWall);
+    QVERIFY(dCpu < 0.5 * iWall);
+
+    connector.disconnect();
+    standIn.stop();
+}
+
+//=============================================================================================================
+
+void TestFtConnector::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+bool TestFtConnector::compareBlock(const MatrixXd& matData,
+                                   int iFirstSample)
+{
+    for(int s = 0; s < matData.cols(); ++s) {
+        for(int c = 0; c < matData.rows(); ++c) {
+            if(matData(c, s) != FtBufferStandIn::value(c, iFirstSample + s)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
+double TestFtConnector::threadCpuTimeMs()
+{
+#ifdef Q_OS_UNIX
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1.0e6;
+#else
+    return 0.0;
+#endif
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestFtConnector)
+#include "test_ftconnector.moc"
@@ -86,6 +86,8 @@ private slots:
     void testEmptyInputsForProjecting();
     void testEmptyInputsForSCDC();
     void testDimensionsForSCDC();
+    void testProjectingAgainstLinearSearch();
+    void testSparseSCDC();
     void cleanupTestCase();
 
 private:
@@ -204,6 +206,64 @@ void TestGeometryInfo::testDimensionsForSCDC() {
 
 //=============================================================================================================
 
+void TestGeometryInfo::testProjectingAgainstLinearSearch() {
+    // random positions around the head surface, the k-d tree has to find the same vertices as a linear search
+    QVector<Vector3f> vPositions;
+    for(int i = 0; i < 200; ++i) {
+        vPositions.push_back(Vector3f::Random() * 0.15f);
+    }
+    vPositions.push_back(realSurface.rr.row(0).transpose());
+
+    QVector<int> vMapping = GeometryInfo::projectSensors(realSurface.rr, vPositions);
+    QVERIFY(vMapping.size() == vPositions.size());
+
+    for(int i = 0; i < vPositions.size(); ++i) {
+        qint32 iChampionId = -1;
+        double dChampDist = std::numeric_limits<double>::max();
+        for(qint32 v = 0; v < realSurface.rr.rows(); ++v) {
+            double dDist = (realSurface.rr.row(v).transpose() - vPositions[i]).cast<double>().norm();
+            if(dDist < dChampDist) {
+                iChampionId = v;
+                dChampDist = dDist;
+            }
+        }
+        QVERIFY((realSurface.rr.row(vMapping[i]).transpose() - vPositions[i]).cast<double>().norm() <= dChampDist * (1.0 + 1e-6));
+    }
+    QVERIFY(vMapping.last() == 0);
+}
+
+//=============================================================================================================
+
+void TestGeometryInfo::testSparseSCDC() {
+    QVector<int> vSubset;
+    for(int i = 0; i < realSurface.rr.rows(); i += 50) {
+        vSubset.push_back(i);
+    }
+
+    // the sparse table has to hold exactly the distances of the dense table within the cancel distance
+    const double dCancelDist = 0.03;
+    QSharedPointer<MatrixXd> pDense = GeometryInfo::scdc(realSurface.rr, realSurface.neighbor_vert, vSubset, dCancelDist);
+    QSharedPointer<SparseMatrix<double> > pSparse = GeometryInfo::scdcSparse(realSurface.rr, realSurface.neighbor_vert, vSubset, dCancelDist);
+
+    QVERIFY(pSparse->rows() == pDense->rows());
+    QVERIFY(pSparse->cols() == pDense->cols());
+
+    qint64 iCountDense = 0;
+    for(qint32 col = 0; col < pDense->cols(); ++col) {
+        for(qint32 row = 0; row < pDense->rows(); ++row) {
+            if(pDense->coeff(row, col) <= dCancelDist) {
+                iCountDense++;
+            }
+        }
+        for(SparseMatrix<double>::InnerIterator it(*pSparse, col); it; ++it) {
+            QVERIFY(it.value() == pDense->coeff(it.row(), col));
+        }
+    }
+    QVERIFY(iCountDense == pSparse->nonZeros());
+}
+
+//=============================================================================================================
+
 void TestGeometryInfo::cleanupTestCase() {
 }
 
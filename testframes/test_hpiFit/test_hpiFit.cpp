@@ -230,6 +230,11 @@ void TestHpiFit::initTestCase()
         mHpiResult(i,1) = devHeadT.angleTo(pFiffInfo->dev_head_t.trans);
 
     }
+    // Run time of the fit stages, findOrder fits once per frequency
+    const HpiFitTiming& timing = HPI.getTiming();
+    QVERIFY(timing.iNumFits == mRefPos.rows() + vFreqs.size());
+    qInfo() << "Mean fit time" << timing.iTotal * 1e-6 / timing.iNumFits << "ms, dipfit" << timing.iDipfit * 1e-6 / timing.iNumFits << "ms";
+
     // For debug: position file for HPIFit
 //    UTILSLIB::IOUtils::write_eigen_matrix(mHpiPos, QCoreApplication::applicationDirPath() + "/MNE-sample-data/mHpiPos.txt");
 }
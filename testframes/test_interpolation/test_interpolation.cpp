@@ -85,6 +85,7 @@ private slots:
     void testDimensionsForInterpolation();
     void testSumOfRow();
     void testEmptyInputsForWeightMatrix();
+    void testSparseDistanceTable();
     void cleanupTestCase();
 
 private:
@@ -248,6 +249,42 @@ void TestInterpolation::testEmptyInputsForWeightMatrix()
 
 //=============================================================================================================
 
+void TestInterpolation::testSparseDistanceTable()
+{
+    // the weight matrix from the sparse distance table has to match the one from the dense table
+    QVector<int> vMappedSubSet = GeometryInfo::projectSensors(realSurface.rr,
+                                                              vMegSensors);
+
+    QSharedPointer<MatrixXd> pDense = GeometryInfo::scdc(realSurface.rr,
+                                                         realSurface.neighbor_vert,
+                                                         vMappedSubSet,
+                                                         0.05);
+    QSharedPointer<SparseMatrix<double> > pSparse = GeometryInfo::scdcSparse(realSurface.rr,
+                                                                             realSurface.neighbor_vert,
+                                                                             vMappedSubSet,
+                                                                             0.05);
+
+    QVector<int> vBadDense = GeometryInfo::filterBadChannels(pDense, evoked.info, FIFFV_MEG_CH);
+    QVector<int> vBadSparse = GeometryInfo::filterBadChannels(pSparse, evoked.info, FIFFV_MEG_CH);
+    QVERIFY(vBadDense == vBadSparse);
+
+    QSharedPointer<SparseMatrix<float> > pWDense = Interpolation::createInterpolationMat(vMappedSubSet,
+                                                                                         pDense,
+                                                                                         Interpolation::cubic,
+                                                                                         0.05,
+                                                                                         vBadDense);
+    QSharedPointer<SparseMatrix<float> > pWSparse = Interpolation::createInterpolationMat(vMappedSubSet,
+                                                                                          pSparse,
+                                                                                          Interpolation::cubic,
+                                                                                          0.05,
+                                                                                          vBadSparse);
+
+    QVERIFY(pWDense->nonZeros() == pWSparse->nonZeros());
+    QVERIFY(SparseMatrix<float>(*pWDense - *pWSparse).norm() == 0.0f);
+}
+
+//=============================================================================================================
+
 void TestInterpolation::cleanupTestCase()
 {
 }
@@ -0,0 +1,274 @@
+//=============================================================================================================
+/**
+ * @file     test_minimum_norm.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test the factored, label and single sample MinimumNorm paths against the dense imaging kernel
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/applicationlogger.h>
+
+#include <inverse/minimumNorm/minimumnorm.h>
+#include <mne/mne_forwardsolution.h>
+#include <mne/mne_inverse_operator.h>
+#include <mne/mne_sourceestimate.h>
+#include <fiff/fiff_evoked.h>
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_constants.h>
+#include <fs/label.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace MNELIB;
+using namespace FIFFLIB;
+using namespace FSLIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestMinimumNorm
+ *
+ * @brief The TestMinimumNorm class compares the MinimumNorm source estimates with the dense imaging kernel
+ *
+ */
+class TestMinimumNorm: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMinimumNorm();
+
+private slots:
+    void initTestCase();
+    void compareFactored();
+    void compareLabel();
+    void compareSingleSample();
+    void cleanupTestCase();
+
+private:
+    double relativeError(const MatrixXd& matTest,
+                         const MatrixXd& matRef) const;
+
+    double dEpsilon;
+
+    float m_fTMin;
+    float m_fTStep;
+
+    QSharedPointer<MinimumNorm> m_pMinimumNormDense;
+    QSharedPointer<MinimumNorm> m_pMinimumNormFactored;
+
+    MatrixXd m_matData;
+    MatrixXd m_matRef;
+
+    Label m_label;
+    VectorXi m_vecLabelSel;
+};
+
+//=============================================================================================================
+
+TestMinimumNorm::TestMinimumNorm()
+: dEpsilon(0.000001)
+{
+}
+
+//=============================================================================================================
+
+void TestMinimumNorm::initTestCase()
+{
+    qInstallMessageHandler(UTILSLIB::ApplicationLogger::customLogWriter);
+
+    QFile t_fileEvoked(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif");
+    QFile t_fileFwd(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/Result/ref-sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QFile t_fileCov(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QVERIFY(t_fileEvoked.exists());
+    QVERIFY(t_fileFwd.exists());
+    QVERIFY(t_fileCov.exists());
+
+    // Loose orientation inverse operator with dSPM, so the current components are combined and noise normalized
+    QPair<float, float> baseline(-1.0f, -1.0f);
+    FiffEvoked evoked(t_fileEvoked, 0, baseline);
+    QVERIFY(!evoked.isEmpty());
+
+    MNEForwardSolution t_forward(t_fileFwd, false, true);
+    FiffCov noise_cov(t_fileCov);
+    noise_cov = noise_cov.regularize(evoked.info, 0.05, 0.05, 0.1, true);
+
+    MNEInverseOperator inverse_operator(evoked.info, t_forward, noise_cov, 0.2f, 0.8f);
+
+    float fLambda = 1.0f / 9.0f;
+
+    m_pMinimumNormDense = QSharedPointer<MinimumNorm>(new MinimumNorm(inverse_operator, fLambda, QString("dSPM")));
+    m_pMinimumNormDense->doInverseSetup(evoked.nave, false);
+
+    m_pMinimumNormFactored = QSharedPointer<MinimumNorm>(new MinimumNorm(inverse_operator, fLambda, QString("dSPM")));
+    m_pMinimumNormFactored->setFactoredKernel(true);
+    m_pMinimumNormFactored->doInverseSetup(evoked.nave, false);
+
+    QVERIFY(m_pMinimumNormFactored->getKernel().size() == 0);
+
+    MNEInverseOperator& inv = m_pMinimumNormDense->getPreparedInverseOperator();
+
+    m_matData = evoked.pick_channels(inv.noise_cov->names).data;
+    m_fTMin = evoked.times[0];
+    m_fTStep = 1.0f / evoked.info.sfreq;
+
+    // Reference: dense kernel times the data, norm over the current components, then the noise normalization
+    MatrixXd matSol = m_pMinimumNormDense->getKernel() * m_matData;
+
+    if(inv.source_ori == FIFFV_MNE_FREE_ORI) {
+        MatrixXd matCombined(matSol.rows() / 3, matSol.cols());
+        for(int i = 0; i < matSol.cols(); ++i) {
+            for(int j = 0; j < matCombined.rows(); ++j) {
+                matCombined(j, i) = matSol.block<3,1>(3 * j, i).norm();
+            }
+        }
+        matSol = matCombined;
+    }
+
+    m_matRef = inv.noisenorm * matSol;
+
+    // Every fifth source of the right hemisphere
+    const VectorXi& vecVertNoRh = inv.src[1].vertno;
+    int iNumLabelVert = (vecVertNoRh.size() + 4) / 5;
+
+    VectorXi vecLabelVert(iNumLabelVert);
+    m_vecLabelSel = VectorXi(iNumLabelVert);
+    for(int i = 0; i < iNumLabelVert; ++i) {
+        vecLabelVert[i] = vecVertNoRh[5 * i];
+        m_vecLabelSel[i] = inv.src[0].vertno.size() + 5 * i;
+    }
+
+    m_label = Label(vecLabelVert, MatrixX3f::Zero(iNumLabelVert, 3), VectorXd::Ones(iNumLabelVert), 1, QString("test-rh"));
+}
+
+//=============================================================================================================
+
+double TestMinimumNorm::relativeError(const MatrixXd& matTest,
+                                      const MatrixXd& matRef) const
+{
+    return (matTest - matRef).cwiseAbs().maxCoeff() / matRef.cwiseAbs().maxCoeff();
+}
+
+//=============================================================================================================
+
+void TestMinimumNorm::compareFactored()
+{
+    MNESourceEstimate sourceEstimateDense = m_pMinimumNormDense->calculateInverse(m_matData, m_fTMin, m_fTStep);
+    MNESourceEstimate sourceEstimateFactored = m_pMinimumNormFactored->calculateInverse(m_matData, m_fTMin, m_fTStep);
+
+    QVERIFY(!sourceEstimateDense.isEmpty());
+    QVERIFY(!sourceEstimateFactored.isEmpty());
+
+    QCOMPARE(sourceEstimateFactored.data.rows(), m_matRef.rows());
+    QCOMPARE(sourceEstimateFactored.data.cols(), m_matRef.cols());
+
+    QVERIFY(relativeError(sourceEstimateDense.data, m_matRef) < dEpsilon);
+    QVERIFY(relativeError(sourceEstimateFactored.data, m_matRef) < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestMinimumNorm::compareLabel()
+{
+    MatrixXd matRefSel(m_vecLabelSel.size(), m_matRef.cols());
+    for(int i = 0; i < m_vecLabelSel.size(); ++i) {
+        matRefSel.row(i) = m_matRef.row(m_vecLabelSel[i]);
+    }
+
+    MNESourceEstimate sourceEstimateDense = m_pMinimumNormDense->calculateInverse(m_matData, m_fTMin, m_fTStep, m_label);
+    MNESourceEstimate sourceEstimateFactored = m_pMinimumNormFactored->calculateInverse(m_matData, m_fTMin, m_fTStep, m_label);
+
+    QVERIFY(!sourceEstimateFactored.isEmpty());
+    QVERIFY(sourceEstimateFactored.vertices == m_label.vertices);
+
+    QVERIFY(relativeError(sourceEstimateDense.data, matRefSel) < dEpsilon);
+    QVERIFY(relativeError(sourceEstimateFactored.data, matRefSel) < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestMinimumNorm::compareSingleSample()
+{
+    const int iSample = m_matData.cols() / 2;
+
+    MNESourceEstimate sourceEstimateDense = m_pMinimumNormDense->calculateInverse(m_matData, m_fTMin, m_fTStep, Label(), iSample);
+    MNESourceEstimate sourceEstimateFactored = m_pMinimumNormFactored->calculateInverse(m_matData, m_fTMin, m_fTStep, Label(), iSample);
+
+    QVERIFY(!sourceEstimateFactored.isEmpty());
+    QCOMPARE(static_cast<int>(sourceEstimateFactored.data.cols()), 1);
+    QVERIFY(std::abs(sourceEstimateFactored.tmin - (m_fTMin + iSample * m_fTStep)) < dEpsilon);
+
+    QVERIFY(relativeError(sourceEstimateDense.data, m_matRef.col(iSample)) < dEpsilon);
+    QVERIFY(relativeError(sourceEstimateFactored.data, m_matRef.col(iSample)) < dEpsilon);
+
+    // Label and single sample combined
+    VectorXd vecRefSel(m_vecLabelSel.size());
+    for(int i = 0; i < m_vecLabelSel.size(); ++i) {
+        vecRefSel[i] = m_matRef(m_vecLabelSel[i], iSample);
+    }
+
+    MNESourceEstimate sourceEstimateLabel = m_pMinimumNormFactored->calculateInverse(m_matData, m_fTMin, m_fTStep, m_label, iSample);
+
+    QVERIFY(relativeError(sourceEstimateLabel.data, vecRefSel) < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestMinimumNorm::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestMinimumNorm)
+#include "test_minimum_norm.moc"
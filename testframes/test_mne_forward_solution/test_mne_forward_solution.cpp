@@ -42,6 +42,7 @@
 
 #include <fwd/computeFwd/compute_fwd_settings.h>
 #include <fwd/computeFwd/compute_fwd.h>
+#include <fwd/fwd_bem_model.h>
 #include <mne/mne.h>
 
 #include <fiff/fiff.h>
@@ -79,6 +80,7 @@ private slots:
     void initTestCase();
     void computeForward();
     void compareForward();
+    void bemSolutionCache();
     void cleanupTestCase();
 
 private:
@@ -186,6 +188,58 @@ void TestMneForwardSolution::compareForward()
 
 //=============================================================================================================
 
+void TestMneForwardSolution::bemSolutionCache()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> BEM Solution Cache >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    QString bemName = QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/subjects/sample/bem/sample-1280-1280-1280-bem.fif";
+    QByteArray cacheEnv = qgetenv("MNE_BEM_SOLUTION_CACHE");
+
+    // The cache is off unless its directory is given
+    qunsetenv("MNE_BEM_SOLUTION_CACHE");
+
+    FwdBemModel* pModel = FwdBemModel::fwd_bem_load_homog_surface(bemName);
+    QVERIFY(pModel);
+    QVERIFY(FwdBemModel::fwd_bem_solution_cache_name(pModel,FWD_BEM_LINEAR_COLL).isEmpty());
+
+    // A recomputed solution is written to the cache
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    qputenv("MNE_BEM_SOLUTION_CACHE", cacheDir.path().toLocal8Bit());
+
+    QString cacheName = FwdBemModel::fwd_bem_solution_cache_name(pModel,FWD_BEM_LINEAR_COLL);
+    QVERIFY(cacheName.startsWith(cacheDir.path()));
+
+    // Returns 0 (OK) on success
+    QCOMPARE(FwdBemModel::fwd_bem_load_recompute_solution(bemName,FWD_BEM_LINEAR_COLL,1,pModel), 0);
+    QVERIFY(QFile::exists(cacheName));
+
+    // Reading it back gives the same solution
+    FwdBemModel* pCachedModel = FwdBemModel::fwd_bem_load_homog_surface(bemName);
+    QVERIFY(pCachedModel);
+    QCOMPARE(FwdBemModel::fwd_bem_solution_cache_name(pCachedModel,FWD_BEM_LINEAR_COLL), cacheName);
+    // Returns 1 (TRUE) if the solution was found
+    QCOMPARE(FwdBemModel::fwd_bem_load_solution(cacheName,FWD_BEM_LINEAR_COLL,pCachedModel), 1);
+    QCOMPARE(pCachedModel->nsol, pModel->nsol);
+
+    Eigen::Map<Eigen::MatrixXf> matSolution(pModel->solution[0],pModel->nsol,pModel->nsol);
+    Eigen::Map<Eigen::MatrixXf> matCachedSolution(pCachedModel->solution[0],pCachedModel->nsol,pCachedModel->nsol);
+    QVERIFY(matSolution == matCachedSolution);
+
+    delete pModel;
+    delete pCachedModel;
+
+    if(cacheEnv.isEmpty()) {
+        qunsetenv("MNE_BEM_SOLUTION_CACHE");
+    } else {
+        qputenv("MNE_BEM_SOLUTION_CACHE", cacheEnv);
+    }
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< BEM Solution Cache Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+//=============================================================================================================
+
 void TestMneForwardSolution::cleanupTestCase()
 {
 }
@@ -0,0 +1,292 @@
+//=============================================================================================================
+/**
+ * @file     test_plugin_connector_edge.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    The plugin connector edge test implementation
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <scShared/Management/pluginconnectoredge.h>
+#include <scMeas/realtimemultisamplearray.h>
+#include <scMeas/realtimesamplearraychinfo.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QAtomicInt>
+#include <QThread>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <thread>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace SCSHAREDLIB;
+using namespace SCMEASLIB;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestPluginConnectorEdge
+ *
+ * @brief The TestPluginConnectorEdge class provides tests for the overflow policies and the fan-out of PluginConnectorEdge
+ *
+ */
+class TestPluginConnectorEdge: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestPluginConnectorEdge();
+
+private slots:
+    void initTestCase();
+    void block();
+    void dropOldest();
+    void coalesce();
+    void zeroCopyFanOut();
+    void cleanupTestCase();
+
+private:
+    void publish(double dValue);
+    QList<double> blockValues(const QList<Measurement::SPtr>& lPackets);
+
+    QSharedPointer<RealTimeMultiSampleArray>    m_pRTMSA;
+};
+
+//=============================================================================================================
+
+TestPluginConnectorEdge::TestPluginConnectorEdge()
+{
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::initTestCase()
+{
+    QList<RealTimeSampleArrayChInfo> lChInfo;
+    lChInfo << RealTimeSampleArrayChInfo() << RealTimeSampleArrayChInfo();
+
+    m_pRTMSA = QSharedPointer<RealTimeMultiSampleArray>::create();
+    m_pRTMSA->init(lChInfo);
+    m_pRTMSA->setMultiArraySize(1);
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::block()
+{
+    QObject receiver;
+    QList<Measurement::SPtr> lDelivered;
+    PluginConnectorEdge::SPtr pEdge = PluginConnectorEdge::create(&receiver,
+                                                                  [&lDelivered](Measurement::SPtr pMeasurement) {
+                                                                      lDelivered.append(pMeasurement);
+                                                                  },
+                                                                  PluginConnectorEdge::Block,
+                                                                  2);
+
+    // The sender pushes from its own thread, the queue is drained in this one
+    QAtomicInt iPushed(0);
+    std::thread sender([this, pEdge, &iPushed]() {
+        for(int i = 0; i < 5; ++i) {
+            publish(i);
+            pEdge->push(m_pRTMSA);
+            iPushed.fetchAndAddOrdered(1);
+        }
+    });
+
+    // No events are processed while sleeping, so the sender has to wait on the full queue
+    QThread::msleep(200);
+    QCOMPARE(iPushed.loadAcquire(), 2);
+    QCOMPARE(pEdge->getNumQueued(), 2);
+
+    QTRY_COMPARE(lDelivered.size(), 5);
+    sender.join();
+
+    QCOMPARE(pEdge->getNumDropped(), qint64(0));
+    QCOMPARE(blockValues(lDelivered), QList<double>() << 0 << 1 << 2 << 3 << 4);
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::dropOldest()
+{
+    QObject receiver;
+    QList<Measurement::SPtr> lDelivered;
+    PluginConnectorEdge::SPtr pEdge = PluginConnectorEdge::create(&receiver,
+                                                                  [&lDelivered](Measurement::SPtr pMeasurement) {
+                                                                      lDelivered.append(pMeasurement);
+                                                                  },
+                                                                  PluginConnectorEdge::DropOldest,
+                                                                  3);
+
+    for(int i = 0; i < 5; ++i) {
+        publish(i);
+        pEdge->push(m_pRTMSA);
+    }
+
+    QCOMPARE(pEdge->getNumQueued(), 3);
+    QCOMPARE(pEdge->getNumDropped(), qint64(2));
+
+    QTRY_COMPARE(lDelivered.size(), 3);
+    QCOMPARE(blockValues(lDelivered), QList<double>() << 2 << 3 << 4);
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::coalesce()
+{
+    QObject receiver;
+    QList<Measurement::SPtr> lDelivered;
+    PluginConnectorEdge::SPtr pEdge = PluginConnectorEdge::create(&receiver,
+                                                                  [&lDelivered](Measurement::SPtr pMeasurement) {
+                                                                      lDelivered.append(pMeasurement);
+                                                                  },
+                                                                  PluginConnectorEdge::Coalesce,
+                                                                  3);
+
+    // The first three blocks are merged, the full merged packet is discarded by the fourth one, which is then
+    // merged with the fifth one
+    for(int i = 0; i < 5; ++i) {
+        publish(i);
+        pEdge->push(m_pRTMSA);
+        QCOMPARE(pEdge->getNumQueued(), 1);
+    }
+
+    QCOMPARE(pEdge->getNumDropped(), qint64(3));
+
+    QTRY_COMPARE(lDelivered.size(), 1);
+    QSharedPointer<RealTimeMultiSampleArray> pMerged = lDelivered.first().dynamicCast<RealTimeMultiSampleArray>();
+    QVERIFY(pMerged);
+    QCOMPARE(pMerged->getMultiArraySize(), 2);
+    QCOMPARE(blockValues(lDelivered), QList<double>() << 3 << 4);
+
+    // Nothing got lost while the receiver kept up
+    lDelivered.clear();
+    for(int i = 5; i < 8; ++i) {
+        publish(i);
+        pEdge->push(m_pRTMSA);
+        QTRY_COMPARE(lDelivered.size(), i - 4);
+    }
+    QCOMPARE(pEdge->getNumDropped(), qint64(3));
+    QCOMPARE(blockValues(lDelivered), QList<double>() << 5 << 6 << 7);
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::zeroCopyFanOut()
+{
+    QObject receiver;
+    QList<Measurement::SPtr> lDeliveredA;
+    QList<Measurement::SPtr> lDeliveredB;
+    PluginConnectorEdge::SPtr pEdgeA = PluginConnectorEdge::create(&receiver,
+                                                                   [&lDeliveredA](Measurement::SPtr pMeasurement) {
+                                                                       lDeliveredA.append(pMeasurement);
+                                                                   });
+    PluginConnectorEdge::SPtr pEdgeB = PluginConnectorEdge::create(&receiver,
+                                                                   [&lDeliveredB](Measurement::SPtr pMeasurement) {
+                                                                       lDeliveredB.append(pMeasurement);
+                                                                   });
+
+    publish(1);
+    pEdgeA->push(m_pRTMSA);
+    pEdgeB->push(m_pRTMSA);
+    const double* pSamples = m_pRTMSA->getMultiSampleArray().first().data();
+
+    // Publishing the next block must not touch the samples which are still queued
+    publish(2);
+
+    QTRY_COMPARE(lDeliveredA.size(), 1);
+    QTRY_COMPARE(lDeliveredB.size(), 1);
+
+    QSharedPointer<RealTimeMultiSampleArray> pA = lDeliveredA.first().dynamicCast<RealTimeMultiSampleArray>();
+    QSharedPointer<RealTimeMultiSampleArray> pB = lDeliveredB.first().dynamicCast<RealTimeMultiSampleArray>();
+    QVERIFY(pA && pB);
+    QVERIFY(pA != m_pRTMSA && pB != m_pRTMSA && pA != pB);
+
+    QCOMPARE(pA->getMultiSampleArray().first().data(), pSamples);
+    QCOMPARE(pB->getMultiSampleArray().first().data(), pSamples);
+    QCOMPARE(blockValues(lDeliveredA), QList<double>() << 1);
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestPluginConnectorEdge::publish(double dValue)
+{
+    m_pRTMSA->setValue(MatrixXd::Constant(2, 4, dValue));
+}
+
+//=============================================================================================================
+
+QList<double> TestPluginConnectorEdge::blockValues(const QList<Measurement::SPtr>& lPackets)
+{
+    QList<double> lValues;
+
+    for(const Measurement::SPtr& pPacket : lPackets) {
+        QSharedPointer<RealTimeMultiSampleArray> pRTMSA = pPacket.dynamicCast<RealTimeMultiSampleArray>();
+        if(!pRTMSA) {
+            continue;
+        }
+        for(const MatrixXd& matBlock : pRTMSA->getMultiSampleArray()) {
+            lValues.append(matBlock(0,0));
+        }
+    }
+
+    return lValues;
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestPluginConnectorEdge)
+#include "test_plugin_connector_edge.moc"
@@ -0,0 +1,259 @@
+//=============================================================================================================
+/**
+ * @file     test_rap_music.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test the pruned RAP MUSIC pair search against the exhaustive one
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/applicationlogger.h>
+
+#include <inverse/rapMusic/rapmusic.h>
+#include <mne/mne_forwardsolution.h>
+
+#include <cmath>
+#include <random>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QElapsedTimer>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace MNELIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestRapMusic
+ *
+ * @brief The TestRapMusic class compares the pruned pair search of RapMusic with the exhaustive search
+ *
+ */
+class TestRapMusic: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRapMusic();
+
+private slots:
+    void initTestCase();
+    void comparePairs();
+    void compareCorrelations();
+    void compareDirections();
+    void reportPairSearch();
+    void cleanupTestCase();
+
+private:
+    QList<DipolePair<double> > runRapMusic(bool bExhaustive,
+                                           RapMusic::PairSearchStats& stats,
+                                           qint64& iElapsedNs);
+
+    double dEpsilon;
+
+    MNEForwardSolution m_fwd;
+    MatrixXd m_matMeasurement;
+
+    QList<DipolePair<double> > m_lPruned;
+    QList<DipolePair<double> > m_lExhaustive;
+
+    RapMusic::PairSearchStats m_statsPruned;
+    RapMusic::PairSearchStats m_statsExhaustive;
+
+    qint64 m_iTimePruned;
+    qint64 m_iTimeExhaustive;
+};
+
+//=============================================================================================================
+
+TestRapMusic::TestRapMusic()
+: dEpsilon(0.000001)
+, m_statsPruned()
+, m_statsExhaustive()
+, m_iTimePruned(0)
+, m_iTimeExhaustive(0)
+{
+}
+
+//=============================================================================================================
+
+void TestRapMusic::initTestCase()
+{
+    qInstallMessageHandler(UTILSLIB::ApplicationLogger::customLogWriter);
+
+    // A small random lead field keeps the exhaustive search cheap
+    const int iNumChannels = 60;
+    const int iNumSources = 120;
+    const int iNumSamples = 200;
+
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    m_fwd.sol->data = MatrixXd::NullaryExpr(iNumChannels, 3 * iNumSources, [&]() { return normal(generator); });
+    m_fwd.sol->nrow = iNumChannels;
+    m_fwd.sol->ncol = 3 * iNumSources;
+
+    // Two correlated sources plus a third independent one, with a little sensor noise
+    MatrixXd matSources(3 * iNumSources, iNumSamples);
+    matSources.setZero();
+
+    for(int t = 0; t < iNumSamples; ++t) {
+        double dSignal = std::sin(2.0 * M_PI * 10.0 * t / iNumSamples);
+        matSources(3 * 17 + 0, t) = dSignal;
+        matSources(3 * 17 + 2, t) = 0.5 * dSignal;
+        matSources(3 * 83 + 1, t) = 0.8 * dSignal;
+        matSources(3 * 51 + 2, t) = std::cos(2.0 * M_PI * 3.0 * t / iNumSamples);
+    }
+
+    m_matMeasurement = m_fwd.sol->data * matSources;
+    m_matMeasurement += 0.01 * MatrixXd::NullaryExpr(iNumChannels, iNumSamples, [&]() { return normal(generator); });
+
+    m_lPruned = runRapMusic(false, m_statsPruned, m_iTimePruned);
+    m_lExhaustive = runRapMusic(true, m_statsExhaustive, m_iTimeExhaustive);
+}
+
+//=============================================================================================================
+
+QList<DipolePair<double> > TestRapMusic::runRapMusic(bool bExhaustive,
+                                                     RapMusic::PairSearchStats& stats,
+                                                     qint64& iElapsedNs)
+{
+    RapMusic rapMusic;
+    QList<DipolePair<double> > lDipoles;
+
+    if(!rapMusic.init(m_fwd, false, 3, 0.0)) {
+        return lDipoles;
+    }
+
+    rapMusic.setExhaustiveSearch(bExhaustive);
+
+    QElapsedTimer timer;
+    timer.start();
+    rapMusic.calculateInverse(m_matMeasurement, lDipoles);
+    iElapsedNs = timer.nsecsElapsed();
+
+    stats = rapMusic.getPairSearchStats();
+
+    return lDipoles;
+}
+
+//=============================================================================================================
+
+void TestRapMusic::comparePairs()
+{
+    QVERIFY(!m_lExhaustive.isEmpty());
+    QCOMPARE(m_lPruned.size(), m_lExhaustive.size());
+
+    for(int i = 0; i < m_lExhaustive.size(); ++i) {
+        QCOMPARE(m_lPruned[i].m_iIdx1, m_lExhaustive[i].m_iIdx1);
+        QCOMPARE(m_lPruned[i].m_iIdx2, m_lExhaustive[i].m_iIdx2);
+    }
+}
+
+//=============================================================================================================
+
+void TestRapMusic::compareCorrelations()
+{
+    QCOMPARE(m_lPruned.size(), m_lExhaustive.size());
+
+    for(int i = 0; i < m_lExhaustive.size(); ++i) {
+        QVERIFY(std::abs(m_lPruned[i].m_vCorrelation - m_lExhaustive[i].m_vCorrelation) < dEpsilon);
+    }
+}
+
+//=============================================================================================================
+
+void TestRapMusic::compareDirections()
+{
+    QCOMPARE(m_lPruned.size(), m_lExhaustive.size());
+
+    for(int i = 0; i < m_lExhaustive.size(); ++i) {
+        const DipolePair<double>& pruned = m_lPruned[i];
+        const DipolePair<double>& exhaustive = m_lExhaustive[i];
+
+        QVERIFY(std::abs(pruned.m_Dipole1.phi_x() - exhaustive.m_Dipole1.phi_x()) < dEpsilon);
+        QVERIFY(std::abs(pruned.m_Dipole1.phi_y() - exhaustive.m_Dipole1.phi_y()) < dEpsilon);
+        QVERIFY(std::abs(pruned.m_Dipole1.phi_z() - exhaustive.m_Dipole1.phi_z()) < dEpsilon);
+        QVERIFY(std::abs(pruned.m_Dipole2.phi_x() - exhaustive.m_Dipole2.phi_x()) < dEpsilon);
+        QVERIFY(std::abs(pruned.m_Dipole2.phi_y() - exhaustive.m_Dipole2.phi_y()) < dEpsilon);
+        QVERIFY(std::abs(pruned.m_Dipole2.phi_z() - exhaustive.m_Dipole2.phi_z()) < dEpsilon);
+    }
+}
+
+//=============================================================================================================
+
+void TestRapMusic::reportPairSearch()
+{
+    printf("Pair search (pruned): %lld pairs, %lld evaluated, %lld pruned, %lld evaluated by subcorr, %.3f ms\n",
+           m_statsPruned.iNumPairs, m_statsPruned.iNumEvaluated, m_statsPruned.iNumPruned, m_statsPruned.iNumVerified,
+           m_iTimePruned / 1000000.0);
+    printf("Pair search (exhaustive): %lld pairs, %lld evaluated by subcorr, %.3f ms\n",
+           m_statsExhaustive.iNumPairs, m_statsExhaustive.iNumVerified,
+           m_iTimeExhaustive / 1000000.0);
+    printf("Pair search speedup: %.2f\n", (double)m_iTimeExhaustive / qMax(m_iTimePruned, qint64(1)));
+
+    //Both searches scan the same pairs, the pruned one accounts for every pair and needs fewer subcorr evaluations
+    QCOMPARE(m_statsPruned.iNumPairs, m_statsExhaustive.iNumPairs);
+    QCOMPARE(m_statsExhaustive.iNumVerified, m_statsExhaustive.iNumPairs);
+    QCOMPARE(m_statsExhaustive.iNumEvaluated, qint64(0));
+    QVERIFY(m_statsPruned.iNumEvaluated + m_statsPruned.iNumPruned <= m_statsPruned.iNumPairs);
+    QVERIFY(m_statsPruned.iNumVerified > 0);
+    QVERIFY(m_statsPruned.iNumVerified < m_statsExhaustive.iNumVerified);
+}
+
+//=============================================================================================================
+
+void TestRapMusic::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestRapMusic)
+#include "test_rap_music.moc"
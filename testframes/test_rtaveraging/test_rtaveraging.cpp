@@ -0,0 +1,296 @@
+//=============================================================================================================
+/**
+ * @file     test_rtaveraging.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test the running averages and standard errors of RtAveragingWorker against a batch average
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/applicationlogger.h>
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_evoked_set.h>
+#include <fiff/fiff_constants.h>
+#include <rtprocessing/rtaveraging.h>
+
+#include <random>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestRtAveraging
+ *
+ * @brief The TestRtAveraging class compares the running averages of RtAveragingWorker with a batch average
+ *
+ */
+class TestRtAveraging: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtAveraging();
+
+private slots:
+    void initTestCase();
+    void compareSlidingWindowMean();
+    void compareCumulativeMean();
+    void compareSlidingWindowStdErr();
+    void compareCumulativeStdErrSwitchedOnLate();
+    void cleanupTestCase();
+
+private:
+    void feedBlocks(RtAveragingWorker& worker,
+                    int iFirstBlock,
+                    int iNumBlocks);
+
+    void connectWorker(RtAveragingWorker& worker);
+
+    MatrixXd batchMean(int iFirstEpoch,
+                       int iNumEpochs) const;
+
+    MatrixXd batchStdErr(int iFirstEpoch,
+                         int iNumEpochs) const;
+
+    double dEpsilon;
+
+    int m_iNumBlocks;
+    int m_iBlockSize;
+    int m_iTriggerPos;
+    int m_iPreStimSamples;
+    int m_iPostStimSamples;
+    int m_iNumAverages;
+
+    FiffInfo::SPtr m_pFiffInfo;
+    QList<MatrixXd> m_lBlocks;
+
+    FiffEvoked m_lastEvoked;
+    FiffEvoked m_lastStdErr;
+};
+
+//=============================================================================================================
+
+TestRtAveraging::TestRtAveraging()
+: dEpsilon(0.000001)
+, m_iNumBlocks(12)
+, m_iBlockSize(200)
+, m_iTriggerPos(50)
+, m_iPreStimSamples(20)
+, m_iPostStimSamples(100)
+, m_iNumAverages(5)
+{
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::initTestCase()
+{
+    qInstallMessageHandler(UTILSLIB::ApplicationLogger::customLogWriter);
+
+    const int iNumChannels = 6;
+
+    // EEG channels plus a trigger channel in the last row
+    m_pFiffInfo = FiffInfo::SPtr::create();
+    for(int i = 0; i <= iNumChannels; ++i) {
+        FiffChInfo chInfo;
+        chInfo.kind = i < iNumChannels ? FIFFV_EEG_CH : FIFFV_STIM_CH;
+        chInfo.ch_name = i < iNumChannels ? QString("EEG %1").arg(i + 1, 3, 10, QChar('0')) : QString("STI 014");
+        m_pFiffInfo->chs.append(chInfo);
+        m_pFiffInfo->ch_names.append(chInfo.ch_name);
+    }
+    m_pFiffInfo->nchan = iNumChannels + 1;
+    m_pFiffInfo->sfreq = 1000.0;
+
+    // Each block holds one trigger and a noisy response which lies completely inside the block
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    for(int b = 0; b < m_iNumBlocks; ++b) {
+        MatrixXd matBlock = MatrixXd::NullaryExpr(iNumChannels + 1, m_iBlockSize, [&]() { return normal(generator); });
+        matBlock.row(iNumChannels).setZero();
+        matBlock(iNumChannels, m_iTriggerPos) = 1.0;
+        m_lBlocks.append(matBlock);
+    }
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::connectWorker(RtAveragingWorker& worker)
+{
+    m_lastEvoked = FiffEvoked();
+    m_lastStdErr = FiffEvoked();
+
+    connect(&worker, &RtAveragingWorker::resultReady,
+            this, [this](const FiffEvokedSet& evokedStimSet, const QStringList&) {
+                m_lastEvoked = evokedStimSet.evoked.first();
+            });
+    connect(&worker, &RtAveragingWorker::stdErrReady,
+            this, [this](const FiffEvokedSet& evokedStimStdErrSet, const QStringList&) {
+                m_lastStdErr = evokedStimStdErrSet.evoked.first();
+            });
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::feedBlocks(RtAveragingWorker& worker,
+                                 int iFirstBlock,
+                                 int iNumBlocks)
+{
+    for(int b = iFirstBlock; b < iFirstBlock + iNumBlocks; ++b) {
+        worker.doWork(m_lBlocks.at(b));
+    }
+}
+
+//=============================================================================================================
+
+MatrixXd TestRtAveraging::batchMean(int iFirstEpoch,
+                                    int iNumEpochs) const
+{
+    MatrixXd matSum = MatrixXd::Zero(m_pFiffInfo->nchan, m_iPreStimSamples + m_iPostStimSamples);
+
+    for(int b = iFirstEpoch; b < iFirstEpoch + iNumEpochs; ++b) {
+        matSum += m_lBlocks.at(b).middleCols(m_iTriggerPos - m_iPreStimSamples, m_iPreStimSamples + m_iPostStimSamples);
+    }
+
+    return matSum / iNumEpochs;
+}
+
+//=============================================================================================================
+
+MatrixXd TestRtAveraging::batchStdErr(int iFirstEpoch,
+                                      int iNumEpochs) const
+{
+    MatrixXd matMean = batchMean(iFirstEpoch, iNumEpochs);
+    MatrixXd matSumSquared = MatrixXd::Zero(matMean.rows(), matMean.cols());
+
+    for(int b = iFirstEpoch; b < iFirstEpoch + iNumEpochs; ++b) {
+        MatrixXd matEpoch = m_lBlocks.at(b).middleCols(m_iTriggerPos - m_iPreStimSamples, m_iPreStimSamples + m_iPostStimSamples);
+        matSumSquared.array() += (matEpoch - matMean).array().square();
+    }
+
+    return (matSumSquared.array() / (iNumEpochs - 1) / iNumEpochs).sqrt().matrix();
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::compareSlidingWindowMean()
+{
+    RtAveragingWorker worker(m_iNumAverages, m_iPreStimSamples, m_iPostStimSamples, 0, 0, m_pFiffInfo->nchan - 1, m_pFiffInfo);
+    connectWorker(worker);
+
+    feedBlocks(worker, 0, m_iNumBlocks);
+
+    QCOMPARE(m_lastEvoked.nave, m_iNumAverages);
+    QVERIFY((m_lastEvoked.data - batchMean(m_iNumBlocks - m_iNumAverages, m_iNumAverages)).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::compareCumulativeMean()
+{
+    RtAveragingWorker worker(m_iNumAverages, m_iPreStimSamples, m_iPostStimSamples, 0, 0, m_pFiffInfo->nchan - 1, m_pFiffInfo);
+    worker.setAveragingMode(RtAveragingWorker::Cumulative);
+    connectWorker(worker);
+
+    feedBlocks(worker, 0, m_iNumBlocks);
+
+    QCOMPARE(m_lastEvoked.nave, m_iNumBlocks);
+    QVERIFY((m_lastEvoked.data - batchMean(0, m_iNumBlocks)).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::compareSlidingWindowStdErr()
+{
+    RtAveragingWorker worker(m_iNumAverages, m_iPreStimSamples, m_iPostStimSamples, 0, 0, m_pFiffInfo->nchan - 1, m_pFiffInfo);
+    worker.setComputeStdErr(true);
+    connectWorker(worker);
+
+    feedBlocks(worker, 0, m_iNumBlocks);
+
+    QCOMPARE(m_lastStdErr.nave, m_iNumAverages);
+    QCOMPARE(m_lastStdErr.aspect_kind, FIFFV_ASPECT_STD_ERR);
+    QVERIFY((m_lastStdErr.data - batchStdErr(m_iNumBlocks - m_iNumAverages, m_iNumAverages)).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::compareCumulativeStdErrSwitchedOnLate()
+{
+    // No epochs are stored in cumulative mode, so the standard error has to cover the epochs seen before it was switched on
+    RtAveragingWorker worker(m_iNumAverages, m_iPreStimSamples, m_iPostStimSamples, 0, 0, m_pFiffInfo->nchan - 1, m_pFiffInfo);
+    worker.setAveragingMode(RtAveragingWorker::Cumulative);
+    connectWorker(worker);
+
+    feedBlocks(worker, 0, m_iNumBlocks / 2);
+    worker.setComputeStdErr(true);
+    feedBlocks(worker, m_iNumBlocks / 2, m_iNumBlocks - m_iNumBlocks / 2);
+
+    QCOMPARE(m_lastEvoked.nave, m_iNumBlocks);
+    QVERIFY((m_lastEvoked.data - batchMean(0, m_iNumBlocks)).cwiseAbs().maxCoeff() < dEpsilon);
+
+    QCOMPARE(m_lastStdErr.nave, m_iNumBlocks);
+    QVERIFY((m_lastStdErr.data - batchStdErr(0, m_iNumBlocks)).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtAveraging::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestRtAveraging)
+#include "test_rtaveraging.moc"
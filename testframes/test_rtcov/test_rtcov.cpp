@@ -0,0 +1,268 @@
+//=============================================================================================================
+/**
+ * @file     test_rtcov.cpp
+ * @author   Lorenz Esch <lesch@mgh.harvard.edu>
+ * @since    0.1.8
+ * @date     December, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, Lorenz Esch. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test the RtCov estimation modes against a batch covariance
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/applicationlogger.h>
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_constants.h>
+#include <rtprocessing/rtcov.h>
+
+#include <cmath>
+#include <random>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestRtCov
+ *
+ * @brief The TestRtCov class compares the RtCov estimation modes with a batch covariance
+ *
+ */
+class TestRtCov: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtCov();
+
+private slots:
+    void initTestCase();
+    void compareBlock();
+    void compareBlockRestart();
+    void compareSlidingWindow();
+    void compareExponentiallyWeighted();
+    void cleanupTestCase();
+
+private:
+    FiffCov runRtCov(RtCov::EstimationMode mode,
+                     int iWindow,
+                     int iUpdateInterval,
+                     int iNumSamples);
+
+    MatrixXd weightedCovariance(const MatrixXd& matData,
+                                const VectorXd& vecWeights) const;
+
+    double dEpsilon;
+
+    int m_iBlockSize;
+
+    QSharedPointer<FiffInfo> m_pFiffInfo;
+    MatrixXd m_matData;
+};
+
+//=============================================================================================================
+
+TestRtCov::TestRtCov()
+: dEpsilon(0.000001)
+, m_iBlockSize(100)
+{
+}
+
+//=============================================================================================================
+
+void TestRtCov::initTestCase()
+{
+    qInstallMessageHandler(UTILSLIB::ApplicationLogger::customLogWriter);
+
+    const int iNumChannels = 8;
+    const int iNumSamples = 3000;
+
+    // EEG channels without projectors, so a zero regularization leaves the covariance untouched
+    m_pFiffInfo = QSharedPointer<FiffInfo>::create();
+    for(int i = 0; i < iNumChannels; ++i) {
+        FiffChInfo chInfo;
+        chInfo.kind = FIFFV_EEG_CH;
+        chInfo.ch_name = QString("EEG %1").arg(i + 1, 3, 10, QChar('0'));
+        m_pFiffInfo->chs.append(chInfo);
+        m_pFiffInfo->ch_names.append(chInfo.ch_name);
+    }
+    m_pFiffInfo->nchan = iNumChannels;
+    m_pFiffInfo->sfreq = 1000.0;
+
+    // Correlated channels with an offset, so the mean has to be removed
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    MatrixXd matMixing = MatrixXd::NullaryExpr(iNumChannels, iNumChannels, [&]() { return normal(generator); });
+    MatrixXd matSources = MatrixXd::NullaryExpr(iNumChannels, iNumSamples, [&]() { return normal(generator); });
+
+    m_matData = matMixing * matSources;
+    m_matData.colwise() += VectorXd::LinSpaced(iNumChannels, 1.0, 5.0);
+}
+
+//=============================================================================================================
+
+FiffCov TestRtCov::runRtCov(RtCov::EstimationMode mode,
+                            int iWindow,
+                            int iUpdateInterval,
+                            int iNumSamples)
+{
+    RtCov rtCov(m_pFiffInfo);
+    rtCov.setEstimationMode(mode);
+    rtCov.setUpdateInterval(iUpdateInterval);
+    rtCov.setRegularization(0.0, 0.0, 0.0);
+
+    FiffCov lastCov;
+
+    for(int i = 0; i + m_iBlockSize <= iNumSamples; i += m_iBlockSize) {
+        FiffCov fiffCov = rtCov.estimateCovariance(m_matData.middleCols(i, m_iBlockSize), iWindow);
+        if(!fiffCov.names.isEmpty()) {
+            lastCov = fiffCov;
+        }
+    }
+
+    return lastCov;
+}
+
+//=============================================================================================================
+
+MatrixXd TestRtCov::weightedCovariance(const MatrixXd& matData,
+                                       const VectorXd& vecWeights) const
+{
+    double dWeight = vecWeights.sum();
+    double dNorm = dWeight - vecWeights.squaredNorm() / dWeight;
+
+    VectorXd vecMean = matData * vecWeights / dWeight;
+    MatrixXd matCentered = matData.colwise() - vecMean;
+
+    return matCentered * vecWeights.asDiagonal() * matCentered.transpose() / dNorm;
+}
+
+//=============================================================================================================
+
+void TestRtCov::compareBlock()
+{
+    const int iWindow = 1000;
+
+    FiffCov fiffCov = runRtCov(RtCov::Block, iWindow, 0, iWindow);
+    QVERIFY(!fiffCov.names.isEmpty());
+
+    MatrixXd matBatch = weightedCovariance(m_matData.leftCols(iWindow), VectorXd::Ones(iWindow));
+
+    QCOMPARE(fiffCov.nfree, iWindow - 1);
+    QVERIFY((fiffCov.data - matBatch).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtCov::compareBlockRestart()
+{
+    // The block mode starts over after each estimate, so the last estimate only covers the last window
+    const int iWindow = 1000;
+
+    FiffCov fiffCov = runRtCov(RtCov::Block, iWindow, 0, 3 * iWindow);
+    QVERIFY(!fiffCov.names.isEmpty());
+
+    MatrixXd matBatch = weightedCovariance(m_matData.middleCols(2 * iWindow, iWindow), VectorXd::Ones(iWindow));
+
+    QVERIFY((fiffCov.data - matBatch).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtCov::compareSlidingWindow()
+{
+    const int iWindow = 1000;
+    const int iNumSamples = m_matData.cols();
+
+    FiffCov fiffCov = runRtCov(RtCov::SlidingWindow, iWindow, m_iBlockSize, iNumSamples);
+    QVERIFY(!fiffCov.names.isEmpty());
+
+    MatrixXd matBatch = weightedCovariance(m_matData.rightCols(iWindow), VectorXd::Ones(iWindow));
+
+    QCOMPARE(fiffCov.nfree, iWindow - 1);
+    QVERIFY((fiffCov.data - matBatch).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtCov::compareExponentiallyWeighted()
+{
+    const int iWindow = 1000;
+    const int iNumSamples = m_matData.cols();
+
+    FiffCov fiffCov = runRtCov(RtCov::ExponentiallyWeighted, iWindow, m_iBlockSize, iNumSamples);
+    QVERIFY(!fiffCov.names.isEmpty());
+
+    // The decay is applied once per block, so all samples of a block share the same weight
+    double dDecay = 1.0 - 1.0 / iWindow;
+    int iNumBlocks = iNumSamples / m_iBlockSize;
+
+    VectorXd vecWeights(iNumSamples);
+    for(int b = 0; b < iNumBlocks; ++b) {
+        vecWeights.segment(b * m_iBlockSize, m_iBlockSize).setConstant(std::pow(dDecay, static_cast<double>((iNumBlocks - 1 - b) * m_iBlockSize)));
+    }
+
+    MatrixXd matBatch = weightedCovariance(m_matData, vecWeights);
+
+    QVERIFY((fiffCov.data - matBatch).cwiseAbs().maxCoeff() < dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestRtCov::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestRtCov)
+#include "test_rtcov.moc"
@@ -50,8 +50,13 @@
 #include <connectivity/metrics/weightedphaselagindex.h>
 #include <connectivity/metrics/debiasedsquaredweightedphaselagindex.h>
 #include <connectivity/metrics/crosscorrelation.h>
+#include <connectivity/metrics/crossspectraldensity.h>
+#include <connectivity/connectivity.h>
 #include <connectivity/connectivitysettings.h>
 #include <connectivity/network/network.h>
+#include <connectivity/network/networknode.h>
+#include <connectivity/network/networkedge.h>
+#include <connectivity/network/networkadjacency.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -97,6 +102,8 @@ private slots:
     void spectralConnectivityCoherence();
     void spectralConnectivityImagCoherence();
     void spectralConnectivityXCOR();
+    void spectralConnectivityPackedCsd();
+    void compactNetwork();
     void cleanupTestCase();
 
 private:
@@ -348,6 +355,190 @@ void TestSpectralConnectivity::spectralConnectivityXCOR()
 
 //=============================================================================================================
 
+void TestSpectralConnectivity::spectralConnectivityPackedCsd()
+{
+    //*********************************************************************************************************
+    // Compare the tiled CSD kernel to the CSDs computed pair by pair. Use enough channels to span several tiles.
+    //*********************************************************************************************************
+
+    int iNRows = 70;
+    int iNTapers = 3;
+    int iNFreqs = 65;
+    int iBinStart = 4;
+    int iBinAmount = 50;
+    double dDenom = 1.5;
+
+    QVector<MatrixXcd> vecTapSpectra;
+    for(int i = 0; i < iNRows; ++i) {
+        vecTapSpectra.append(MatrixXcd::Random(iNTapers, iNFreqs));
+    }
+
+    MatrixXcd matSpectra, matCsd;
+    CrossSpectralDensity::packSpectra(vecTapSpectra, iBinStart, iBinAmount, matSpectra);
+    CrossSpectralDensity::compute(matSpectra, iNRows, dDenom, matCsd);
+
+    QCOMPARE(matCsd.cols(), CrossSpectralDensity::getNumberOfPairs(iNRows));
+
+    double dMaxError = 0.0;
+    RowVectorXcd vecRefCsd;
+
+    for(int i = 0; i < iNRows; ++i) {
+        for(int j = i; j < iNRows; ++j) {
+            vecRefCsd = vecTapSpectra.at(i).middleCols(iBinStart, iBinAmount).cwiseProduct(vecTapSpectra.at(j).middleCols(iBinStart, iBinAmount).conjugate()).colwise().sum() / dDenom;
+            dMaxError = std::max(dMaxError, (vecRefCsd.transpose() - matCsd.col(CrossSpectralDensity::getPairIndex(i, j, iNRows))).cwiseAbs().maxCoeff());
+        }
+    }
+
+    QVERIFY(dMaxError < dEpsilon);
+
+    //*********************************************************************************************************
+    // The row ranges, which are accumulated in parallel, cover the packed columns of the full computation
+    //*********************************************************************************************************
+
+    MatrixXcd matCsdRows;
+    int iPairStart = 0;
+
+    for(int iRowStart = 0; iRowStart < iNRows; iRowStart += 9) {
+        CrossSpectralDensity::computeRows(matSpectra, iNRows, iRowStart, iRowStart + 9, dDenom, matCsdRows);
+
+        QCOMPARE(CrossSpectralDensity::getPairIndex(iRowStart, iRowStart, iNRows), iPairStart);
+        QVERIFY((matCsdRows - matCsd.middleCols(iPairStart, matCsdRows.cols())).cwiseAbs().maxCoeff() < dEpsilon);
+
+        iPairStart += matCsdRows.cols();
+    }
+
+    QCOMPARE(iPairStart, matCsd.cols());
+
+    //*********************************************************************************************************
+    // Compare the metrics computed together from the shared sums to the metrics computed one by one
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList;
+    for(int i = 0; i < m_connectivitySettings.size(); ++i) {
+        MatrixXd matData(iNRows, m_connectivitySettings.at(i).matData.cols());
+        matData.topRows(2) = m_connectivitySettings.at(i).matData;
+        matData.bottomRows(iNRows - 2) = MatrixXd::Random(iNRows - 2, matData.cols());
+        matDataList.append(matData);
+    }
+
+    ConnectivitySettings connectivitySettings;
+    connectivitySettings.setFFTSize(matDataList.at(0).cols());
+    connectivitySettings.setWindowType("hanning");
+    connectivitySettings.append(matDataList);
+    connectivitySettings.setConnectivityMethods(QStringList() << "COH" << "PLV" << "PLI" << "WPLI" << "DSWPLI");
+
+    QList<Network> lNetworks = Connectivity::calculate(connectivitySettings);
+    QCOMPARE(lNetworks.size(), 5);
+
+    for(int i = 0; i < lNetworks.size(); ++i) {
+        Network network;
+        QString sMethod = lNetworks.at(i).getConnectivityMethod();
+
+        if(sMethod == "COH") {
+            network = Coherence::calculate(connectivitySettings);
+        } else if(sMethod == "PLV") {
+            network = PhaseLockingValue::calculate(connectivitySettings);
+        } else if(sMethod == "PLI") {
+            network = PhaseLagIndex::calculate(connectivitySettings);
+        } else if(sMethod == "WPLI") {
+            network = WeightedPhaseLagIndex::calculate(connectivitySettings);
+        } else {
+            network = DebiasedSquaredWeightedPhaseLagIndex::calculate(connectivitySettings);
+        }
+
+        QVERIFY((lNetworks.at(i).getFullConnectivityMatrix() - network.getFullConnectivityMatrix()).cwiseAbs().maxCoeff() < dEpsilon);
+        QVERIFY(network.isCompact());
+    }
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::compactNetwork()
+{
+    //*********************************************************************************************************
+    // Create a network with edge objects and compare it to its compact version
+    //*********************************************************************************************************
+
+    int iNumberNodes = 40;
+    int iNumberBins = 20;
+
+    Network network("COH");
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        network.append(NetworkNode::SPtr(new NetworkNode(i, RowVectorXf::Random(3))));
+    }
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        for(int j = i + 1; j < iNumberNodes; ++j) {
+            NetworkEdge::SPtr pEdge = NetworkEdge::SPtr(new NetworkEdge(i, j, MatrixXd::Random(iNumberBins, 1)));
+
+            network.getNodeAt(i)->append(pEdge);
+            network.getNodeAt(j)->append(pEdge);
+            network.append(pEdge);
+        }
+    }
+
+    Network compactNetwork = network;
+    compactNetwork.compact();
+
+    QVERIFY(compactNetwork.isCompact());
+    QCOMPARE(compactNetwork.getAdjacency().getNumberEdges(), network.getFullEdges().size());
+    QVERIFY((compactNetwork.getFullConnectivityMatrix() - network.getFullConnectivityMatrix()).cwiseAbs().maxCoeff() < dEpsilon);
+
+    //*********************************************************************************************************
+    // Compare thresholding and degrees
+    //*********************************************************************************************************
+
+    network.setThreshold(0.2);
+    compactNetwork.setThreshold(0.2);
+
+    QVERIFY((compactNetwork.getThresholdedConnectivityMatrix() - network.getThresholdedConnectivityMatrix()).cwiseAbs().maxCoeff() < dEpsilon);
+    QCOMPARE(compactNetwork.getThresholdedEdges().size(), network.getThresholdedEdges().size());
+    QCOMPARE(compactNetwork.getThresholdedDistribution(), network.getThresholdedDistribution());
+    QVERIFY(compactNetwork.getThresholdedDegrees() == network.getThresholdedDegrees());
+
+    //*********************************************************************************************************
+    // The nodes of the compact network hold the same edges
+    //*********************************************************************************************************
+
+    QCOMPARE(compactNetwork.getNodes().size(), network.getNodes().size());
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        QCOMPARE(compactNetwork.getNodeAt(i)->getFullDegree(), network.getNodeAt(i)->getFullDegree());
+        QCOMPARE(compactNetwork.getNodeAt(i)->getThresholdedOutdegree(), network.getNodeAt(i)->getThresholdedOutdegree());
+        QCOMPARE(compactNetwork.getNodeAt(i)->getThresholdedIndegree(), network.getNodeAt(i)->getThresholdedIndegree());
+    }
+
+    //*********************************************************************************************************
+    // The weight range of a compact network set from an adjacency uses absolute weights
+    //*********************************************************************************************************
+
+    NetworkAdjacency adjacency(iNumberNodes, 1);
+    VectorXd vecWeight(1);
+
+    vecWeight(0) = -0.8;
+    adjacency.appendEdge(0, 1, vecWeight);
+    vecWeight(0) = 0.4;
+    adjacency.appendEdge(1, 2, vecWeight);
+    adjacency.finalize();
+
+    Network adjacencyNetwork("COR");
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        adjacencyNetwork.append(NetworkNode::SPtr(new NetworkNode(i, RowVectorXf::Random(3))));
+    }
+
+    adjacencyNetwork.setAdjacency(adjacency);
+
+    QVERIFY(adjacencyNetwork.isCompact());
+    QVERIFY(std::fabs(adjacencyNetwork.getMinMaxFullWeights().first - 0.4) < dEpsilon);
+    QVERIFY(std::fabs(adjacencyNetwork.getMinMaxFullWeights().second - 0.8) < dEpsilon);
+    QCOMPARE(adjacencyNetwork.getFullDistribution(), 4);
+    QCOMPARE(adjacencyNetwork.getNodeAt(1)->getFullDegree(), qint16(2));
+}
+
+//=============================================================================================================
+
 QList<MatrixXd> TestSpectralConnectivity::readConnectivityData()
 {
     MatrixXd inputTrials;
@@ -56,8 +56,14 @@ SUBDIRS += \
     test_mne_forward_solution \
     test_fiff_cov \
     test_fiff_digitizer \
+    test_ftconnector \
+    test_fiff_stream_server \
     test_mne_msh_display_surface_set \
-    test_mne_project_to_surface
+    test_mne_project_to_surface \
+    test_minimum_norm \
+    test_rap_music \
+    test_rtaveraging \
+    test_rtcov
 
     qtHaveModule(charts) {
         SUBDIRS += \
@@ -65,4 +71,10 @@ SUBDIRS += \
             test_geometryinfo \
             test_spectral_connectivity \
             test_mne_anonymize
+
+        # Links the mne_scan libraries, which are built with the applications
+        !contains(MNECPP_CONFIG, noApplications) {
+            SUBDIRS += \
+                test_plugin_connector_edge
+        }
     }